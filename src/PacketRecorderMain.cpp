@@ -0,0 +1,126 @@
+#include "PacketCaptureFile.h"
+#include "UdpBatchReceiver.h"
+
+#include <QtCore/QString>
+#include <QtNetwork/QHostAddress>
+#include <boost/program_options.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Records the UDP packets arriving on a port to a capture file, to be
+// replayed into a chunker with <replay file="..."/> (see PacketCaptureDevice).
+
+using namespace pelican::ampp;
+
+static volatile bool halt = false;
+
+static void stopRecording(int)
+{
+    halt = true;
+}
+
+int main(int argc, char** argv)
+{
+    namespace po = boost::program_options;
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "Produce help message.")
+        ("port,p", po::value<unsigned>(), "UDP port to record.")
+        ("host", po::value<std::string>()->default_value(""), "Address to bind to (default any).")
+        ("output,o", po::value<std::string>(), "Capture file to write.")
+        ("snap,s", po::value<unsigned>()->default_value(9000), "Maximum bytes kept per packet.")
+        ("count,n", po::value<unsigned long>()->default_value(0), "Stop after this many packets (0 for no limit).")
+        ("seconds,t", po::value<double>()->default_value(0.0), "Stop after this many seconds (0 for no limit).")
+        ("batch", po::value<unsigned>()->default_value(64), "Packets read per system call.")
+        ("receiveBuffer", po::value<int>()->default_value(67108864), "Socket receive buffer in bytes.");
+
+    po::variables_map varMap;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), varMap);
+        po::notify(varMap);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    if (varMap.count("help") || !varMap.count("port") || !varMap.count("output")) {
+        std::cout << "Usage: packetRecorder --port <port> --output <file>" << std::endl
+                  << desc << std::endl;
+        return varMap.count("help") ? 0 : 1;
+    }
+
+    unsigned port = varMap["port"].as<unsigned>();
+    QString host = QString::fromStdString(varMap["host"].as<std::string>());
+    QString fileName = QString::fromStdString(varMap["output"].as<std::string>());
+    unsigned snap = varMap["snap"].as<unsigned>();
+    unsigned long maxPackets = varMap["count"].as<unsigned long>();
+    double seconds = varMap["seconds"].as<double>();
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::cerr << "Error: unable to create socket: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    UdpBatchReceiver::setReceiveBufferSize(fd, varMap["receiveBuffer"].as<int>());
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    QHostAddress hostAddress(host);
+    address.sin_addr.s_addr = (host.isEmpty() || hostAddress.isNull())
+                              ? htonl(INADDR_ANY) : htonl(hostAddress.toIPv4Address());
+    if (::bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        std::cerr << "Error: unable to bind to port " << port << ": "
+                  << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    PacketCaptureWriter writer;
+    if (!writer.open(fileName, snap)) {
+        std::cerr << "Error: unable to create " << fileName.toStdString() << std::endl;
+        return 1;
+    }
+
+    UdpBatchReceiver receiver(varMap["batch"].as<unsigned>());
+    receiver.addSegment(snap, true);
+    std::vector<char> buffer((size_t)receiver.maxBatch() * snap);
+
+    signal(SIGINT, stopRecording);
+    signal(SIGTERM, stopRecording);
+    std::cout << "Recording port " << port << " to " << fileName.toStdString()
+              << " (Ctrl-C to stop)" << std::endl;
+
+    quint64 start = PacketCaptureFile::now();
+    quint64 end = seconds > 0.0 ? start + (quint64)(seconds * 1.0e9) : 0;
+    while (!halt) {
+        unsigned n = receiver.maxBatch();
+        if (maxPackets && maxPackets - writer.packets() < n)
+            n = maxPackets - writer.packets();
+        int received = receiver.receive(fd, &buffer[0], n, 100);
+        // The packets of one batch share the time it was returned.
+        quint64 now = PacketCaptureFile::now();
+        for (int i = 0; i < received; ++i) {
+            if (!writer.write(&buffer[(size_t)i * snap], receiver.length(i), now)) {
+                std::cerr << "Error: unable to write " << fileName.toStdString() << std::endl;
+                halt = true;
+                break;
+            }
+        }
+        if ((maxPackets && writer.packets() >= maxPackets) || (end && now >= end))
+            break;
+    }
+    writer.close();
+    ::close(fd);
+    std::cout << "Recorded " << writer.packets() << " packets in "
+              << (PacketCaptureFile::now() - start) * 1.0e-9 << " s" << std::endl;
+    return 0;
+}
@@ -2,6 +2,10 @@
 #define ABCHUNKER_H
 
 #include "pelican/server/AbstractChunker.h"
+#include "UdpBatchReceiver.h"
+#include "PacketCaptureDevice.h"
+#include "Metrics.h"
+#include <vector>
 
 namespace pelican {
 namespace ampp {
@@ -23,6 +27,12 @@ class ABChunker : public AbstractChunker
 
         // Obtains a chunk of data from the device when data is available.
         virtual void next(QIODevice*);
+
+    private:
+        // Returns the next received packet and its length, receiving a new
+        // batch from the socket when required (0 if the chunker stopped).
+        const char* nextPacket(QIODevice* device, unsigned int& length);
+
     private:
         unsigned long int _chunksProced;
         unsigned int _chunkSize;
@@ -44,6 +54,14 @@ class ABChunker : public AbstractChunker
         char *_pktSaved;
         unsigned int _x;
         unsigned int _y;
+        unsigned int _receiveBufferSize;
+        UdpBatchReceiver _receiver;
+        PacketCaptureDevice::Config _capture;
+        ChunkerMetrics _metrics;
+        std::vector<char> _batch;
+        std::vector<unsigned int> _lengths;
+        unsigned int _batchCount;
+        unsigned int _batchNext;
 };
 
 PELICAN_DECLARE_CHUNKER(ABChunker)
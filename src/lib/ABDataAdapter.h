@@ -2,7 +2,9 @@
 #define ABDATAADAPTER_H
 
 #include "pelican/core/AbstractStreamAdapter.h"
+#include "ChannelKernels.h"
 #include "timer.h"
+#include <vector>
 
 namespace pelican {
 namespace ampp {
@@ -24,6 +26,10 @@ class ABDataAdapter : public AbstractStreamAdapter
 
         static TimerData _adapterTime;
 
+    private:
+        // Unpack the 48 bit big-endian integration counters of all packets.
+        void _unpackCounters(const char* chunk, unsigned packets);
+
     private:
         static const unsigned _headerSize = 8;
         static const unsigned _footerSize = 8;
@@ -46,6 +52,12 @@ class ABDataAdapter : public AbstractStreamAdapter
         double _lastTimestamp;
         unsigned int _timestampFirst;
         unsigned int _x;
+
+        std::vector<char> _chunkBuffer;
+        std::vector<unsigned long int> _integCounts;
+        std::vector<unsigned> _blockPackets;
+        ABPowerKernel<RuntimeChannels>::Function _decodePower;
+        ABProductsKernel<RuntimeChannels>::Function _decodeProducts;
 };
 
 PELICAN_DECLARE_ADAPTER(ABDataAdapter)
@@ -5,6 +5,7 @@
 #include "LofarUdpHeader.h"
 #include "LofarTypes.h"
 #include <complex>
+#include <vector>
 
 #include "timer.h"
 
@@ -43,7 +44,7 @@ class TimeSeriesDataSetC32;
  *
  * - @b samplesPerPacket: Number of (time) samples per packet.
  * - @b fixedSizePackets: Specify if UDP packets are fixed size or not.
- * - @b sampleSize: Number of bits per sample. (Samples are assumed to be complex pairs of the number of bits specified).
+ * - @b sampleSize: Number of bits per sample, 4, 8 or 16. (Samples are assumed to be complex pairs of the number of bits specified).
  * - @b packetsPerChunk: Number of UDP packets in each input data chunk.
  * - @b samplesPerTimeBlock: Number of time samples to put in a block.
  * - @b subbands: Number of sub-bands per packet.
@@ -58,6 +59,10 @@ class AdapterTimeSeriesDataSet : public AbstractStreamAdapter
         typedef float Real;
         typedef std::complex<Real> Complex;
 
+        /// Unpacks the samples of one packet into the time series.
+        typedef void (*UnpackFunction)(const char*, Complex*, unsigned,
+                unsigned, unsigned, unsigned long);
+
     public:
         /// Constructor
         AdapterTimeSeriesDataSet(const ConfigNode& config);
@@ -73,21 +78,22 @@ class AdapterTimeSeriesDataSet : public AbstractStreamAdapter
         void _checkData();
 
         /// Read the udp packet header from a buffer read from the IO device.
-        void _readHeader(char* buffer, UDPPacket::Header& header);
+        void _readHeader(const char* buffer, UDPPacket::Header& header);
 
         /// Reads the udp data data section into the data blob data array.
-        void _readData(unsigned packet, char* buffer,
+        void _readData(unsigned packet, const char* buffer,
                 TimeSeriesDataSetC32* data);
 
+        /// Unpack and transpose one packet of samples decoded by @p Sample,
+        /// for @p NPOL polarisations (0 if only known at run time).
+        template<class Sample, unsigned NPOL>
+        static void _unpack(const char* buffer, Complex* times,
+                unsigned nSubbands, unsigned nPolarisations,
+                unsigned nSamples, unsigned long nTimes);
+
         /// Prints the header to standard out (for debugging).
         void _printHeader(const UDPPacket::Header& header);
 
-        /// Converts a i8Complex to std::complex float.
-        Complex _makeComplex(const TYPES::i8complex& z);
-
-        /// Converts a i8Complex to std::complex float.
-        Complex _makeComplex(const TYPES::i16complex& z);
-
     private:
         /// Constructs an error message with the class name.
         QString _err(const QString& message);
@@ -109,9 +115,8 @@ class AdapterTimeSeriesDataSet : public AbstractStreamAdapter
         size_t _packetDataSize;
         size_t _dataSize;
         size_t _paddingSize;
-        std::vector<char> _headerTemp;
-        std::vector<char> _dataTemp;
-        std::vector<char> _paddingTemp;
+        std::vector<char> _chunkBuffer;
+        UnpackFunction _unpackPacket;
 
      public:
         static TimerData adapterTime;
@@ -16,6 +16,7 @@ namespace pelican {
 namespace ampp {
 class GPU_Job;
 class GPU_Manager;
+class WorkerPool;
 
 /**
  * @class AsyncronousModule
@@ -23,7 +24,16 @@ class GPU_Manager;
  * @brief
  *     Base class for Asyncronous Pelican Modules
  * @details
- * 
+ *     The tasks attached with connect() run on a pool of the module's own,
+ *     at low priority, so that slow consumers of the exported data (e.g.
+ *     candidate analysis and output) neither take threads from the
+ *     QtConcurrent pool nor compete with the data path:
+ *     @verbatim
+ *        <exportPool threads="1" queueDepth="16" priority="low"/>
+ *     @endverbatim
+ *     threads="0" runs them on the QtConcurrent pool instead. Exporting
+ *     blocks while the queue is full. The pool's queue depth and task
+ *     times are in the metrics as "<module>.exportPool.*".
  */
 
 class AsyncronousModule : public AbstractModule
@@ -49,8 +59,12 @@ class AsyncronousModule : public AbstractModule
         /// return the number of locks for the specified object
         int lockNumber( const DataBlob* ) const;
 
-        /// block the thread until all asyncronous jobs have completed
-        void waitForJobCompletion() const;
+        /// block the thread until all asyncronous jobs have completed,
+        /// returning false if they have not within timeout ms
+        bool waitForJobCompletion( unsigned long timeout = ULONG_MAX ) const;
+
+        /// the number of exported DataBlobs whose tasks are still running
+        int tasksPending() const;
 
     protected:
         /// queue a GPU_Job for submission
@@ -110,6 +124,7 @@ class AsyncronousModule : public AbstractModule
 
     private:
         ProcessingChain1<DataBlob*>* _chain;
+        WorkerPool* _exportPool;
 
     protected:
         mutable QMutex lockerMutex;
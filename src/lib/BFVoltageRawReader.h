@@ -0,0 +1,60 @@
+#ifndef BFVOLTAGERAWREADER_H
+#define BFVOLTAGERAWREADER_H
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QList>
+
+/**
+ * @file BFVoltageRawReader.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+class SpectrumDataSetC32;
+
+/**
+ * @class BFVoltageRawReader
+ *
+ * @brief
+ *    Reads back the raw 32 bit voltage files written by H5_LofarBFVoltageWriter.
+ *
+ * @details
+ *    The writer produces one file per polarisation component (Xr, Xi, Yr, Yi),
+ *    each holding floats ordered by time block, sub-band then channel. This
+ *    class reassembles them into SpectrumDataSetC32 blobs so buffered voltages
+ *    can be reprocessed offline (e.g. with the PPFInverter).
+ *
+ * @code
+ *    BFVoltageRawReader reader(files, nSubbands, nChannels);
+ *    SpectrumDataSetC32 spectra;
+ *    while (reader.read(&spectra, 256)) inverter.run(&spectra, &timeSeries);
+ * @endcode
+ */
+class BFVoltageRawReader
+{
+    public:
+        /// Open the component files (in the order Xr, Xi, Yr, Yi).
+        BFVoltageRawReader(const QStringList& files, unsigned nSubbands,
+                unsigned nChannels);
+        ~BFVoltageRawReader();
+
+        /// Read up to nTimeBlocks spectra. Returns the number of blocks read.
+        unsigned read(SpectrumDataSetC32* data, unsigned nTimeBlocks);
+
+        /// Set the timestamp of the first block and the time per block.
+        void setTiming(double startTimestamp, double blockRate);
+
+    private:
+        QList<QFile*> _files;
+        unsigned _nSubbands;
+        unsigned _nChannels;
+        double _timestamp;
+        double _blockRate;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // BFVOLTAGERAWREADER_H
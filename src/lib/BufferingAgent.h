@@ -3,11 +3,13 @@
 
 
 #include "pelican/core/AbstractDataClient.h"
-#include "LockingContainer.hpp"
+#include "pelican/utility/FactoryGeneric.h"
+#include "Metrics.h"
 #include <QList>
+#include <QMutex>
 #include <QThread>
+#include <QWaitCondition>
 #include <boost/function.hpp>
-#include <deque>
 
 /**
  * @file BufferingAgent.h
@@ -23,31 +25,75 @@ namespace ampp {
  * @brief
  *    A dedicated thread for buffering data 
  * @details
- * 
+ *    Keeps up to depth() sets of DataBlobs filled ahead by the fetch
+ *    function (a data client's getData()), so that receiving the next
+ *    chunk overlaps the pipeline working on this one.
+ *
+ *    Each set (slot) has its own DataBlobs, created on the first
+ *    getData() call with the types of the blobs in the hash passed in.
+ *    getData() hands a filled slot over by returning its hash (the blobs
+ *    are not copied); the slot goes back to be refilled on the next
+ *    getData() call, once the pipeline is done with it. getData() only
+ *    waits when nothing has been prefetched.
+ *
+ *    An error thrown by the fetch function is rethrown (as a QString, for
+ *    a std::exception or anything else too) by the getData() call that
+ *    would have returned that data.
+ *
+ *    Telemetry, for an agent "A": the counters "A.hits" (data was
+ *    ready) and "A.misses" (getData() had to wait), the histogram
+ *    "A.wait" of those waits and the gauge "A.prefetched".
  */
 
 class BufferingAgent : public QThread
 {
     public:
         typedef pelican::AbstractDataClient::DataBlobHash DataBlobHash;
-        typedef boost::function1<void, DataBlobHash&> DataFetchFunction;
+        typedef boost::function1<DataBlobHash, DataBlobHash&> DataFetchFunction;
 
     public:
-        BufferingAgent( const DataFetchFunction& fn );
+        BufferingAgent( const DataFetchFunction& fn, unsigned int depth = 3,
+                        const QString& name = "BufferingAgent" );
         ~BufferingAgent();
 
         void run();
         void stop();
 
-        void getData(DataBlobHash& hash);
+        /// the next prefetched data (see above)
+        DataBlobHash getData(DataBlobHash& hash);
+
+        /// the number of sets of data fetched ahead
+        unsigned int depth() const { return _depth; }
+
+        unsigned long long hits() const { return _hits.value(); }
+        unsigned long long misses() const { return _misses.value(); }
 
     private:
-        unsigned int _max_queue_length;
+        struct Slot {
+            DataBlobHash blobs; // to be filled
+            DataBlobHash valid; // as returned by the fetch function
+            QString error;
+        };
+        void _createSlots( const DataBlobHash& hash );
+
+    private:
+        unsigned int _depth;
         bool _halt;
         DataFetchFunction _fn;
-        std::deque<DataBlobHash*> _queue; // objects ready for serving
-        QList<DataBlobHash> _buffer_objects;
-        LockingContainer<DataBlobHash> _buffer;
+        FactoryGeneric<DataBlob> _blobFactory; // owns the slot blobs
+        QList<Slot*> _slots;
+        QList<Slot*> _free;   // waiting to be filled
+        QList<Slot*> _filled; // ready for serving, oldest first
+        Slot* _served;        // in use by the pipeline
+        QMutex _mutex;
+        QWaitCondition _freed;
+        QWaitCondition _ready;
+
+        // Telemetry.
+        MetricCounter& _hits;
+        MetricCounter& _misses;
+        MetricHistogram& _wait;
+        MetricGauge& _prefetched;
 };
 
 } // namespace ampp
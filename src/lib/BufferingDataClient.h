@@ -13,7 +13,14 @@ namespace ampp {
  *  
  * @brief
  *     Wraps another DataClient in the background, running it in its own thread
- * 
+ * @details
+ *     The wrapped client's getData() runs in a BufferingAgent thread,
+ *     fetching up to depth chunks ahead of the pipeline:
+ *     @verbatim
+ *        <prefetch depth="3"/>
+ *     @endverbatim
+ *     Prefetch hits and misses are in the metrics as
+ *     "BufferingDataClient.hits" and ".misses".
  */
 
 template<class DataClientType>
@@ -27,12 +34,11 @@ class BufferingDataClient : public DataClientType
         virtual pelican::AbstractDataClient::DataBlobHash getData(pelican::AbstractDataClient::DataBlobHash&);
 
     private:
-        // fn to execute the event loop
-        //void exec();
+        // the wrapped client's getData(), run by the agent
+        pelican::AbstractDataClient::DataBlobHash _fetch(pelican::AbstractDataClient::DataBlobHash&);
 
     private:
         BufferingAgent _agent;
-        //bool _halt;
 };
 
 } // namespace ampp
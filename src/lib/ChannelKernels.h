@@ -0,0 +1,460 @@
+#ifndef CHANNELKERNELS_H
+#define CHANNELKERNELS_H
+
+#include <complex>
+
+/**
+ * @file ChannelKernels.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class FixedChannels
+ *
+ * @brief
+ *    Channel count policy with the number of channels known at compile time.
+ * @details
+ *    The runtime argument is ignored so that the inner loop bound becomes a
+ *    constant the compiler can unroll and vectorise.
+ */
+template<unsigned N>
+struct FixedChannels
+{
+    static inline unsigned count(unsigned) { return N; }
+};
+
+/**
+ * @class RuntimeChannels
+ *
+ * @brief
+ *    Generic fallback channel count policy.
+ */
+struct RuntimeChannels
+{
+    static inline unsigned count(unsigned n) { return n; }
+};
+
+/**
+ * @class ChannelKernels
+ *
+ * @brief
+ *    Registry of channel loop kernels specialised for the common channel counts.
+ *
+ * @details
+ *    Each kernel is a class template over a channel count policy exposing a
+ *    static run() method and a Function typedef for its signature. select()
+ *    returns the instantiation matching the requested channel count, or the
+ *    RuntimeChannels version if the count is not one we instantiate for.
+ *    The lookup is a switch, so callers should select once per run() and
+ *    call the returned pointer in their loops.
+ *
+ * @code
+ *    StokesKernel<RuntimeChannels>::Function detect =
+ *              ChannelKernels::select<StokesKernel>(nChannels);
+ * @endcode
+ */
+class ChannelKernels
+{
+    public:
+        template<template<class> class Kernel>
+        static typename Kernel<RuntimeChannels>::Function select(unsigned nChannels)
+        {
+            switch( nChannels ) {
+                case 32:   return &Kernel<FixedChannels<32> >::run;
+                case 64:   return &Kernel<FixedChannels<64> >::run;
+                case 128:  return &Kernel<FixedChannels<128> >::run;
+                case 256:  return &Kernel<FixedChannels<256> >::run;
+                case 512:  return &Kernel<FixedChannels<512> >::run;
+                case 1024: return &Kernel<FixedChannels<1024> >::run;
+                default:   return &Kernel<RuntimeChannels>::run;
+            }
+        }
+
+        /// return true if a specialised kernel exists for nChannels
+        static bool isSpecialised(unsigned nChannels)
+        {
+            switch( nChannels ) {
+                case 32: case 64: case 128: case 256: case 512: case 1024:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+};
+
+// -----------------------------------------------------------------------------
+// Kernels
+//
+
+/**
+ * @details Form all four Stokes parameters from the X and Y polarisations
+ *          of one spectrum (StokesGenerator).
+ */
+template<class C>
+struct StokesKernel
+{
+    typedef void (*Function)(const std::complex<float>*, const std::complex<float>*,
+                             float*, float*, float*, float*, unsigned);
+
+    static void run(const std::complex<float>* dataPolX,
+                    const std::complex<float>* dataPolY,
+                    float* I, float* Q, float* U, float* V, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const float* x = reinterpret_cast<const float*>(dataPolX);
+        const float* y = reinterpret_cast<const float*>(dataPolY);
+        for (unsigned c = 0; c < n; ++c) {
+            float Xr = x[2*c], Xi = x[2*c+1];
+            float Yr = y[2*c], Yi = y[2*c+1];
+            float powerX = Xr*Xr + Xi*Xi;
+            float powerY = Yr*Yr + Yi*Yi;
+            I[c] = powerX + powerY;
+            Q[c] = powerX - powerY;
+            U[c] = 2.0f * (Xr*Yr + Xi*Yi);
+            V[c] = 2.0f * (Xi*Yr - Xr*Yi);
+        }
+    }
+};
+
+/**
+ * @details Form total power (Stokes-I) only from the X and Y polarisations
+ *          of one spectrum (StokesGenerator).
+ */
+template<class C>
+struct StokesIKernel
+{
+    typedef void (*Function)(const std::complex<float>*, const std::complex<float>*,
+                             float*, unsigned);
+
+    static void run(const std::complex<float>* dataPolX,
+                    const std::complex<float>* dataPolY,
+                    float* I, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const float* x = reinterpret_cast<const float*>(dataPolX);
+        const float* y = reinterpret_cast<const float*>(dataPolY);
+        for (unsigned c = 0; c < n; ++c) {
+            I[c] = x[2*c]*x[2*c] + x[2*c+1]*x[2*c+1]
+                 + y[2*c]*y[2*c] + y[2*c+1]*y[2*c+1];
+        }
+    }
+};
+
+/**
+ * @details As StokesKernel for a dual polarisation spectrum in the
+ *          SpectrumDataSetC32::PolarisationInterleaved layout (X and Y
+ *          adjacent for each channel).
+ */
+template<class C>
+struct InterleavedStokesKernel
+{
+    typedef void (*Function)(const std::complex<float>*,
+                             float*, float*, float*, float*, unsigned);
+
+    static void run(const std::complex<float>* dataPolXY,
+                    float* I, float* Q, float* U, float* V, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const float* xy = reinterpret_cast<const float*>(dataPolXY);
+        for (unsigned c = 0; c < n; ++c) {
+            float Xr = xy[4*c],   Xi = xy[4*c+1];
+            float Yr = xy[4*c+2], Yi = xy[4*c+3];
+            float powerX = Xr*Xr + Xi*Xi;
+            float powerY = Yr*Yr + Yi*Yi;
+            I[c] = powerX + powerY;
+            Q[c] = powerX - powerY;
+            U[c] = 2.0f * (Xr*Yr + Xi*Yi);
+            V[c] = 2.0f * (Xi*Yr - Xr*Yi);
+        }
+    }
+};
+
+/**
+ * @details As StokesIKernel for a dual polarisation spectrum in the
+ *          SpectrumDataSetC32::PolarisationInterleaved layout.
+ */
+template<class C>
+struct InterleavedStokesIKernel
+{
+    typedef void (*Function)(const std::complex<float>*, float*, unsigned);
+
+    static void run(const std::complex<float>* dataPolXY, float* I,
+                    unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const float* xy = reinterpret_cast<const float*>(dataPolXY);
+        for (unsigned c = 0; c < n; ++c) {
+            I[c] = xy[4*c]*xy[4*c] + xy[4*c+1]*xy[4*c+1]
+                 + xy[4*c+2]*xy[4*c+2] + xy[4*c+3]*xy[4*c+3];
+        }
+    }
+};
+
+/**
+ * @details Form the power of the X and Y polarisations separately for one
+ *          spectrum (EmbracePowerGenerator).
+ */
+template<class C>
+struct PowerKernel
+{
+    typedef void (*Function)(const std::complex<float>*, const std::complex<float>*,
+                             float*, float*, unsigned);
+
+    static void run(const std::complex<float>* dataPolX,
+                    const std::complex<float>* dataPolY,
+                    float* IX, float* IY, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const float* x = reinterpret_cast<const float*>(dataPolX);
+        const float* y = reinterpret_cast<const float*>(dataPolY);
+        for (unsigned c = 0; c < n; ++c) {
+            IX[c] = x[2*c]*x[2*c] + x[2*c+1]*x[2*c+1];
+            IY[c] = y[2*c]*y[2*c] + y[2*c+1]*y[2*c+1];
+        }
+    }
+};
+
+/**
+ * @details As PowerKernel for a dual polarisation spectrum in the
+ *          SpectrumDataSetC32::PolarisationInterleaved layout.
+ */
+template<class C>
+struct InterleavedPowerKernel
+{
+    typedef void (*Function)(const std::complex<float>*, float*, float*, unsigned);
+
+    static void run(const std::complex<float>* dataPolXY, float* IX, float* IY,
+                    unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const float* xy = reinterpret_cast<const float*>(dataPolXY);
+        for (unsigned c = 0; c < n; ++c) {
+            IX[c] = xy[4*c]*xy[4*c] + xy[4*c+1]*xy[4*c+1];
+            IY[c] = xy[4*c+2]*xy[4*c+2] + xy[4*c+3]*xy[4*c+3];
+        }
+    }
+};
+
+/**
+ * @details Accumulate one input spectrum of nChannels into an output spectrum
+ *          of nChannels/binChannels (StokesIntegrator).
+ */
+template<class C>
+struct IntegrateKernel
+{
+    typedef void (*Function)(const float*, float*, unsigned, unsigned);
+
+    static void run(const float* in, float* out, unsigned nChannels,
+                    unsigned binChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        if( binChannels == 1 ) {
+            for (unsigned c = 0; c < n; ++c)
+                out[c] += in[c];
+            return;
+        }
+        const unsigned newChannels = n / binChannels;
+        for (unsigned nc = 0; nc < newChannels; ++nc) {
+            const float* bin = in + nc * binChannels;
+            float sum = 0.0f;
+            for (unsigned c = 0; c < binChannels; ++c)
+                sum += bin[c];
+            out[nc] += sum;
+        }
+    }
+};
+
+/**
+ * @details Subtract a bandpass model from one spectrum into a
+ *          separate output (RFI_Clipper).
+ */
+template<class C>
+struct SubtractKernel
+{
+    typedef void (*Function)(const float*, const float*, float*, unsigned);
+
+    static void run(const float* in, const float* model, float* out,
+                    unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        for (unsigned c = 0; c < n; ++c)
+            out[c] = in[c] - model[c];
+    }
+};
+
+/**
+ * @details Scatter one spectrum into a channel-major buffer with the given
+ *          stride, optionally reversing the channel order (DedispersionBuffer).
+ */
+template<class C>
+struct TransposeKernel
+{
+    typedef void (*Function)(const float*, float*, unsigned, bool, unsigned);
+
+    static void run(const float* data, float* out, unsigned stride,
+                    bool invert, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        if( invert ) {
+            for (unsigned c = 0; c < n; ++c)
+                out[c * stride] = data[n - 1 - c];
+        }
+        else {
+            for (unsigned c = 0; c < n; ++c)
+                out[c * stride] = data[c];
+        }
+    }
+};
+
+/**
+ * @details As TransposeKernel, but replace the samples flagged by the RFI
+ *          clipper (weight 0) with values from the noise template, writing the
+ *          result back into the spectrum as well (DedispersionBuffer).
+ */
+template<class C>
+struct WeightedTransposeKernel
+{
+    typedef void (*Function)(float*, const float*, const float*, float*,
+                             unsigned, bool, unsigned);
+
+    static void run(float* data, const float* weights, const float* noise,
+                    float* out, unsigned stride, bool invert, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        for (unsigned c = 0; c < n; ++c) {
+            unsigned i = invert ? n - 1 - c : c;
+            unsigned o = c * stride;
+            data[i] = data[i] - (weights[i] - 1) * noise[o];
+            out[o] = data[i];
+        }
+    }
+};
+
+/**
+ * @details Apply the polyphase FIR filter to a ring buffer of nTaps blocks
+ *          of nChannels samples, the oldest block being at @p oldest
+ *          (PPFChanneliser).
+ */
+template<class C>
+struct FirKernel
+{
+    typedef void (*Function)(const std::complex<float>*, unsigned, unsigned,
+                             const float*, std::complex<float>*, unsigned);
+
+    static void run(const std::complex<float>* sampleBuffer, unsigned oldest,
+                    unsigned nTaps, const float* coeffs,
+                    std::complex<float>* filteredSamples, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        float* out = reinterpret_cast<float*>(filteredSamples);
+        for (unsigned c = 0; c < 2 * n; ++c)
+            out[c] = 0.0f;
+
+        for (unsigned t = 0; t < nTaps; ++t) {
+            const float* in = reinterpret_cast<const float*>(
+                    sampleBuffer + ((oldest + t) % nTaps) * n);
+            const float* coeff = coeffs + t * n;
+            for (unsigned c = 0; c < n; ++c) {
+                out[2*c]   += in[2*c]   * coeff[c];
+                out[2*c+1] += in[2*c+1] * coeff[c];
+            }
+        }
+    }
+};
+
+/**
+ * @details Sum the XX* and YY* products of one K7 spectrum (four
+ *          little-endian 16 bit words per channel: XX*, YY*, Re(XY*), Im(XY*))
+ *          into total power (K7DataAdapter).
+ */
+template<class C>
+struct K7PowerKernel
+{
+    typedef void (*Function)(const unsigned short*, float*, unsigned);
+
+    static void run(const unsigned short* in, float* I, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        for (unsigned c = 0; c < n; ++c)
+            I[c] = (float)((unsigned)in[4*c] + (unsigned)in[4*c+1]);
+    }
+};
+
+/**
+ * @details As K7PowerKernel, but keep the four products of one K7 spectrum
+ *          as separate outputs; the cross terms are signed (K7DataAdapter).
+ */
+template<class C>
+struct K7ProductsKernel
+{
+    typedef void (*Function)(const unsigned short*, float*, float*, float*,
+                             float*, unsigned);
+
+    static void run(const unsigned short* in, float* XX, float* YY,
+                    float* XYre, float* XYim, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        const short* cross = reinterpret_cast<const short*>(in);
+        for (unsigned c = 0; c < n; ++c) {
+            XX[c]   = (float)in[4*c];
+            YY[c]   = (float)in[4*c+1];
+            XYre[c] = (float)cross[4*c+2];
+            XYim[c] = (float)cross[4*c+3];
+        }
+    }
+};
+
+/// Swap the bytes of a big-endian 16 bit word (written so that the
+/// compiler turns it into a vector shuffle inside the kernel loops).
+inline unsigned short byteSwap16(unsigned short v)
+{
+    return (unsigned short)((v << 8) | (v >> 8));
+}
+
+/**
+ * @details As K7PowerKernel for the big-endian products of an AB (ROACH2)
+ *          spectrum (ABDataAdapter).
+ */
+template<class C>
+struct ABPowerKernel
+{
+    typedef void (*Function)(const unsigned short*, float*, unsigned);
+
+    static void run(const unsigned short* in, float* I, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        for (unsigned c = 0; c < n; ++c)
+            I[c] = (float)((unsigned)byteSwap16(in[4*c])
+                         + (unsigned)byteSwap16(in[4*c+1]));
+    }
+};
+
+/**
+ * @details As K7ProductsKernel for the big-endian products of an AB (ROACH2)
+ *          spectrum (ABDataAdapter).
+ */
+template<class C>
+struct ABProductsKernel
+{
+    typedef void (*Function)(const unsigned short*, float*, float*, float*,
+                             float*, unsigned);
+
+    static void run(const unsigned short* in, float* XX, float* YY,
+                    float* XYre, float* XYim, unsigned nChannels)
+    {
+        const unsigned n = C::count(nChannels);
+        for (unsigned c = 0; c < n; ++c) {
+            XX[c]   = (float)byteSwap16(in[4*c]);
+            YY[c]   = (float)byteSwap16(in[4*c+1]);
+            XYre[c] = (float)(short)byteSwap16(in[4*c+2]);
+            XYim[c] = (float)(short)byteSwap16(in[4*c+3]);
+        }
+    }
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // CHANNELKERNELS_H
@@ -0,0 +1,103 @@
+#ifndef COMPLETIONCOUNTER_H
+#define COMPLETIONCOUNTER_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QWaitCondition>
+#include <climits>
+#include <time.h>
+#include "Metrics.h"
+
+/**
+ * @file CompletionCounter.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class Deadline
+ *
+ * @brief
+ *    A point in time some milliseconds ahead, for waits spread over
+ *    several calls. ULONG_MAX milliseconds is never.
+ */
+class Deadline
+{
+    public:
+        Deadline(unsigned long ms);
+
+        /// Milliseconds left (0 once passed, ULONG_MAX if never).
+        unsigned long remaining() const;
+
+    private:
+        bool _never;
+        struct timespec _end;
+};
+
+/**
+ * @class CompletionCounter
+ *
+ * @brief
+ *    Count of outstanding tasks that can be waited on until it drops to zero.
+ *
+ * @details
+ *    Each task is counted with add() when it is launched and done() when it
+ *    has finished; wait() sleeps on a condition variable (rather than
+ *    polling) until no task is outstanding, or until a timeout.
+ *
+ *    The highest number of tasks outstanding at once, the number of waits
+ *    that had to block and the number of those that timed out are kept as
+ *    a measure of the back pressure from the tasks.
+ *
+ *    Telemetry, for a counter "C": the gauge "C.pending" (whose maximum is
+ *    maxPending()) and the counters "C.blockedWaits" and "C.timeouts".
+ */
+class CompletionCounter
+{
+    public:
+        CompletionCounter( const QString& name );
+        ~CompletionCounter();
+
+        const QString& name() const { return _name; }
+
+        /// Count n more tasks.
+        void add(int n = 1);
+
+        /// Mark n tasks as finished, waking the waiters when none are left.
+        void done(int n = 1);
+
+        /// Number of tasks outstanding.
+        int pending() const;
+
+        /// Block until no task is outstanding, returning false if that has
+        /// not happened within timeout ms.
+        bool wait(unsigned long timeout = ULONG_MAX) const;
+
+        int maxPending() const;
+        unsigned long blockedWaits() const;
+        unsigned long timeouts() const;
+
+    private:
+        CompletionCounter(const CompletionCounter&);
+        CompletionCounter& operator=(const CompletionCounter&);
+
+    private:
+        QString _name;
+        mutable QMutex _mutex;
+        mutable QWaitCondition _finished;
+        int _pending;
+        int _maxPending;
+        mutable unsigned long _blockedWaits;
+        mutable unsigned long _timeouts;
+
+        // Telemetry.
+        MetricGauge& _pendingGauge;
+        MetricCounter& _blockedCounter;
+        MetricCounter& _timeoutCounter;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // COMPLETIONCOUNTER_H
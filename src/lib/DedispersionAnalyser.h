@@ -20,7 +20,9 @@ class DedispersionDataAnalysis;
  * @brief
  *    Extract astronomical events form dedispersion data
  * @details
- *
+ *    Events are searched for in boxcars of 1 to 2^power2ForBinning
+ *    samples. When shedding load (shedWideBoxcars()) only boxcars up to
+ *    2^shedPower2ForBinning (default half the levels) are searched.
  */
 
 class DedispersionAnalyser : public AbstractModule
@@ -30,10 +32,17 @@ class DedispersionAnalyser : public AbstractModule
         ~DedispersionAnalyser();
         int analyse( DedispersionSpectra*, DedispersionDataAnalysis* );
 
+        /// search only the narrower boxcars (true) or all of them (false)
+        void shedWideBoxcars( bool shed ) { _binLevels = shed ? _shedBinPow2 : _binPow2; }
+        /// the boxcar levels searched, up to 2^binLevels() samples
+        unsigned binLevels() const { return _binLevels; }
+
     private:
         float _detectionThreshold; // self-explanatory
         unsigned _useStokesStats; // whether to use the noise values in the stokes blob or recompute
         unsigned _binPow2;
+        unsigned _shedBinPow2;
+        volatile unsigned _binLevels; // changed while analysing
 };
 
 PELICAN_DECLARE_MODULE(DedispersionAnalyser)
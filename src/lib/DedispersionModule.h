@@ -9,6 +9,7 @@
 #include "pelican/utility/LockingCircularBuffer.hpp"
 #include "LockingContainer.hpp"
 #include "LockingPtrContainer.hpp"
+#include "Metrics.h"
 #include "DedispersionSpectra.h"
 #include "AsyncronousModule.h"
 #include "GPU_Kernel.h"
@@ -30,6 +31,7 @@ class GPU_DataMapping;
 class GPU_Job;
 class GPU_Param;
 class GPU_NVidia;
+class GPU_CPU;
 class DedispersionBuffer;
 class LockingBuffer;
 
@@ -58,13 +60,18 @@ class DedispersionModule : public AsyncronousModule
               GPU_MemoryMapOutput _outputBuffer;
               GPU_MemoryMap _inputBuffer;
               GPU_MemoryMapConst _dmShift;
+              std::vector<float> _stagedInput; // copy of the input on a GPU_CPU
 
            public:
               DedispersionKernel( float, float, float, float, unsigned, unsigned, unsigned );
               void setDMShift( std::vector<float>& );
               void setOutputBuffer( std::vector<float>& );
               void setInputBuffer( std::vector<float>&, GPU_MemoryMap::CallBackT );
+              void setDMTrials( unsigned tdms ) { _tdms = tdms; }
               void run( GPU_NVidia& );
+              void stageIn( GPU_CPU& );
+              void run( GPU_CPU& );
+              bool runsOnCpu() const { return true; }
               void cleanUp();
         };
 
@@ -75,8 +82,9 @@ class DedispersionModule : public AsyncronousModule
         /// read LO frequency from the redis database
         //void getLOFreqFromRedis();
 
-        /// wait for all asyncronous tasks that have been launched to complete
-        void waitForJobCompletion();
+        /// wait for all asyncronous tasks that have been launched to complete,
+        /// returning false if they have not within timeout ms
+        bool waitForJobCompletion( unsigned long timeout = ULONG_MAX );
 
         /// processing the incoming data, generating a new DedispersedSpectra in
         /// the process
@@ -106,6 +114,12 @@ class DedispersionModule : public AsyncronousModule
         /// deprecated
         int maxshift() const { return _maxshift; }
 
+        /// dedisperse only the lowest shedDedispersionSamples DMs (true) or
+        /// all dedispersionSamples of them (false), from the next buffer on
+        void shedDMTrials( bool shed ) { _activeTdms = shed ? _shedTdms : _tdms; }
+        /// the number of DM trials dedispersed
+        unsigned dmTrials() const { return _activeTdms; }
+
      protected:
         void dedisperse( DedispersionBuffer* buffer, DedispersionSpectra* dataOut );
         void _cleanBuffers();
@@ -115,6 +129,8 @@ class DedispersionModule : public AsyncronousModule
         QVector<float> _means;
         QVector<float> _rmss;
         unsigned _tdms; 
+        unsigned _shedTdms;
+        volatile unsigned _activeTdms; // _tdms unless shedding load
         double _tsamp; // the time delta that is represented by each sample
         unsigned _numSamplesBuffer;
         float _dmStep;
@@ -148,6 +164,13 @@ class DedispersionModule : public AsyncronousModule
         DEFINE_TIMER( _launchTimer )
         DEFINE_TIMER( _dedisperseTimer )
 
+        // Telemetry: time spent waiting for a free buffer (the GPU falling
+        // behind), the number of free buffers and the time taken to drain
+        // the jobs in flight (on resize and shutdown).
+        MetricHistogram& _bufferWait;
+        MetricGauge& _buffersFree;
+        MetricHistogram& _drainWait;
+
 };
 
 PELICAN_DECLARE_MODULE(DedispersionModule)
@@ -24,8 +24,23 @@ class SpectrumDataSetStokes;
  * @class EmbracePowerGenerator
  *
  * @details Module used for converting a collection of spectra from X,Y polarisations to stokes parameters.
-
  *
+ * EMBRACE has two single polarisation directions rather than two
+ * polarisations, so by default the power of each direction is output as a
+ * separate "polarisation". With summedPower set only the total power is
+ * output, which halves the output data and the work of the following
+ * modules.
+ *
+ * Example configuration node :
+ *
+ @verbatim
+        <EmbracePowerGenerator>
+            <summedPower value="false"/>
+            <processingThreads value="4"/>
+        </EmbracePowerGenerator>
+ @endverbatim
+ *
+ * The detection kernels are shared with StokesGenerator (see ChannelKernels.h).
  */
 
 class EmbracePowerGenerator : public AbstractModule
@@ -43,7 +58,8 @@ class EmbracePowerGenerator : public AbstractModule
                 SpectrumDataSetStokes* stokes);
 
     private:
-        float _sqr(float x) { return x * x; }
+        bool _summedPower;
+        unsigned _nThreads;
 
 };
 
@@ -8,6 +8,8 @@
 #include "LofarTypes.h"
 #include "LofarUdpHeader.h"
 
+#include "PacketCaptureDevice.h"
+#include "Metrics.h"
 #include "pelican/server/AbstractChunker.h"
 
 #include <QtCore/QString>
@@ -81,6 +83,8 @@ class EmbraceSubbandSplittingChunker : public AbstractChunker
         unsigned _nPolarisations;
 
         unsigned _packetSize;
+        PacketCaptureDevice::Config _capture;
+        ChunkerMetrics _metrics;
         unsigned _packetSizeStream1;
         unsigned _packetSizeStream2;
         unsigned _bytesStream1;
@@ -0,0 +1,70 @@
+#ifndef GPU_CPU_H
+#define GPU_CPU_H
+
+#include "GPU_Resource.h"
+
+/**
+ * @file GPU_CPU.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+class GPU_Manager;
+
+/**
+ * @class GPU_CPU
+ *  
+ * @brief
+ *     Runs GPU_Jobs on the host's cores via a GPU_Manager
+ * @details
+ *     Takes jobs whose kernels all have a CPU implementation
+ *     (GPU_Kernel::runsOnCpu()), so that a GPU_Manager can hand work to idle
+ *     cores when no card is free, or where there is no card at all.
+ *     Kernels get the host memory of their maps from devicePtr(), as they
+ *     would get the device memory from GPU_NVidia, and may use up to
+ *     threads() threads (e.g. with OpenMP).
+ *
+ *     Jobs are phased: the kernels' stageIn() and stageOut() are called
+ *     around their run(), and overlap with the phases of the jobs either
+ *     side.
+ */
+
+class GPU_CPU : public GPU_Resource
+{
+    public:
+        /// a resource using up to threads threads per job
+        //  (0 for the OpenMP default)
+        GPU_CPU( unsigned int threads = 0 );
+        ~GPU_CPU();
+
+        /// only jobs whose kernels all run on the CPU
+        virtual bool canRun( GPU_Job* job ) const;
+
+        virtual void stageIn( GPU_Job* job );
+        virtual void stageOut( GPU_Job* job );
+        virtual bool phased() const { return true; }
+
+        /// add number CPU resources to the manager
+        static void initialiseResources( GPU_Manager* manager,
+                                         unsigned int number,
+                                         unsigned int threads = 0 );
+
+        /// the number of threads a kernel should use
+        unsigned int threads() const { return _threads; }
+
+        // call this function from the kernel run() method: the data
+        // is used where it is, in host memory
+        template<class MemMap>
+            void* devicePtr( const MemMap& map ) { return map.hostPtr(); }
+
+    protected:
+        virtual void run( GPU_Job* job );
+
+    private:
+        unsigned int _threads;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // GPU_CPU_H 
@@ -6,6 +6,7 @@
 #include <QtCore/QWaitCondition>
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
+#include <time.h>
 #include "GPU_MemoryMap.h"
 
 /**
@@ -24,13 +25,17 @@ class GPU_Kernel;
  * @brief
  *    Specifies a Job to run, its input and output data
  * @details
- * 
+ *    Jobs are taken from the GPU_Manager queue in order of priority, and
+ *    in the order submitted within a priority. The time a job spent
+ *    queued and running is kept from its status changes.
  */
 
 class GPU_Job
 {
     public:
         typedef enum{ None, Queued, Running, Finished, Failed } JobStatus;
+        typedef enum{ High, Normal, Low } JobPriority;
+        static const int priorities = Low + 1;
 
     public:
         GPU_Job();
@@ -41,7 +46,7 @@ class GPU_Job
 
         void addKernel( GPU_Kernel* kernel );
         const QList<GPU_Kernel*>& kernels() { return _kernels; };
-        inline void setStatus( const JobStatus& status ) { _status = status; };
+        void setStatus( const JobStatus& status );
         void setAsRunning();
         inline JobStatus status() const { return _status; };
         const std::string& error() const { return _errorMsg; }
@@ -52,6 +57,18 @@ class GPU_Job
         const QList<boost::function0<void> >& callBacks() const { return _callbacks; };
         void reset();
 
+        /// the queue to take the job from (Normal by default)
+        void setPriority( JobPriority priority ) { _priority = priority; }
+        JobPriority priority() const { return _priority; }
+
+        /// seconds from submission until the job started running
+        double queueTime() const { return _queueTime; }
+        /// seconds the job has been running for (until it finished or failed)
+        double execTime() const { return _execTime; }
+
+    private:
+        static double _since( const struct timespec& start, struct timespec& now );
+
     private:
         std::string _errorMsg;
         QList<GPU_Kernel*> _kernels;
@@ -61,6 +78,11 @@ class GPU_Job
         mutable QWaitCondition* _waitCondition;
         QList<boost::function0<void> > _callbacks;
         JobStatus _status;
+        JobPriority _priority;
+        struct timespec _queued;
+        struct timespec _started;
+        double _queueTime;
+        double _execTime;
 };
 
 } // namespace ampp
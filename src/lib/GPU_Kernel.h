@@ -11,6 +11,7 @@ namespace pelican {
 
 namespace ampp {
 class GPU_NVidia;
+class GPU_CPU;
 
 /**
  * @class GPU_Kernel
@@ -29,6 +30,17 @@ class GPU_Kernel
         // implement this method to run the nvidia kernel
         // using GPU_MemoryMap type to transfer data
         virtual void run( GPU_NVidia& ) = 0;
+        // implement this method, and return true from runsOnCpu(),
+        // to allow the kernel to run on a GPU_CPU resource
+        virtual void run( GPU_CPU& );
+        virtual bool runsOnCpu() const { return false; }
+        // optional phases around run( GPU_CPU& ): stageIn() should take
+        // what it needs of the inputs and run their callbacks, so that
+        // the inputs can be reused whilst the job computes; stageOut()
+        // completes the outputs. The phases of different jobs may run
+        // at the same time.
+        virtual void stageIn( GPU_CPU& ) {}
+        virtual void stageOut( GPU_CPU& ) {}
         // this method will be called when something
         // goes wrong and the run is abandoned.
         // call any callbacks for the MemoryMap from here
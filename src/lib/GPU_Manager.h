@@ -3,9 +3,13 @@
 
 
 #include <QtCore/QList>
-#include <QtCore/QSet>
 #include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
 #include "GPU_Resource.h"
+#include "GPU_Job.h"
+#include "LockFreeQueue.h"
+#include "Metrics.h"
 
 /**
  * @file GPU_Manager.h
@@ -18,7 +22,7 @@ class GPU_Job;
 
 /**
  * @class GPU_Manager
- *  
+ *
  * @brief
  *    A GPU Resource Manager and Job Queue
  * @details
@@ -26,11 +30,29 @@ class GPU_Job;
  *    As the resource becomes available, the next item from the queue
  *    is taken and executed.
  *
- *    Use the @code addResource() method to add GPU cards to be managed. Note that
- *    all the resources should be compatible with the types of jobs to be
- *    submitted - there is no checking of job suitability.
+ *    Use the @code addResource() method to add GPU cards (or CPU workers,
+ *    see GPU_CPU) to be managed. Each job goes to a resource that can run
+ *    it (GPU_Resource::canRun()); a job that none of the resources can run
+ *    fails straight away.
+ *
+ *    Every resource has its own thread, asleep while there is nothing for
+ *    it to do, and a lock-free queue per job priority. A job is handed to
+ *    the first idle resource able to run it, or else queued on the able
+ *    resource with the fewest jobs waiting; a resource that runs out of
+ *    work takes the oldest job it can run from the others' queues, highest
+ *    priority first. Jobs never wait behind other QtConcurrent work.
+ *
+ *    For a phased resource (GPU_Resource::phased()) the resource thread
+ *    only stages jobs in, and hands them on to a compute thread and then
+ *    a stage-out thread, each holding one job at a time: up to three jobs
+ *    are in flight on the resource, and a job's inputs are released
+ *    (their callbacks run) while the job before it still computes.
+ *
+ *    At most maxQueueDepth() jobs may be waiting; a job submitted beyond
+ *    that fails at once with a "queue full" error rather than adding to
+ *    the latency of everything behind it.
  *
- *    call @code submit() to add a job to be processed. All job status 
+ *    call @code submit() to add a job to be processed. All job status
  *    information/callbacks etc can be found through the GPU_Job interface.
  *
  */
@@ -39,11 +61,11 @@ class GPU_Manager
 {
 
     public:
-        GPU_Manager();
+        GPU_Manager( unsigned int maxQueueDepth = 1024 );
         ~GPU_Manager();
 
         /// submit a job to the queue
-        GPU_Job* submit( GPU_Job* job ); 
+        GPU_Job* submit( GPU_Job* job );
 
         /// add a GPU resource (e.g. an NVidia card) to manage
         //  ownership is transferred to the manager
@@ -59,20 +81,127 @@ class GPU_Manager
         /// return number of resources managed
         int resources() const;
 
+        /// the maximum number of jobs waiting in the queue
+        unsigned int maxQueueDepth() const { return _maxQueueDepth; }
+        void setMaxQueueDepth( unsigned int depth );
+
     private:
-        void _matchResources();
+        class Worker;
+        class Stage;
+
+        // a queued job with the resources (bit per worker) able to run it
+        struct Entry {
+            GPU_Job* job;
+            quint64 resources;
+        };
+        struct RunnableBy {
+            quint64 bit;
+            bool operator()( const Entry& e ) const { return ( e.resources & bit ) != 0; }
+        };
+
+        quint64 _resourcesFor( GPU_Job* ) const;
+        void _enqueue( GPU_Job* job, quint64 resources );
+        Worker* _claimIdle( quint64 resources ) const;
+        bool _take( Worker* worker, Entry& entry );
         void _runJob( GPU_Resource*, GPU_Job* );
-        void _resourceFree( GPU_Resource* );
+        void _start( GPU_Job* job );
+        bool _attempt( GPU_Resource* r, void (GPU_Resource::*phase)( GPU_Job* ),
+                       GPU_Job* job );
+        void _finish( GPU_Job* job );
+        void _fail( GPU_Job* job, const std::string& error );
 
     private:
+        static const int maxResources = 64;
+
         mutable QMutex _resourceMutex;
-        QList<GPU_Job*> _queue;
-        QList<GPU_Resource*> _resources;
-        QList<GPU_Resource*> _freeResource;
-        bool _destructor;
+        QList<GPU_Job*> _pending; // submitted before any resource was added
+        Worker* _workers[maxResources];
+        int _nWorkers;
+        unsigned int _maxQueueDepth;
+        int _queued;
+
+        // Telemetry.
+        MetricGauge& _queueDepth;
+        MetricHistogram& _queueTime;
+        MetricHistogram& _jobTime;
+        MetricCounter& _jobsFailed;
+        MetricCounter& _jobsRejected;
+
+};
+
+/**
+ * @class GPU_Manager::Worker
+ *
+ * @brief
+ *    Thread running the jobs of one resource.
+ */
+class GPU_Manager::Worker : public QThread
+{
+    public:
+        Worker( GPU_Manager* manager, GPU_Resource* resource, int index,
+                unsigned int queueDepth );
+        ~Worker();
+        void run();
+        void stop();
+
+        /// mark as busy if idle, returning false if already busy
+        bool claim() { return __sync_bool_compare_and_swap( &_idle, 1, 0 ); }
+        /// wake the thread of a claimed worker
+        void wake();
+        bool idle() const { return __sync_fetch_and_add( const_cast<int*>(&_idle), 0 ) == 1; }
+
+        GPU_Resource* resource() const { return _resource; }
+        quint64 bit() const { return (quint64)1 << _index; }
+        LockFreeQueue<Entry>& queue( int priority ) { return *_queues[priority]; }
+        unsigned int queued() const;
 
+    private:
+        GPU_Manager* _manager;
+        GPU_Resource* _resource;
+        Stage* _compute;
+        Stage* _stageOut;
+        int _index;
+        LockFreeQueue<Entry>* _queues[GPU_Job::priorities];
+        int _idle;
+        volatile bool _halt;
+        QMutex _mutex;
+        QWaitCondition _wake;
+};
+
+/**
+ * @class GPU_Manager::Stage
+ *
+ * @brief
+ *    Thread running one phase (compute or stage-out) of the jobs of a
+ *    phased resource, one job at a time.
+ */
+class GPU_Manager::Stage : public QThread
+{
+    public:
+        typedef enum { Compute, StageOut } Phase;
+
+    public:
+        /// jobs go on to next (if any) after this phase
+        Stage( GPU_Manager* manager, GPU_Resource* resource, Phase phase,
+               Stage* next = 0 );
+        /// finishes the job it holds before returning
+        ~Stage();
+        void run();
+
+        /// hand over a job, waiting until the previous one is done
+        void put( GPU_Job* job );
+
+    private:
+        GPU_Manager* _manager;
+        GPU_Resource* _resource;
+        Phase _phase;
+        Stage* _next;
+        GPU_Job* _job;
+        bool _halt;
+        QMutex _mutex;
+        QWaitCondition _changed;
 };
 
 } // namespace ampp
 } // namespace pelican
-#endif // GPU_MANAGER_H 
+#endif // GPU_MANAGER_H
@@ -18,7 +18,14 @@ class GPU_Job;
  * @brief
  *    Base class for all GPU Resource Types
  * @details
- * 
+ *    A job runs in three phases: stageIn() moves its inputs to the
+ *    resource, compute() runs its kernels and stageOut() returns the
+ *    results. By default everything happens in run(), called from
+ *    compute(). A resource returning true from phased() lets the
+ *    GPU_Manager run the phases of consecutive jobs concurrently (the
+ *    stage-in of one job with the compute of the one before and the
+ *    stage-out of the one before that), so its phases must be safe to
+ *    call from different threads.
  */
 
 class GPU_Resource
@@ -27,8 +34,20 @@ class GPU_Resource
     public:
         GPU_Resource();
         virtual ~GPU_Resource();
+        /// run all the phases of a job in turn
         void exec(GPU_Job*);
 
+        virtual void stageIn( GPU_Job* ) {}
+        virtual void compute( GPU_Job* job ) { run( job ); }
+        virtual void stageOut( GPU_Job* ) {}
+
+        /// return true if the phases of different jobs may overlap
+        virtual bool phased() const { return false; }
+
+        /// return false if the job cannot be run on this resource
+        //  (e.g. a kernel has no implementation for it)
+        virtual bool canRun( GPU_Job* ) const { return true; }
+
     protected:
         virtual void run( GPU_Job* job) = 0;
 
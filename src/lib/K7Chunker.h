@@ -2,10 +2,16 @@
 #define K7CHUNKER_H
 
 #include "K7Packet.h"
+#include "UdpBatchReceiver.h"
+#include "PacketReorderWindow.h"
+#include "PacketCaptureDevice.h"
+#include "SharedChunkRing.h"
+#include "Metrics.h"
 #include "pelican/server/AbstractChunker.h"
 #include <QtCore/QString>
 #include <QtCore/QObject>
 #include <QtCore/QMutex>
+#include <vector>
 
 namespace pelican {
 namespace ampp {
@@ -20,7 +26,7 @@ class K7Chunker : public AbstractChunker
         K7Chunker(const ConfigNode& config);
 
         // Destructor
-        ~K7Chunker() {}
+        ~K7Chunker();
 
         // Creates the socket to use for the incoming data stream.
         virtual QIODevice* newDevice();
@@ -35,11 +41,18 @@ class K7Chunker : public AbstractChunker
         }
 
     private:
-        // Generates an empty UDP packet.
-        void updateEmptyPacket(K7Packet& packet, unsigned long int timestamp, unsigned int accumulation, unsigned int rate);
+        // Describes the parts of a packet to keep (header and channel range).
+        void describePacket(UdpBatchReceiver& receiver);
 
-        // Write K7Packet to writeableData object
-        int writePacket(WritableData* writer, K7Packet& packet, unsigned int packetSize, unsigned int offset);
+        // Writes an empty stream packet with the given header into the chunk.
+        void writeEmptyPacket(char* slot, unsigned long int timestamp, unsigned int accumulation, unsigned int rate);
+
+        // Checks a received stream packet and places it in the reorder window.
+        // Returns false if a packet received in place has to be moved.
+        bool acceptPacket(char* packet, unsigned int length, unsigned int slot, bool inPlace);
+
+        // Zero-fills the slots of the chunk that are still empty.
+        unsigned int fillGaps(char* chunk);
 
         // Returns an error message suitable for throwing.
         QString _err(QString message)
@@ -49,6 +62,11 @@ class K7Chunker : public AbstractChunker
 
     private:
         WritableData _writable;
+        char* _chunk;
+        SharedChunkRing* _shm;
+        int _shmTimeout;
+        bool _shmStalled;
+        unsigned long int _shmDiscarded;
         unsigned int _nPackets;
         unsigned int _packetsRejected;
         unsigned int _packetsAccepted;
@@ -57,8 +75,12 @@ class K7Chunker : public AbstractChunker
         unsigned int _headerSize;
         unsigned int _bytesStream;
         unsigned int _packetSizeStream;
-        unsigned long int _startTimestamp;
-        unsigned long int _startAccumulation;
+        bool _synchronised;
+        unsigned int _rate;
+        quint64 _sequence;
+        unsigned long int _timestamp;
+        unsigned int _accumulation;
+        unsigned long int _packetsLost;
         unsigned int _clock;
         unsigned long int _packetsPerSecond;
         unsigned int _chunkerCounter;
@@ -67,7 +89,13 @@ class K7Chunker : public AbstractChunker
         unsigned int _channelEnd;
         unsigned int _nChannels;
         unsigned int _streamChannels;
-        K7Packet _emptyPacket;
+        unsigned int _receiveBufferSize;
+        UdpBatchReceiver _receiver;
+        PacketCaptureDevice::Config _capture;
+        ChunkerMetrics _metrics;
+        std::vector<unsigned> _lengths;
+        PacketReorderWindow* _window;
+        std::vector<char> _staging;
 };
 
 PELICAN_DECLARE_CHUNKER(K7Chunker)
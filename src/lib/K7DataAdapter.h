@@ -3,6 +3,7 @@
 
 #include "pelican/core/AbstractStreamAdapter.h"
 #include "K7Packet.h"
+#include "ChannelKernels.h"
 
 namespace pelican {
 
@@ -26,7 +27,7 @@ class K7DataAdapter : public AbstractStreamAdapter
 
     private:
         // Read the UDP packet header from a buffer read from the IO device.
-        void _readHeader(char* buffer, K7Packet::Header& header);
+        void _readHeader(const char* buffer, K7Packet::Header& header);
 
         // Prints the header to standard out (for debugging).
         void _printHeader(const K7Packet::Header& header);
@@ -42,8 +43,9 @@ class K7DataAdapter : public AbstractStreamAdapter
         size_t _headerSize;
         size_t _packetSize;
         size_t _payloadSize;
-        std::vector<char> _headerBuffer;
-        std::vector<char> _dataBuffer;
+        std::vector<char> _chunkBuffer;
+        K7PowerKernel<RuntimeChannels>::Function _decodePower;
+        K7ProductsKernel<RuntimeChannels>::Function _decodeProducts;
 
         unsigned int _channelsPerPacket;
         unsigned int _channelsPerBlob;
@@ -2,16 +2,35 @@
 #define K7DATACLIENT_H
 
 #include "pelican/core/PelicanServerClient.h"
+#include <QtCore/QString>
 
 namespace pelican {
 namespace ampp {
 
+class SharedChunkRing;
+
+// Data client for the K7 stream. Chunks come from the K7Server over TCP or,
+// when the client node has <shm name="..."/> matching the K7Chunker's, are
+// read in place from the chunker's shared memory ring.
 class K7DataClient : public PelicanServerClient
 {
     public:
         K7DataClient( const ConfigNode& configNode, const DataTypes& types, const Config* config );
         ~K7DataClient();
+
+        // Gets the next chunk and adapts it into the data blobs.
+        virtual DataBlobHash getData(DataBlobHash& dataHash);
+
     private:
+        // Reads the next chunk from the shared memory ring.
+        DataBlobHash _getSharedData(DataBlobHash& dataHash);
+
+    private:
+        QString _shmName;
+        SharedChunkRing* _shm;
+        bool _hasSequence;
+        quint64 _sequence;
+        unsigned long int _chunksLost;
 };
 
 PELICAN_DECLARE_CLIENT(K7DataClient)
@@ -20,4 +39,3 @@ PELICAN_DECLARE_CLIENT(K7DataClient)
 } // namespace pelican
 
 #endif // K7DATACLIENT_H
-
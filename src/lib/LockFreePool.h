@@ -0,0 +1,215 @@
+#ifndef LOCKFREEPOOL_H
+#define LOCKFREEPOOL_H
+
+#include <QList>
+#include <QHash>
+#include <QWaitCondition>
+#include <QMutex>
+#include <QMutexLocker>
+#include <vector>
+#include "LockFreeQueue.h"
+#include "CompletionCounter.h"
+#include "Metrics.h"
+
+/**
+ * @file LockFreePool.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class LockFreePool
+ *
+ * @brief
+ *    Bounded pool of objects handed out and returned without locks.
+ *
+ * @details
+ *    The free objects sit in a LockFreeQueue, so tryNext() and unlock()
+ *    are a few atomic operations and never allocate. next() only falls
+ *    back to sleeping on a condition variable when the pool is empty, and
+ *    unlock() only takes the mutex to wake it when somebody is asleep;
+ *    likewise for waitAllAvailable().
+ *
+ *    Each object has an in-use flag, found through a table built by
+ *    reset(), so that returning an object twice (or one that is not from
+ *    the pool) is caught in O(1): it asserts in debug builds and is
+ *    ignored otherwise.
+ *
+ *    Occupancy: numberAvailable(), the fewest ever available
+ *    (lowWater()), the number of next() calls that had to wait
+ *    (blocked()) and, if one is set with setGauge(), a MetricGauge of the
+ *    objects in use (whose maximum is then the peak occupancy).
+ *
+ *    reset() must not be called while objects are out or others are
+ *    using the pool.
+ */
+template<typename T>
+class LockFreePool
+{
+    public:
+        LockFreePool()
+            : _free(0), _size(0), _available(0), _lowWater(0), _blocked(0),
+              _waiters(0), _drainWaiters(0), _gauge(0) {}
+        ~LockFreePool() {
+            {
+                QMutexLocker lock(&_mutex);
+                _freed.wakeAll();
+                _allAvailable.wakeAll();
+            }
+            delete _free;
+        }
+
+        /// manage the given objects, all of them free
+        void reset( const QList<T*>& items ) {
+            QMutexLocker lock(&_mutex);
+            delete _free;
+            _free = new LockFreeQueue<T*>( items.size() );
+            _index.clear();
+            _inUse.assign( items.size(), 0 );
+            for( int i = 0; i < items.size(); ++i ) {
+                _index.insert( items[i], i );
+                _free->push( items[i] );
+            }
+            _size = items.size();
+            _available = _size;
+            _lowWater = _size;
+            _publish( _size );
+        }
+
+        /// return the next free object, or 0 if there is none
+        T* tryNext() {
+            T* item;
+            if( ! _free || ! _free->pop( item ) ) return 0;
+            _taken( item );
+            return item;
+        }
+
+        /// return the next free object
+        //  This will block until one becomes available
+        //  (or return 0 after timeout ms)
+        T* next( unsigned long timeout = ULONG_MAX ) {
+            T* item = tryNext();
+            if( item ) return item;
+            __sync_fetch_and_add( &_blocked, 1 );
+            QMutexLocker lock(&_mutex);
+            // counted before looking again, so unlock() sees us or we see
+            // what it returned
+            __sync_fetch_and_add( &_waiters, 1 );
+            Deadline deadline( timeout );
+            while( ! ( item = tryNext() ) ) {
+                unsigned long ms = deadline.remaining();
+                if( ms == 0 ) break;
+                _freed.wait( &_mutex, ms );
+            }
+            __sync_fetch_and_sub( &_waiters, 1 );
+            return item;
+        }
+
+        /// return an object to the pool
+        void unlock( const T* data ) {
+            T* item = const_cast<T*>(data);
+            int i = _index.value( item, -1 );
+            Q_ASSERT( i >= 0 ); // not from this pool
+            if( i < 0 ) return;
+            bool wasInUse = __sync_bool_compare_and_swap( &_inUse[i], 1, 0 );
+            Q_ASSERT( wasInUse ); // returned twice
+            if( ! wasInUse ) return;
+            _free->push( item ); // cannot be full: it holds at most _size
+            int available = __sync_add_and_fetch( &_available, 1 );
+            _publish( available );
+            if( _load( _waiters ) || ( available == _size && _load( _drainWaiters ) ) ) {
+                QMutexLocker lock(&_mutex);
+                _freed.wakeOne();
+                if( available == _size ) _allAvailable.wakeAll();
+            }
+        }
+
+        /// return true only if there are no objects in use
+        bool allAvailable() const {
+            return numberAvailable() == _size;
+        }
+
+        /// block until there are no objects in use, returning false
+        //  if there still are after timeout ms
+        bool waitAllAvailable( unsigned long timeout = ULONG_MAX ) const {
+            if( allAvailable() ) return true;
+            QMutexLocker lock(&_mutex);
+            __sync_fetch_and_add( &_drainWaiters, 1 );
+            Deadline deadline( timeout );
+            bool all;
+            while( ! ( all = allAvailable() ) ) {
+                unsigned long ms = deadline.remaining();
+                if( ms == 0 ) break;
+                _allAvailable.wait( &_mutex, ms );
+            }
+            __sync_fetch_and_sub( &_drainWaiters, 1 );
+            return all;
+        }
+
+        /// the number of objects managed
+        int size() const { return _size; }
+
+        /// the number of free objects
+        int numberAvailable() const { return _load( _available ); }
+
+        /// the fewest objects that have been free since reset()
+        int lowWater() const { return _load( _lowWater ); }
+
+        /// the number of calls to next() that had to wait
+        unsigned long blocked() const {
+            return __sync_fetch_and_add( const_cast<unsigned long*>(&_blocked), 0 );
+        }
+
+        /// keep gauge set to the number of objects in use
+        void setGauge( MetricGauge* gauge ) {
+            _gauge = gauge;
+            _publish( numberAvailable() );
+        }
+
+    private:
+        LockFreePool( const LockFreePool& );
+        LockFreePool& operator=( const LockFreePool& );
+
+        static int _load( const int& v ) {
+            return __sync_fetch_and_add( const_cast<int*>(&v), 0 );
+        }
+
+        void _taken( T* item ) {
+            __sync_lock_test_and_set( &_inUse[_index.value( item )], 1 );
+            int available = __sync_sub_and_fetch( &_available, 1 );
+            // below 0 if taken between the push and the count in unlock()
+            if( available < 0 ) available = 0;
+            int low = _load( _lowWater );
+            while( available < low ) {
+                int previous = __sync_val_compare_and_swap( &_lowWater, low, available );
+                if( previous == low ) break;
+                low = previous;
+            }
+            _publish( available );
+        }
+
+        void _publish( int available ) {
+            if( _gauge ) _gauge->set( _size - available );
+        }
+
+    private:
+        LockFreeQueue<T*>* _free;
+        QHash<const T*, int> _index; // read only between resets
+        std::vector<int> _inUse;
+        int _size;
+        int _available;
+        int _lowWater;
+        unsigned long _blocked;
+        int _waiters;
+        mutable int _drainWaiters;
+        MetricGauge* _gauge;
+        mutable QMutex _mutex;
+        QWaitCondition _freed;
+        mutable QWaitCondition _allAvailable;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // LOCKFREEPOOL_H
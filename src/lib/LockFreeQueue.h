@@ -0,0 +1,169 @@
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <vector>
+
+/**
+ * @file LockFreeQueue.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class LockFreeQueue
+ *
+ * @brief
+ *    Bounded lock-free queue for any number of producers and consumers.
+ *
+ * @details
+ *    Each slot carries a sequence number telling whether it is ready to be
+ *    written (sequence == position) or read (sequence == position + 1) for
+ *    the current lap of the ring; producers and consumers claim positions
+ *    with a compare-and-swap on their own index and then hand the slot over
+ *    by advancing its sequence. Nobody ever waits on a lock, and push() on a
+ *    full queue or pop() on an empty one return false at once.
+ *
+ *    popIf() only takes the item at the head when a predicate accepts it, so
+ *    that a consumer can leave work it cannot handle to the others. The
+ *    predicate may see a copy of an item that another consumer takes at the
+ *    same time, so it must not rely on anything the item points to.
+ *
+ *    The capacity is rounded up to a power of two. T must be copyable.
+ */
+template<typename T>
+class LockFreeQueue
+{
+    public:
+        LockFreeQueue(unsigned capacity);
+        ~LockFreeQueue() {}
+
+        /// Number of slots.
+        unsigned capacity() const { return _mask + 1; }
+
+        /// Number of items queued (approximate while others are using it).
+        unsigned size() const;
+
+        bool empty() const { return size() == 0; }
+
+        /// Add an item at the tail, returning false if the queue is full.
+        bool push(const T& item);
+
+        /// Take the item at the head, returning false if the queue is empty.
+        bool pop(T& item) { return popIf(item, _any); }
+
+        /// Take the item at the head if pred(item) is true.
+        template<class Predicate>
+        bool popIf(T& item, Predicate pred);
+
+    private:
+        LockFreeQueue(const LockFreeQueue&);
+        LockFreeQueue& operator=(const LockFreeQueue&);
+
+        struct Slot {
+            unsigned sequence;
+            T item;
+        };
+
+        static bool _any(const T&) { return true; }
+        static unsigned _load(const unsigned& v) {
+            return __sync_fetch_and_add(const_cast<unsigned*>(&v), 0);
+        }
+        static void _store(unsigned& v, unsigned value) {
+            __sync_synchronize();
+            *(volatile unsigned*)&v = value;
+        }
+
+    private:
+        unsigned _mask;
+        std::vector<Slot> _slots;
+
+        // Producer and consumer indices on their own cache lines.
+        char _pad0[64];
+        unsigned _head;
+        char _pad1[64];
+        unsigned _tail;
+        char _pad2[64];
+};
+
+template<typename T>
+LockFreeQueue<T>::LockFreeQueue(unsigned capacity)
+    : _head(0), _tail(0)
+{
+    unsigned size = 2;
+    while( size < capacity ) size <<= 1;
+    _mask = size - 1;
+    _slots.resize(size);
+    for( unsigned i = 0; i < size; ++i )
+        _slots[i].sequence = i;
+}
+
+template<typename T>
+unsigned LockFreeQueue<T>::size() const
+{
+    unsigned head = _load(_head);
+    unsigned tail = _load(_tail);
+    return tail - head > _mask + 1 ? 0 : tail - head;
+}
+
+template<typename T>
+bool LockFreeQueue<T>::push(const T& item)
+{
+    unsigned position = _load(_tail);
+    Slot* slot;
+    for(;;) {
+        slot = &_slots[position & _mask];
+        int lap = (int)(_load(slot->sequence) - position);
+        if( lap == 0 ) {
+            unsigned previous = __sync_val_compare_and_swap(&_tail, position, position + 1);
+            if( previous == position ) break;
+            position = previous;
+        }
+        else if( lap < 0 ) {
+            return false; // the slot has not been read since the last lap
+        }
+        else {
+            position = _load(_tail);
+        }
+    }
+    slot->item = item;
+    _store(slot->sequence, position + 1);
+    return true;
+}
+
+template<typename T>
+template<class Predicate>
+bool LockFreeQueue<T>::popIf(T& item, Predicate pred)
+{
+    unsigned position = _load(_head);
+    Slot* slot;
+    for(;;) {
+        slot = &_slots[position & _mask];
+        int lap = (int)(_load(slot->sequence) - (position + 1));
+        if( lap == 0 ) {
+            // The slot cannot be reused before our position is taken, so the
+            // copy is the item we get if the swap succeeds.
+            T head = slot->item;
+            if( ! pred(head) ) return false;
+            unsigned previous = __sync_val_compare_and_swap(&_head, position, position + 1);
+            if( previous == position ) {
+                item = head;
+                break;
+            }
+            position = previous;
+        }
+        else if( lap < 0 ) {
+            return false; // nothing written here yet
+        }
+        else {
+            position = _load(_head);
+        }
+    }
+    _store(slot->sequence, position + _mask + 1);
+    return true;
+}
+
+} // namespace ampp
+} // namespace pelican
+#endif // LOCKFREEQUEUE_H
@@ -4,6 +4,8 @@
 #include "LofarTypes.h"
 #include "LofarUdpHeader.h"
 
+#include "PacketCaptureDevice.h"
+#include "Metrics.h"
 #include "pelican/server/AbstractChunker.h"
 
 #include <QtCore/QString>
@@ -66,6 +68,8 @@ class LofarChunker : public AbstractChunker
         unsigned _startTime;
         unsigned _startBlockid;
         unsigned _packetSize;
+        PacketCaptureDevice::Config _capture;
+        ChunkerMetrics _metrics;
         unsigned _clock;
 
         friend class LofarChunkerTest;
@@ -0,0 +1,359 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QtCore/QString>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <time.h>
+#include <ostream>
+
+/**
+ * @file Metrics.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class MetricCounter
+ *
+ * @brief
+ *    Monotonic 64 bit counter, safe to increment from any thread.
+ */
+class MetricCounter
+{
+    public:
+        MetricCounter() : _value(0) {}
+        void add(quint64 n = 1) { __sync_fetch_and_add(&_value, n); }
+        quint64 value() const { return __sync_fetch_and_add(const_cast<quint64*>(&_value), 0); }
+
+    private:
+        quint64 _value;
+};
+
+/**
+ * @class MetricGauge
+ *
+ * @brief
+ *    Last value of a level (such as a queue depth) and its maximum.
+ */
+class MetricGauge
+{
+    public:
+        MetricGauge() : _value(0), _max(0) {}
+        inline void set(qint64 value);
+        qint64 value() const { return _value; }
+        qint64 max() const { return _max; }
+
+    private:
+        volatile qint64 _value;
+        qint64 _max;
+};
+
+/**
+ * @class MetricHistogram
+ *
+ * @brief
+ *    Distribution of durations in power of two buckets of microseconds.
+ *
+ * @details
+ *    Bucket k counts durations in [2^k, 2^(k+1)) us (bucket 0 also holds
+ *    anything shorter). Recording is a handful of atomic adds so histograms
+ *    can stay enabled in production.
+ */
+class MetricHistogram
+{
+    public:
+        static const unsigned nBuckets = 32;
+
+    public:
+        MetricHistogram();
+        /// Record a duration in seconds.
+        void record(double seconds);
+
+        quint64 count() const { return _read(_count); }
+        /// Total of the recorded durations in microseconds.
+        quint64 total() const { return _read(_total); }
+        quint64 max() const { return _read(_max); }
+        quint64 bucket(unsigned k) const { return _read(_buckets[k]); }
+        /// Upper bound (us) of the bucket holding the given fraction of counts.
+        quint64 percentile(double fraction) const;
+
+    private:
+        static quint64 _read(const quint64& v) {
+            return __sync_fetch_and_add(const_cast<quint64*>(&v), 0);
+        }
+
+    private:
+        quint64 _buckets[nBuckets];
+        quint64 _count;
+        quint64 _total;
+        quint64 _max;
+};
+
+/**
+ * @class MetricTimer
+ *
+ * @brief
+ *    Records the time between its construction (or start()) and its
+ *    destruction (or stop()) in a histogram.
+ */
+class MetricTimer
+{
+    public:
+        MetricTimer(MetricHistogram& histogram, bool running = true)
+            : _histogram(histogram), _running(false) { if( running ) start(); }
+        ~MetricTimer() { stop(); }
+        void start() { clock_gettime(CLOCK_MONOTONIC, &_start); _running = true; }
+        /// Record the elapsed time, returning it in seconds.
+        double stop();
+
+    private:
+        MetricHistogram& _histogram;
+        struct timespec _start;
+        bool _running;
+};
+
+/**
+ * @class MetricProfile
+ *
+ * @brief
+ *    Fine grained distribution of the durations of a hot path stage, for
+ *    tail latencies (p99, p99.9) that the power of two buckets of a
+ *    MetricHistogram cannot resolve.
+ *
+ * @details
+ *    Durations are kept in nanoseconds in log-linear buckets: each power
+ *    of two is split into nSubBuckets, so a percentile is good to 1/8 of
+ *    its value (as in HDR histograms) from 1 ns up to about 18 minutes.
+ *
+ *    Each thread records into its own shard (there are nShards, handed out
+ *    to threads in turn), so that the stages of a pipeline running on
+ *    different threads do not contend for the same cache lines. Readers
+ *    sum the shards; nothing takes a lock.
+ *
+ *    Profiling is off unless the environment variable AMPP_PROFILE is set
+ *    to a non zero value, or setEnabled(true) is called. ProfileTimer (and
+ *    the timerStart()/timerUpdate() of timer.h) only read the clock when it
+ *    is on.
+ *
+ *    A budget (e.g. the real time a chunk covers, getBlockRate() *
+ *    nTimeBlocks()) may be set: the durations over it are counted.
+ */
+class MetricProfile
+{
+    public:
+        static const unsigned nSubBits = 3;
+        static const unsigned nSubBuckets = 1 << nSubBits;
+        static const unsigned nBuckets = 38 * nSubBuckets;
+        static const unsigned nShards = 8;
+
+    public:
+        MetricProfile();
+        ~MetricProfile();
+
+        /// true while profiling is switched on
+        static bool enabled() { return _enabled; }
+        static void setEnabled(bool enabled) { _enabled = enabled; }
+
+        /// Record a duration in nanoseconds.
+        void record(quint64 ns);
+
+        /// Count durations over this many seconds (0 for no budget).
+        void setBudget(double seconds) { _budget = (quint64)(seconds * 1.0e9 + 0.5); }
+        quint64 budget() const { return _budget; }
+
+        quint64 count() const;
+        /// Total of the recorded durations in nanoseconds.
+        quint64 total() const;
+        quint64 max() const;
+        /// The number of durations over the budget.
+        quint64 overBudget() const;
+        /// Upper bound (ns) of the bucket holding the given fraction of counts.
+        quint64 percentile(double fraction) const;
+
+        /// the bucket a duration goes in, and the upper bound of a bucket
+        static unsigned bucketOf(quint64 ns);
+        static quint64 upperBound(unsigned k);
+
+    private:
+        MetricProfile(const MetricProfile&);
+        MetricProfile& operator=(const MetricProfile&);
+
+        struct Shard {
+            quint64 buckets[nBuckets];
+            quint64 count;
+            quint64 total;
+            quint64 max;
+            quint64 over;
+            char pad[64]; // off the cache line of the next shard
+        };
+
+        static unsigned _shardIndex();
+        static quint64 _read(const quint64& v) {
+            return __sync_fetch_and_add(const_cast<quint64*>(&v), 0);
+        }
+
+    private:
+        static volatile bool _enabled;
+        Shard* _shards;
+        volatile quint64 _budget;
+};
+
+/**
+ * @class ProfileTimer
+ *
+ * @brief
+ *    Records the time between its construction and its destruction (or
+ *    stop()) in a MetricProfile, when profiling is enabled.
+ */
+class ProfileTimer
+{
+    public:
+        ProfileTimer(MetricProfile& profile)
+            : _profile(profile), _running(MetricProfile::enabled()) {
+            if( _running ) clock_gettime(CLOCK_MONOTONIC, &_start);
+        }
+        ~ProfileTimer() { stop(); }
+        inline void stop();
+
+    private:
+        MetricProfile& _profile;
+        struct timespec _start;
+        bool _running;
+};
+
+/**
+ * @class MetricsRegistry
+ *
+ * @brief
+ *    Process wide, named counters, gauges, histograms and profiles.
+ *
+ * @details
+ *    Metrics are created on first use and never move or go away, so callers
+ *    look them up once (usually in their constructor) and keep the
+ *    reference; updating a metric does not take any lock.
+ *
+ *    Names are dotted, starting with the component, e.g.
+ *    "K7Chunker.8622.packetsLost" or "DedispersionPipeline.ppf".
+ *
+ *    The registry is written out as text by write(), or periodically to a
+ *    file by startWriter(). When the environment variable AMPP_METRICS_FILE
+ *    is set the writer is started with that file on first use of the
+ *    registry (any "%p" in the name is replaced by the process id), every
+ *    AMPP_METRICS_INTERVAL seconds (default 1). Profiles are written with
+ *    their p50, p99 and p99.9, so with AMPP_PROFILE set the file is also
+ *    the periodic dump of the stage latencies.
+ */
+class MetricsRegistry
+{
+    public:
+        static MetricsRegistry& instance();
+
+        MetricCounter& counter(const QString& name);
+        MetricGauge& gauge(const QString& name);
+        MetricHistogram& histogram(const QString& name);
+        MetricProfile& profile(const QString& name);
+
+        /// Write all metrics as text.
+        void write(std::ostream& stream) const;
+
+        /// Write all metrics to a file (replaced atomically).
+        bool writeFile(const QString& fileName) const;
+
+        /// Start writing the metrics to fileName every interval seconds.
+        void startWriter(const QString& fileName, double interval);
+
+        /// Stop the periodic writer.
+        void stopWriter();
+
+    private:
+        MetricsRegistry();
+        ~MetricsRegistry();
+        MetricsRegistry(const MetricsRegistry&);
+        MetricsRegistry& operator=(const MetricsRegistry&);
+
+    private:
+        class Writer;
+        mutable QMutex _mutex;
+        QMap<QString, MetricCounter*> _counters;
+        QMap<QString, MetricGauge*> _gauges;
+        QMap<QString, MetricHistogram*> _histograms;
+        QMap<QString, MetricProfile*> _profiles;
+        Writer* _writer;
+};
+
+/**
+ * @class MetricsRegistry::Writer
+ *
+ * @brief
+ *    Thread writing the registry to a file at regular intervals.
+ */
+class MetricsRegistry::Writer : public QThread
+{
+    public:
+        Writer(const MetricsRegistry* registry, const QString& fileName,
+               double interval);
+        ~Writer();
+        void run();
+        void stop() { _halt = true; }
+
+    private:
+        const MetricsRegistry* _registry;
+        QString _fileName;
+        unsigned long _intervalMs;
+        volatile bool _halt;
+};
+
+/**
+ * @class ChunkerMetrics
+ *
+ * @brief
+ *    Packet and chunk counters kept by the UDP chunkers.
+ *
+ * @details
+ *    Registered as "<prefix>.packetsAccepted" etc. where the prefix names the
+ *    chunker and its port, e.g. "K7Chunker.8622". Lost packets are those
+ *    zero-filled in the chunk; discarded packets are those dropped because
+ *    no chunk buffer space was available.
+ */
+struct ChunkerMetrics
+{
+    ChunkerMetrics(const QString& prefix);
+
+    MetricCounter& packetsAccepted;
+    MetricCounter& packetsRejected;
+    MetricCounter& packetsLost;
+    MetricCounter& packetsDuplicated;
+    MetricCounter& packetsLate;
+    MetricCounter& chunks;
+    MetricCounter& packetsDiscarded;
+};
+
+inline void MetricGauge::set(qint64 value)
+{
+    _value = value;
+    qint64 max = _max;
+    while( value > max ) {
+        qint64 previous = __sync_val_compare_and_swap(&_max, max, value);
+        if( previous == max ) break;
+        max = previous;
+    }
+}
+
+inline void ProfileTimer::stop()
+{
+    if( ! _running ) return;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    qint64 ns = (qint64)(end.tv_sec - _start.tv_sec) * 1000000000LL
+                + (end.tv_nsec - _start.tv_nsec);
+    _profile.record(ns > 0 ? (quint64)ns : 0);
+    _running = false;
+}
+
+} // namespace ampp
+} // namespace pelican
+#endif // METRICS_H
@@ -7,6 +7,10 @@
 
 #include "pelican/modules/AbstractModule.h"
 #include "PolyphaseCoefficients.h"
+#include "ChannelKernels.h"
+#include "SpectrumDataSet.h"
+
+#include <QtCore/QByteArray>
 
 #include <complex>
 #include <vector>
@@ -22,7 +26,6 @@ class ConfigNode;
 namespace ampp {
 
 class TimeSeriesDataSetC32;
-class SpectrumDataSetC32;
 
 /**
  * @class PPFChanneliser
@@ -31,6 +34,12 @@ class SpectrumDataSetC32;
  *
  * @details Channelises time stream data using a polyphase channelising filter.
  *
+ * The sub-band centre (DC) is in channel nChannels / 2 and channel 0 is the
+ * lower edge of the sub-band. The shift is applied by the filter: the
+ * coefficients of odd samples are negated (see
+ * PolyphaseCoefficients::genereateFilter()), which modulates each filtered
+ * block by (-1)^t before the FFT. The PPFInverter uses the same order.
+ *
  * Example configuration node :
  *
  @verbatim
@@ -38,6 +47,8 @@ class SpectrumDataSetC32;
  			<channels number="512"/>
  			<processingThreads number="2"/>
  			<filter nTaps="8" filterWindow="kaiser"/>
+ 			<cache directory="/var/cache/pelican"/>
+ 			<outputLayout value="blocks"/>
  		</PPFChanneliser>
  @endverbatim
  *
@@ -49,6 +60,16 @@ class SpectrumDataSetC32;
  *     - @i nTaps: Number of filter taps in the PPF coefficient data
  *     - @i filterWindow: The filter window type used in generating FIR filter coefficients. Possible options are: "kaiser" (default), "gaussian", "blackman" and "hamming".
  *
+ * - @b cache: Optional directory in which generated FIR coefficients and
+ *   FFTW wisdom are stored. If present, coefficients matching
+ *   (nTaps, channels, filterWindow) and the FFTW plan wisdom are loaded from
+ *   it at construction and written there the first time they are generated.
+ *
+ * - @b outputLayout: Memory layout of the output spectra, "blocks"
+ *   (default, one contiguous spectrum per polarisation) or "interleaved"
+ *   (polarisations adjacent per channel, see SpectrumDataSetC32::Layout).
+ *   The interleaved layout is written directly by the FFT.
+ *
  */
 
 class PPFChanneliser : public AbstractModule
@@ -88,6 +109,10 @@ class PPFChanneliser : public AbstractModule
         /// FFT filtered samples to form a spectrum.
         void _fft(const Complex* samples, Complex* spectrum);
 
+        /// FFT filtered samples to form a spectrum with output stride
+        /// equal to the number of polarisations.
+        void _fftInterleaved(const Complex* samples, Complex* spectrum);
+
         /// Returns the sub-band ID range to be processed.
         void _assign_threads(unsigned& start, unsigned& end,
                 unsigned nSubbands, unsigned nThreads, unsigned threadId);
@@ -99,6 +124,19 @@ class PPFChanneliser : public AbstractModule
         /// Create the FFTW plan for use with the channeliser.
         void _createFFTWPlan(unsigned nChannels, fftwf_plan& plan);
 
+        /// Create the FFTW plan writing spectra with the given output stride.
+        void _createStridedFFTWPlan(unsigned nChannels, unsigned stride,
+                fftwf_plan& plan);
+
+        /// Returns the name of the FFTW wisdom file in the cache directory.
+        QString _wisdomFileName(unsigned nChannels) const;
+
+        /// Import the saved FFTW wisdom, returning the wisdom held before planning.
+        QByteArray _loadWisdom(unsigned nChannels);
+
+        /// Save the FFTW wisdom if planning has added to it.
+        void _saveWisdom(unsigned nChannels, const QByteArray& wisdom);
+
         /// Return an error message.
         QString _err(const QString& message);
 
@@ -107,6 +145,7 @@ class PPFChanneliser : public AbstractModule
 
         unsigned _nChannels;
         unsigned _nThreads;
+        QString _cacheDir;
 
         PolyphaseCoefficients _ppfCoeffs;
         vector<float> _coeffs;
@@ -116,6 +155,14 @@ class PPFChanneliser : public AbstractModule
 
         fftwf_plan _fftPlan;
 
+        // Output layout and the strided plan used for the interleaved layout.
+        SpectrumDataSetC32::Layout _layout;
+        fftwf_plan _fftPlanInterleaved;
+        unsigned _interleavedStride;
+
+        // FIR kernel specialised for _nChannels (if a common size).
+        FirKernel<RuntimeChannels>::Function _firKernel;
+
         // Work Buffers (need to have a buffer per thread).
         vector<vector<Complex> > _workBuffer;
         vector<vector<Complex> > _filteredData;
@@ -135,6 +182,18 @@ inline void PPFChanneliser::_fft(const Complex* samples, Complex* spectrum)
     fftwf_execute_dft(_fftPlan, (fftwf_complex*)samples, (fftwf_complex*)spectrum);
 }
 
+/**
+ * @details
+ * FFT a vector of nChannels filtered samples writing the spectrum with a
+ * stride of _interleavedStride.
+ */
+inline void PPFChanneliser::_fftInterleaved(const Complex* samples,
+        Complex* spectrum)
+{
+    fftwf_execute_dft(_fftPlanInterleaved, (fftwf_complex*)samples,
+            (fftwf_complex*)spectrum);
+}
+
 // Declare this class as a pelican module.
 PELICAN_DECLARE_MODULE(PPFChanneliser)
 
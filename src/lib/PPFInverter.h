@@ -0,0 +1,154 @@
+#ifndef PPF_INVERTER_H_
+#define PPF_INVERTER_H_
+
+/**
+ * @file PPFInverter.h
+ */
+
+#include "pelican/modules/AbstractModule.h"
+#include "PolyphaseCoefficients.h"
+#include "TimeSeriesDataSet.h"
+#include "SpectrumDataSet.h"
+
+#include <complex>
+#include <vector>
+
+#include <fftw3.h>
+
+namespace pelican {
+
+class ConfigNode;
+
+namespace ampp {
+
+/**
+ * @class PPFInverter
+ *
+ * @brief Module to invert the polyphase channeliser (synthesis filterbank).
+ *
+ * @details Reconstructs the sub-band time series from spectra produced by
+ * the PPFChanneliser and optionally re-channelises it at a different
+ * resolution, so that a higher time resolution product can be formed from
+ * already channelised (or recorded) voltages.
+ *
+ * Each spectrum is inverse FFT'd to recover the FIR filter output, which
+ * for each sample position in the block is the input filtered across blocks
+ * by one polyphase branch of the channeliser filter. The synthesis filter of
+ * each position is the nTaps long least squares inverse of that branch over
+ * the central passband fraction of every channel, so the filter must be the
+ * same as the one used by the channeliser. A critically sampled filterbank
+ * cannot be inverted at the channel edges, where the branches have
+ * (near) zeros; signal there is attenuated. The output is delayed by
+ * nTaps - 1 spectra and the timestamp of the output is corrected for this
+ * delay. Filter history is kept between calls so consecutive blobs give a
+ * continuous time series.
+ *
+ * Example configuration node :
+ *
+ @verbatim
+        <PPFInverter>
+            <outputChannelsPerSubband value="16"/>
+            <processingThreads value="2"/>
+            <filter nTaps="8" filterWindow="kaiser"/>
+            <synthesis passband="0.5"/>
+            <cache directory="/var/cache/pelican"/>
+        </PPFInverter>
+ @endverbatim
+ *
+ * - @b outputChannelsPerSubband: The number of channels generated by the
+ *   re-channelising run() method. When producing a time series this is the
+ *   number of samples per time block, so the output can be fed to a
+ *   PPFChanneliser configured with the same number of channels.
+ *   The number of input samples per call (time blocks x input channels)
+ *   must be a multiple of this value, which must be even (or 1). The
+ *   re-channelised spectra have the sub-band centre (DC) in channel
+ *   outputChannelsPerSubband / 2, as the PPFChanneliser output does.
+ *
+ * - @b processingThreads: The number of threads to parallelise over.
+ *
+ * - @b filter: As for the PPFChanneliser that produced the spectra.
+ *
+ * - @b synthesis: The fraction of each channel, centred on the channel,
+ *   over which the synthesis filter inverts the channeliser (0 to 1). A
+ *   wider passband reconstructs more of the band less accurately.
+ *
+ * - @b cache: Optional coefficient cache directory (see PPFChanneliser).
+ *
+ * Voltages written to disk by H5_LofarBFVoltageWriter can be read back for
+ * offline processing with BFVoltageRawReader.
+ */
+
+class PPFInverter : public AbstractModule
+{
+    private:
+        friend class PPFInverterTest;
+        typedef std::complex<float> Complex;
+
+    public:
+        /// Constructs the inverter module.
+        PPFInverter(const ConfigNode& config);
+
+        /// Destroys the inverter module.
+        ~PPFInverter();
+
+        /// Reconstruct the sub-band time series from a set of spectra.
+        void run(const SpectrumDataSetC32* spectra,
+                TimeSeriesDataSetC32* timeSeries);
+
+        /// Reconstruct the sub-band time series and re-channelise it to
+        /// outputChannelsPerSubband channels.
+        void run(const SpectrumDataSetC32* spectra,
+                SpectrumDataSetC32* rechannelised);
+
+    private:
+        /// Set up the coefficients, plans and buffers for the input dimensions.
+        void _setup(unsigned nSubbands, unsigned nPolarisations,
+                unsigned nChannels);
+
+        /// Design the synthesis filter for one sample position.
+        void _designSynthesis(const double* coeffs, unsigned nChannels,
+                unsigned c, double* f) const;
+
+        /// Synthesise one spectrum worth of time samples for a sub-band and
+        /// polarisation.
+        void _synthesise(const Complex* spectrum, unsigned stride,
+                unsigned iStream, Complex* scratch, Complex* output);
+
+        /// Return an error message.
+        QString _err(const QString& message);
+
+    private:
+        unsigned _nOutChannels;
+        unsigned _nThreads;
+        unsigned _nTaps;
+        double _passband;
+        PolyphaseCoefficients::FirWindow _window;
+        QString _cacheDir;
+
+        // Input dimensions the module has been set up for.
+        unsigned _nChannels;
+        unsigned _nStreams;
+
+        std::vector<float> _coeffs;   // nTaps x nChannels synthesis filter.
+
+        // Filter history (nTaps blocks) and newest block per stream.
+        std::vector<std::vector<Complex> > _history;
+        std::vector<unsigned> _iNewest;
+
+        // Per thread work buffers.
+        std::vector<std::vector<Complex> > _scratch;
+
+        fftwf_plan _ifftPlan;
+        fftwf_plan _fftPlan;
+
+        // Reconstructed series used when re-channelising.
+        TimeSeriesDataSetC32 _timeSeries;
+};
+
+// Declare this class as a pelican module.
+PELICAN_DECLARE_MODULE(PPFInverter)
+
+}// namespace ampp
+}// namespace pelican
+
+#endif // PPF_INVERTER_H_
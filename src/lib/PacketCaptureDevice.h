@@ -0,0 +1,241 @@
+#ifndef PACKETCAPTUREDEVICE_H
+#define PACKETCAPTUREDEVICE_H
+
+#include "PacketRing.h"
+#include "UdpBatchReceiver.h"
+#include "Metrics.h"
+#include "PacketCaptureFile.h"
+
+#include <QtCore/QIODevice>
+#include <QtCore/QThread>
+#include <QtCore/QString>
+#include <QtCore/QAtomicInt>
+#include <vector>
+
+/**
+ * @file PacketCaptureDevice.h
+ */
+
+namespace pelican {
+class ConfigNode;
+
+namespace ampp {
+class PacketCaptureDevice;
+
+/**
+ * @class PacketCaptureThread
+ *
+ * @brief
+ *    Dedicated thread receiving UDP packets into a PacketRing.
+ *
+ * @details
+ *    Runs (optionally pinned to one core) reading batches of datagrams with
+ *    UdpBatchReceiver straight into the free slots of the ring. When the
+ *    ring is full the socket is still drained and the packets are counted as
+ *    dropped at the ring, rather than being lost silently in the kernel.
+ */
+class PacketCaptureThread : public QThread
+{
+    public:
+        PacketCaptureThread(PacketCaptureDevice* device, int socketDescriptor,
+                            int cpu);
+        ~PacketCaptureThread();
+
+        void run();
+        void stop();
+
+        /// Pin the calling thread to the given core (does nothing if cpu < 0).
+        static bool pinCurrentThread(int cpu);
+
+    private:
+        PacketCaptureDevice* _device;
+        int _socket;
+        int _cpu;
+        volatile bool _halt;
+};
+
+/**
+ * @class PacketReplayThread
+ *
+ * @brief
+ *    Thread feeding the packets of a capture file into a PacketRing.
+ *
+ * @details
+ *    Takes the place of PacketCaptureThread when the device replays a file.
+ *    Packets are offered as fast as the ring takes them, at their recorded
+ *    times or at a fixed rate. A full ring is waited on rather than counted
+ *    as dropped, so every packet of the file reaches the chunker and runs
+ *    are repeatable.
+ */
+class PacketReplayThread : public QThread
+{
+    public:
+        PacketReplayThread(PacketCaptureDevice* device, int cpu);
+        ~PacketReplayThread();
+
+        void run();
+        void stop();
+
+    private:
+        // Wait until time (ns, CLOCK_MONOTONIC), returning false if stopped.
+        bool _sleepUntil(quint64 time);
+        static quint64 _now();
+
+    private:
+        PacketCaptureDevice* _device;
+        int _cpu;
+        volatile bool _halt;
+};
+
+/**
+ * @class PacketCaptureDevice
+ *
+ * @brief
+ *    QIODevice returned by the UDP chunkers when packet capture is enabled.
+ *
+ * @details
+ *    Owns a native UDP socket, a PacketRing and the PacketCaptureThread
+ *    filling it. The chunker's next() runs as the assembler on the other side
+ *    of the ring: readyRead() is raised (queued, at most once until the
+ *    chunker calls acknowledge()) whenever new packets are committed.
+ *
+ *    Capture is configured in the chunker's XML node, in addition to the
+ *    socket options used by UdpBatchReceiver:
+ *
+ * @verbatim
+ *    <capture ringSlots="65536" cpu="2" assemblerCpu="3"/>
+ *    <socket batch="64" receiveBuffer="67108864"/>
+ * @endverbatim
+ *
+ *    Capture is disabled (the chunker uses its socket directly) when
+ *    ringSlots is 0, which is the default.
+ *
+ *    Instead of a socket the packets can be read from a capture file made
+ *    with the packetRecorder program, for repeatable throughput tests of any
+ *    UDP chunker:
+ *
+ * @verbatim
+ *    <replay file="k7.cap" rate="max" loops="0"/>
+ * @endverbatim
+ *
+ *    rate is "max" (as fast as the chunker takes them, the default),
+ *    "recorded" (the recorded packet times) or a number of packets per
+ *    second; loops is the number of passes over the file (0 repeats it until
+ *    the chunker is stopped, the default is 1). Replay enables capture with
+ *    a default of 65536 ring slots.
+ *
+ *    Chunkers that read one datagram at a time use the static
+ *    receiveDatagram() and discardDatagram() helpers, which work for both a
+ *    QUdpSocket and a PacketCaptureDevice.
+ */
+class PacketCaptureDevice : public QIODevice
+{
+    friend class PacketCaptureThread;
+    friend class PacketReplayThread;
+
+    public:
+        /// Capture settings read from a chunker configuration node.
+        struct Config {
+            Config() : ringSlots(0), batch(64), receiveBuffer(67108864),
+                       cpu(-1), assemblerCpu(-1), replayRate(0.0),
+                       replayLoops(1) {}
+            Config(const ConfigNode& config);
+            bool enabled() const { return ringSlots > 0; }
+            bool replay() const { return ! replayFile.isEmpty(); }
+
+            unsigned ringSlots;
+            unsigned batch;
+            int receiveBuffer;
+            int cpu;
+            int assemblerCpu;
+
+            QString replayFile;
+            double replayRate;      // Packets/s, 0 for max, < 0 for recorded.
+            unsigned replayLoops;   // 0 for forever.
+        };
+
+    public:
+        /// Create a device for packets of packetSize bytes. Segments may be
+        /// added to receiver() before bind() to keep only part of each packet.
+        PacketCaptureDevice(const Config& config, unsigned packetSize);
+        ~PacketCaptureDevice();
+
+        /// Access the receiver to describe the packet segments to keep.
+        UdpBatchReceiver& receiver() { return _receiver; }
+
+        /// Bind the socket and start the capture thread. When replaying a
+        /// file, open it and start the replay thread instead (the port only
+        /// names the metrics).
+        bool bind(const QString& host, quint16 port);
+
+        /// Error message for a failed bind().
+        const QString& bindError() const { return _error; }
+
+        /// Called by the chunker at the start of next(): re-arms the readyRead()
+        /// notification and pins the calling thread to the assembler core.
+        void acknowledge();
+
+        /// True if there are packets in the ring.
+        bool hasPendingDatagrams() const { return _ring && _ring->size() > 0; }
+
+        /// Copy the next packet into data, returning the packet length
+        /// (0 if none is available).
+        qint64 readDatagram(char* data, qint64 maxSize);
+
+        /// Copy up to maxPackets packets into consecutive slots of dest,
+        /// waiting up to timeoutMs for the first. Returns the number copied.
+        int readDatagrams(char* dest, unsigned maxPackets, unsigned* lengths,
+                          int timeoutMs);
+
+        /// Size of the kept part of each packet.
+        unsigned slotSize() const { return _receiver.slotSize(); }
+
+        /// Number of packets dropped at the ring.
+        unsigned long dropped() const { return _ring ? _ring->dropped() : 0; }
+
+        // QIODevice interface.
+        bool isSequential() const { return true; }
+        qint64 bytesAvailable() const;
+        bool waitForReadyRead(int msecs);
+
+        /// Blocking read of one datagram from a QUdpSocket or a capture device.
+        static qint64 receiveDatagram(QIODevice* device, char* data, qint64 maxSize);
+
+        /// Non blocking discard of one datagram.
+        static void discardDatagram(QIODevice* device);
+
+        /// acknowledge() if the device is a PacketCaptureDevice.
+        static void acknowledge(QIODevice* device);
+
+    protected:
+        qint64 readData(char* data, qint64 maxSize);
+        qint64 writeData(const char*, qint64) { return -1; }
+
+    private:
+        // Called by the capture thread after committing packets.
+        void _notify();
+
+        // bind() for replay from a capture file.
+        bool _bindReplay(quint16 port);
+
+    private:
+        Config _config;
+        UdpBatchReceiver _receiver;
+        PacketRing* _ring;
+        PacketCaptureReader* _reader;
+        QThread* _thread;
+        unsigned _packetSize;
+        int _socket;
+        QString _error;
+        QAtomicInt _signalled;
+        bool _assemblerPinned;
+
+        // Ring occupancy and drops, registered as "PacketCapture.<port>.*".
+        MetricGauge* _ringDepth;
+        MetricCounter* _ringDropped;
+        MetricCounter* _replayed;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETCAPTUREDEVICE_H
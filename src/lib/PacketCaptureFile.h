@@ -0,0 +1,152 @@
+#ifndef PACKETCAPTUREFILE_H
+#define PACKETCAPTUREFILE_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QString>
+#include <cstdio>
+
+/**
+ * @file PacketCaptureFile.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class PacketCaptureFile
+ *
+ * @brief
+ *    Layout of the raw packet capture files.
+ *
+ * @details
+ *    A capture file is a FileHeader followed by one record per datagram: a
+ *    RecordHeader and the captured bytes, padded to a multiple of 8 bytes.
+ *    All fields are in host byte order (the files are meant to be replayed
+ *    on the kind of machine they were recorded on). Times are in
+ *    nanoseconds, records holding the time since the start of the capture.
+ *
+ *    Packets are written by PacketCaptureWriter (see the packetRecorder
+ *    program) and replayed into any UDP chunker with PacketCaptureDevice.
+ */
+class PacketCaptureFile
+{
+    public:
+        static const quint32 version = 1;
+
+        struct FileHeader {
+            char magic[8];          // "AMPPCAP"
+            quint32 version;
+            quint32 snapLength;     // Maximum bytes kept per datagram.
+            quint64 startTime;      // Unix time of the start, in ns.
+        };
+
+        struct RecordHeader {
+            quint64 time;           // Time since startTime, in ns.
+            quint32 length;         // Length of the datagram received.
+            quint32 captured;       // Bytes stored (at most snapLength).
+        };
+
+        /// The magic string at the start of a capture file.
+        static const char* magic() { return "AMPPCAP"; }
+
+        /// Size of a record holding @p captured bytes, including its padding.
+        static size_t recordSize(quint32 captured) {
+            return sizeof(RecordHeader) + ((captured + 7) & ~7U);
+        }
+
+        /// Current time in ns (CLOCK_REALTIME).
+        static quint64 now();
+};
+
+/**
+ * @class PacketCaptureWriter
+ *
+ * @brief
+ *    Writes datagrams to a capture file.
+ */
+class PacketCaptureWriter
+{
+    public:
+        PacketCaptureWriter();
+        ~PacketCaptureWriter();
+
+        /// Create the file, keeping at most @p snapLength bytes per datagram.
+        bool open(const QString& fileName, quint32 snapLength);
+
+        /// Append a datagram of @p length bytes received at @p time (ns, as
+        /// returned by PacketCaptureFile::now()).
+        bool write(const char* data, quint32 length, quint64 time);
+
+        /// Flush and close the file.
+        void close();
+
+        bool isOpen() const { return _file != 0; }
+
+        /// Number of datagrams written.
+        quint64 packets() const { return _packets; }
+
+    private:
+        PacketCaptureWriter(const PacketCaptureWriter&);
+        PacketCaptureWriter& operator=(const PacketCaptureWriter&);
+
+    private:
+        std::FILE* _file;
+        quint32 _snapLength;
+        quint64 _startTime;
+        quint64 _packets;
+};
+
+/**
+ * @class PacketCaptureReader
+ *
+ * @brief
+ *    Reads the datagrams of a capture file mapped into memory.
+ */
+class PacketCaptureReader
+{
+    public:
+        /// A datagram of the file (pointing into the mapped file).
+        struct Record {
+            const char* data;
+            quint32 length;
+            quint32 captured;
+            quint64 time;
+        };
+
+    public:
+        PacketCaptureReader();
+        ~PacketCaptureReader();
+
+        /// Map the file, returning false (see error()) if it is not a
+        /// capture file.
+        bool open(const QString& fileName);
+
+        /// Unmap the file.
+        void close();
+
+        /// Read the next record, returning false at the end of the file (or
+        /// at a record truncated by an interrupted recording).
+        bool read(Record& record);
+
+        /// Go back to the first record.
+        void rewind() { _position = sizeof(PacketCaptureFile::FileHeader); }
+
+        const PacketCaptureFile::FileHeader& header() const { return _header; }
+        const QString& error() const { return _error; }
+
+    private:
+        PacketCaptureReader(const PacketCaptureReader&);
+        PacketCaptureReader& operator=(const PacketCaptureReader&);
+
+    private:
+        const char* _map;
+        size_t _size;
+        size_t _position;
+        PacketCaptureFile::FileHeader _header;
+        QString _error;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETCAPTUREFILE_H
@@ -0,0 +1,147 @@
+#ifndef PACKETREORDERWINDOW_H
+#define PACKETREORDERWINDOW_H
+
+#include <QtCore/QtGlobal>
+#include <vector>
+
+/**
+ * @file PacketReorderWindow.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class PacketReorderWindow
+ *
+ * @brief
+ *    Places sequence numbered packets into their slots in a chunk.
+ *
+ * @details
+ *    A chunk holds the packets with sequence numbers [first, first + slots).
+ *    Packets arriving out of order are copied into their own slot, packets
+ *    whose slot is already filled are counted as duplicates and packets for a
+ *    chunk that has already been closed are counted as late. Packets for the
+ *    following chunks are kept aside and placed when the next chunk is
+ *    started.
+ *
+ *    The chunk is complete when all of its slots are filled, or once a packet
+ *    @p window sequence numbers past its last slot has been seen: the slots
+ *    still empty at that point are the true gaps and left to the caller to
+ *    fill.
+ *
+ *    Packets received directly into the chunk are accepted without a copy
+ *    with claim() when they already sit in their own slot.
+ */
+class PacketReorderWindow
+{
+    public:
+        /// Outcome of placing a packet.
+        enum Status { Placed, Carried, Duplicate, Late, Overflow };
+
+    public:
+        /// Create a window for chunks of @p slots packets of @p slotSize bytes,
+        /// keeping up to @p carrySlots packets for the following chunks.
+        PacketReorderWindow(unsigned slots, unsigned slotSize, unsigned window,
+                            unsigned carrySlots);
+        ~PacketReorderWindow();
+
+        /// Begin a new chunk following the previous one (or the sequence
+        /// given to resync()), placing any packets kept for it.
+        void start(char* chunk);
+
+        /// Make @p sequence the first packet of the current chunk if nothing
+        /// has been placed yet, otherwise close the chunk and start the next
+        /// one at @p sequence. Packets kept for later chunks are discarded.
+        /// The packet of @p sequence is at stream @p position, packets
+        /// following it @p step apart (by default the position is the
+        /// sequence number).
+        void resync(quint64 sequence, quint64 position, unsigned step = 1);
+        void resync(quint64 sequence) { resync(sequence, sequence); }
+
+        /// Accept a packet already received into @p slot of the chunk if that
+        /// is its own slot and the slot is empty.
+        inline bool claim(quint64 sequence, unsigned slot);
+
+        /// Copy a packet into its slot, or keep it for a later chunk.
+        Status place(quint64 sequence, const char* packet);
+
+        /// True when no more packets are expected for the current chunk.
+        bool complete() const;
+
+        /// First empty slot after the last one filled, setting @p count to
+        /// the number of contiguous empty slots from there (the place where
+        /// the next packets are expected).
+        unsigned freeRun(unsigned& count) const;
+
+        /// True if the slot holds a packet.
+        bool filled(unsigned slot) const { return _filled[slot] != 0; }
+
+        /// Sequence number of the first slot of the current chunk.
+        quint64 first() const { return _first; }
+
+        /// Stream position of the packet due in @p slot of the current
+        /// chunk (e.g. the sample number, for the header of an empty packet),
+        /// counted from the packet the stream was last resynchronised on.
+        quint64 position(unsigned slot) const
+        { return _origin + (_first + slot - _originSequence) * _step; }
+
+        /// Number of slots filled in the current chunk.
+        unsigned placed() const { return _placed; }
+
+        /// Number of slots per chunk.
+        unsigned slots() const { return _slots; }
+
+        /// Number of packets currently kept for later chunks.
+        unsigned carried() const { return _nCarried; }
+
+        /// Totals since construction.
+        unsigned long duplicates() const { return _duplicates; }
+        unsigned long late() const { return _late; }
+        unsigned long overflows() const { return _overflows; }
+
+    private:
+        void _fill(unsigned slot, quint64 sequence);
+        void _seen(quint64 sequence);
+
+    private:
+        char* _chunk;
+        unsigned _slots;
+        unsigned _slotSize;
+        unsigned _window;
+        quint64 _first;
+        quint64 _next;
+        quint64 _latest;
+        quint64 _origin;         // position of _originSequence
+        quint64 _originSequence;
+        unsigned _step;
+        quint64 _nextOrigin;     // the same for the chunk after a resync
+        quint64 _nextOriginSequence;
+        unsigned _nextStep;
+        bool _hasLatest;
+        bool _closed;
+        unsigned _placed;
+        unsigned _end;
+        std::vector<char> _filled;
+
+        std::vector<char> _carry;
+        std::vector<quint64> _carrySequence;
+        std::vector<char> _carryUsed;
+        unsigned _nCarried;
+
+        unsigned long _duplicates;
+        unsigned long _late;
+        unsigned long _overflows;
+};
+
+inline bool PacketReorderWindow::claim(quint64 sequence, unsigned slot)
+{
+    if( _closed || sequence != _first + slot || _filled[slot] ) return false;
+    _fill(slot, sequence);
+    return true;
+}
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETREORDERWINDOW_H
@@ -0,0 +1,174 @@
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <climits>
+#include <vector>
+#include <cstddef>
+
+/**
+ * @file PacketRing.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class PacketRing
+ *
+ * @brief
+ *    Lock-free single producer / single consumer ring of fixed size packet slots.
+ *
+ * @details
+ *    The producer (a capture thread) asks for a run of contiguous free slots,
+ *    fills them and commits them; the consumer (the chunk assembler) asks for a
+ *    run of contiguous filled slots, uses them in place and releases them.
+ *    Each side owns one index and only reads the other's index (with acquire
+ *    semantics) when its cached copy says the ring is full or empty, so the
+ *    steady state costs one atomic store per batch on each side.
+ *
+ *    Either side can block until the other has made progress with
+ *    waitForData() or waitForSpace(). A waiting side raises a flag before it
+ *    sleeps on a condition variable, and the other side only takes the mutex
+ *    to wake it when that flag is set, so the fast path stays lock free.
+ *
+ *    The number of slots is rounded up to a power of two. Packets that the
+ *    producer could not store because the ring was full are recorded with
+ *    countDropped().
+ */
+class PacketRing
+{
+    public:
+        PacketRing(unsigned nSlots, unsigned slotSize);
+        ~PacketRing();
+
+        /// Size of each slot in bytes.
+        unsigned slotSize() const { return _slotSize; }
+
+        /// Number of slots.
+        unsigned capacity() const { return _mask + 1; }
+
+        /// Number of filled slots (approximate when called from a third thread).
+        unsigned size() const;
+
+        /// Total number of packets dropped because the ring was full.
+        unsigned long dropped() const { return (unsigned)(int)_dropped; }
+
+        // Producer side.
+
+        /// Return the first of up to @p count contiguous free slots, setting
+        /// @p count to the number available (possibly 0).
+        inline char* writeSlots(unsigned& count);
+
+        /// Publish @p n slots filled since writeSlots() with their lengths.
+        inline void commit(unsigned n, const unsigned* lengths);
+
+        /// Record packets that were received but could not be stored.
+        void countDropped(unsigned n) { _dropped.fetchAndAddRelaxed((int)n); }
+
+        /// Block until at least one slot is free, returning false if none
+        /// has been freed within @p msecs ms (ULONG_MAX is never).
+        bool waitForSpace(unsigned long msecs = ULONG_MAX);
+
+        // Consumer side.
+
+        /// Return the first of up to @p count contiguous filled slots, setting
+        /// @p count to the number available and @p lengths to their lengths.
+        inline const char* readSlots(unsigned& count, const unsigned*& lengths);
+
+        /// Hand @p n slots obtained with readSlots() back to the producer.
+        inline void release(unsigned n);
+
+        /// Block until at least one slot is filled, returning false if none
+        /// has been committed within @p msecs ms (ULONG_MAX is never).
+        bool waitForData(unsigned long msecs = ULONG_MAX);
+
+    private:
+        PacketRing(const PacketRing&);
+        PacketRing& operator=(const PacketRing&);
+
+        // Loads the other side's index with acquire semantics.
+        static inline unsigned _acquire(QAtomicInt& index) {
+            return (unsigned)index.fetchAndAddAcquire(0);
+        }
+
+        // Wakes the other side if it is waiting.
+        void _wake(QWaitCondition& condition);
+
+    private:
+        unsigned _mask;
+        unsigned _slotSize;
+        std::vector<char> _data;
+        std::vector<unsigned> _lengths;
+
+        // Producer state (kept on its own cache line).
+        char _pad0[64];
+        QAtomicInt _head;
+        unsigned _cachedTail;
+
+        // Consumer state.
+        char _pad1[64];
+        QAtomicInt _tail;
+        unsigned _cachedHead;
+
+        char _pad2[64];
+        QAtomicInt _dropped;
+
+        // Set while the consumer (producer) waits for data (space).
+        QAtomicInt _consumerWaiting;
+        QAtomicInt _producerWaiting;
+        QMutex _mutex;
+        QWaitCondition _dataReady;
+        QWaitCondition _spaceReady;
+};
+
+inline char* PacketRing::writeSlots(unsigned& count)
+{
+    unsigned head = (unsigned)(int)_head;
+    unsigned capacity = _mask + 1;
+    if( capacity - (head - _cachedTail) < count )
+        _cachedTail = _acquire(_tail);
+    unsigned available = capacity - (head - _cachedTail);
+    unsigned contiguous = capacity - (head & _mask);
+    if( available > contiguous ) available = contiguous;
+    if( count > available ) count = available;
+    return &_data[(size_t)(head & _mask) * _slotSize];
+}
+
+inline void PacketRing::commit(unsigned n, const unsigned* lengths)
+{
+    unsigned head = (unsigned)(int)_head;
+    unsigned* dest = &_lengths[head & _mask];
+    for( unsigned i = 0; i < n; ++i )
+        dest[i] = lengths[i];
+    // Ordered so that the flag is read after the slots are published.
+    _head.fetchAndStoreOrdered((int)(head + n));
+    if( (int)_consumerWaiting ) _wake(_dataReady);
+}
+
+inline const char* PacketRing::readSlots(unsigned& count, const unsigned*& lengths)
+{
+    unsigned tail = (unsigned)(int)_tail;
+    if( _cachedHead - tail < count )
+        _cachedHead = _acquire(_head);
+    unsigned available = _cachedHead - tail;
+    unsigned contiguous = (_mask + 1) - (tail & _mask);
+    if( available > contiguous ) available = contiguous;
+    if( count > available ) count = available;
+    lengths = &_lengths[tail & _mask];
+    return &_data[(size_t)(tail & _mask) * _slotSize];
+}
+
+inline void PacketRing::release(unsigned n)
+{
+    unsigned tail = (unsigned)(int)_tail;
+    _tail.fetchAndStoreOrdered((int)(tail + n));
+    if( (int)_producerWaiting ) _wake(_spaceReady);
+}
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETRING_H
@@ -131,9 +131,28 @@ class PolyphaseCoefficients : public T_PolyphaseCoefficients<double>
         void load(const QString& fileName, unsigned nFilterTaps,
                 unsigned nChannels);
 
+        /// Generate the coefficients. Those of odd channels are negated,
+        /// which puts DC in channel nChannels / 2 of the channelised output.
         void genereateFilter(unsigned nTaps, unsigned nChannels,
                 FirWindow windowType = KAISER);
 
+        /// Load previously generated coefficients from a binary cache file.
+        /// Returns false if the file is missing or was generated for
+        /// different parameters.
+        bool loadCache(const QString& fileName, unsigned nTaps,
+                unsigned nChannels, FirWindow windowType);
+
+        /// Write the current coefficients to a binary cache file.
+        void saveCache(const QString& fileName, FirWindow windowType) const;
+
+        /// Returns the name of the cache file for the given parameters.
+        static QString cacheFileName(const QString& directory, unsigned nTaps,
+                unsigned nChannels, FirWindow windowType);
+
+    private:
+        static const quint32 _cacheMagic = 0x50504643; // "PPFC"
+        static const quint32 _cacheVersion = 1;
+
     private:
         // The following methods are taken from LOFAR CNProc FIR.cc under GPL
         double _besselI0(double x);
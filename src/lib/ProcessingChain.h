@@ -3,6 +3,7 @@
 #include <QMutex>
 #include <QHash>
 #include <boost/function.hpp> 
+#include "CompletionCounter.h"
 
 
 /**
@@ -28,11 +29,13 @@ class ProcessingChain
         typedef boost::function0<void> CallBackT;
 
     public:
-        ProcessingChain();
+        /// name: prefix of the telemetry of the chains running
+        ProcessingChain( const QString& name );
         ~ProcessingChain();
 
-        /// block thread until all tasks are complete
-        void waitTaskCompletion() const;
+        /// block thread until all tasks are complete, returning false
+        //  if they are not within timeout ms
+        bool waitTaskCompletion( unsigned long timeout = ULONG_MAX ) const;
 
         /// execute the chain, starting with the parallel tasks
         //  and then the post completion task (sequential)
@@ -45,6 +48,7 @@ class ProcessingChain
         QMutex _mutex;
         QHash<unsigned, unsigned> _processCount; // keep a track of threads per _taskId
         unsigned _taskId; // unique identifier for each call to exec()
+        CompletionCounter _running; // calls to exec() not yet finished
 };
 
 } // namespace ampp
@@ -3,7 +3,10 @@
 #include <QMutex>
 #include <QHash>
 #include <boost/function.hpp> 
+#include <boost/bind.hpp>
 #include <QtConcurrentRun>
+#include "CompletionCounter.h"
+#include "WorkerPool.h"
 
 
 /**
@@ -21,7 +24,11 @@ namespace ampp {
  *    A container to launch and monitor processing stages
  *    Functors for the Parrallel stages to take a single argument
  * @details
- * 
+ *    Each exec() is counted as outstanding until its post tasks have
+ *    run; waitTaskCompletion() sleeps until none are left.
+ *
+ *    The parallel tasks run on the QtConcurrent pool unless a WorkerPool
+ *    is set with setPool().
  */
 
 template<typename argT>
@@ -32,17 +39,25 @@ class ProcessingChain1
         typedef boost::function0<void> PostCallBackT;
 
     public:
-        ProcessingChain1() : _taskId(0) {};
+        /// name: prefix of the telemetry of the chains running
+        ProcessingChain1( const QString& name ) : _taskId(0), _running(name), _pool(0) {};
         ~ProcessingChain1() {
             waitTaskCompletion();
         };
 
-        void waitTaskCompletion() const {
-            while( _processCount.size() ) {
-                usleep(10);
-            }
+        /// block thread until all tasks are complete, returning false
+        //  if they are not within timeout ms
+        bool waitTaskCompletion( unsigned long timeout = ULONG_MAX ) const {
+            return _running.wait( timeout );
         }
 
+        /// the chains running and the highest number ever running at once
+        const CompletionCounter& running() const { return _running; }
+
+        /// run the parallel tasks on pool (not owned) rather than
+        //  on the QtConcurrent pool
+        void setPool( WorkerPool* pool ) { _pool = pool; }
+
         /// execute the chain, starting with the parallel tasks
         //  and then the post completion task (sequential)
         //  This function is thread safe and re-entrant
@@ -53,14 +68,25 @@ class ProcessingChain1
                     _finished( postTasks );
                  }
                  else {
-                    QMutexLocker lock(&_mutex);
-                    _processCount[++_taskId]=0;
+                    _running.add();
+                    unsigned taskId;
+                    {
+                        QMutexLocker lock(&_mutex);
+                        taskId = ++_taskId;
+                        _processCount[taskId] = parallelTasks.size();
+                    }
                     // each task is launched in a separate thread
+                    // (not holding the lock, as a full pool blocks)
                     foreach( const CallBackT& functor, parallelTasks ) { 
-                        ++_processCount[_taskId];
-                        QtConcurrent::run( this, &ProcessingChain1::_runTask, functor, 
-                                           _taskId, postTasks, arg 
-                                         );
+                        if( _pool ) {
+                            _pool->submit( boost::bind( &ProcessingChain1::_runTask, this,
+                                                        functor, taskId, postTasks, arg ) );
+                        }
+                        else {
+                            QtConcurrent::run( this, &ProcessingChain1::_runTask, functor, 
+                                               taskId, postTasks, arg 
+                                             );
+                        }
                     }
                  }
         }
@@ -69,12 +95,25 @@ class ProcessingChain1
         void _runTask( const CallBackT& functor, unsigned taskId, 
                        const QList<PostCallBackT>& postTasks, const argT& arg )
         {
-             functor( arg );
+             try {
+                 functor( arg );
+             }
+             catch( ... ) {
+                 // still release the data
+                 _taskDone( taskId, postTasks );
+                 throw;
+             }
+             _taskDone( taskId, postTasks );
+        }
+
+        void _taskDone( unsigned taskId, const QList<PostCallBackT>& postTasks )
+        {
              QMutexLocker lock(&_mutex);
              if( --_processCount[taskId] == 0) {
                 _processCount.remove(taskId);
                 lock.unlock(); // allow other tasks to launch
                 _finished( postTasks );
+                _running.done();
              }
         }
 
@@ -90,6 +129,8 @@ class ProcessingChain1
         QMutex _mutex;
         QHash<unsigned, unsigned> _processCount; // keep a track of threads per _taskId
         unsigned _taskId; // unique identifier for each call to exec()
+        CompletionCounter _running; // calls to exec() not yet finished
+        WorkerPool* _pool;
 };
 
 } // namespace ampp
@@ -0,0 +1,131 @@
+#ifndef REALTIMEWATCHDOG_H
+#define REALTIMEWATCHDOG_H
+
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <boost/function.hpp>
+#include <time.h>
+#include "Metrics.h"
+
+/**
+ * @file RealTimeWatchdog.h
+ */
+
+namespace pelican {
+class ConfigNode;
+
+namespace ampp {
+
+/**
+ * @class RealTimeWatchdog
+ *
+ * @brief
+ *    Keeps track of how far a pipeline is behind real time and sheds load
+ *    when it stays behind.
+ *
+ * @details
+ *    Each iteration of the pipeline is timed (start() and stop(), or
+ *    record()) against its budget, the time the chunk covers. The deficit
+ *    is the backlog this builds up: the time over budget, less the time
+ *    under budget since, never below zero. Without shedding the backlog
+ *    ends up as packets dropped by the chunker a whole buffer at a time.
+ *
+ *    The pipeline registers shedding policies with addPolicy(): functors
+ *    called with true to shed (e.g. fewer DM trials) and false to restore.
+ *    While the deficit is over overload() budgets and iterations are still
+ *    over budget, every sustain() iterations the next policy is applied.
+ *    Once the deficit has been zero for recover() iterations the last
+ *    policy applied is restored. Both are logged.
+ *
+ *    Configuration (from the pipeline's config node):
+ *    @verbatim
+ *        <watchdog enable="true" overload="2" sustain="10" recover="100"/>
+ *        <shed policy="boxcars"/>
+ *        <shed policy="dmTrials"/>
+ *    @endverbatim
+ *    The shed tags give the policies to use, in order (all of those
+ *    registered, in the order registered, if there are none). Shedding is
+ *    off unless enabled; the deficit is tracked either way.
+ *
+ *    Telemetry, for watchdog "W": the gauges "W.deficit_us" and
+ *    "W.shedLevel" (the number of policies applied) and the counters
+ *    "W.overBudget" (iterations) and "W.shed" (policies applied).
+ */
+class RealTimeWatchdog
+{
+    public:
+        typedef boost::function1<void, bool> PolicyT;
+
+    public:
+        RealTimeWatchdog( const QString& name );
+        /// restores any policies still applied
+        ~RealTimeWatchdog();
+
+        /// register a shedding policy
+        void addPolicy( const QString& name, const PolicyT& shed );
+
+        /// read the <watchdog> and <shed> options
+        void configure( const ConfigNode& config );
+
+        void setEnabled( bool enabled ) { _enabled = enabled; }
+        bool enabled() const { return _enabled; }
+
+        /// the deficit (in budgets) to shed at, and the iterations it has
+        //  to last to shed and to be gone to restore
+        void setThresholds( double overload, unsigned sustain, unsigned recover );
+        double overload() const { return _overload; }
+        unsigned sustain() const { return _sustain; }
+        unsigned recover() const { return _recover; }
+
+        /// the policies to use, in order of shedding (any applied are
+        //  restored first)
+        void setPolicies( const QStringList& names );
+        QStringList policies() const;
+
+        /// start timing an iteration
+        void start();
+        /// end of the iteration started, which had budget seconds
+        void stop( double budget );
+        /// account for an iteration taking elapsed of budget seconds
+        void record( double elapsed, double budget );
+
+        /// the time (s) behind real time
+        double deficit() const { return _deficit; }
+        /// the number of policies applied
+        int level() const { return _level; }
+
+    private:
+        struct Policy {
+            QString name;
+            PolicyT shed;
+        };
+
+        void _shed();
+        void _restore();
+
+    private:
+        QString _name;
+        bool _enabled;
+        double _overload;
+        unsigned _sustain;
+        unsigned _recover;
+        QList<Policy> _registered;
+        QList<Policy> _active;
+        bool _chosen; // _active set by setPolicies()
+        double _deficit;
+        unsigned _overloaded; // iterations in a row over the threshold
+        unsigned _caughtUp;   // iterations in a row with no deficit
+        int _level;
+        struct timespec _start;
+        bool _running;
+
+        MetricGauge& _deficitGauge;
+        MetricGauge& _levelGauge;
+        MetricCounter& _overBudget;
+        MetricCounter& _shedCount;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // REALTIMEWATCHDOG_H
@@ -0,0 +1,126 @@
+#ifndef SHAREDCHUNKRING_H
+#define SHAREDCHUNKRING_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QString>
+#include <cstddef>
+
+/**
+ * @file SharedChunkRing.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class SharedChunkRing
+ *
+ * @brief
+ *    Ring of chunk buffers in POSIX shared memory, passing chunks from a
+ *    server to a pipeline on the same host without copying them.
+ *
+ * @details
+ *    The server (the producer) creates the segment "/<name>" holding a fixed
+ *    number of slots, fills a slot in place (acquire()) and publishes it
+ *    with the chunk's sequence number; the client (the consumer) attaches to
+ *    the segment by name, uses the published slot in place (next()) and
+ *    hands it back with release().
+ *
+ *    There is one producer and one consumer. Each side only writes its own
+ *    counter in the segment header, so no lock is shared between the two
+ *    processes. A side that has to wait sleeps on a futex in the header
+ *    that the other side bumps and wakes each time it publishes or releases
+ *    a chunk. The producer waits for a free
+ *    slot when the consumer falls behind (back-pressure), up to the timeout
+ *    given to acquire(): a chunk given up by the producer is counted with
+ *    skip() and shows up as a gap in the sequence numbers seen by the
+ *    consumer.
+ *
+ *    The header records the producer's pid and a generation that is
+ *    different for each segment created, so that a consumer can tell with
+ *    stale() that the producer has gone or has been restarted and has
+ *    replaced the segment, and attach again.
+ *
+ *    Constructors throw a QString if the segment cannot be created or is not
+ *    a chunk ring.
+ */
+class SharedChunkRing
+{
+    public:
+        /// Create the segment (replacing any existing one of that name) with
+        /// @p nSlots slots of @p slotSize bytes. The segment is removed when
+        /// the ring is destroyed.
+        SharedChunkRing(const QString& name, unsigned nSlots, size_t slotSize);
+
+        /// Attach to an existing segment.
+        SharedChunkRing(const QString& name);
+
+        ~SharedChunkRing();
+
+        const QString& name() const { return _name; }
+        unsigned slots() const;
+        size_t slotSize() const;
+
+        /// Number of published chunks not yet released by the consumer.
+        unsigned size() const;
+
+        // Producer side.
+
+        /// Return the next free slot, waiting up to @p timeoutMs (-1 for
+        /// ever) for the consumer to release one. Returns 0 on timeout.
+        char* acquire(int timeoutMs);
+
+        /// Publish @p bytes of the slot returned by acquire(), returning the
+        /// sequence number given to the chunk.
+        quint64 publish(size_t bytes);
+
+        /// Give up the current chunk: its sequence number is not published.
+        void skip();
+
+        /// Number of chunks skipped by the producer.
+        quint64 skipped() const;
+
+        // Consumer side.
+
+        /// Return the next published chunk, setting its size and sequence
+        /// number, waiting up to @p timeoutMs (-1 for ever). Returns 0 on
+        /// timeout or, with nothing left to read, once the producer has
+        /// closed the ring.
+        const char* next(size_t& bytes, quint64& sequence, int timeoutMs);
+
+        /// Hand the chunk returned by next() back to the producer.
+        void release();
+
+        /// True once the producer has closed the ring, its process has gone
+        /// or the segment has been replaced by a new one of the same name.
+        bool stale() const;
+
+    private:
+        struct Header;
+        struct Slot;
+
+    private:
+        SharedChunkRing(const SharedChunkRing&);
+        SharedChunkRing& operator=(const SharedChunkRing&);
+
+        void _attach(int fd, size_t size, bool create);
+        bool _current() const;
+        Slot* _slot(quint64 index) const;
+        char* _data(quint64 index) const;
+        static quint64 _load(const volatile quint64& value);
+        static void _store(volatile quint64& value, quint64 v);
+        static void _wait(volatile quint32& word, quint32 value, unsigned long ms);
+        static void _wake(volatile quint32& word);
+
+    private:
+        QString _name;
+        bool _owner;
+        char* _map;
+        size_t _size;
+        Header* _header;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // SHAREDCHUNKRING_H
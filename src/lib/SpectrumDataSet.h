@@ -88,13 +88,12 @@ class SpectrumDataSetBase : public DataBlob
 template <class T>
 class SpectrumDataSet : public SpectrumDataSetBase
 {
-    private:
-        // Copy constructor
+    protected:
+        // Copy constructor (for the copy constructors of the concrete blobs)
         SpectrumDataSet(const SpectrumDataSet& spec)
-        : SpectrumDataSetBase(static_cast<const SpectrumDataSetBase&>(spec))
-        {
-            std::copy(spec.begin(), spec.end(), _data.begin());
-        }
+        : SpectrumDataSetBase(static_cast<const SpectrumDataSetBase&>(spec)),
+          _data(spec._data)
+        {}
 
     public:
         /// Constructs an empty sub-band spectra data blob.
@@ -257,19 +256,86 @@ unsigned long SpectrumDataSet<T>::_index(unsigned s, unsigned p, unsigned b) con
  *
  * @details Inherits from the SubbandSpectra template class.
  *
+ * The data can be held in one of two layouts:
+ *  - @b PolarisationBlocks (default): time block -> sub-band -> polarisation
+ *    -> channel, i.e. each polarisation is a contiguous spectrum as described
+ *    by SpectrumDataSetBase::index().
+ *  - @b PolarisationInterleaved: time block -> sub-band -> channel ->
+ *    polarisation, i.e. the polarisations of each channel are adjacent so a
+ *    detector can consume X and Y in a single sequential pass.
+ *
+ * spectrumData(b, s, p) returns the first channel of a spectrum in either
+ * layout; successive channels are channelStride() elements apart. The
+ * sample() and sampleIndex() accessors are valid for both layouts.
+ * The serialised form is always PolarisationBlocks.
  */
 
 class SpectrumDataSetC32 : public SpectrumDataSet<std::complex<float> >
 {
+    public:
+        typedef enum { PolarisationBlocks, PolarisationInterleaved } Layout;
+
     public:
         /// Constructor.
         SpectrumDataSetC32()
-        : SpectrumDataSet<std::complex<float> >("SpectrumDataSetC32") {}
+        : SpectrumDataSet<std::complex<float> >("SpectrumDataSetC32"),
+          _layout(PolarisationBlocks) {}
 
         /// Destructor.
         virtual ~SpectrumDataSetC32() {}
 
     public:
+        using SpectrumDataSetBase::index;
+        using SpectrumDataSet<std::complex<float> >::spectrumData;
+
+        /// Set the memory layout of the data (does not reorder existing data).
+        void setLayout(Layout layout) { _layout = layout; }
+
+        /// Return the memory layout of the data.
+        Layout layout() const { return _layout; }
+
+        /// Returns the number of elements between successive channels of
+        /// the same spectrum.
+        inline unsigned channelStride() const {
+            return (_layout == PolarisationInterleaved) ? _nPolarisations : 1;
+        }
+
+        /// Calculates the index of channel @p c of the spectrum for block
+        /// @p b, sub-band @p s and polarisation @p p in the given layout.
+        static inline long index(unsigned subband, unsigned numSubbands,
+                unsigned polarisation, unsigned numPolarisations,
+                unsigned block, unsigned numChannels, unsigned channel,
+                Layout layout);
+
+        /// Returns the data index of channel @p c for block @p b,
+        /// sub-band @p s and polarisation @p p in the current layout.
+        inline long sampleIndex(unsigned b, unsigned s, unsigned p,
+                unsigned c) const {
+            return index(s, _nSubbands, p, _nPolarisations, b, _nChannels, c,
+                    _layout);
+        }
+
+        /// Returns a reference to a single sample in the current layout.
+        std::complex<float>& sample(unsigned b, unsigned s, unsigned p,
+                unsigned c) { return _data[sampleIndex(b, s, p, c)]; }
+
+        /// Returns a reference to a single sample in the current layout
+        /// (const overload).
+        const std::complex<float>& sample(unsigned b, unsigned s, unsigned p,
+                unsigned c) const { return _data[sampleIndex(b, s, p, c)]; }
+
+        /// Returns a pointer to the first channel of the spectrum for block
+        /// @p b, sub-band @p s and polarisation @p p. Channels are
+        /// channelStride() elements apart.
+        std::complex<float>* spectrumData(unsigned b, unsigned s, unsigned p)
+        { return &_data[sampleIndex(b, s, p, 0)]; }
+
+        /// Returns a pointer to the first channel of the spectrum
+        /// (const overload).
+        const std::complex<float>* spectrumData(unsigned b, unsigned s,
+                unsigned p) const
+        { return &_data[sampleIndex(b, s, p, 0)]; }
+
         /// Write the spectrum to file.
         void write(const QString& fileName,
                 int s = -1, int p = -1, int b = -1) const;
@@ -286,8 +352,23 @@ class SpectrumDataSetC32 : public SpectrumDataSet<std::complex<float> >
         virtual inline unsigned nPolarisationComponents() const { 
             return _nPolarisations*2;
         }
+
+    private:
+        Layout _layout;
 };
 
+inline long SpectrumDataSetC32::index(unsigned subband, unsigned numSubbands,
+        unsigned polarisation, unsigned numPolarisations, unsigned block,
+        unsigned numChannels, unsigned channel, Layout layout)
+{
+    if (layout == PolarisationInterleaved) {
+        return numChannels * numPolarisations * ( numSubbands * block + subband )
+                + channel * numPolarisations + polarisation;
+    }
+    return SpectrumDataSetBase::index(subband, numSubbands, polarisation,
+            numPolarisations, block, numChannels) + channel;
+}
+
 
 
 /**
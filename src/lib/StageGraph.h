@@ -0,0 +1,202 @@
+#ifndef STAGEGRAPH_H
+#define STAGEGRAPH_H
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <boost/function.hpp>
+#include "CompletionCounter.h"
+#include "Metrics.h"
+
+/**
+ * @file StageGraph.h
+ */
+
+namespace pelican {
+class DataBlob;
+class ConfigNode;
+
+namespace ampp {
+
+/**
+ * @class StageGraph
+ *
+ * @brief
+ *    Runs a chain of processing stages on DataBlobs, pipelined.
+ *
+ * @details
+ *    Each stage is a functor (typically calling a module's run method)
+ *    with its own worker thread(s) and a bounded queue in front of it.
+ *    A blob pushed into the graph goes through the stages in turn, so
+ *    that stage 2 works on blob N while stage 1 already works on blob N+1
+ *    and the throughput is set by the slowest stage rather than the sum
+ *    of them. push() blocks while the first queue is full, which is the
+ *    back pressure on the caller.
+ *
+ *    With one thread per stage (the default) the blobs go through every
+ *    stage in the order pushed, which stateful modules (RFI_Clipper,
+ *    DedispersionModule) need. A stage with more threads may reorder.
+ *
+ *    Blob lifetime: once the last stage is done with a blob the
+ *    onCompletion() functors are called, which is where the caller gives
+ *    its buffer back (e.g. unlocks it in a LockingPtrContainer). If a
+ *    stage throws, the error is counted and the onFailure() functors are
+ *    called with the stage name instead of running the remaining stages,
+ *    followed by the completion functors as usual.
+ *
+ *    When not asynchronous (setAsync(false)) push() runs every stage in
+ *    the calling thread, as a pipeline without the graph would.
+ *
+ *    Configuration (from the pipeline's config node):
+ *    @verbatim
+ *        <stages async="true"/>
+ *        <stage name="rfiClipper" threads="1" queueDepth="4"/>
+ *    @endverbatim
+ *
+ *    Telemetry, for graph "G" and stage "s": the histogram "G.s" of the
+ *    stage times, the gauge "G.s.queued" and the counter "G.s.errors".
+ *    When profiling is on (see MetricProfile) the stage times also go in
+ *    the profile "G.s", against the budget given to setBudget(). The blobs
+ *    in flight are counted by the CompletionCounter "G.inFlight".
+ */
+class StageGraph
+{
+    public:
+        typedef boost::function1<void, DataBlob*> TaskT;
+        typedef boost::function2<void, DataBlob*, const QString&> FailureT;
+
+    public:
+        StageGraph( const QString& name );
+        /// waits for the blobs in flight before stopping the stages
+        ~StageGraph();
+
+        /// append a stage to the chain
+        void addStage( const QString& name, const TaskT& task,
+                       unsigned threads = 1, unsigned queueDepth = 4 );
+
+        /// set the threads and queue depth of a stage (before the first push)
+        void setStage( const QString& name, unsigned threads, unsigned queueDepth );
+
+        /// read the <stages> and <stage> options
+        void configure( const ConfigNode& config );
+
+        /// called for every blob once it has been through all stages
+        void onCompletion( const TaskT& fn ) { _completion.append( fn ); }
+
+        /// called when a stage throws on a blob
+        void onFailure( const FailureT& fn ) { _failure.append( fn ); }
+
+        void setAsync( bool async );
+        bool async() const { return _async; }
+
+        /// the most blobs that can be in the graph at once (in the
+        //  queues or being worked on); the caller needs that many
+        //  buffers, plus the one it is filling
+        int capacity() const;
+
+        /// send a blob through the stages
+        void push( DataBlob* blob );
+
+        /// block until every blob pushed has completed, returning false
+        //  if they have not within timeout ms
+        bool waitForCompletion( unsigned long timeout = ULONG_MAX ) const;
+
+        /// the number of blobs pushed and not yet completed
+        int inFlight() const { return _inFlight.pending(); }
+
+        /// the time (s) each stage has for a blob to keep up in real time
+        void setBudget( double seconds );
+
+    private:
+        class Stage;
+        class Worker;
+
+        void _start();
+        bool _run( int stage, DataBlob* blob );
+        void _complete( DataBlob* blob );
+        Stage* _stage( const QString& name ) const;
+
+    private:
+        QString _name;
+        bool _async;
+        bool _started;
+        QList<Stage*> _stages;
+        QList<TaskT> _completion;
+        QList<FailureT> _failure;
+        CompletionCounter _inFlight;
+};
+
+/**
+ * @class StageGraph::Stage
+ *
+ * @brief
+ *    A stage of a StageGraph: the task, its bounded input queue and the
+ *    threads taking from it.
+ */
+class StageGraph::Stage
+{
+    public:
+        Stage( StageGraph* graph, int index, const QString& graphName,
+               const QString& name, const TaskT& task, unsigned threads,
+               unsigned queueDepth );
+        ~Stage();
+
+        void start();
+        void stop();
+
+        /// add a blob to the queue, waiting for room
+        void put( DataBlob* blob );
+        /// take a blob from the queue, waiting for one; 0 once stopped
+        DataBlob* take();
+
+        const QString& name() const { return _name; }
+        const TaskT& task() const { return _task; }
+        unsigned threads() const { return _threads; }
+        unsigned queueDepth() const { return _queueDepth; }
+        void setThreads( unsigned threads ) { _threads = threads ? threads : 1; }
+        void setQueueDepth( unsigned depth ) { _queueDepth = depth ? depth : 1; }
+
+        MetricHistogram& time;
+        MetricProfile& profile;
+        MetricCounter& errors;
+
+    private:
+        StageGraph* _graph;
+        int _index;
+        QString _name;
+        TaskT _task;
+        unsigned _threads;
+        unsigned _queueDepth;
+        QList<Worker*> _workers;
+        QList<DataBlob*> _queue;
+        bool _halt;
+        QMutex _mutex;
+        QWaitCondition _notEmpty;
+        QWaitCondition _notFull;
+        MetricGauge& _queued;
+};
+
+/**
+ * @class StageGraph::Worker
+ *
+ * @brief
+ *    Thread running the task of a stage on the blobs in its queue.
+ */
+class StageGraph::Worker : public QThread
+{
+    public:
+        Worker( StageGraph* graph, Stage* stage, int index )
+            : _graph(graph), _stage(stage), _index(index) {}
+        void run();
+
+    private:
+        StageGraph* _graph;
+        Stage* _stage;
+        int _index;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // STAGEGRAPH_H
@@ -46,9 +46,15 @@ class StokesGenerator : public AbstractModule
         void run(const TimeSeriesDataSetC32* streamData,
                 SpectrumDataSetStokes* stokes);
 
+        /// generate Stokes I only (true), e.g. to shed load, or the
+        /// configured numberOfStokes (false)
+        void setStokesIOnly(bool iOnly) { _stokesIOnly = iOnly; }
+        bool stokesIOnly() const { return _stokesIOnly; }
+
     private:
         float _sqr(float x) { return x * x; }
         unsigned _numberOfStokes;
+        volatile bool _stokesIOnly;
 };
 
 // Declare this class as a pelican module.
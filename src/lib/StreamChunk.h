@@ -0,0 +1,42 @@
+#ifndef STREAMCHUNK_H
+#define STREAMCHUNK_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * @file StreamChunk.h
+ */
+
+class QIODevice;
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class StreamChunk
+ *
+ * @brief
+ *    Access to the bytes of a chunk handed to a stream adapter.
+ *
+ * @details
+ *    Data clients usually pass the chunk to AbstractStreamAdapter::deserialise()
+ *    as a QBuffer over memory they already hold. In that case map() returns a
+ *    pointer into that memory and moves the device past the bytes, so the
+ *    adapter can decode the packets where they are. Any other device is read
+ *    in full into the given buffer, waiting for data as needed; a QString is
+ *    thrown if the device ends, or fails, before the chunk is complete.
+ */
+class StreamChunk
+{
+    public:
+        /// Return a pointer to the next @p bytes of @p device, valid until the
+        /// device or @p buffer is next modified.
+        static const char* map(QIODevice* device, size_t bytes,
+                               std::vector<char>& buffer);
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // STREAMCHUNK_H
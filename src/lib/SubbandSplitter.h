@@ -0,0 +1,75 @@
+#ifndef SUBBANDSPLITTER_H
+#define SUBBANDSPLITTER_H
+
+#include "LofarUdpHeader.h"
+#include <vector>
+#include <cstddef>
+
+/**
+ * @file SubbandSplitter.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class SubbandSplitter
+ *
+ * @brief
+ *    Scatters the sub-bands of a LOFAR UDP packet into several output streams.
+ *
+ * @details
+ *    Each stream takes a contiguous range of sub-bands. As the packet data is
+ *    ordered by sub-band, each range is a single block of the packet which is
+ *    copied (with the header, nrBeamlets adjusted) straight into the slot of
+ *    the stream's chunk, so a packet is read once whatever the number of
+ *    streams.
+ */
+class SubbandSplitter
+{
+    public:
+        /// Split packets of @p nSubbands sub-bands of @p subbandBytes each.
+        SubbandSplitter(unsigned nSubbands, unsigned subbandBytes);
+        ~SubbandSplitter();
+
+        /// Add a stream of sub-bands [start, end], returning its index.
+        unsigned addStream(unsigned start, unsigned end);
+
+        /// Number of streams.
+        unsigned streams() const { return _ranges.size(); }
+
+        /// Number of sub-bands of a stream.
+        unsigned subbands(unsigned stream) const { return _ranges[stream].nSubbands; }
+
+        /// Size (header and data) of the packets of a stream.
+        size_t packetSize(unsigned stream) const { return _headerSize + _ranges[stream].bytes; }
+
+        /// Size (header and data) of the incoming packets.
+        size_t inputPacketSize() const { return _headerSize + (size_t)_nSubbands * _subbandBytes; }
+
+        /// Write the sub-bands of @p packet to @p slot of each stream's chunk.
+        void scatter(const UDPPacket& packet, char* const* outputs,
+                     unsigned slot) const;
+
+        /// Write an empty packet with @p header to @p slot of each stream's chunk.
+        void fill(const UDPPacket::Header& header, char* const* outputs,
+                  unsigned slot) const;
+
+    private:
+        struct Range {
+            unsigned nSubbands;
+            size_t offset;
+            size_t bytes;
+        };
+
+    private:
+        static const size_t _headerSize = sizeof(UDPPacket::Header);
+        unsigned _nSubbands;
+        unsigned _subbandBytes;
+        std::vector<Range> _ranges;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // SUBBANDSPLITTER_H
@@ -0,0 +1,90 @@
+#ifndef SUBBAND_SPLITTING_CHUNKER_H_
+#define SUBBAND_SPLITTING_CHUNKER_H_
+
+/**
+ * @file SubbandSplittingChunker.h
+ */
+
+#include "LofarUdpHeader.h"
+#include "SubbandSplitter.h"
+
+#include "PacketCaptureDevice.h"
+#include "Metrics.h"
+#include "pelican/server/AbstractChunker.h"
+
+#include <QtCore/QString>
+
+namespace pelican {
+namespace ampp {
+
+/**
+ * @class SubbandSplittingChunker
+ *
+ * @ingroup pelican_lofar
+ *
+ * @brief
+ *    Splits a LOFAR UDP stream by sub-band into any number of chunk streams.
+ *
+ * @details
+ *    Generalises LofarDataSplittingChunker to N output streams: one
+ *    \<stream\> tag per \<data\> tag, in the same order, each naming the
+ *    range of sub-bands written to that data type. Every packet is received
+ *    once and its sub-band ranges copied straight into the chunks of all the
+ *    streams; missing packets are written as empty packets to every stream.
+ *
+ @verbatim
+    <SubbandSplittingChunker>
+        <connection host="127.0.0.1" port="8090"/>
+        <data type="LofarTimeStream1"/>
+        <data type="LofarTimeStream2"/>
+        <data type="LofarTimeStream3"/>
+        <stream subbandStart="0"  subbandEnd="19"/>
+        <stream subbandStart="20" subbandEnd="39"/>
+        <stream subbandStart="40" subbandEnd="60"/>
+        <dataBitSize            value="16"/>
+        <samplesPerPacket       value="16"/>
+        <subbandsPerPacket      value="61"/>
+        <nRawPolarisations      value="2"/>
+        <clock                  value="200"/>
+        <udpPacketsPerIteration value="8192"/>
+    </SubbandSplittingChunker>
+ @endverbatim
+ */
+
+class SubbandSplittingChunker : public AbstractChunker
+{
+    public:
+        /// Constructor
+        SubbandSplittingChunker(const ConfigNode& config);
+
+        /// Destructor
+        ~SubbandSplittingChunker();
+
+        /// Creates the socket to use for the incoming data stream.
+        virtual QIODevice* newDevice();
+
+        /// Called whenever there is data ready to be processed.
+        virtual void next(QIODevice*);
+
+    private:
+        /// Returns an error message suitable for throwing.
+        QString _err(QString message)
+        { return QString("SubbandSplittingChunker::") + message; }
+
+    private:
+        unsigned _nPackets;
+        unsigned _nSamples;
+        unsigned _clock;
+        unsigned _startTime;
+        unsigned _startBlockid;
+
+        SubbandSplitter* _splitter;
+        PacketCaptureDevice::Config _capture;
+        ChunkerMetrics _metrics;
+};
+
+PELICAN_DECLARE_CHUNKER(SubbandSplittingChunker)
+
+} // namespace ampp
+} // namespace pelican
+#endif // SUBBAND_SPLITTING_CHUNKER_H_
@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <string>
+#include "Metrics.h"
 
 /**
  * @file TimerData.h
@@ -16,9 +17,15 @@ namespace ampp {
  * @class TimerData
  *  
  * @brief
+ *    Wall clock and thread time of a piece of code, between tick() and tock().
  * 
  * @details
- * 
+ *    Keeps the minimum, maximum, average and latest times. A named timer
+ *    also records each time in the MetricHistogram of that name and, while
+ *    profiling is on, in the MetricProfile of that name, so that its
+ *    percentiles go into the metrics file and report(). A tock() without a
+ *    tick() before it is ignored (timerStart() does not tick while
+ *    profiling is off; stageTimerStart() always does).
  */
 
 class TimerData
@@ -30,6 +37,9 @@ class TimerData
         inline void report( const char* message ) const;
         inline void tick();
         inline void tock();
+        /// the histogram and profile of a named timer (0 if unnamed)
+        MetricHistogram* histogram();
+        MetricProfile* profile();
 
         int counter;
         double timeStart;
@@ -45,6 +55,9 @@ class TimerData
         inline double _timerSec( clockid_t type );
         struct timespec _tp; // raw clock
         std::string _name;
+        MetricHistogram* _histogram;
+        MetricProfile* _profile;
+        bool _running;
 };
 
 void TimerData::report( const char* message ) const {
@@ -56,21 +69,35 @@ void TimerData::report( const char* message ) const {
     printf("-- Latest : %.8f sec\n", timeElapsed);
     printf("-- Thread : %.8f sec\n", threadElapsed);
     printf("-- Counter: %d\n", counter);
+    if( _profile ) {
+        printf("-- p50    : %.8f sec\n", _profile->percentile(0.5) * 1.0e-9);
+        printf("-- p99    : %.8f sec\n", _profile->percentile(0.99) * 1.0e-9);
+        printf("-- p99.9  : %.8f sec\n", _profile->percentile(0.999) * 1.0e-9);
+        if( _profile->budget() )
+            printf("-- Over budget (%.8f sec): %llu\n", _profile->budget() * 1.0e-9,
+                   (unsigned long long)_profile->overBudget());
+    }
     printf("----------------------------------------------------\n");
 }
 
 void TimerData::tick() {
+    _running = true;
     timeStart = _timerSec(CLOCK_MONOTONIC);
     threadStart = _timerSec(CLOCK_THREAD_CPUTIME_ID);
 }
 
 void TimerData::tock() {
+    if( ! _running ) return;
+    _running = false;
     timeElapsed = _timerSec(CLOCK_MONOTONIC) - timeStart;
     threadElapsed = _timerSec(CLOCK_THREAD_CPUTIME_ID) - threadStart;
     if (timeElapsed < timeMin) timeMin = timeElapsed;
     if (timeElapsed > timeMax) timeMax = timeElapsed;
     timeAverage = (timeElapsed + counter * timeAverage) / (counter + 1);
     ++counter;
+    if( MetricHistogram* h = histogram() ) h->record(timeElapsed);
+    if( MetricProfile::enabled() )
+        if( MetricProfile* p = profile() ) p->record((quint64)(timeElapsed * 1.0e9));
 }
 
 double TimerData::_timerSec( clockid_t type )
@@ -0,0 +1,110 @@
+#ifndef UDPBATCHRECEIVER_H
+#define UDPBATCHRECEIVER_H
+
+#include <vector>
+
+/**
+ * @file UdpBatchReceiver.h
+ */
+
+struct mmsghdr;
+struct iovec;
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class UdpBatchReceiver
+ *
+ * @brief
+ *    Receives batches of UDP datagrams straight into caller supplied memory.
+ *
+ * @details
+ *    Wraps the Linux recvmmsg() call so that up to maxBatch datagrams are read
+ *    with a single system call. Each datagram is described as a sequence of
+ *    segments; kept segments are scattered contiguously into a fixed size
+ *    slot of the destination buffer while discarded segments are read into a
+ *    scratch area. This lets a chunker select a channel range directly into
+ *    its WritableData memory without any user space copies.
+ *
+ *    On systems without recvmmsg() the same interface is provided with one
+ *    recvmsg() call per datagram.
+ *
+ * @code
+ *    UdpBatchReceiver receiver(64);
+ *    receiver.addSegment(sizeof(K7Packet::Header), true);
+ *    receiver.addSegment(skipBytes, false);
+ *    receiver.addSegment(streamBytes, true);
+ *    receiver.addSegment(trailingBytes, false);
+ *    int n = receiver.receive(fd, chunkPtr, nFreeSlots, 100);
+ * @endcode
+ */
+class UdpBatchReceiver
+{
+    public:
+        /// Construct a receiver reading at most maxBatch datagrams per call.
+        UdpBatchReceiver(unsigned maxBatch = 64);
+        ~UdpBatchReceiver();
+
+        /// Append a segment of length bytes to the datagram description.
+        void addSegment(unsigned length, bool keep);
+
+        /// Remove all segments.
+        void clearSegments();
+
+        /// Size of the kept part of each datagram (the slot size).
+        unsigned slotSize() const { return _slotSize; }
+
+        /// Full size of the datagram described by the segments.
+        unsigned packetSize() const { return _packetSize; }
+
+        /// Maximum number of datagrams read per call.
+        unsigned maxBatch() const { return _maxBatch; }
+
+        /// Request a kernel receive buffer of the given size, returning the
+        /// size actually granted.
+        static int setReceiveBufferSize(int fd, int bytes);
+
+        /// Wait up to timeoutMs for data and read at most maxPackets datagrams
+        /// into consecutive slots starting at dest. Returns the number read,
+        /// 0 on timeout or -1 on error.
+        int receive(int fd, char* dest, unsigned maxPackets, int timeoutMs);
+
+        /// Copy the kept segments of a datagram already in memory (e.g. from
+        /// a capture file) into slot, returning its length, as receive()
+        /// would report.
+        unsigned gather(const char* packet, unsigned length, char* slot) const;
+
+        /// Length of datagram i of the last batch. A datagram longer than
+        /// packetSize() is cut short in its slot but reported with more than
+        /// packetSize() bytes, so that length checks reject it.
+        unsigned length(unsigned i) const { return _lengths[i]; }
+
+        /// True if this build uses recvmmsg().
+        static bool batched();
+
+    private:
+        struct Segment {
+            unsigned length;
+            bool keep;
+        };
+
+    private:
+        UdpBatchReceiver(const UdpBatchReceiver&);
+        UdpBatchReceiver& operator=(const UdpBatchReceiver&);
+
+    private:
+        unsigned _maxBatch;
+        unsigned _slotSize;
+        unsigned _packetSize;
+        std::vector<Segment> _segments;
+        std::vector<char> _discard;
+        std::vector<unsigned> _lengths;
+        mmsghdr* _msgs;
+        iovec* _iovecs;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // UDPBATCHRECEIVER_H
@@ -0,0 +1,112 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <boost/function.hpp>
+#include "Metrics.h"
+
+/**
+ * @file WorkerPool.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class WorkerPool
+ *
+ * @brief
+ *    A fixed set of threads, at a given priority, running tasks from a
+ *    bounded queue.
+ *
+ * @details
+ *    An alternative to the shared QtConcurrent pool for work that should
+ *    neither take threads from, nor compete on equal terms with, the data
+ *    path: e.g. the analysis of dedispersed data and writing out of
+ *    candidates. submit() blocks while the queue is full.
+ *
+ *    A task that throws is reported and counted; the pool carries on.
+ *
+ *    Linux ignores the priority given to a thread under the default
+ *    (SCHED_OTHER) policy, so each worker also raises its own nice value
+ *    by niceIncrement() of the pool priority: 10 for low and up to 19 for
+ *    idle (which Qt also runs under SCHED_IDLE).
+ *
+ *    Telemetry, for a pool "P": the gauge "P.queued", the histogram
+ *    "P.task" of the task run times, the counter "P.blocked" of submits
+ *    that found the queue full and "P.errors".
+ */
+class WorkerPool
+{
+    public:
+        typedef boost::function0<void> TaskT;
+
+    public:
+        WorkerPool( const QString& name, unsigned threads, unsigned queueDepth,
+                    QThread::Priority priority = QThread::LowPriority );
+        /// runs the tasks already queued before returning
+        ~WorkerPool();
+
+        /// queue a task, waiting for room
+        void submit( const TaskT& task );
+
+        /// the number of tasks waiting to run
+        int queued() const;
+
+        unsigned threads() const { return _workers.size(); }
+        unsigned queueDepth() const { return _queueDepth; }
+
+        /// priority from its name: idle, low, normal, high (else low)
+        static QThread::Priority priority( const QString& name );
+
+        /// the nice value a worker adds to that of the thread creating
+        /// the pool, for a priority
+        static int niceIncrement( QThread::Priority priority );
+
+    private:
+        class Worker;
+        bool _take( TaskT& task );
+        void _run( const TaskT& task );
+
+    private:
+        QString _name;
+        unsigned _queueDepth;
+        QList<Worker*> _workers;
+        QList<TaskT> _queue;
+        bool _halt;
+        mutable QMutex _mutex;
+        QWaitCondition _notEmpty;
+        QWaitCondition _notFull;
+
+        // Telemetry.
+        MetricGauge& _queued;
+        MetricHistogram& _taskTime;
+        MetricCounter& _blocked;
+        MetricCounter& _errors;
+};
+
+/**
+ * @class WorkerPool::Worker
+ *
+ * @brief
+ *    Thread of a WorkerPool.
+ */
+class WorkerPool::Worker : public QThread
+{
+    public:
+        Worker( WorkerPool* pool, int nice ) : _pool(pool), _nice(nice) {}
+        void run();
+
+    private:
+        WorkerPool* _pool;
+        int _nice;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // WORKERPOOL_H
@@ -12,7 +12,10 @@ namespace pelican {
 namespace ampp {
 
 // Construct the example chunker.
-ABChunker::ABChunker(const ConfigNode& config) : AbstractChunker(config)
+ABChunker::ABChunker(const ConfigNode& config) : AbstractChunker(config),
+    _receiver(config.getOption("socket", "batch", "64").toUInt()),
+    _capture(config),
+    _metrics(QString("ABChunker.") + QString::number(port()))
 {
     // Set chunk size from the configuration.
     // The host, port and data type are set in the base class.
@@ -35,6 +38,14 @@ ABChunker::ABChunker(const ConfigNode& config) : AbstractChunker(config)
     _x = 0;
     _y = 0;
 
+    // Packets are received in batches with recvmmsg() into a staging area.
+    _receiveBufferSize = config.getOption("socket", "receiveBuffer", "67108864").toUInt();
+    _receiver.addSegment(_pktSize, true);
+    _batch.resize(_receiver.maxBatch() * _pktSize);
+    _lengths.resize(_receiver.maxBatch());
+    _batchCount = 0;
+    _batchNext = 0;
+
     // Allocate memory for the saved packet
     _pktSaved = new char[_pktSize];
 
@@ -64,6 +75,16 @@ ABChunker::~ABChunker()
 // Creates a suitable device ready for reading.
 QIODevice* ABChunker::newDevice()
 {
+    // With packet capture enabled a dedicated thread receives the packets into
+    // a ring which next() consumes.
+    if (_capture.enabled())
+    {
+        PacketCaptureDevice* capture = new PacketCaptureDevice(_capture, _pktSize);
+        if (!capture->bind(host(), port()))
+            std::cerr << "ABChunker: " << capture->bindError().toStdString() << std::endl;
+        return capture;
+    }
+
     // Return an opened QUdpSocket.
     QUdpSocket* socket = new QUdpSocket;
     socket->bind(QHostAddress(host()), port());
@@ -71,14 +92,15 @@ QIODevice* ABChunker::newDevice()
     // Wait for the socket to bind.
     while (socket->state() != QUdpSocket::BoundState) {}
 
+    int granted = UdpBatchReceiver::setReceiveBufferSize(socket->socketDescriptor(), _receiveBufferSize);
+    std::cout << "ABChunker: socket receive buffer " << granted << " bytes" << std::endl;
+
     return socket;
 }
 
 // Called whenever there is data available on the device.
 void ABChunker::next(QIODevice* device)
 {
-    // Get a pointer to the UDP socket.
-    QUdpSocket* socket = static_cast<QUdpSocket*>(device);
     unsigned int specQuart = 0;
     unsigned int beam = 0;
     unsigned long int integCount = 0;
@@ -89,10 +111,13 @@ void ABChunker::next(QIODevice* device)
     unsigned int packetCounter = 0;
     unsigned long int missedIntegCount = 0;
     unsigned int missedSpecQuart = 0;
-    char pkt[_pktSize];
+    const char* pkt = 0;
     char pktMissed[_pktSize];
     char fakeHdr[_hdrSize];
 
+    // Re-arm the packet capture notification (if capturing).
+    PacketCaptureDevice::acknowledge(device);
+
     // Get writable buffer space for the chunk.
     WritableData writableData = getDataStorage(_chunkSize);
     if (writableData.isValid())
@@ -140,6 +165,7 @@ void ABChunker::next(QIODevice* device)
                 _prevIntegCount = missedIntegCount;
             }
             _prevPktCount += packetCounter;
+            _metrics.packetsLost.add(packetCounter);
             // packetCounter is now either _lostPackets (which could be 0) or
             // _nPackets.
             i += packetCounter;
@@ -165,6 +191,7 @@ void ABChunker::next(QIODevice* device)
                 //std::cout << _savedIntegCount << std::endl;
                 writableData.write(_pktSaved, _pktSize, bytesRead);
                 bytesRead += _pktSize;
+                _metrics.packetsAccepted.add();
 
                 Q_ASSERT(_savedSpecQuart == (_prevSpecQuart + 1) % _pktsPerSpec);
                 Q_ASSERT(0 == _savedSpecQuart ?
@@ -184,16 +211,14 @@ void ABChunker::next(QIODevice* device)
                 }
             }
 
-            // Read the datagram, but avoid using pendingDatagramSize().
-            while (!socket->hasPendingDatagrams()) {
-                // MUST WAIT for the next datagram.
-                socket->waitForReadyRead(100);
-            }
-
-            // Read the current packet from the socket
-            unsigned int len = socket->readDatagram(pkt, _pktSize);
+            // Take the next packet of the current batch, receiving a new
+            // batch from the socket if required.
+            unsigned int len = 0;
+            pkt = nextPacket(device, len);
+            if (!pkt) return;
             if (len != _pktSize)
             {
+                _metrics.packetsRejected.add();
                 std::cerr << "ERROR: readDatagram() <= 0!" << std::endl;
                 continue;
             }
@@ -315,6 +340,7 @@ void ABChunker::next(QIODevice* device)
                 _prevIntegCount = missedIntegCount;
             }
             _prevPktCount += packetCounter;
+            _metrics.packetsLost.add(packetCounter);
             if (packetCounter != 0)
             {
                 std::cerr << packetCounter << " packets added." << std::endl;
@@ -332,6 +358,7 @@ void ABChunker::next(QIODevice* device)
                 //std::cout << integCount << std::endl;
                 writableData.write(pkt, _pktSize, bytesRead);
                 bytesRead += _pktSize;
+                _metrics.packetsAccepted.add();
 
                 // Update previous counts.
                 _prevSpecQuart = specQuart;
@@ -353,6 +380,7 @@ void ABChunker::next(QIODevice* device)
             }
         }
         _chunksProced++;
+        _metrics.chunks.add();
         _y++;
         if (_y % 100 == 0)
         {
@@ -367,8 +395,42 @@ void ABChunker::next(QIODevice* device)
         {
             std::cout << "100x no available space!" << std::endl;
         }
-        socket->readDatagram(0, 0);
+        PacketCaptureDevice::discardDatagram(device);
+        _metrics.packetsDiscarded.add();
+    }
+}
+
+// Returns the next packet of the current batch, receiving a new batch (from
+// the socket or the capture ring) when the current one has been used up.
+const char* ABChunker::nextPacket(QIODevice* device, unsigned int& length)
+{
+    PacketCaptureDevice* capture = dynamic_cast<PacketCaptureDevice*>(device);
+    while (_batchNext == _batchCount)
+    {
+        if (!isActive()) return 0;
+        // MUST WAIT for the next datagram.
+        int n;
+        if (capture)
+        {
+            n = capture->readDatagrams(&_batch[0], _receiver.maxBatch(), &_lengths[0], 100);
+        }
+        else
+        {
+            QUdpSocket* socket = static_cast<QUdpSocket*>(device);
+            n = _receiver.receive(socket->socketDescriptor(), &_batch[0], _receiver.maxBatch(), 100);
+            for (int k = 0; k < n; ++k)
+                _lengths[k] = _receiver.length(k);
+        }
+        if (n < 0)
+        {
+            std::cerr << "ERROR: recvmmsg() failed!" << std::endl;
+            continue;
+        }
+        _batchCount = n;
+        _batchNext = 0;
     }
+    length = _lengths[_batchNext];
+    return &_batch[(_batchNext++) * _pktSize];
 }
 
 } // namespace ampp
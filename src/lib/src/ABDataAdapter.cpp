@@ -1,5 +1,7 @@
 #include "ABDataAdapter.h"
 #include "SpectrumDataSet.h"
+#include "Metrics.h"
+#include "StreamChunk.h"
 #include <arpa/inet.h>
 #include <iomanip>
 //#include <sys/time.h>
@@ -9,7 +11,7 @@
 using namespace pelican;
 using namespace pelican::ampp;
 
-TimerData ABDataAdapter::_adapterTime;
+TimerData ABDataAdapter::_adapterTime("ABDataAdapter.deserialise");
 
 // Construct the signal data adapter.
 ABDataAdapter::ABDataAdapter(const ConfigNode& config)
@@ -44,6 +46,19 @@ ABDataAdapter::ABDataAdapter(const ConfigNode& config)
 
     _x = 0;
 
+    // Either total intensity (XX* + YY*) or all four pseudo-Stokes products
+    // XX*, YY*, Re(XY*) and Im(XY*) as separate polarisations.
+    QString products = config.getOption("products", "value", "power").toLower();
+    if (products == "power")
+        _nPolarisations = 1;
+    else if (products == "full")
+        _nPolarisations = 4;
+    else
+        throw QString("ABDataAdapter: Unknown products \"" + products + "\" (expected power or full).");
+
+    _decodePower = ChannelKernels::select<ABPowerKernel>(_nChannels);
+    _decodeProducts = ChannelKernels::select<ABProductsKernel>(_nChannels);
+
     // Get start time (MJD) from the S6 redis server
     _mcount0UnixTime = 0.0;
     getResetTimeFromRedis();
@@ -84,7 +99,9 @@ void ABDataAdapter::getResetTimeFromRedis()
 // Called to de-serialise a chunk of data from the input device.
 void ABDataAdapter::deserialise(QIODevice* device)
 {
-    //timerStart(&_adapterTime);
+    static MetricHistogram& deserialiseTime = MetricsRegistry::instance().histogram("ABDataAdapter.deserialise");
+    MetricTimer timer(deserialiseTime);
+    timerStart(&_adapterTime);
     /*struct timeval stTime = {0};
     (void) gettimeofday(&stTime, NULL);
     double t = (stTime.tv_sec - 1425601680) + (stTime.tv_usec * 0.000001);
@@ -100,54 +117,24 @@ void ABDataAdapter::deserialise(QIODevice* device)
     // Number of time samples; Each channel contains 4 pseudo-Stokes values,
     // each of size sizeof(short int)
     unsigned nBlocks = (packets / _pktsPerSpec) * _samplesPerPacket;
-    _nPolarisations = 1;
     blob->resize(nBlocks, 1, _nPolarisations, _nChannels);
+    if (packets == 0) return;
 
-    // Create a temporary buffer to read out the packet headers, and
-    // get the pointer to the data array in the data blob being filled.
-    char headerData[_headerSize];
-    //char d[_pktsPerSpec * (_packetSize - _headerSize - _footerSize)];
-    char d[_packetSize - _headerSize];// - _footerSize];
-    char footerData[_footerSize];
-
-    // Loop over the UDP packets in the chunk.
-    float *data = NULL;
-    unsigned bytesRead = 0;
-    unsigned block = 0;
+    // Decode in place from the chunk where possible.
+    const char* chunk = StreamChunk::map(device, packets * _packetSize, _chunkBuffer);
+    _unpackCounters(chunk, packets);
+
+    // Check the packet sequence and find the packets holding the last
+    // spectral quarter, which are written out to the blob.
     signed int specQuart = 0;
     unsigned long int integCount = 0;
-    unsigned int icDiff = 0;
-    unsigned int sqDiff = 0;
     double timestamp = 0.0;
-    unsigned long int firstIntegCountThisBlock = 0;
+    unsigned long int firstIntegCountThisBlock = _integCounts[0];
+    _blockPackets.clear();
 
     for (unsigned p = 0; p < packets; p++)
     {
-        // Ensure there is enough data to read from the device.
-        while (device->bytesAvailable() < _packetSize)
-        {
-            device->waitForReadyRead(-1);
-        }
-
-        // Read the packet header from the input device.
-        device->read(headerData, _headerSize);
-
-#if 1
-        // Get the packet integration count
-        unsigned long int counter = (*((unsigned long int *) headerData)) & 0x0000FFFFFFFFFFFF;
-        integCount = (unsigned long int)        // Casting required.
-                      (((counter & 0x0000FF0000000000) >> 40)
-                     + ((counter & 0x000000FF00000000) >> 24)
-                     + ((counter & 0x00000000FF000000) >> 8)
-                     + ((counter & 0x0000000000FF0000) << 8)
-                     + ((counter & 0x000000000000FF00) << 24)
-                     + ((counter & 0x00000000000000FF) << 40));
-
-        if (0 == p)
-        {
-            firstIntegCountThisBlock = integCount;
-        }
-        //std::cout << integCount << std::endl;
+        integCount = _integCounts[p];
         timestamp = ((double) (integCount - _integCountStart) * _tSamp);
         if (!_first)
         {
@@ -166,51 +153,53 @@ void ABDataAdapter::deserialise(QIODevice* device)
         }
 
         // Get the spectral quarter number
-        specQuart = (unsigned char) headerData[6];
-        //std::cout << specQuart << ", " << integCount << std::endl;
-
-        //bytesRead += device->read(d + bytesRead,
-        //                          _packetSize - _headerSize - _footerSize);
-        device->read(d, _packetSize - _headerSize);// - _footerSize);
-        // Write out spectrum to blob if this is the last spectral quarter.
-        unsigned short int* dd = (unsigned short int*) d;
-        if (_pktsPerSpec - 3 == specQuart)
+        specQuart = (unsigned char) chunk[(size_t)p * _packetSize + 6];
+        if (_pktsPerSpec - 3 == specQuart && _blockPackets.size() < nBlocks)
         {
-#if 0
-            for (unsigned pol = 0; pol < _nPolarisations; pol++)
-            {
-                data = (float*) blob->spectrumData(block, 0, pol);
-                for (unsigned chan = 0; chan < _nChannels; chan++)
-                {
-                    data[chan] = (float) dd[chan * 4 + pol];
-                }
-            }
-#else
-
-            // Compute Stokes I and ignore the rest.
-            data = (float*) blob->spectrumData(block, 0, 0);
-            for (unsigned chan = 0; chan < _nChannels; chan++)
-            {
-                data[chan] = (float) (ntohs(dd[chan * 4 + 0])          // XX*
-                                      + ntohs(dd[chan * 4 + 1]));      // YY*
-            }
-#endif
-     
-            //memset(d, '\0', _pktsPerSpec * (_packetSize - _headerSize - _footerSize));
-            //memset(d, '\0', _packetSize - _headerSize - _footerSize);
-            //bytesRead = 0;
-            block++;
+            _blockPackets.push_back(p);
         }
-        // Read the packet footer from the input device and discard it.
-        //device->read(footerData, _footerSize);
 
         _lastTimestamp = timestamp;
         _prevIntegCount = integCount;
-#endif
+    }
+
+    // Write out the spectra.
+    int nSpectra = _blockPackets.size();
+#pragma omp parallel for schedule(static)
+    for (int block = 0; block < nSpectra; block++)
+    {
+        const unsigned short* dd = reinterpret_cast<const unsigned short*>(
+                chunk + (size_t)_blockPackets[block] * _packetSize + _headerSize);
+        if (_nPolarisations == 1)
+        {
+            _decodePower(dd, blob->spectrumData(block, 0, 0), _nChannels); // XX* + YY*
+        }
+        else
+        {
+            _decodeProducts(dd, blob->spectrumData(block, 0, 0), blob->spectrumData(block, 0, 1),
+                            blob->spectrumData(block, 0, 2), blob->spectrumData(block, 0, 3), _nChannels);
+        }
     }
 
     blob->setLofarTimestamp((firstIntegCountThisBlock * _tSamp) + _mcount0UnixTime);
     blob->setBlockRate(_tSamp);
-    //timerUpdate(&_adapterTime);
+    timerUpdate(&_adapterTime);
 }
 
+
+// Unpack the integration counters of all packets in the chunk: the first six
+// bytes of each header, big-endian.
+void ABDataAdapter::_unpackCounters(const char* chunk, unsigned packets)
+{
+    _integCounts.resize(packets);
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(chunk);
+    for (unsigned p = 0; p < packets; p++, header += _packetSize)
+    {
+        _integCounts[p] = ((unsigned long int) header[0] << 40)
+                        | ((unsigned long int) header[1] << 32)
+                        | ((unsigned long int) header[2] << 24)
+                        | ((unsigned long int) header[3] << 16)
+                        | ((unsigned long int) header[4] << 8)
+                        |  (unsigned long int) header[5];
+    }
+}
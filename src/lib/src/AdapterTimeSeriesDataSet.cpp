@@ -2,6 +2,8 @@
 
 #include "LofarTypes.h"
 #include "TimeSeriesDataSet.h"
+#include "Metrics.h"
+#include "StreamChunk.h"
 
 #include "pelican/utility/ConfigNode.h"
 #include "pelican/core/AbstractStreamAdapter.h"
@@ -21,7 +23,44 @@ using std::endl;
 namespace pelican {
 namespace ampp {
 
-TimerData AdapterTimeSeriesDataSet::adapterTime;
+TimerData AdapterTimeSeriesDataSet::adapterTime("AdapterTimeSeriesDataSet.deserialise");
+
+/*
+ * Decoders for the LOFAR beamlet sample formats, converting complex sample i
+ * of a packet to float. They are kept to simple arithmetic on packed words
+ * so that the unpack loops vectorise.
+ */
+struct I16Sample
+{
+    static inline void decode(const char* buffer, unsigned i, float& re, float& im)
+    {
+        const TYPES::int16* w = reinterpret_cast<const TYPES::int16*>(buffer);
+        re = (float) w[2 * i];
+        im = (float) w[2 * i + 1];
+    }
+};
+
+struct I8Sample
+{
+    static inline void decode(const char* buffer, unsigned i, float& re, float& im)
+    {
+        const TYPES::int8* w = reinterpret_cast<const TYPES::int8*>(buffer);
+        re = (float) w[2 * i];
+        im = (float) w[2 * i + 1];
+    }
+};
+
+// Real part in the low nibble, imaginary part in the high nibble, with the
+// half offset of TYPES::i4complex.
+struct I4Sample
+{
+    static inline void decode(const char* buffer, unsigned i, float& re, float& im)
+    {
+        const TYPES::int8 w = (TYPES::int8) buffer[i];
+        re = (float) ((TYPES::int8) (w << 4) >> 4) + 0.5f;
+        im = (float) (w >> 4) + 0.5f;
+    }
+};
 
 /**
  * @details
@@ -55,11 +94,15 @@ AdapterTimeSeriesDataSet::AdapterTimeSeriesDataSet(const ConfigNode& config)
     _dataSize = _fixedPacketSize ? 8130 : _packetDataSize;
     _paddingSize = _fixedPacketSize ? _packetSize - _headerSize - _dataSize : 0;
 
-    // Temporary arrays for buffering data from the IO Device.
-    _headerTemp.resize(_headerSize);
-    _dataTemp.resize(_dataSize);
-    _paddingTemp.resize(_paddingSize + 1);
-
+    // Select the unpacking kernel, specialised for dual polarisation data.
+    bool dual = _nPolarisations == 2;
+    switch (_sampleBits)
+    {
+        case 4:  _unpackPacket = dual ? &_unpack<I4Sample, 2> : &_unpack<I4Sample, 0>; break;
+        case 8:  _unpackPacket = dual ? &_unpack<I8Sample, 2> : &_unpack<I8Sample, 0>; break;
+        case 16: _unpackPacket = dual ? &_unpack<I16Sample, 2> : &_unpack<I16Sample, 0>; break;
+        default: _unpackPacket = 0; break;
+    }
 }
 
 
@@ -77,6 +120,9 @@ AdapterTimeSeriesDataSet::AdapterTimeSeriesDataSet(const ConfigNode& config)
  */
 void AdapterTimeSeriesDataSet::deserialise(QIODevice* in)
 {
+    static MetricHistogram& deserialiseTime = MetricsRegistry::instance().histogram("AdapterTimeSeriesDataSet.deserialise");
+    static MetricCounter& outOfSequence = MetricsRegistry::instance().counter("AdapterTimeSeriesDataSet.outOfSequence");
+    MetricTimer timer(deserialiseTime);
     timerStart(&adapterTime);
     // Sanity check on data blob dimensions and chunk size.
     _checkData();
@@ -84,63 +130,32 @@ void AdapterTimeSeriesDataSet::deserialise(QIODevice* in)
     // UDP packet header.
     UDPPacket::Header header;
 
-    char* headerTemp = &_headerTemp[0];
-    char* dataTemp = &_dataTemp[0];
-    char* paddingTemp = &_paddingTemp[0];
-    unsigned bytesRead = 0;
-    int tempBytesRead = 0;
-
-    // Loop over UDP packets
-    for (unsigned p = 0u; p < _nUDPPacketsPerChunk; ++p) {
-
-        // Read the header from the IO device.
-        bytesRead = 0;
-        while (1)
-        {
-            tempBytesRead = in->read(headerTemp + bytesRead, _headerSize - bytesRead);
-            if (tempBytesRead <= 0) in->waitForReadyRead(-1);
-            else bytesRead += tempBytesRead;
-            if (bytesRead == _headerSize) break;
-        }
-        _readHeader(headerTemp, header);
-
-        // First packet, extract time-stamp.
-        if (p == 0u) {
-//            TYPES::TimeStamp timestamp;
-//            timestamp.setStationClockSpeed(_clock * 1000000);
-//            timestamp.setStamp (header.timestamp, header.blockSequenceNumber);
-            unsigned totBlocks = _clock == 160 ? 156250 : (header.timestamp % 2 == 0 ? 195313 : 195312);
-            double thisTimestamp = header.timestamp + ((1.0 * header.blockSequenceNumber) / totBlocks);
-            _timeData->setLofarTimestamp(thisTimestamp);
-            _timeData->setBlockRate(1.0 / totBlocks );
-            if (thisTimestamp - _lastTimestamp > 1.0 / totBlocks){
-              std::cout << "Adapter: data out of sequence -- " << thisTimestamp - _lastTimestamp << std::endl;
-            }
-            _lastTimestamp = _timeData -> getEndLofarTimestamp();
-        }
+    // Decode in place from the chunk where possible.
+    size_t packetSize = _headerSize + _dataSize + _paddingSize;
+    const int nPackets = _nUDPPacketsPerChunk;
+    if (nPackets == 0) {
+        timerUpdate(&adapterTime);
+        return;
+    }
+    const char* chunk = StreamChunk::map(in, packetSize * nPackets, _chunkBuffer);
+
+    // First packet, extract time-stamp.
+    _readHeader(chunk, header);
+    unsigned totBlocks = _clock == 160 ? 156250 : (header.timestamp % 2 == 0 ? 195313 : 195312);
+    double thisTimestamp = header.timestamp + ((1.0 * header.blockSequenceNumber) / totBlocks);
+    _timeData->setLofarTimestamp(thisTimestamp);
+    _timeData->setBlockRate(1.0 / totBlocks );
+    if (thisTimestamp - _lastTimestamp > 1.0 / totBlocks){
+      std::cout << "Adapter: data out of sequence -- " << thisTimestamp - _lastTimestamp << std::endl;
+      outOfSequence.add();
+    }
+    _lastTimestamp = _timeData -> getEndLofarTimestamp();
 
-        // Read the useful data (depends on configured dimensions).
-        bytesRead = 0;
-        while (1)
-        {
-            tempBytesRead = in->read(dataTemp + bytesRead, _dataSize - bytesRead);
-            if (tempBytesRead <= 0) in->waitForReadyRead(-1);
-            else bytesRead += tempBytesRead;
-            if (bytesRead == _dataSize) break;
-        }
-        _readData(p, dataTemp, _timeData);
-
-        // Read off padding (from word alignment of the packet).
-        if (_paddingSize != 0) {
-            bytesRead = 0;
-            while (1)
-            {
-                tempBytesRead = in->read(paddingTemp + bytesRead, _paddingSize - bytesRead);
-                if (tempBytesRead <= 0) in->waitForReadyRead(-1);
-                else bytesRead += tempBytesRead;
-                if (bytesRead == _paddingSize) break;
-            }
-        }
+    // Unpack the packets, each into its own range of times. Any padding
+    // (from word alignment of the packet) is skipped.
+#pragma omp parallel for schedule(static)
+    for (int p = 0; p < nPackets; ++p) {
+        _readData(p, chunk + (size_t)p * packetSize + _headerSize, _timeData);
     }
     timerUpdate(&adapterTime);
 }
@@ -152,7 +167,7 @@ void AdapterTimeSeriesDataSet::deserialise(QIODevice* in)
 void AdapterTimeSeriesDataSet::_checkData()
 {
     // Check for supported sample bits.
-    if (_sampleBits != 8 && _sampleBits != 16)
+    if (_sampleBits != 4 && _sampleBits != 8 && _sampleBits != 16)
         throw _err("Sample size (%1 bits) not supported.").arg(_sampleBits);
 
     // Check that there is something of to adapt.
@@ -199,9 +214,9 @@ void AdapterTimeSeriesDataSet::_checkData()
  * @param[in]  buffer   Char* buffer read from the IO device
  */
 inline
-void AdapterTimeSeriesDataSet::_readHeader(char* buffer, UDPPacket::Header& header)
+void AdapterTimeSeriesDataSet::_readHeader(const char* buffer, UDPPacket::Header& header)
 {
-    header = *reinterpret_cast<UDPPacket::Header*>(buffer);
+    header = *reinterpret_cast<const UDPPacket::Header*>(buffer);
     //_printHeader(header);
 }
 
@@ -214,82 +229,43 @@ void AdapterTimeSeriesDataSet::_readHeader(char* buffer, UDPPacket::Header& head
  * @param[in]  buffer    Char* buffer read from the IO device.
  * @param[out] data      time stream data data array (assumes double precision).
  */
-void AdapterTimeSeriesDataSet::_readData(unsigned packet, char* buffer,
+void AdapterTimeSeriesDataSet::_readData(unsigned packet, const char* buffer,
         TimeSeriesDataSetC32* data)
 {
-    unsigned time0 = packet * _nSamplesPerPacket;
+    // The time blocks of each sub-band and polarisation are contiguous, so
+    // the packet fills one run of times in each time series.
+    unsigned long nTimes = (unsigned long) data->nTimeBlocks() * _nSamplesPerTimeBlock;
+    Complex* times = data->data() + (unsigned long) packet * _nSamplesPerPacket;
+    _unpackPacket(buffer, times, _nSubbands, _nPolarisations,
+            _nSamplesPerPacket, nTimes);
+}
 
-    // Loop over dimensions in the packet and write into the data blob.
-    unsigned iTimeBlock, index;
-    Complex *times, *times0, *times1;
-    unsigned iPtr = 0;
 
-    switch (_sampleBits)
-    {
-        case 8:
-        {
-            TYPES::i8complex i8c;
-            for (unsigned s = 0; s < _nSubbands; ++s) {
-                for (unsigned t = 0; t < _nSamplesPerPacket; ++t) {
-                    iTimeBlock = (time0 + t) / _nSamplesPerTimeBlock;
-                    for (unsigned p = 0; p < _nPolarisations; ++p) {
-                        times = data->timeSeriesData(iTimeBlock, s, p);
-                        index = time0 - (iTimeBlock * _nSamplesPerTimeBlock) + t;
-                        i8c = *reinterpret_cast<TYPES::i8complex*>(&buffer[iPtr]);
-                        times[index] = _makeComplex(i8c);
-                        iPtr += sizeof(TYPES::i8complex);
-                    }
-                }
-            }
-            break;
-        }
-        case 16:
-        {
-            TYPES::i16complex i16c;
-            //float tmp[2];
-            const size_t dataSize = sizeof(i16c);
-            //Complex* times0start = data->timeSeriesData(time0/_nSamplesPerTimeBlock, 0, 0);
-            //Complex* times1start = data->timeSeriesData(time0/_nSamplesPerTimeBlock, 0, 1);
-            Complex* times0start = data->data();
-            unsigned nTimeBlocks = data->nTimeBlocks();
-            unsigned nPols = data->nPolarisations();
-            for (unsigned s = 0; s < _nSubbands; ++s) {
-                for (unsigned t = 0; t < _nSamplesPerPacket; ++t) {
-
-                    iTimeBlock = (time0 + t) / _nSamplesPerTimeBlock;
-
-                    index = time0 - (iTimeBlock * _nSamplesPerTimeBlock) + t;
-
-                    //                    times0 = data->timeSeriesData(iTimeBlock, s, 0);
-                    //                    times1 = data->timeSeriesData(iTimeBlock, s, 1);
-                    times0 = &times0start[_nSamplesPerTimeBlock*(nTimeBlocks*(s*nPols+0)+iTimeBlock)];
-                    times1 = &times0start[_nSamplesPerTimeBlock*(nTimeBlocks*(s*nPols+1)+iTimeBlock)];
-
-
-                    //printf("Times0 pointer: %p \n", times0);
-                    //printf("Times1 pointer: %p \n", times1);
-
-                    i16c = *reinterpret_cast<TYPES::i16complex*>(&buffer[iPtr]);
-                    times0[index] = _makeComplex(i16c);
-                    //tmp[0]=(Real)i16c.real();
-                    //tmp[1]=(Real)i16c.imag();
-                    //times0[index] = *reinterpret_cast<Complex*>(&tmp[0]);
-
-                    iPtr += dataSize;
-                    i16c = *reinterpret_cast<TYPES::i16complex*>(&buffer[iPtr]);
-                    times1[index] = _makeComplex(i16c);
-                    //tmp[0]=(Real)i16c.real();
-                    //tmp[1]=(Real)i16c.imag();
-                    //times1[index] = *reinterpret_cast<Complex*>(&tmp[0]);
-                    iPtr += dataSize;
-
-                }
+/**
+ * @details
+ * Unpacks one packet, ordered by sub-band, time and polarisation, into the
+ * time series of each sub-band and polarisation.
+ *
+ * @param[in]  buffer   Packet data section.
+ * @param[out] times    First time of the packet in the series of sub-band 0,
+ *                      polarisation 0.
+ * @param[in]  nTimes   Length of each time series (the stride between them).
+ */
+template<class Sample, unsigned NPOL>
+void AdapterTimeSeriesDataSet::_unpack(const char* buffer, Complex* times,
+        unsigned nSubbands, unsigned nPolarisations, unsigned nSamples,
+        unsigned long nTimes)
+{
+    const unsigned nPols = NPOL ? NPOL : nPolarisations;
+    for (unsigned s = 0; s < nSubbands; ++s) {
+        for (unsigned p = 0; p < nPols; ++p) {
+            Real* out = reinterpret_cast<Real*>(times + (s * nPols + p) * nTimes);
+            unsigned i = s * nSamples * nPols + p;
+            for (unsigned t = 0; t < nSamples; ++t) {
+                Sample::decode(buffer, i + t * nPols, out[2 * t], out[2 * t + 1]);
             }
-            break;
         }
-        default:
-            throw _err("Bits per sample (%1) unsupported").arg(_sampleBits);
-    };
+    }
 }
 
 
@@ -318,19 +294,6 @@ void AdapterTimeSeriesDataSet::_printHeader(const UDPPacket::Header& header)
 }
 
 
-inline AdapterTimeSeriesDataSet::Complex
-AdapterTimeSeriesDataSet::_makeComplex(const TYPES::i8complex& z)
-{
-    return Complex( (Real) z.real(), (Real) z.imag() );
-}
-
-
-inline AdapterTimeSeriesDataSet::Complex
-AdapterTimeSeriesDataSet::_makeComplex(const TYPES::i16complex& z)
-{
-    return Complex( (Real) z.real(), (Real) z.imag() );
-}
-
 inline QString AdapterTimeSeriesDataSet::_err(const QString& message)
 {
     return QString("AdapterTimeSeriesDataSet: ") + message;
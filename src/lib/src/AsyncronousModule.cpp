@@ -2,6 +2,8 @@
 #include <QtConcurrentRun>
 #include "GPU_Manager.h"
 #include "GPU_NVidia.h"
+#include "GPU_CPU.h"
+#include "WorkerPool.h"
 #include <boost/bind.hpp>
 #include <iostream>
 
@@ -15,9 +17,18 @@ namespace ampp {
  *@details AsyncronousModule 
  */
 AsyncronousModule::AsyncronousModule( const ConfigNode& config )
-    : AbstractModule( config )
+    : AbstractModule( config ), _exportPool(0)
 {
-   _chain = new ProcessingChain1<DataBlob*>;
+   _chain = new ProcessingChain1<DataBlob*>( config.type() + ".chain" );
+   // the connected tasks run on a pool of their own
+   //    <exportPool threads="1" queueDepth="16" priority="low"/>
+   unsigned int exportThreads = config.getOption("exportPool", "threads", "1").toUInt();
+   if( exportThreads ) {
+       _exportPool = new WorkerPool( config.type() + ".exportPool", exportThreads,
+               config.getOption("exportPool", "queueDepth", "16").toUInt(),
+               WorkerPool::priority( config.getOption("exportPool", "priority", "low") ) );
+       _chain->setPool( _exportPool );
+   }
    // initialise the GPU manager if required
    // for now we share the mamanger between all instances
    // and hog all the cards. We could refine this by removing
@@ -25,7 +36,20 @@ AsyncronousModule::AsyncronousModule( const ConfigNode& config )
    // down an appropriately configured gpuManager in the 
    // constructor.
    if( gpuManager()->resources() == 0 ) {
+       // jobs beyond this many waiting fail rather than queue up
+       //    <jobQueue maxDepth="1024"/>
+       QString depth = QString::number( gpuManager()->maxQueueDepth() );
+       gpuManager()->setMaxQueueDepth( config.getOption("jobQueue", "maxDepth", depth).toUInt() );
+#ifdef CUDA_FOUND
        GPU_NVidia::initialiseResources( gpuManager() );
+#endif
+       // CPU workers take the jobs no card is free for. Without any
+       // card they default to a single worker using all cores.
+       //    <cpuResources value="1" threads="0"/>
+       QString defaultCpus = gpuManager()->resources() ? "0" : "1";
+       unsigned int cpus = config.getOption("cpuResources", "value", defaultCpus).toUInt();
+       unsigned int threads = config.getOption("cpuResources", "threads", "0").toUInt();
+       GPU_CPU::initialiseResources( gpuManager(), cpus, threads );
    }
 }
 
@@ -43,10 +67,15 @@ AsyncronousModule::~AsyncronousModule()
     // outstanding jobs
     // are finished before removing the rest of the object
     delete _chain;
+    delete _exportPool;
+}
+
+bool AsyncronousModule::waitForJobCompletion( unsigned long timeout ) const {
+    return _chain->waitTaskCompletion( timeout );
 }
 
-void AsyncronousModule::waitForJobCompletion() const {
-    _chain->waitTaskCompletion();
+int AsyncronousModule::tasksPending() const {
+    return _chain->running().pending();
 }
 
 void AsyncronousModule::connect( const boost::function1<void, DataBlob*>& functor ) {
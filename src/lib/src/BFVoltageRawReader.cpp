@@ -0,0 +1,83 @@
+#include "BFVoltageRawReader.h"
+#include "SpectrumDataSet.h"
+
+#include <vector>
+
+namespace pelican {
+
+namespace ampp {
+
+
+/**
+ *@details BFVoltageRawReader
+ */
+BFVoltageRawReader::BFVoltageRawReader(const QStringList& files,
+        unsigned nSubbands, unsigned nChannels)
+    : _nSubbands(nSubbands), _nChannels(nChannels), _timestamp(0),
+      _blockRate(0)
+{
+    if( files.size() != 4 )
+        throw QString("BFVoltageRawReader: expecting 4 files (Xr, Xi, Yr, Yi), got %1")
+                .arg(files.size());
+
+    foreach( const QString& name, files ) {
+        QFile* file = new QFile(name);
+        _files.append(file);
+        if( ! file->open(QIODevice::ReadOnly) )
+            throw QString("BFVoltageRawReader: unable to open file %1").arg(name);
+    }
+}
+
+/**
+ *@details
+ */
+BFVoltageRawReader::~BFVoltageRawReader()
+{
+    foreach( QFile* file, _files ) {
+        delete file;
+    }
+}
+
+void BFVoltageRawReader::setTiming(double startTimestamp, double blockRate)
+{
+    _timestamp = startTimestamp;
+    _blockRate = blockRate;
+}
+
+unsigned BFVoltageRawReader::read(SpectrumDataSetC32* data, unsigned nTimeBlocks)
+{
+    const unsigned nPolarisations = 2;
+    unsigned blockValues = _nSubbands * _nChannels;
+    qint64 blockBytes = blockValues * sizeof(float);
+
+    // Each block must be present in all of the component files.
+    qint64 available = _files[0]->bytesAvailable();
+    for( int i = 1; i < _files.size(); ++i )
+        available = qMin(available, _files[i]->bytesAvailable());
+    unsigned nBlocks = qMin<qint64>(nTimeBlocks, available / blockBytes);
+    if( nBlocks == 0 ) return 0;
+
+    data->resize(nBlocks, _nSubbands, nPolarisations, _nChannels);
+    data->setLayout(SpectrumDataSetC32::PolarisationBlocks);
+    data->setLofarTimestamp(_timestamp);
+    data->setBlockRate(_blockRate);
+
+    std::vector<float> re(blockValues), im(blockValues);
+    for( unsigned t = 0; t < nBlocks; ++t ) {
+        for( unsigned p = 0; p < nPolarisations; ++p ) {
+            _files[2*p]->read(reinterpret_cast<char*>(&re[0]), blockBytes);
+            _files[2*p+1]->read(reinterpret_cast<char*>(&im[0]), blockBytes);
+            for( unsigned s = 0; s < _nSubbands; ++s ) {
+                std::complex<float>* spectrum = data->spectrumData(t, s, p);
+                const unsigned offset = s * _nChannels;
+                for( unsigned c = 0; c < _nChannels; ++c )
+                    spectrum[c] = std::complex<float>(re[offset + c], im[offset + c]);
+            }
+        }
+    }
+    _timestamp += nBlocks * _blockRate;
+    return nBlocks;
+}
+
+} // namespace ampp
+} // namespace pelican
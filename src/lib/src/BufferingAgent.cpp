@@ -1,64 +1,113 @@
 #include "BufferingAgent.h"
+#include <QMutexLocker>
 #include <iostream>
+#include <exception>
 
 namespace pelican {
 namespace ampp {
 
-BufferingAgent::BufferingAgent(const DataFetchFunction& fn)
+BufferingAgent::BufferingAgent(const DataFetchFunction& fn, unsigned int depth,
+                               const QString& name)
     : QThread()
-    , _max_queue_length(3)
+    , _depth(depth ? depth : 1)
     , _halt(false)
     , _fn(fn)
+    , _served(0)
+    , _hits(MetricsRegistry::instance().counter(name + ".hits"))
+    , _misses(MetricsRegistry::instance().counter(name + ".misses"))
+    , _wait(MetricsRegistry::instance().histogram(name + ".wait"))
+    , _prefetched(MetricsRegistry::instance().gauge(name + ".prefetched"))
 {
-    std::cout << "in ba constructor" << std::endl;
-    // create some objects to fill
-    for(unsigned int i=0; i < _max_queue_length; ++i ) {
-        _buffer_objects.push_back(DataBlobHash());
-    }
-    // assign then to the buffer locking manager
-    _buffer.reset(&_buffer_objects);
 }
 
 BufferingAgent::~BufferingAgent()
 {
-    _halt = true;
-    if(!_queue.empty()) _buffer.unlock(_queue.front()); // ensure to remove any block 
+    stop();
+    wait(); // for the fetch under way, if any
+    foreach( Slot* slot, _slots ) {
+        delete slot;
+    }
+}
+
+void BufferingAgent::_createSlots(const DataBlobHash& hash)
+{
+    // one more than the depth: the one being served
+    for(unsigned int i=0; i <= _depth; ++i ) {
+        Slot* slot = new Slot;
+        foreach( const QString& key, hash.keys() ) {
+            slot->blobs.insert( key, _blobFactory.create( hash.value(key)->type() ) );
+        }
+        _slots.append( slot );
+        _free.append( slot );
+    }
 }
 
 void BufferingAgent::run() {
-    _halt = false;
-    while(1) {
-        if(_halt) return;
-        DataBlobHash& hash = *(_buffer.next()); // blocks until ready
-        std::cout << "got next buffer!" << std::endl;
-        if(_halt) {
-            std::cout << "blah" << std::endl;
-            return;
+    for(;;) {
+        Slot* slot;
+        {
+            QMutexLocker lock(&_mutex);
+            while( _free.isEmpty() && ! _halt ) _freed.wait(&_mutex);
+            if( _halt ) return;
+            slot = _free.takeFirst();
+        }
+        try {
+            slot->valid = _fn(slot->blobs);
+            slot->error.clear();
         }
-        _fn(hash);
-        std::cout << "pushing to the queue" << std::endl;
-        _queue.push_back(&hash);
+        catch( const QString& e ) {
+            slot->valid.clear();
+            slot->error = e;
+        }
+        catch( const std::exception& e ) {
+            slot->valid.clear();
+            slot->error = QString("BufferingAgent: ") + e.what();
+        }
+        catch( ... ) {
+            slot->valid.clear();
+            slot->error = "BufferingAgent: unknown error fetching data";
+        }
+        QMutexLocker lock(&_mutex);
+        _filled.append( slot );
+        _prefetched.set( _filled.size() );
+        _ready.wakeOne();
     }
 }
 
 void BufferingAgent::stop()
 {
+    QMutexLocker lock(&_mutex);
     _halt = true;
-    quit();
+    _freed.wakeAll();
+    _ready.wakeAll();
 }
 
-void BufferingAgent::getData(BufferingAgent::DataBlobHash& hash) {
-    // spin until we have data
-    std::cout << "a" << std::endl;
-    do{
-    } // TODO verify empty() is thread safe (and _queue.pop_front() call later on particularly when the _buffer is still filling slots)
-    while(_queue.empty());
-    std::cout << "b" << std::endl;
-
-    DataBlobHash* tmp = _queue.front();
-    hash.swap(*tmp); // TODO verify this is doing what we think its doing
-    _queue.pop_front(); // remove from queue before unblocking the other thread to reduce conflicts
-    _buffer.unlock(tmp);
+BufferingAgent::DataBlobHash BufferingAgent::getData(BufferingAgent::DataBlobHash& hash) {
+    QMutexLocker lock(&_mutex);
+    if( _slots.isEmpty() ) {
+        // now we know what blobs to fill
+        _createSlots( hash );
+        start();
+    }
+    // the pipeline has finished with the last data we served
+    if( _served ) {
+        _free.append( _served );
+        _served = 0;
+        _freed.wakeOne();
+    }
+    if( _filled.isEmpty() ) {
+        _misses.add();
+        MetricTimer timer( _wait );
+        while( _filled.isEmpty() && ! _halt ) _ready.wait(&_mutex);
+        if( _filled.isEmpty() ) return DataBlobHash();
+    }
+    else {
+        _hits.add();
+    }
+    _served = _filled.takeFirst();
+    _prefetched.set( _filled.size() );
+    if( ! _served->error.isEmpty() ) throw _served->error;
+    return _served->valid;
 }
 
 } // namespace ampp
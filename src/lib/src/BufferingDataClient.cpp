@@ -1,5 +1,4 @@
 #include "BufferingDataClient.h"
-#include <QCoreApplication>
 #include <boost/bind.hpp>
 
 namespace pelican {
@@ -8,45 +7,33 @@ namespace ampp {
 template<class DataClientType>
 BufferingDataClient<DataClientType>::BufferingDataClient(const ConfigNode& configNode, const DataTypes& types, const Config* config)
     : DataClientType(configNode, types, config)
-    , _agent(boost::bind(&DataClientType::getData, this, _1))
-//    , _halt(false)
+    , _agent(boost::bind(&BufferingDataClient<DataClientType>::_fetch, this, _1),
+             configNode.getOption("prefetch", "depth", "3").toUInt(),
+             "BufferingDataClient")
 {
-    // start the thread running that collects data
-    std::cout << "starting agent..." << std::endl;
-    _agent.start();
-    std::cout << "done..." << std::endl;
-
-    // dedicate a thread to running the event loop of the agent to ensure messages are delivered to the agent
-    //QtConcurrent::run(boost::bind(&BufferingDataClient<DataClientType>::exec, this));   
+    // the agent starts fetching on the first call to getData(), when
+    // it knows which blobs to fill
 }
 
 template<class DataClientType>
 BufferingDataClient<DataClientType>::~BufferingDataClient()
 {
     // stop the thread running
-    std::cout << "stopping agent..." << std::endl;
     _agent.stop();
-    std::cout << "done..." << std::endl;
-    //_halt = true;
+    _agent.wait();
 }
 
-#if 0
 template<class DataClientType>
-void BufferingDataClient<DataClientType>::exec() 
+pelican::AbstractDataClient::DataBlobHash BufferingDataClient<DataClientType>::_fetch(pelican::AbstractDataClient::DataBlobHash& hash)
 {
-    while(!_halt) {
-        QCoreApplication::processEvents();
-    }
+    // not virtual: getData() is ours
+    return DataClientType::getData(hash);
 }
-#endif
 
 template<class DataClientType>
 pelican::AbstractDataClient::DataBlobHash BufferingDataClient<DataClientType>::getData(pelican::AbstractDataClient::DataBlobHash& hash)
 {
-    std::cout << "getting data..." << std::endl;
-    _agent.getData(hash);
-    std::cout << "done..." << std::endl;
-    return hash;
+    return _agent.getData(hash);
 }
 
 } // namespace ampp
@@ -0,0 +1,121 @@
+#include "CompletionCounter.h"
+
+#include <QtCore/QMutexLocker>
+
+
+namespace pelican {
+
+namespace ampp {
+
+// -----------------------------------------------------------------------------
+// Deadline
+//
+
+Deadline::Deadline(unsigned long ms)
+    : _never(ms == ULONG_MAX)
+{
+    clock_gettime(CLOCK_MONOTONIC, &_end);
+    if( _never ) return;
+    _end.tv_sec += ms / 1000;
+    _end.tv_nsec += (ms % 1000) * 1000000L;
+    if( _end.tv_nsec >= 1000000000L ) {
+        _end.tv_nsec -= 1000000000L;
+        ++_end.tv_sec;
+    }
+}
+
+unsigned long Deadline::remaining() const
+{
+    if( _never ) return ULONG_MAX;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long ns = (long long)(_end.tv_sec - now.tv_sec) * 1000000000LL
+                   + (_end.tv_nsec - now.tv_nsec);
+    // rounded up, so that a wait of remaining() ms does reach the deadline
+    return ns > 0 ? (unsigned long)( ( ns + 999999 ) / 1000000 ) : 0;
+}
+
+// -----------------------------------------------------------------------------
+// CompletionCounter
+//
+
+/**
+ *@details CompletionCounter
+ */
+CompletionCounter::CompletionCounter( const QString& name )
+    : _name(name), _pending(0), _maxPending(0), _blockedWaits(0), _timeouts(0),
+      _pendingGauge(MetricsRegistry::instance().gauge(name + ".pending")),
+      _blockedCounter(MetricsRegistry::instance().counter(name + ".blockedWaits")),
+      _timeoutCounter(MetricsRegistry::instance().counter(name + ".timeouts"))
+{
+}
+
+/**
+ *@details
+ */
+CompletionCounter::~CompletionCounter()
+{
+}
+
+void CompletionCounter::add(int n)
+{
+    QMutexLocker lock(&_mutex);
+    _pending += n;
+    if( _pending > _maxPending ) _maxPending = _pending;
+    _pendingGauge.set( _pending );
+}
+
+void CompletionCounter::done(int n)
+{
+    QMutexLocker lock(&_mutex);
+    _pending -= n;
+    Q_ASSERT( _pending >= 0 );
+    _pendingGauge.set( _pending );
+    if( _pending <= 0 ) _finished.wakeAll();
+}
+
+int CompletionCounter::pending() const
+{
+    QMutexLocker lock(&_mutex);
+    return _pending;
+}
+
+bool CompletionCounter::wait(unsigned long timeout) const
+{
+    QMutexLocker lock(&_mutex);
+    if( _pending <= 0 ) return true;
+    ++_blockedWaits;
+    _blockedCounter.add();
+    Deadline deadline(timeout);
+    while( _pending > 0 ) {
+        unsigned long ms = deadline.remaining();
+        if( ms == 0 ) {
+            ++_timeouts;
+            _timeoutCounter.add();
+            return false;
+        }
+        _finished.wait(&_mutex, ms);
+    }
+    return true;
+}
+
+int CompletionCounter::maxPending() const
+{
+    QMutexLocker lock(&_mutex);
+    return _maxPending;
+}
+
+unsigned long CompletionCounter::blockedWaits() const
+{
+    QMutexLocker lock(&_mutex);
+    return _blockedWaits;
+}
+
+unsigned long CompletionCounter::timeouts() const
+{
+    QMutexLocker lock(&_mutex);
+    return _timeouts;
+}
+
+} // namespace ampp
+} // namespace pelican
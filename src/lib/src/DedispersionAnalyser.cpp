@@ -20,6 +20,10 @@ DedispersionAnalyser::DedispersionAnalyser( const ConfigNode& config )
     //unsigned int nChannels = config.getOption("outputChannelsPerSubband", "value", "512").toUInt();
     _detectionThreshold = config.getOption("detectionThreshold", "in_sigma", "6.0").toFloat();
     _binPow2 = config.getOption("power2ForBinning", "value", "6").toUInt();
+    _shedBinPow2 = config.getOption("shedPower2ForBinning", "value",
+                                    QString::number(_binPow2 / 2)).toUInt();
+    if( _shedBinPow2 > _binPow2 ) _shedBinPow2 = _binPow2;
+    _binLevels = _binPow2;
     _useStokesStats = config.getOption("useStokesStats", "0_or_1").toUInt();
 }
 
@@ -68,6 +72,9 @@ int DedispersionAnalyser::analyse( DedispersionSpectra* data,
     // Add a dummy event to get the timestamp of the first bin in the blob
     result->addEvent( 0, 0, 1, 0.0 );
 
+    // the levels above are skipped while shedding load
+    unsigned int levels = _binLevels;
+
     // Compute 2^_binPowerOf2
     unsigned int maxPow2 = pow(2,_binPow2);
     unsigned int numberOfwidestBins = nsamp/maxPow2;
@@ -114,7 +121,7 @@ int DedispersionAnalyser::analyse( DedispersionSpectra* data,
             result->addEvent( dm_count, index, 1, binnedOutput[0][j] );
           }
         }
-        for (int n = 1 ; n < _binPow2 + 1; ++n){
+        for (int n = 1 ; n < levels + 1; ++n){
           currentPow2 /= 2;
           for (int j = 0; j < currentPow2; ++j){
             int binFactor = maxPow2/currentPow2;
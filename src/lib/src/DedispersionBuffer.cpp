@@ -6,6 +6,7 @@
 #include <algorithm>
 #include "SpectrumDataSet.h"
 #include "WeightedSpectrumDataSet.h"
+#include "ChannelKernels.h"
 #include <omp.h>
 
 namespace pelican {
@@ -18,7 +19,8 @@ namespace ampp {
  */
 DedispersionBuffer::DedispersionBuffer( unsigned int size, unsigned int sampleSize,
                                         bool invertChannels )
-   : _sampleSize(sampleSize), _invertChannels(invertChannels)
+   : _sampleSize(sampleSize), _invertChannels(invertChannels),
+     _addSampleTimer("DedispersionBuffer.addSamples")
 {
     setSampleCapacity(size);
     clear();
@@ -126,49 +128,42 @@ void DedispersionBuffer::dumpbin( const QString& fileName ) const {
     }
     unsigned maxSamples = std::min( numSamples, spaceRemaining() + *sampleNumber );
     timerStart(&_addSampleTimer);
+    WeightedTransposeKernel<RuntimeChannels>::Function transposeWeighted =
+        ChannelKernels::select<WeightedTransposeKernel>(nChannels);
     int start = *sampleNumber;
     Q_ASSERT(maxSamples > start);
     if( _invertChannels ) {
-        int nChannelsMinusOne = nChannels - 1;
         int nSubbandsMinusOne= nSubbands - 1;
         // Try varying x, from 6 down.  Also try it with this commented out.
         //        omp_set_num_threads(6);
-        int s, c;
+        int s;
         int localSampleCount = _sampleCount - start;    // create a copy for omp to lock
-#pragma omp parallel for private(s,c) schedule(dynamic)
+#pragma omp parallel for private(s) schedule(dynamic)
         for(int t = start; t < (int)maxSamples; ++t ) {
             for (s = 0; s < (int)nSubbands; ++s ) {
                 int bsize = s*nChannels*_nsamp + localSampleCount + t;
                 float* data = streamData->spectrumData(t, nSubbandsMinusOne - s, 0);
                 const float* weightData = weights->spectrumData(t, nSubbandsMinusOne - s, 0);
-                for (c = 0; c < (int)nChannels; ++c ) {
-                  //                    _timedata[(bsize + (c * _nsamp))] = data[nChannelsMinusOne - c];
-
-                  // The following equation is used to replace data
-                  // samples that have been set to zero by the RFI
-                  // clipper to values from a template noise buffer
-                  // that obbey the distribution that the RFI clipper
-                  // forces
-                  data[nChannelsMinusOne - c]  = data[nChannelsMinusOne - c] - (weightData[nChannelsMinusOne - c] - 1) * noiseTemplate[(bsize + (c * _nsamp))]; // change the data
-                  _timedata[(bsize + (c * _nsamp))] = data[nChannelsMinusOne - c];
-                }
+                // The kernel replaces data samples that have been set to
+                // zero by the RFI clipper with values from a template noise
+                // buffer that obbey the distribution that the RFI clipper
+                // forces
+                transposeWeighted( data, weightData, &noiseTemplate[bsize],
+                                   &_timedata[bsize], _nsamp, true, nChannels );
             }
         }
     } else {
-        int s, c;
+        int s;
         int localSampleCount = _sampleCount - start;    // create a copy for omp to lock
-#pragma omp parallel for private(s,c) schedule(dynamic)
+#pragma omp parallel for private(s) schedule(dynamic)
         for(int t = start; t < (int)maxSamples; ++t) {
             int sampleOffset = localSampleCount + t;
             for ( s = 0; s < (int)nSubbands; ++s) {
                 float* data = streamData->spectrumData(t, s, 0);
                 const float* weightData = weights->spectrumData(t, s, 0);
                 int bsize = s*nChannels * _nsamp + sampleOffset;
-                for ( c = 0; c < (int)nChannels; ++c) {
-                  //                    _timedata[ bsize + ( c * _nsamp ) ] = data[c];
-                  data[c] = data[c] - (weightData[c] - 1) * noiseTemplate[bsize + (c * _nsamp)];
-                  _timedata[ bsize + (c * _nsamp)] = data[c];
-                    }
+                transposeWeighted( data, weightData, &noiseTemplate[bsize],
+                                   &_timedata[bsize], _nsamp, false, nChannels );
             }
         }
     }
@@ -197,43 +192,33 @@ void DedispersionBuffer::dumpbin( const QString& fileName ) const {
     }
     unsigned maxSamples = std::min( numSamples, spaceRemaining() + *sampleNumber );
     timerStart(&_addSampleTimer);
+    TransposeKernel<RuntimeChannels>::Function transpose =
+        ChannelKernels::select<TransposeKernel>(nChannels);
     int start = *sampleNumber;
     if( _invertChannels ) {
-        int nChannelsMinusOne = nChannels - 1;
         int nSubbandsMinusOne= nSubbands - 1;
         // Try varying x, from 6 down.  Also try it with this commented out.
         //        omp_set_num_threads(6);
-        int s, c;
+        int s;
         int localSampleCount = _sampleCount - start;    // create a copy for omp to lock
-#pragma omp parallel for private(s,c) schedule(dynamic)
+#pragma omp parallel for private(s) schedule(dynamic)
         for(int t = start; t < (int)(start + maxSamples); ++t ) {
             for (s = 0; s < (int)nSubbands; ++s ) {
                 int bsize = s*nChannels*_nsamp + localSampleCount + t;
-                float* data = streamData->spectrumData(t, nSubbandsMinusOne - s, 0);
-                for (c = 0; c < (int)nChannels; ++c ) {
-                  //                    _timedata[(bsize + (c * _nsamp))] = data[nChannelsMinusOne - c];
-
-                  // The following equation is used to replace data
-                  // samples that have been set to zero by the RFI
-                  // clipper to values from a template noise buffer
-                  // that obbey the distribution that the RFI clipper
-                  // forces
-                  _timedata[(bsize + (c * _nsamp))] = data[nChannelsMinusOne - c];
-                }
+                const float* data = streamData->spectrumData(t, nSubbandsMinusOne - s, 0);
+                transpose( data, &_timedata[bsize], _nsamp, true, nChannels );
             }
         }
     } else {
-        int s, c;
+        int s;
         int localSampleCount = _sampleCount - start;    // create a copy for omp to lock
-#pragma omp parallel for private(s,c) schedule(dynamic)
+#pragma omp parallel for private(s) schedule(dynamic)
         for(int t = start; t < (int)(start + maxSamples); ++t) {
             int sampleOffset = localSampleCount + t;
             for ( s = 0; s < (int)nSubbands; ++s) {
-                float* data = streamData->spectrumData(t, s, 0);
+                const float* data = streamData->spectrumData(t, s, 0);
                 int bsize = s*nChannels * _nsamp + sampleOffset;
-                for ( c = 0; c < (int)nChannels; ++c) {
-                  _timedata[ bsize + (c * _nsamp)] = data[c];
-                    }
+                transpose( data, &_timedata[bsize], _nsamp, false, nChannels );
             }
         }
     }
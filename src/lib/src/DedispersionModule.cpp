@@ -11,6 +11,7 @@
 #include "GPU_Kernel.h"
 #include "GPU_Param.h"
 #include "GPU_NVidia.h"
+#include "GPU_CPU.h"
 #include "GPU_Manager.h"
 #include <fstream>
 #include <boost/random/mersenne_twister.hpp>
@@ -40,13 +41,27 @@ namespace ampp {
  * </DedispersionModule>
  */
 
-DedispersionModule::DedispersionModule( const ConfigNode& config ) : AsyncronousModule(config)
+DedispersionModule::DedispersionModule( const ConfigNode& config ) : AsyncronousModule(config),
+    _copyTimer("DedispersionModule.copy"),
+    _bufferTimer("DedispersionModule.nextBuffer"),
+    _launchTimer("DedispersionModule.launch"),
+    _dedisperseTimer("DedispersionModule.submit"),
+    _bufferWait(MetricsRegistry::instance().histogram("DedispersionModule.bufferWait")),
+    _buffersFree(MetricsRegistry::instance().gauge("DedispersionModule.buffersFree")),
+    _drainWait(MetricsRegistry::instance().histogram("DedispersionModule.drainWait"))
 {
     // Get configuration options
     //unsigned int nChannels = config.getOption("outputChannelsPerSubband", "value", "512").toUInt();
     float timeSamplesPow2 = config.getOption("timeBinsPerBufferPow2", "value", "15").toFloat();
     _numSamplesBuffer = (int) pow(2.0, timeSamplesPow2);
     _tdms = config.getOption("dedispersionSamples", "value", "1984").toUInt();
+    _shedTdms = config.getOption("shedDedispersionSamples", "value",
+                                 QString::number(_tdms / 2)).toUInt();
+    if ( _shedTdms < 1 || _shedTdms > _tdms )
+    {
+        _shedTdms = _tdms;
+    }
+    _activeTdms = _tdms;
     _dmStep = config.getOption("dedispersionStepSize", "value", "0.0").toFloat();
     _dmLow = config.getOption("dedispersionMinimum", "value", "0.0").toFloat();
     if ( _dmLow < 0.0 )
@@ -86,13 +101,13 @@ DedispersionModule::~DedispersionModule()
     _cleanBuffers();
 }
 
-void DedispersionModule::waitForJobCompletion()
+bool DedispersionModule::waitForJobCompletion( unsigned long timeout )
 {
-    while ( ! ( _kernels.allAvailable() && _jobBuffer.allAvailable() ) )
-    {
-        usleep(10);
-    }
-    AsyncronousModule::waitForJobCompletion();
+    MetricTimer wait( _drainWait );
+    Deadline deadline( timeout );
+    return _kernels.waitAllAvailable( deadline.remaining() )
+           && _jobBuffer.waitAllAvailable( deadline.remaining() )
+           && AsyncronousModule::waitForJobCompletion( deadline.remaining() );
 }
 
 void DedispersionModule::_cleanBuffers()
@@ -229,35 +244,38 @@ void DedispersionModule::dedisperse( WeightedSpectrumDataSet* weightedData )
   do {
     unsigned ret = _currentBuffer->addSamples( weightedData, _noiseTemplate, &sampleNumber );
     if (0 == ret) {
-      //timerStart(&_launchTimer);
-      //timerStart(&_bufferTimer);
+      timerStart(&_launchTimer);
+      timerStart(&_bufferTimer);
+      MetricTimer wait( _bufferWait );
       DedispersionBuffer* next = _buffers.next();
+      wait.stop();
+      _buffersFree.set( _buffers.numberAvailable() );
       next->clear();
-      //timerUpdate(&_bufferTimer);
+      timerUpdate(&_bufferTimer);
       {   // lock mutex scope
         // lock here to ensure there is just a single hit on the 
         // lock mutex for each buffer
         QMutexLocker l( &lockerMutex );
         lockAllUnprotected( _blobs );
-        //timerStart(&_copyTimer);
+        timerStart(&_copyTimer);
         //        std::cout << "maxshift to be copied" << std::endl;
 	//        lockAllUnprotected( _currentBuffer->copy( next, _noiseTemplate, _maxshift ) );
         lockAllUnprotected( _currentBuffer->copy( next, _noiseTemplate, _maxshift + _remainingSamples, sampleNumber ) );
 //        lockAllUnprotected( _currentBuffer->copy( next, _noiseTemplate, _maxshift, sampleNumber ) );
         //        std::cout << "maxshift copied" << std::endl;
         
-        //timerUpdate( &_copyTimer );
+        timerUpdate( &_copyTimer );
         // ensure lock is maintianed for the next buffer
         // if not already marked by the maxshift copy
         if( sampleNumber != maxSamples && ! next->inputDataBlobs().contains(streamData) )
           lockUnprotected( streamData );
       }
       _blobs.clear();
-      //timerStart( &_dedisperseTimer );
+      timerStart( &_dedisperseTimer );
       QtConcurrent::run( this, &DedispersionModule::dedisperse, _currentBuffer, _dedispersionDataBuffer.next() );
-      //timerUpdate( &_dedisperseTimer );
+      timerUpdate( &_dedisperseTimer );
       _currentBuffer = next;
-      //timerUpdate(&_launchTimer);
+      timerUpdate(&_launchTimer);
       //timerReport(&_launchTimer, "Launch Total");
       //timerReport(&_dedisperseTimer, "Dedispersing Time");
       //timerReport(&_bufferTimer,"bufferTimer");
@@ -288,10 +306,14 @@ void DedispersionModule::dedisperse( DedispersionBuffer* buffer, DedispersionSpe
       dataOut << " " << 
       std::endl;
     */
-    dataOut->resize( nsamp, _tdms, _dmLow, _dmStep );
+    // the highest DMs are left out while shedding load; the buffers and
+    // kernels are sized for all of them
+    unsigned tdms = _activeTdms;
+    dataOut->resize( nsamp, tdms, _dmLow, _dmStep );
     // Set up a job for the GPU processing kernel
     GPU_Job* job = _jobBuffer.next();
     DedispersionKernel* kernelPtr = _kernels.next();
+    kernelPtr->setDMTrials( tdms );
     kernelPtr->setOutputBuffer( dataOut->data() );
     kernelPtr->setInputBuffer( buffer->getData(),
                    boost::bind( &DedispersionModule::gpuDataUploaded, this, buffer ) );
@@ -382,5 +404,41 @@ void DedispersionModule::DedispersionKernel::run( GPU_NVidia& gpu )
                        );
 }
 
+// Copy the input so that its buffer goes back to the module whilst the
+// previous job is still dedispersing.
+void DedispersionModule::DedispersionKernel::stageIn( GPU_CPU& cpu )
+{
+    const float* in = (const float*)cpu.devicePtr(_inputBuffer);
+    _stagedInput.assign( in, in + _inputBuffer.size() / sizeof(float) );
+    _inputBuffer.runCallBacks();
+}
+
+// The brute force dedispersion of the CUDA kernel, on the host: output
+// sample t at trial d is the sum over channels of the input sample shifted
+// by that channel's delay at the trial's DM.
+void DedispersionModule::DedispersionKernel::run( GPU_CPU& cpu )
+{
+    float* out = (float*)cpu.devicePtr(_outputBuffer);
+    const float* in = &_stagedInput[0];
+    const float* dmShift = (const float*)cpu.devicePtr(_dmShift);
+    int nOut = (int)(_nsamples - _maxshift);
+    int tdms = (int)_tdms;
+    float startdm = _startdm / _tsamp;
+    float dmstep = _dmstep / _tsamp;
+
+    #pragma omp parallel for schedule(static) num_threads(cpu.threads())
+    for ( int d = 0; d < tdms; ++d )
+    {
+        float* trial = out + (size_t)d * nOut;
+        float shift = startdm + d * dmstep;
+        for ( int t = 0; t < nOut; ++t ) trial[t] = 0.0f;
+        for ( unsigned c = 0; c < _nChans; ++c )
+        {
+            const float* channel = in + (size_t)c * _nsamples + (int)(dmShift[c] * shift);
+            for ( int t = 0; t < nOut; ++t ) trial[t] += channel[t];
+        }
+    }
+}
+
 } // namespace ampp
 } // namespace pelican
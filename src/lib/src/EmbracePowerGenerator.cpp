@@ -1,5 +1,6 @@
 #include "EmbracePowerGenerator.h"
 #include "SpectrumDataSet.h"
+#include "ChannelKernels.h"
 
 #include "pelican/utility/ConfigNode.h"
 
@@ -7,6 +8,8 @@
 #include <cmath>
 #include <complex>
 
+#include <omp.h>
+
 namespace pelican {
 namespace ampp {
 
@@ -15,6 +18,8 @@ namespace ampp {
 EmbracePowerGenerator::EmbracePowerGenerator(const ConfigNode& config)
 : AbstractModule(config)
 {
+    _summedPower = config.getOption("summedPower", "value", "false").toLower() == "true";
+    _nThreads = config.getOption("processingThreads", "value", "4").toUInt();
 }
 
 
@@ -26,7 +31,8 @@ EmbracePowerGenerator::~EmbracePowerGenerator()
 
 /**
  * @details
- *
+ * The (time block, sub-band) spectra are independent, so they are
+ * distributed between threads as one flattened loop.
  */
 
 void EmbracePowerGenerator::run(const SpectrumDataSetC32* channeliserOutput,
@@ -40,49 +46,45 @@ void EmbracePowerGenerator::run(const SpectrumDataSetC32* channeliserOutput,
 
     stokes->setLofarTimestamp(channeliserOutput->getLofarTimestamp());
     stokes->setBlockRate(channeliserOutput->getBlockRate());
-    stokes->resize(nSamples, nSubbands, 2, nChannels); // 2 is because
-						       // EMBRACE has
-						       // 2, single
-						       // pol
-						       // directions
-						       // rather than
-						       // polarizations
-
-    const Complex* dataPolX, *dataPolY;
-    float *IX, *IY;
-    float powerX, powerY;
-
-    const Complex* dataPolDataBlock = channeliserOutput->data();
-    for (unsigned t = 0; t < nSamples; ++t) {
-        for (unsigned s = 0; s < nSubbands; ++s) {
-            unsigned dataPolIndexX = channeliserOutput->index( s, nSubbands, 
-                                                               0,2,
-                                                               t, nChannels);
-            unsigned dataPolIndexY = channeliserOutput->index( s, nSubbands, 
-                                                               1,2,
-                                                               t, nChannels);
-            dataPolX = &dataPolDataBlock[dataPolIndexX];
-            dataPolY = &dataPolDataBlock[dataPolIndexY];
-
-            IX = stokes->spectrumData(t, s, 0);
-            IY = stokes->spectrumData(t, s, 1);
-
-            for (unsigned c = 0; c < nChannels; ++c) {
-                float Xr = dataPolX[c].real();
-                float Xi = dataPolX[c].imag();
-                float Yr = dataPolY[c].real();
-                float Yi = dataPolY[c].imag();
-
-                powerX = _sqr(Xr) + _sqr(Xi);
-                powerY = _sqr(Yr) + _sqr(Yi);
-
-                IX[c] = powerX;
-                IY[c] = powerY;
-            }
+    // 2 is because EMBRACE has 2, single pol directions rather than
+    // polarizations
+    stokes->resize(nSamples, nSubbands, _summedPower ? 1 : 2, nChannels);
+
+    bool interleaved =
+        (channeliserOutput->layout() == SpectrumDataSetC32::PolarisationInterleaved);
+    Q_ASSERT( !interleaved || channeliserOutput->nPolarisations() == 2 );
+
+    PowerKernel<RuntimeChannels>::Function power =
+        ChannelKernels::select<PowerKernel>(nChannels);
+    StokesIKernel<RuntimeChannels>::Function summedPower =
+        ChannelKernels::select<StokesIKernel>(nChannels);
+    InterleavedPowerKernel<RuntimeChannels>::Function interleavedPower =
+        ChannelKernels::select<InterleavedPowerKernel>(nChannels);
+    InterleavedStokesIKernel<RuntimeChannels>::Function interleavedSummedPower =
+        ChannelKernels::select<InterleavedStokesIKernel>(nChannels);
+
+    int nSpectra = nSamples * nSubbands;
+#pragma omp parallel for num_threads(_nThreads)
+    for (int i = 0; i < nSpectra; ++i) {
+        unsigned t = i / nSubbands;
+        unsigned s = i % nSubbands;
+        const Complex* dataPolX = channeliserOutput->spectrumData(t, s, 0);
+        float* IX = stokes->spectrumData(t, s, 0);
+        if (interleaved) {
+            if (_summedPower)
+                interleavedSummedPower(dataPolX, IX, nChannels);
+            else
+                interleavedPower(dataPolX, IX, stokes->spectrumData(t, s, 1), nChannels);
+        }
+        else {
+            const Complex* dataPolY = channeliserOutput->spectrumData(t, s, 1);
+            if (_summedPower)
+                summedPower(dataPolX, dataPolY, IX, nChannels);
+            else
+                power(dataPolX, dataPolY, IX, stokes->spectrumData(t, s, 1), nChannels);
         }
     }
 }
 
 }// namespace ampp
 }// namespace pelican
-
@@ -44,7 +44,8 @@ namespace ampp {
  *
  */
 EmbraceSubbandSplittingChunker::EmbraceSubbandSplittingChunker(const ConfigNode& config)
-: AbstractChunker(config)
+: AbstractChunker(config), _capture(config),
+  _metrics(QString("EmbraceSubbandSplittingChunker.") + QString::number(port()))
 {
     // Check the configuration type matches the class name.
     if (config.type() != "EmbraceSubbandSplittingChunker")
@@ -142,6 +143,16 @@ EmbraceSubbandSplittingChunker::EmbraceSubbandSplittingChunker(const ConfigNode&
  */
 QIODevice* EmbraceSubbandSplittingChunker::newDevice()
 {
+    // With packet capture enabled a dedicated thread receives the packets
+    // into a ring which next() consumes.
+    if (_capture.enabled()) {
+        PacketCaptureDevice* capture = new PacketCaptureDevice(_capture, _packetSize);
+        if (!capture->bind(host(), port()))
+            cerr << "EmbraceSubbandSplittingChunker::newDevice(): "
+                 << capture->bindError().toStdString() << endl;
+        return capture;
+    }
+
     QUdpSocket* socket = new QUdpSocket;
     const QHostAddress myhost(host());
     std::cout << "IP address: " << host().toUtf8().constData() << std::endl;
@@ -165,7 +176,8 @@ QIODevice* EmbraceSubbandSplittingChunker::newDevice()
  */
 void EmbraceSubbandSplittingChunker::next(QIODevice* device)
 {
-    QUdpSocket* socket = static_cast<QUdpSocket*>(device);
+    // Re-arm the packet capture notification (if capturing).
+    PacketCaptureDevice::acknowledge(device);
 
     unsigned offsetStream1 = 0;
     unsigned offsetStream2 = 0;
@@ -196,12 +208,9 @@ void EmbraceSubbandSplittingChunker::next(QIODevice* device)
             // Chunker sanity check.
             if (!isActive()) return;
 
-            // Wait for datagram to be available.
-            while (!socket->hasPendingDatagrams())
-                socket->waitForReadyRead(100);
-
-            // Read the current packet from the socket.
-            if (socket->readDatagram(reinterpret_cast<char*>(&currPacket), _packetSize) <= 0)
+            // Wait for datagram to be available and read it (from the socket or
+            // the capture ring).
+            if (PacketCaptureDevice::receiveDatagram(device, reinterpret_cast<char*>(&currPacket), _packetSize) <= 0)
 	      {
 		cerr << "EmbraceSubbandSplittingChunker::next(): "
 		  "Error while receiving UDP Packet!" << endl;
@@ -231,6 +240,7 @@ void EmbraceSubbandSplittingChunker::next(QIODevice* device)
 	      cerr << "EmbraceSubbandSplittingChunker::next(): "
                 "Rejecting packet due to problematic seqid" << endl;
                 _packetsRejected++;
+                _metrics.packetsRejected.add();
                 i--;
                 continue;
             }
@@ -248,6 +258,7 @@ void EmbraceSubbandSplittingChunker::next(QIODevice* device)
             if (diff < _nSamples)
             {
                 ++_packetsRejected;
+                _metrics.packetsDuplicated.add();
                 i -= 1;
                 continue;
             }
@@ -292,11 +303,13 @@ void EmbraceSubbandSplittingChunker::next(QIODevice* device)
             }
 
             i += packetCounter;
+            _metrics.packetsLost.add(packetCounter);
 
             // Write received packet to 2 streams after updating header and data
             if (i != _nPackets)
             {
                 ++_packetsAccepted;
+                _metrics.packetsAccepted.add();
 
                 // Headers for new packets
 
@@ -333,12 +346,14 @@ void EmbraceSubbandSplittingChunker::next(QIODevice* device)
                 prevBlockid = blockid;
             }
         }
+        _metrics.chunks.add();
     }
 
     else {
         // Must discard the datagram if there is no available space.
         if (!isActive()) return;
-        socket->readDatagram(0, 0);
+        PacketCaptureDevice::discardDatagram(device);
+        _metrics.packetsDiscarded.add();
         cout << "EmbraceSubbandSplittingChunker::next(): "
                 "Writable data not valid, discarding packets." << endl;
     }
@@ -0,0 +1,91 @@
+#include "GPU_CPU.h"
+#include "GPU_Manager.h"
+#include "GPU_Kernel.h"
+#include "GPU_Job.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+namespace pelican {
+
+namespace ampp {
+
+
+/**
+ *@details GPU_CPU 
+ */
+GPU_CPU::GPU_CPU( unsigned int threads )
+    : _threads(threads)
+{
+#ifdef _OPENMP
+    if( _threads == 0 ) _threads = omp_get_max_threads();
+#else
+    if( _threads == 0 ) _threads = 1;
+#endif
+}
+
+/**
+ *@details
+ */
+GPU_CPU::~GPU_CPU()
+{
+}
+
+bool GPU_CPU::canRun( GPU_Job* job ) const
+{
+    foreach( GPU_Kernel* kernel, job->kernels() ) {
+        if( ! kernel->runsOnCpu() ) return false;
+    }
+    return true;
+}
+
+void GPU_CPU::stageIn( GPU_Job* job )
+{
+    foreach( GPU_Kernel* kernel, job->kernels() ) {
+       try {
+           kernel->stageIn( *this );
+       }
+       catch( ... ) {
+           kernel->cleanUp();
+           throw;
+       }
+    }
+}
+
+void GPU_CPU::run( GPU_Job* job )
+{
+    foreach( GPU_Kernel* kernel, job->kernels() ) {
+       try {
+           kernel->run( *this );
+       }
+       catch( ... ) {
+           kernel->cleanUp();
+           throw;
+       }
+    }
+}
+
+void GPU_CPU::stageOut( GPU_Job* job )
+{
+    foreach( GPU_Kernel* kernel, job->kernels() ) {
+       try {
+           kernel->stageOut( *this );
+       }
+       catch( ... ) {
+           kernel->cleanUp();
+           throw;
+       }
+    }
+}
+
+void GPU_CPU::initialiseResources( GPU_Manager* manager, unsigned int number,
+                                   unsigned int threads )
+{
+     for( unsigned int i = 0; i < number; ++i ) {
+        manager->addResource( new GPU_CPU( threads ) );
+     }
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -11,7 +11,8 @@ namespace ampp {
  *@details GPU_Job 
  */
 GPU_Job::GPU_Job()
-    : _processing(false), _waitCondition(0)
+    : _processing(false), _waitCondition(0), _priority(Normal),
+      _queueTime(0.0), _execTime(0.0)
 {
     setStatus( GPU_Job::None );
 }
@@ -19,7 +20,8 @@ GPU_Job::GPU_Job()
 // limited copy
 // no status information
 GPU_Job::GPU_Job( const GPU_Job& job )
-    : _processing(false), _waitCondition(0)
+    : _processing(false), _waitCondition(0), _priority(Normal),
+      _queueTime(0.0), _execTime(0.0)
 {
      *this=job;
 }
@@ -27,6 +29,7 @@ GPU_Job::GPU_Job( const GPU_Job& job )
 const GPU_Job& GPU_Job::operator=( const GPU_Job& job ) {
     _callbacks = job._callbacks;
     _kernels = job._kernels;
+    _priority = job._priority;
     setStatus( GPU_Job::None );
     return *this;
 }
@@ -44,6 +47,33 @@ void GPU_Job::addKernel( GPU_Kernel* kernel )
     _kernels.append(kernel); 
 }
 
+void GPU_Job::setStatus( const JobStatus& status ) {
+    struct timespec now;
+    switch( status ) {
+        case Queued:
+            clock_gettime( CLOCK_MONOTONIC, &_queued );
+            _queueTime = 0.0;
+            _execTime = 0.0;
+            break;
+        case Running:
+            _queueTime = _since( _queued, now );
+            _started = now;
+            break;
+        case Finished:
+        case Failed:
+            if( _status == Running ) _execTime = _since( _started, now );
+            break;
+        default:
+            break;
+    }
+    _status = status;
+}
+
+double GPU_Job::_since( const struct timespec& start, struct timespec& now ) {
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( now.tv_sec - start.tv_sec ) + ( now.tv_nsec - start.tv_nsec ) * 1.0e-9;
+}
+
 void GPU_Job::reset() {
     _processing = false;
     setStatus( GPU_Job::None );
@@ -1,4 +1,5 @@
 #include "GPU_Kernel.h"
+#include <QString>
 
 
 namespace pelican {
@@ -20,5 +21,10 @@ GPU_Kernel::~GPU_Kernel()
 {
 }
 
+void GPU_Kernel::run( GPU_CPU& )
+{
+    throw QString("GPU_Kernel: no CPU implementation of this kernel");
+}
+
 } // namespace ampp
 } // namespace pelican
@@ -1,21 +1,25 @@
 #include "GPU_Manager.h"
 #include <QMutexLocker>
-#include <QtConcurrentRun>
-#include <boost/bind.hpp>
+#include <QString>
 #include "GPU_Resource.h"
 #include "GPU_Job.h"
-#include "GPU_NVidia.h"
+#include "GPU_Kernel.h"
 #include <iostream>
 
 namespace pelican {
 namespace ampp {
 
 /**
- *@details GPU_Manager 
+ *@details GPU_Manager
  */
-GPU_Manager::GPU_Manager()
+GPU_Manager::GPU_Manager( unsigned int maxQueueDepth )
+    : _nWorkers(0), _maxQueueDepth(maxQueueDepth), _queued(0),
+      _queueDepth(MetricsRegistry::instance().gauge("GPU_Manager.jobsQueued")),
+      _queueTime(MetricsRegistry::instance().histogram("GPU_Manager.queueWait")),
+      _jobTime(MetricsRegistry::instance().histogram("GPU_Manager.job")),
+      _jobsFailed(MetricsRegistry::instance().counter("GPU_Manager.jobsFailed")),
+      _jobsRejected(MetricsRegistry::instance().counter("GPU_Manager.jobsRejected"))
 {
-    _destructor = false;
 }
 
 /**
@@ -23,92 +27,376 @@ GPU_Manager::GPU_Manager()
  */
 GPU_Manager::~GPU_Manager()
 {
-    _destructor = true;
+    // let the running jobs finish, then clean up the resources. No worker
+    // may be deleted until all have stopped, as an idle worker takes jobs
+    // from the queues of the others.
+    for( int i = 0; i < _nWorkers; ++i ) {
+        _workers[i]->stop();
+    }
+    for( int i = 0; i < _nWorkers; ++i ) {
+        _workers[i]->wait();
+    }
     QMutexLocker lock(&_resourceMutex);
-    // clean up the resources
-    foreach(GPU_Resource* r, _resources) {
+    for( int i = 0; i < _nWorkers; ++i ) {
+        GPU_Resource* r = _workers[i]->resource();
+        delete _workers[i];
         delete r;
     }
-    _resources.clear();
-    _freeResource.clear();
-    _queue.clear();
+    _nWorkers = 0;
+    _pending.clear();
 }
 
 void GPU_Manager::addResource(GPU_Resource* r) {
-    QMutexLocker lock(&_resourceMutex);
-    _resources.append(r);
-    _freeResource.append(r);
-    _matchResources();
+    QList<GPU_Job*> pending;
+    {
+        QMutexLocker lock(&_resourceMutex);
+        if( _nWorkers == maxResources )
+            throw QString("GPU_Manager: too many resources (max %1)").arg(maxResources);
+        Worker* worker = new Worker( this, r, _nWorkers, _maxQueueDepth );
+        _workers[_nWorkers] = worker;
+        __sync_synchronize(); // publish the worker before counting it
+        ++_nWorkers;
+        worker->start();
+        pending.swap( _pending );
+    }
+    // jobs submitted before there was anything to run them
+    foreach( GPU_Job* job, pending ) {
+        quint64 resources = _resourcesFor( job );
+        if( resources ) {
+            _enqueue( job, resources );
+        }
+        else {
+            QMutexLocker lock(&_resourceMutex);
+            _pending.append( job ); // wait for a resource that can
+        }
+    }
 }
 
 int GPU_Manager::resources() const {
-    return _resources.size();
+    return _nWorkers;
 }
 
-void GPU_Manager::_matchResources() {
-     // ensure _resourceMutex is locked before calling this 
-     // function
-     if( _queue.size() > 0 ) {
-        if( _freeResource.size() > 0 ) {
-            QtConcurrent::run( this, &GPU_Manager::_runJob, _freeResource.takeFirst(), _queue.takeFirst() );
-        }
+void GPU_Manager::setMaxQueueDepth( unsigned int depth ) {
+    // queues already allocated keep their capacity, and reject jobs
+    // beyond it
+    _maxQueueDepth = depth;
+}
+
+quint64 GPU_Manager::_resourcesFor( GPU_Job* job ) const {
+     quint64 resources = 0;
+     int n = _nWorkers;
+     for( int i = 0; i < n; ++i ) {
+        if( _workers[i]->resource()->canRun( job ) ) resources |= _workers[i]->bit();
      }
+     return resources;
+}
+
+GPU_Manager::Worker* GPU_Manager::_claimIdle( quint64 resources ) const {
+     // in the order the resources were added
+     int n = _nWorkers;
+     for( int i = 0; i < n; ++i ) {
+        if( ( resources & _workers[i]->bit() ) && _workers[i]->claim() )
+            return _workers[i];
+     }
+     return 0;
+}
+
+void GPU_Manager::_enqueue( GPU_Job* job, quint64 resources ) {
+    if( (unsigned int)__sync_fetch_and_add( &_queued, 1 ) >= _maxQueueDepth ) {
+        __sync_fetch_and_sub( &_queued, 1 );
+        _jobsRejected.add();
+        _fail( job, "GPU_Manager: job queue full" );
+        return;
+    }
+    Entry entry = { job, resources };
+    Worker* idle = _claimIdle( resources );
+    Worker* worker = idle;
+    if( ! worker ) {
+        // the least loaded resource that can run it
+        unsigned int least = 0;
+        for( int i = 0; i < _nWorkers; ++i ) {
+            if( ! ( resources & _workers[i]->bit() ) ) continue;
+            unsigned int queued = _workers[i]->queued();
+            if( ! worker || queued < least ) {
+                worker = _workers[i];
+                least = queued;
+            }
+        }
+    }
+    if( ! worker->queue( job->priority() ).push( entry ) ) {
+        __sync_fetch_and_sub( &_queued, 1 );
+        if( idle ) idle->wake(); // to go back to sleep
+        _jobsRejected.add();
+        _fail( job, "GPU_Manager: job queue full" );
+        return;
+    }
+    _queueDepth.set( jobsQueued() );
+    if( idle ) {
+        idle->wake();
+    }
+    else {
+        // A resource may have gone idle after we looked and before the
+        // job was queued; it would not have seen the job, so wake it.
+        __sync_synchronize();
+        idle = _claimIdle( resources );
+        if( idle ) idle->wake();
+    }
+}
+
+bool GPU_Manager::_take( Worker* worker, Entry& entry ) {
+    RunnableBy runnable = { worker->bit() };
+    for( int p = 0; p < GPU_Job::priorities; ++p ) {
+        bool found = worker->queue(p).pop( entry );
+        // or the oldest job this resource can run from any other queue
+        for( int i = 0; ! found && i < _nWorkers; ++i ) {
+            if( _workers[i] != worker )
+                found = _workers[i]->queue(p).popIf( entry, runnable );
+        }
+        if( found ) {
+            __sync_fetch_and_sub( &_queued, 1 );
+            _queueDepth.set( jobsQueued() );
+            return true;
+        }
+    }
+    return false;
 }
 
 void GPU_Manager::_runJob( GPU_Resource* r, GPU_Job* job ) {
+    _start( job );
+    _attempt( r, &GPU_Resource::exec, job );
+    _finish( job );
+}
+
+void GPU_Manager::_start( GPU_Job* job ) {
     job->setStatus( GPU_Job::Running );
+    _queueTime.record( job->queueTime() );
+}
+
+bool GPU_Manager::_attempt( GPU_Resource* r, void (GPU_Resource::*phase)( GPU_Job* ),
+                            GPU_Job* job ) {
     try {
-        r->exec(job);
-        job->setStatus( GPU_Job::Finished );
-    } 
+        (r->*phase)( job );
+        return true;
+    }
     catch( const QString& e ) {
         job->setError( e.toStdString() );
-        job->setStatus( GPU_Job::Failed );
     }
     catch( const std::string& e ) {
         job->setError( e );
-        job->setStatus( GPU_Job::Failed );
     }
     catch( const char* e ) {
         job->setError( std::string(e) );
-        job->setStatus( GPU_Job::Failed );
     }
     catch( ... ) {
         job->setError( "GPU_Manager: caught unknown error whilst running a job" );
-        job->setStatus( GPU_Job::Failed );
     }
+    job->setStatus( GPU_Job::Failed );
+    return false;
+}
+
+void GPU_Manager::_finish( GPU_Job* job ) {
+    if( job->status() == GPU_Job::Failed ) {
+        _jobsFailed.add();
+    }
+    else {
+        job->setStatus( GPU_Job::Finished );
+    }
+    _jobTime.record( job->execTime() );
     job->emitFinished();
-    _resourceFree( r );
     // execute any job callbacks
     foreach( const boost::function0<void>& fn, job->callBacks() ) {
         fn();
     }
 }
 
+void GPU_Manager::_fail( GPU_Job* job, const std::string& error ) {
+    // the job never reaches a resource, so release its kernels' data here
+    foreach( GPU_Kernel* kernel, job->kernels() ) {
+        kernel->cleanUp();
+    }
+    job->setError( error );
+    job->setStatus( GPU_Job::Failed );
+    _jobsFailed.add();
+    job->emitFinished();
+    foreach( const boost::function0<void>& fn, job->callBacks() ) {
+        fn();
+    }
+}
+
 int GPU_Manager::freeResources() const {
-    QMutexLocker lock(&_resourceMutex);
-    return _freeResource.size();
+    int free = 0;
+    int n = _nWorkers;
+    for( int i = 0; i < n; ++i ) {
+        if( _workers[i]->idle() ) ++free;
+    }
+    return free;
 }
 
 int GPU_Manager::jobsQueued() const {
-    QMutexLocker lock(&_resourceMutex);
-    return _queue.size();
+    return __sync_fetch_and_add( const_cast<int*>(&_queued), 0 );
 }
 
 GPU_Job* GPU_Manager::submit( GPU_Job* job) {
     job->setStatus( GPU_Job::Queued );
     job->setAsRunning(); // mark job as being dealt with
-    QMutexLocker lock(&_resourceMutex);
-    _queue.append(job);
-    _matchResources();
+    if( _nWorkers == 0 ) {
+        QMutexLocker lock(&_resourceMutex);
+        if( _nWorkers == 0 ) {
+            // wait for resources to be added
+            _pending.append( job );
+            return job;
+        }
+    }
+    quint64 resources = _resourcesFor( job );
+    if( resources ) {
+        _enqueue( job, resources );
+    }
+    else {
+        // no resource will ever take this job
+        _fail( job, "GPU_Manager: no resource can run this job" );
+    }
     return job;
-} 
+}
 
-void GPU_Manager::_resourceFree( GPU_Resource* res) {
-    if( ! _destructor ) {
-        QMutexLocker lock(&_resourceMutex);
-        _freeResource.append(res);
-        _matchResources();
+// -----------------------------------------------------------------------------
+// GPU_Manager::Worker
+//
+
+GPU_Manager::Worker::Worker( GPU_Manager* manager, GPU_Resource* resource,
+                             int index, unsigned int queueDepth )
+    : QThread(), _manager(manager), _resource(resource), _compute(0),
+      _stageOut(0), _index(index), _idle(1), _halt(false)
+{
+    for( int p = 0; p < GPU_Job::priorities; ++p ) {
+        _queues[p] = new LockFreeQueue<Entry>( queueDepth );
+    }
+    if( resource->phased() ) {
+        _stageOut = new Stage( manager, resource, Stage::StageOut );
+        _compute = new Stage( manager, resource, Stage::Compute, _stageOut );
+        _stageOut->start();
+        _compute->start();
+    }
+}
+
+GPU_Manager::Worker::~Worker()
+{
+    stop();
+    wait();
+    // let the jobs already staged in go through
+    delete _compute;
+    delete _stageOut;
+    for( int p = 0; p < GPU_Job::priorities; ++p ) {
+        delete _queues[p];
+    }
+}
+
+void GPU_Manager::Worker::run()
+{
+    while( ! _halt ) {
+        Entry entry;
+        if( _manager->_take( this, entry ) ) {
+            claim(); // no longer idle, if we were
+            if( _compute ) {
+                // stage in here, whilst the previous job computes
+                _manager->_start( entry.job );
+                if( _manager->_attempt( _resource, &GPU_Resource::stageIn, entry.job ) )
+                    _compute->put( entry.job );
+                else
+                    _manager->_finish( entry.job );
+            }
+            else {
+                _manager->_runJob( _resource, entry.job );
+            }
+        }
+        else if( ! idle() ) {
+            // say we are idle, then look once more before sleeping so
+            // that a job queued meanwhile is not missed
+            __sync_lock_test_and_set( &_idle, 1 );
+            __sync_synchronize();
+        }
+        else {
+            QMutexLocker lock(&_mutex);
+            while( idle() && ! _halt ) _wake.wait(&_mutex);
+        }
+    }
+}
+
+void GPU_Manager::Worker::wake()
+{
+    QMutexLocker lock(&_mutex);
+    _wake.wakeOne();
+}
+
+void GPU_Manager::Worker::stop()
+{
+    QMutexLocker lock(&_mutex);
+    _halt = true;
+    _wake.wakeOne();
+}
+
+unsigned int GPU_Manager::Worker::queued() const
+{
+    unsigned int n = 0;
+    for( int p = 0; p < GPU_Job::priorities; ++p ) {
+        n += _queues[p]->size();
+    }
+    return n;
+}
+
+// -----------------------------------------------------------------------------
+// GPU_Manager::Stage
+//
+
+GPU_Manager::Stage::Stage( GPU_Manager* manager, GPU_Resource* resource,
+                           Phase phase, Stage* next )
+    : QThread(), _manager(manager), _resource(resource), _phase(phase),
+      _next(next), _job(0), _halt(false)
+{
+}
+
+GPU_Manager::Stage::~Stage()
+{
+    {
+        QMutexLocker lock(&_mutex);
+        _halt = true;
+        _changed.wakeAll();
+    }
+    wait();
+}
+
+void GPU_Manager::Stage::put( GPU_Job* job )
+{
+    QMutexLocker lock(&_mutex);
+    while( _job ) _changed.wait(&_mutex);
+    _job = job;
+    _changed.wakeAll();
+}
+
+void GPU_Manager::Stage::run()
+{
+    for(;;) {
+        GPU_Job* job;
+        {
+            QMutexLocker lock(&_mutex);
+            while( ! _job && ! _halt ) _changed.wait(&_mutex);
+            if( ! _job ) return;
+            job = _job;
+        }
+        if( _phase == Compute ) {
+            if( _manager->_attempt( _resource, &GPU_Resource::compute, job ) && _next )
+                _next->put( job );
+            else
+                _manager->_finish( job );
+        }
+        else {
+            _manager->_attempt( _resource, &GPU_Resource::stageOut, job );
+            _manager->_finish( job );
+        }
+        // only now take the next job, so that one job at a time is in
+        // each phase
+        QMutexLocker lock(&_mutex);
+        _job = 0;
+        _changed.wakeAll();
     }
 }
 
@@ -23,7 +23,9 @@ GPU_Resource::~GPU_Resource()
 
 void GPU_Resource::exec( GPU_Job* job )
 {
-    run(job);
+    stageIn(job);
+    compute(job);
+    stageOut(job);
 }
 
 } // namespace ampp
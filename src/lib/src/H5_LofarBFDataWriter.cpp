@@ -22,7 +22,9 @@ namespace ampp {
 // TODO: For now we write in 32-bit format...
 H5_LofarBFDataWriter::H5_LofarBFDataWriter(const ConfigNode& configNode )
   : AbstractOutputStream(configNode), _beamNr(0), _sapNr(0),
-        _nChannels(0), _nSubbands(0), _nPols(0)
+        _nChannels(0), _nSubbands(0), _nPols(0),
+        _writeTimer("H5_LofarBFDataWriter.write"),
+        _sendStreamTimer("H5_LofarBFDataWriter.sendStream")
 {
     _filePath = configNode.getOption("file", "filepath", ".");
     _label = _clean( configNode.getOption("file", "label", "") );
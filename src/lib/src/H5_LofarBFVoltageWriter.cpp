@@ -44,8 +44,8 @@ void H5_LofarBFVoltageWriter::_writeData(const SpectrumDataSetBase* d ) {
     unsigned nSubbands = spec->nSubbands();
     unsigned nChannels = spec->nChannels();
     unsigned nPolarisations = spec->nPolarisations();
+    unsigned stride = spec->channelStride();
     //    float const* data = (const float*)spec->data();
-    const Complex* data = (const Complex*)spec->data();
     const Complex* dataPol;
 
     switch (_nBits) {
@@ -54,17 +54,16 @@ void H5_LofarBFVoltageWriter::_writeData(const SpectrumDataSetBase* d ) {
                  for (unsigned p = 0; p < nPolarisations; ++p ) {
                      int pindex=p*2;
                      for (int s = 0; s < nSubbands; ++s) {
-                         long index = spec->index(s, nSubbands, 
-                                                  p, nPolarisations, t, nChannels );// * 2;
-                         dataPol = &data[index];
+                         dataPol = spec->spectrumData(t, s, p);
                          for(int i = 0; i < nChannels ; ++i) {
                            /*
                              _file[pindex]->write(reinterpret_cast<const char*>(&data[index + i]), sizeof(float));
                              _file[pindex+1]->write(reinterpret_cast<const char*>(&data[index + i + 1]), sizeof(float));
                            */                             
 
-                           _file[pindex]->write(reinterpret_cast<const char*>(&dataPol[i].real()), sizeof(float));
-                           _file[pindex+1]->write(reinterpret_cast<const char*>(&dataPol[i].imag()), sizeof(float));
+                           const float* value = reinterpret_cast<const float*>(&dataPol[i * stride]);
+                           _file[pindex]->write(reinterpret_cast<const char*>(&value[0]), sizeof(float));
+                           _file[pindex+1]->write(reinterpret_cast<const char*>(&value[1]), sizeof(float));
                          }
                      }
                  }
@@ -8,14 +8,19 @@
 #include <QtCore/QObject>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 
 namespace pelican {
 namespace ampp {
 
 // Construct the chunker.
-K7Chunker::K7Chunker(const ConfigNode& config) : AbstractChunker(config)
+K7Chunker::K7Chunker(const ConfigNode& config) : AbstractChunker(config),
+    _receiver(config.getOption("socket", "batch", "64").toUInt()),
+    _capture(config),
+    _metrics(QString("K7Chunker.") + QString::number(port()))
 {
     // Check the configuration type matches the class name.
     if (config.type() != "K7Chunker")
@@ -59,20 +64,60 @@ K7Chunker::K7Chunker(const ConfigNode& config) : AbstractChunker(config)
     std::cout << "K7Chunker::K7Chunker(): _byte1OfStream " << _byte1OfStream << std::endl;
 
     // Initialise class variables.
-    _startTimestamp = 0;
-    _startAccumulation = 0;
+    _synchronised = false;
+    _rate = 0;
+    _sequence = 0;
+    _timestamp = 0;
+    _accumulation = 0;
     _packetsAccepted = 0;
     _packetsRejected = 0;
+    _packetsLost = 0;
 
-    // Set the empty packet data for stream.
-    memset((void*)_emptyPacket.data, 0, _bytesStream);
-    _emptyPacket.header.UTCtimestamp = 0;
-    _emptyPacket.header.accumulationNumber = 0;
-    _emptyPacket.header.accumulationRate = 0;
+    // Kernel receive buffer for the socket (bytes).
+    _receiveBufferSize = config.getOption("socket", "receiveBuffer", "67108864").toUInt();
+
+    // Describe the incoming packet to the batch receiver so that the header
+    // and the selected channel range are received straight into the chunk.
+    describePacket(_receiver);
+    _lengths.resize(std::max(_nPackets, _receiver.maxBatch()));
+    _staging.resize(_receiver.maxBatch() * _packetSizeStream);
+    std::cout << "K7Chunker::K7Chunker(): receiving up to " << _receiver.maxBatch() << " packets per call"
+              << (UdpBatchReceiver::batched() ? " (recvmmsg)" : "") << std::endl;
+
+    // Packets are placed into their slot in the chunk by sequence number.
+    // A chunk is closed once a packet this many packets past its end has
+    // arrived; packets for the next chunk received meanwhile are kept aside.
+    unsigned int window = config.getOption("reorder", "window", "64").toUInt();
+    _window = new PacketReorderWindow(_nPackets, _packetSizeStream, window, window + _receiver.maxBatch());
+    std::cout << "K7Chunker::K7Chunker(): reorder window " << window << " packets" << std::endl;
 
     // Set the chunk processed counter.
     _chunksProcessed = 0;
     _chunkerCounter = 0;
+
+    // Chunks can be handed to a pipeline on the same host through shared
+    // memory instead of the server. The chunker waits up to timeout ms for
+    // the pipeline to free a slot before dropping a chunk.
+    _chunk = 0;
+    _shm = 0;
+    _shmTimeout = 0;
+    _shmStalled = false;
+    _shmDiscarded = 0;
+    QString shmName = config.getOption("shm", "name");
+    if (!shmName.isEmpty())
+    {
+        unsigned int slots = config.getOption("shm", "slots", "8").toUInt();
+        _shmTimeout = config.getOption("shm", "timeout", "1000").toInt();
+        _shm = new SharedChunkRing(shmName, slots, _nPackets * _packetSizeStream);
+        std::cout << "K7Chunker::K7Chunker(): publishing chunks to shared memory " << shmName.toStdString()
+                  << " (" << slots << " slots)" << std::endl;
+    }
+}
+
+K7Chunker::~K7Chunker()
+{
+    delete _shm;
+    delete _window;
 }
 
 // Constructs a new QIODevice (in this case a QUdpSocket) and returns it
@@ -80,191 +125,287 @@ K7Chunker::K7Chunker(const ConfigNode& config) : AbstractChunker(config)
 // the constructor of the abstract chunker.
 QIODevice* K7Chunker::newDevice()
 {
+    // With packet capture enabled a dedicated thread receives the packets into
+    // a ring which next() consumes.
+    if (_capture.enabled())
+    {
+        PacketCaptureDevice* capture = new PacketCaptureDevice(_capture, _packetSize);
+        describePacket(capture->receiver());
+        if (!capture->bind(QString(), port()))
+        {
+            std::cerr << "K7Chunker::newDevice(): " << capture->bindError().toStdString() << std::endl;
+        }
+        return capture;
+    }
+
     QUdpSocket* udpSocket = new QUdpSocket;
 
     if (!udpSocket->bind(port(), QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint ))
     {
         std::cerr << "K7Chunker::newDevice(): Unable to bind to UDP port!" << udpSocket->errorString().toStdString() << std::endl;
     }
+    else
+    {
+        int granted = UdpBatchReceiver::setReceiveBufferSize(udpSocket->socketDescriptor(), _receiveBufferSize);
+        std::cout << "K7Chunker::newDevice(): socket receive buffer " << granted << " bytes" << std::endl;
+    }
 
     return udpSocket;
 }
 
 // Gets the next chunk of data from the UDP socket (if it exists).
+//
+// Packets are received in batches directly into the chunk memory, one slot of
+// _packetSizeStream bytes per packet, with only the selected channel range
+// kept. Each packet belongs to the slot given by its (UTCtimestamp,
+// accumulationNumber): packets already in their slot are kept where they are,
+// the others (reordered, early or after a gap) are copied into place by the
+// reorder window, and duplicates and packets for chunks already sent are
+// dropped. Slots still empty when the chunk is closed are zero-filled.
 void K7Chunker::next(QIODevice* device)
 {
-    unsigned int i;
-    unsigned int lostPackets, difference;
-    unsigned int offsetStream;
-    unsigned int lostPacketCounter;
-    unsigned long int previousTimestamp;
-    unsigned int previousAccumulation;
-    unsigned long int timestamp;
-    unsigned int accumulation;
-    unsigned int rate;
-    QUdpSocket* udpSocket = static_cast<QUdpSocket*>(device);
-    K7Packet currentPacket;
-    K7Packet outputPacket;
-    K7Packet _emptyPacket;
-
-    difference = 0;
-    offsetStream = 0;
-    timestamp = 0;
-    accumulation = 0;
-    rate = 0;
-    previousTimestamp = _startTimestamp;
-    previousAccumulation = _startAccumulation;
-
-    // Get writable buffer space for the chunk.
-    WritableData writableData;
-    if ( ! _writable.isValid() )
-    {
-        writableData = getDataStorage(_nPackets * _packetSizeStream, chunkTypes().at(0));
-    }
-    else
+    PacketCaptureDevice* capture = dynamic_cast<PacketCaptureDevice*>(device);
+    int socketDescriptor = capture ? -1 : static_cast<QUdpSocket*>(device)->socketDescriptor();
+
+    // Re-arm the capture notification.
+    if (capture)
+        capture->acknowledge();
+
+    // Get buffer space for the chunk, from the server or from the shared
+    // memory ring. An unfinished chunk is resumed.
+    char* chunk = _chunk;
+    if (!chunk)
     {
-        writableData = _writable;
+        if (_shm)
+        {
+            // Once the pipeline has not kept up, do not wait again until it
+            // has freed a slot.
+            chunk = _shm->acquire(_shmStalled ? 0 : _shmTimeout);
+            _shmStalled = (chunk == 0);
+        }
+        else
+        {
+            _writable = getDataStorage(_nPackets * _packetSizeStream, chunkTypes().at(0));
+            if (_writable.isValid())
+                chunk = static_cast<char*>(_writable.ptr());
+        }
+        if (chunk)
+            _window->start(chunk);
     }
 
-    if (writableData.isValid())
+    if (chunk)
     {
-        // Loop over the number of UDP packets to put in a chunk.
-        for (i = 0; i < _nPackets; ++i)
+        _chunk = chunk;
+        unsigned long int duplicates = _window->duplicates();
+        unsigned long int late = _window->late();
+
+        while (!_window->complete())
         {
             // Chunker sanity check.
             if (!isActive())
                 return;
 
-            // Wait for datagram to be available.
-            while ( !udpSocket->hasPendingDatagrams() )
-            {
-                _writable = writableData;
-                continue;
-            }
-
-            // Read the current UDP packet from the socket.
-            if (udpSocket->readDatagram(reinterpret_cast<char*>(&currentPacket), _packetSize) <= 0)
-            {
-                std::cerr << "K7Chunker::next(): Error while receiving UDP Packet!" << std::endl;
-                i--;
-                continue;
-            }
-
-            // Get the UDP packet header.
-            timestamp    = currentPacket.header.UTCtimestamp;
-            accumulation = currentPacket.header.accumulationNumber;
-            rate         = currentPacket.header.accumulationRate;
-            //std::cout << "K7Chunker::next(): timestamp " << timestamp << " accumulation " << accumulation << " rate " << rate << std::endl;
-            // First time next() has been run, initialise _startTimestamp and _startAccumulation.
-            if (i == 0 && _startTimestamp == 0)
-            {
-                previousTimestamp = _startTimestamp = _startTimestamp == 0 ? timestamp : _startTimestamp;
-                previousAccumulation = _startAccumulation = _startAccumulation == 0 ? accumulation : _startAccumulation;
-                //std::cout << "K7Chunker::next(): timestamp " << timestamp << " accumulation " << accumulation << " rate " << rate << std::endl;
-            }
-
-            // Sanity check in UTCtimestamp. If the seconds counter is 0xFFFFFFFFFFFFFFFF, the data cannot be trusted (ignore).
-            if (timestamp == ~0UL || previousTimestamp + 10 < timestamp)
-            {
-                std::cerr << "K7Chunker::next(): Data cannot be trusted! Timestamp is " << timestamp << " or previousTimestamp is " << previousTimestamp << std::endl;
-                exit(-1);
-            }
-
-            // Check that the packets are contiguous. accumulationNumber increments by
-            // accumulationRate which is defined in the header of UDP packet.
-            // accumulationNumber is reset every interval (although it might not start from 0
-            // as the previous frame might contain data from this one).
-            lostPackets = 0;
-            difference = (accumulation >= previousAccumulation) ? (accumulation - previousAccumulation) : (accumulation + _packetsPerSecond - previousAccumulation);
-#if 0
-            // Duplicated packets. Need to address this. ICBF does not duplicate packets though.
-            if (difference < rate)
+            // Receive a batch of UDP packets where the next packets are
+            // expected in the chunk or, if there is no room there, into the
+            // staging buffer, from the socket or from the capture ring.
+            unsigned int count;
+            unsigned int slot = _window->freeRun(count);
+            bool inPlace = count > 0;
+            char* dest = inPlace ? chunk + slot * _packetSizeStream : &_staging[0];
+            unsigned int maxPackets = inPlace ? std::min(count, _receiver.maxBatch()) : _receiver.maxBatch();
+            int nReceived;
+            if (capture)
             {
-                std::cout << "Duplicated packets, difference " << difference << std::endl;
-                ++_packetsRejected;
-                i -= 1;
-                continue;
+                nReceived = capture->readDatagrams(dest, maxPackets, &_lengths[0], 100);
             }
             else
-#endif
-            // Missing packets.
-            if (difference > rate)
             {
-                // -1 since it includes the received packet as well.
-                lostPackets = (difference / rate) - 1;
+                nReceived = _receiver.receive(socketDescriptor, dest, maxPackets, 100);
+                for (int k = 0; k < nReceived; ++k)
+                    _lengths[k] = _receiver.length(k);
             }
-
-            if (lostPackets > 0)
+            if (nReceived < 0)
             {
-                printf("K7Chunker::next(): generate %u empty packets, previousTimestamp: %lu, new timestamp: %lu, prevAccumulation: %u, newAccumulation: %u\n",
-                        lostPackets, previousTimestamp, timestamp, previousAccumulation, accumulation);
+                std::cerr << "K7Chunker::next(): Error while receiving UDP Packet!" << std::endl;
+                continue;
             }
 
-            // Generate lostPackets (empty packets) if needed.
-            lostPacketCounter = 0;
-            for (lostPacketCounter = 0; lostPacketCounter < lostPackets && i + lostPacketCounter < _nPackets; ++lostPacketCounter)
+            for (int k = 0; k < nReceived; ++k)
             {
-                // Generate empty packet with correct timestamp and accumulation number.
-                previousTimestamp = (previousAccumulation < _packetsPerSecond) ? previousTimestamp : previousTimestamp + 1;
-                previousAccumulation = previousAccumulation % _packetsPerSecond;
-                updateEmptyPacket(_emptyPacket, previousTimestamp, previousAccumulation, rate);
-                offsetStream = writePacket(&writableData, _emptyPacket, _packetSizeStream, offsetStream);
+                char* packet = dest + k * _packetSizeStream;
+                if (inPlace && !acceptPacket(packet, _lengths[k], slot + k, true))
+                {
+                    // This packet is not the one expected in its slot: move it
+                    // and the rest of the batch out of the way of the packets
+                    // being placed.
+                    memcpy(&_staging[0], packet, (nReceived - k) * _packetSizeStream);
+                    memmove(&_lengths[0], &_lengths[k], (nReceived - k) * sizeof(unsigned));
+                    nReceived -= k;
+                    k = 0;
+                    dest = &_staging[0];
+                    packet = dest;
+                    inPlace = false;
+                }
+                if (!inPlace)
+                    acceptPacket(packet, _lengths[k], 0, false);
             }
-            i += lostPacketCounter;
+        }
 
-            // Write received packet to stream after updating header and data.
-            if (i != _nPackets)
-            {
-                ++_packetsAccepted;
-                // Generate stream packet.
-                outputPacket.header = currentPacket.header;
-                memcpy((void*)outputPacket.data, &currentPacket.data[_byte1OfStream], _bytesStream);
-                offsetStream = writePacket(&writableData, outputPacket, _packetSizeStream, offsetStream);
-                previousTimestamp = timestamp;
-                previousAccumulation = accumulation;
-            }
+        unsigned int lost = fillGaps(chunk);
+        duplicates = _window->duplicates() - duplicates;
+        late = _window->late() - late;
+        _metrics.packetsLost.add(lost);
+        _metrics.packetsDuplicated.add(duplicates);
+        _metrics.packetsLate.add(late);
+        _metrics.chunks.add();
+        if (lost > 0 || duplicates > 0 || late > 0)
+        {
+            printf("K7Chunker::next(): chunk %lu: %u empty packets, %lu duplicated, %lu late\n",
+                    _chunksProcessed, lost, duplicates, late);
         }
+
         _chunksProcessed++;
         _chunkerCounter++;
-        // Clear any data locks.
+        // Hand the chunk over: publish it to the shared memory client or
+        // clear the data locks so the server can send it.
+        if (_shm)
+            _shm->publish(_nPackets * _packetSizeStream);
         _writable = WritableData();
+        _chunk = 0;
         if (_chunkerCounter % 100 == 0)
         {
-            std::cout << "K7Chunker::next(): " << _chunksProcessed << " chunks processed. " << "UTC timestamp " << timestamp << " accumulationNumber " << accumulation << " accumulationRate " << rate << std::endl;
+            std::cout << "K7Chunker::next(): " << _chunksProcessed << " chunks processed. " << "UTC timestamp " << _timestamp << " accumulationNumber " << _accumulation << " accumulationRate " << _rate
+                      << " (" << _packetsLost << " packets lost, " << _window->duplicates() << " duplicated, "
+                      << _window->late() << " late, " << _packetsRejected << " rejected)" << std::endl;
         }
     }
     else
     {
         // Must discard the datagram if there is no available space.
         if (!isActive()) return;
-        udpSocket->readDatagram(0, 0);
+        PacketCaptureDevice::discardDatagram(device);
+        _metrics.packetsDiscarded.add();
+        // Show a chunk's worth of discarded packets to the shared memory
+        // client as a gap in the chunk sequence numbers.
+        if (_shm && ++_shmDiscarded % _nPackets == 0)
+            _shm->skip();
         std::cout << "K7Chunker::next(): Writable data not valid, discarding packets." << std::endl;
     }
-
-    // Update _startTime.
-    _startTimestamp = previousTimestamp;
-    _startAccumulation = previousAccumulation;
 }
 
-// Generates an empty UDP packet with no time stamp.
-void K7Chunker::updateEmptyPacket(K7Packet& packet, unsigned long int timestamp, unsigned int accumulation, unsigned int rate)
+// Checks a received stream packet and hands it to the reorder window, which
+// accepts it in place if it is already in its own slot of the chunk or
+// otherwise copies it where it belongs. Returns false only for a packet
+// received in place that must be moved out of its slot.
+bool K7Chunker::acceptPacket(char* packet, unsigned int length, unsigned int slot, bool inPlace)
 {
-    packet.header.UTCtimestamp = timestamp;
-    packet.header.accumulationNumber = accumulation;
-    packet.header.accumulationRate = rate;
+    if (length != _packetSize)
+    {
+        std::cerr << "K7Chunker::next(): Error while receiving UDP Packet!" << std::endl;
+        ++_packetsRejected;
+        _metrics.packetsRejected.add();
+        return true;
+    }
+
+    // Get the UDP packet header.
+    K7Packet::Header header;
+    memcpy(&header, packet, _headerSize);
+
+    // Sanity check in UTCtimestamp. If the seconds counter is 0xFFFFFFFFFFFFFFFF, the data cannot be trusted (ignore).
+    if ((unsigned long int)header.UTCtimestamp == ~0UL || header.accumulationRate == 0)
+    {
+        ++_packetsRejected;
+        _metrics.packetsRejected.add();
+        return true;
+    }
+
+    // accumulationNumber increments by accumulationRate and is reset every
+    // second (although it might not start from 0 as the previous frame might
+    // contain data from this one), so count packets from the start of the epoch.
+    quint64 sequence = ((quint64)header.UTCtimestamp * _packetsPerSecond + header.accumulationNumber) / header.accumulationRate;
+
+    // Start counting at the first packet received, and again whenever the
+    // rate changes or the stream jumps by more than 10 s.
+    quint64 tenSeconds = 10 * _packetsPerSecond / header.accumulationRate;
+    if (!_synchronised || header.accumulationRate != _rate
+            || sequence + tenSeconds < _sequence || sequence > _sequence + tenSeconds)
+    {
+        if (_synchronised)
+        {
+            std::cerr << "K7Chunker::next(): Resynchronising on timestamp " << header.UTCtimestamp
+                      << " accumulationNumber " << header.accumulationNumber
+                      << " accumulationRate " << header.accumulationRate
+                      << " (previous timestamp " << _timestamp << ")" << std::endl;
+        }
+        // The stream need not start on a multiple of the rate, so keep the
+        // sample of this packet to number the empty packets from.
+        _window->resync(sequence, (quint64)header.UTCtimestamp * _packetsPerSecond + header.accumulationNumber,
+                        header.accumulationRate);
+        _synchronised = true;
+        _rate = header.accumulationRate;
+        _sequence = sequence;
+    }
+
+    if (inPlace)
+    {
+        if (!_window->claim(sequence, slot))
+            return false;
+    }
+    else
+    {
+        PacketReorderWindow::Status status = _window->place(sequence, packet);
+        if (status != PacketReorderWindow::Placed && status != PacketReorderWindow::Carried)
+            return true;
+    }
+
+    ++_packetsAccepted;
+    _metrics.packetsAccepted.add();
+    if (sequence > _sequence)
+    {
+        _sequence = sequence;
+        _timestamp = header.UTCtimestamp;
+        _accumulation = header.accumulationNumber;
+    }
+    return true;
 }
 
-// Write packet to WritableData object.
-int K7Chunker::writePacket(WritableData *writer, K7Packet& packet, unsigned int packetSize, unsigned int offset)
+// Zero-fills the slots of the chunk that are still empty, giving each empty
+// packet the header it should have had. Returns the number of empty packets.
+unsigned int K7Chunker::fillGaps(char* chunk)
 {
-    if (writer->isValid()) {
-        writer->write(reinterpret_cast<void*>(&packet), packetSize, offset);
-        return offset + packetSize;
-    }
-    else {
-        throw _err("writePacket(): WritableData is not valid!");
-        return -1;
+    unsigned int lost = 0;
+    for (unsigned int i = 0; i < _nPackets; ++i)
+    {
+        if (_window->filled(i))
+            continue;
+        quint64 sample = _window->position(i);
+        writeEmptyPacket(chunk + i * _packetSizeStream, sample / _packetsPerSecond, sample % _packetsPerSecond, _rate);
+        ++lost;
     }
+    _packetsLost += lost;
+    return lost;
+}
+
+// Describes the incoming packet to a batch receiver so that only the header
+// and the selected channel range are kept.
+void K7Chunker::describePacket(UdpBatchReceiver& receiver)
+{
+    receiver.clearSegments();
+    receiver.addSegment(_headerSize, true);
+    receiver.addSegment(_byte1OfStream, false);
+    receiver.addSegment(_bytesStream, true);
+    receiver.addSegment(_packetSize - _headerSize - _byte1OfStream - _bytesStream, false);
+}
+
+// Writes an empty stream packet (header and zeroed data) into a chunk slot.
+void K7Chunker::writeEmptyPacket(char* slot, unsigned long int timestamp, unsigned int accumulation, unsigned int rate)
+{
+    K7Packet::Header header;
+    header.UTCtimestamp = timestamp;
+    header.accumulationNumber = accumulation;
+    header.accumulationRate = rate;
+    memcpy(slot, &header, _headerSize);
+    memset(slot + _headerSize, 0, _bytesStream);
 }
 
 } // namespace ampp
@@ -1,5 +1,7 @@
 #include "K7DataAdapter.h"
 #include "SpectrumDataSet.h"
+#include "Metrics.h"
+#include "StreamChunk.h"
 #include "pelican/utility/ConfigNode.h"
 #include <iomanip>
 #include <cmath>
@@ -35,17 +37,28 @@ K7DataAdapter::K7DataAdapter(const ConfigNode& config) : AbstractStreamAdapter(c
     // Setting timestamp for first iteration of the pipeline.
     _lastTimestamp = 0.0;
 
-    // Total intensity will be used only.
-    _nPolarisations = 1;
-
-    // Temporary arrays for buffering data from the IO Device.
-    _headerBuffer.resize(_headerSize);
-    _dataBuffer.resize(_payloadSize);
+    // Either total intensity (XX* + YY*) or the four correlation products
+    // XX*, YY*, Re(XY*) and Im(XY*) as separate polarisations.
+    QString products = config.getOption("products", "value", "power").toLower();
+    if (products == "power")
+        _nPolarisations = 1;
+    else if (products == "full")
+        _nPolarisations = 4;
+    else
+        throw _err("K7DataAdapter(): Unknown products \"" + products + "\" (expected power or full).");
+    std::cout << "K7DataAdapter::K7DataAdapter(): _nPolarisations " << _nPolarisations << std::endl;
+
+    _decodePower = ChannelKernels::select<K7PowerKernel>(_nChannels);
+    _decodeProducts = ChannelKernels::select<K7ProductsKernel>(_nChannels);
 }
 
 // De-serialise a chunk of data from the input device.
 void K7DataAdapter::deserialise(QIODevice* in)
 {
+    static MetricHistogram& deserialiseTime = MetricsRegistry::instance().histogram("K7DataAdapter.deserialise");
+    static MetricCounter& outOfSequence = MetricsRegistry::instance().counter("K7DataAdapter.outOfSequence");
+    MetricTimer timer(deserialiseTime);
+
     // Sanity check on data blob dimensions and chunk size.
     // Check that there is something to adapt to.
     if (_chunkSize == 0)
@@ -62,115 +75,66 @@ void K7DataAdapter::deserialise(QIODevice* in)
     // UDP packet header definition.
     K7Packet::Header header;
 
-    // Declare variables;
-    unsigned int i, j, k;
-    unsigned int nPacketsPerChunk = 0; // Number of UDP packets in chunk/blob.
-    unsigned int block = 0;
-    unsigned int bytesRead = 0;
-    int temporaryBytesRead = 0;
-    double currentTimestamp = 0.0;
-    float *data = NULL;
-
-    // Pointers to temporary arrays for data buffering;
-    char* headerBuffer = &_headerBuffer[0];
-    char* dataBuffer = &_dataBuffer[0];
-
-    i = 0;
-    j = 0;
-
     // A pointer to the data blob to fill should be obtained by calling the
     // dataBlob() inherited method. This returns a pointer to an
     // abstract dataBlob, which should be cast to the appropriate type.
     SpectrumDataSetStokes* blob = (SpectrumDataSetStokes*) dataBlob();
 
     // Set the size of the data blob to fill. The chunk size is obtained by calling the chunkSize() inherited method.
-    nPacketsPerChunk = chunkSize() / _packetSize;
-    //std::cout << "K7DataAdapter::deserialise(): nPacketsPerChunk " << nPacketsPerChunk << std::endl;
+    int nPacketsPerChunk = chunkSize() / _packetSize;
 
     // Resize the blob of data.
     blob->resize(nPacketsPerChunk, 1, _nPolarisations, _nChannels); // Where 1 is number of subbands (LOFAR-wise).
+    if (nPacketsPerChunk == 0) return;
 
-    // Loop over the UDP packets in the chunk.
-    for (i = 0; i < nPacketsPerChunk; i++)
-    {
-        // Read the header from the IO device.
-        bytesRead = 0;
-        while (1)
-        {
-            temporaryBytesRead = in->read(headerBuffer + bytesRead, _headerSize - bytesRead);
-            //std::cout << "K7DataAdapter::deserialise(): temporaryBytesRead " << temporaryBytesRead << std::endl;
-            if (temporaryBytesRead <= 0) in->waitForReadyRead(-1);
-            else bytesRead += temporaryBytesRead;
-            if (bytesRead == _headerSize) break;
-        }
+    // Decode in place from the chunk where possible.
+    const char* chunk = StreamChunk::map(in, nPacketsPerChunk * _packetSize, _chunkBuffer);
 
-        // Read the packet header from the input device.
-        _readHeader(headerBuffer, header);
+    // The first packet in the chunk sets the timestamp and sampling rate.
+    _readHeader(chunk, header);
 
-        // First packet in the chunk.
-        if (i == 0)
-        {
-            // Set the sampling time for precise timestamp calculation.
-            _samplingTime = 1.0 * header.accumulationRate / _packetsPerSecond;
-            //std::cout << "K7DataAdapter::deserialise(): _samplingTime " << std::fixed << std::setprecision(8) << _samplingTime << std::endl;
-
-            // Get the timestamp from UDP packet header.
-            //std::cout << "K7DataAdapter::deserialise(): header.UTCtimestamp " << std::fixed << std::setprecision(10) << header.UTCtimestamp << std::endl;
-            //std::cout << "K7DataAdapter::deserialise(): header.accumulationNumber " << std::fixed << std::setprecision(10) << header.accumulationNumber << std::endl;
-            //std::cout << "K7DataAdapter::deserialise(): header.accumulationRate " << std::fixed << std::setprecision(10) << header.accumulationRate << std::endl;
-
-            // Calculate timestamp of first packet in the chunk.
-            currentTimestamp = 1.0 * header.UTCtimestamp + (1.0 * header.accumulationNumber / _packetsPerSecond);
-            //std::cout << "K7DataAdapter::deserialise(): currentTimestamp " << std::fixed << std::setprecision(10) << currentTimestamp << std::endl;
-
-            _expectedLastTimestamp = currentTimestamp + ((nPacketsPerChunk + 1) * _samplingTime);
-            //std::cout << "K7DataAdapter::deserialise(): _expectedLastTimestamp " << std::fixed << std::setprecision(10) << _expectedLastTimestamp << std::endl;
-
-            // Check if the data is out of sync. During first iteration it will always complain.
-            if (currentTimestamp - _lastTimestamp > _samplingTime)
-            {
-                std::cout << "K7DataAdapter::deserialise(): data out of sequence -- " << std::fixed << std::setprecision(10) << currentTimestamp - _lastTimestamp << std::endl;
-            }
-            _lastTimestamp = currentTimestamp + ((nPacketsPerChunk + 1) * _samplingTime);
-            //std::cout << "K7DataAdapter::deserialise(): _lastTimestamp " << std::fixed << std::setprecision(10) << _lastTimestamp << std::endl;
-            //std::cout << "K7DataAdapter::deserialise(): difference " << std::fixed << std::setprecision(10) << (_lastTimestamp-currentTimestamp)/_samplingTime << std::endl;
-            //std::cout << "K7DataAdapter::deserialise(): expected difference " << std::fixed << std::setprecision(10) << (_expectedLastTimestamp-currentTimestamp)/_samplingTime << std::endl;
-
-            // Set the timestamp and sampling rate in the blob.
-            blob->setLofarTimestamp(currentTimestamp);
-            blob->setBlockRate(_samplingTime);
-        }
+    // Set the sampling time for precise timestamp calculation.
+    _samplingTime = 1.0 * header.accumulationRate / _packetsPerSecond;
 
-        // Read the useful data.
-        bytesRead = 0;
-        while (1)
-        {
-            temporaryBytesRead = in->read(dataBuffer + bytesRead, _payloadSize - bytesRead);
-            if (temporaryBytesRead <= 0) in->waitForReadyRead(-1);
-            else bytesRead += temporaryBytesRead;
-            if (bytesRead == _payloadSize) break;
-        }
+    // Calculate timestamp of first packet in the chunk.
+    double currentTimestamp = 1.0 * header.UTCtimestamp + (1.0 * header.accumulationNumber / _packetsPerSecond);
+    _expectedLastTimestamp = currentTimestamp + ((nPacketsPerChunk + 1) * _samplingTime);
 
-        // Read the packet payload from the input device.
-        //in->read(dataBuffer, _payloadSize);
+    // Check if the data is out of sync. During first iteration it will always complain.
+    if (currentTimestamp - _lastTimestamp > _samplingTime)
+    {
+        std::cout << "K7DataAdapter::deserialise(): data out of sequence -- " << std::fixed << std::setprecision(10) << currentTimestamp - _lastTimestamp << std::endl;
+        outOfSequence.add();
+    }
+    _lastTimestamp = currentTimestamp + ((nPacketsPerChunk + 1) * _samplingTime);
 
-        // Write out spectrum to blob.
-        unsigned short int* dd = (unsigned short int*) dataBuffer;
-        // Assign data (pointer) to a pointer to the spectrum data for the specified time block, sub-band and polarisation.
-        data = (float*) blob->spectrumData(i, 0, 0);
-        for (j = 0; j <= _nChannels; j++)
+    // Set the timestamp and sampling rate in the blob.
+    blob->setLofarTimestamp(currentTimestamp);
+    blob->setBlockRate(_samplingTime);
+
+    // Decode the spectra straight from the chunk, one packet per time block.
+    const unsigned nChannels = _nChannels;
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < nPacketsPerChunk; i++)
+    {
+        const unsigned short* dd = reinterpret_cast<const unsigned short*>(
+                chunk + (size_t)i * _packetSize + _headerSize);
+        if (_nPolarisations == 1)
+        {
+            _decodePower(dd, blob->spectrumData(i, 0, 0), nChannels); // XX* + YY*
+        }
+        else
         {
-            data[j] = (float) (dd[j * 4] + dd[(j * 4) + 1]); // XX* + YY*
-//            data[j] = (float) (dd[j * 4]); // XX*
-//            data[j] = (float) (dd[(j * 4) + 1]); // YY*
+            _decodeProducts(dd, blob->spectrumData(i, 0, 0), blob->spectrumData(i, 0, 1),
+                            blob->spectrumData(i, 0, 2), blob->spectrumData(i, 0, 3), nChannels);
         }
     }
 }
 
 // Reads the UDP packet header from the IO device.
-void K7DataAdapter::_readHeader(char* buffer, K7Packet::Header& header)
+void K7DataAdapter::_readHeader(const char* buffer, K7Packet::Header& header)
 {
-    header = *reinterpret_cast<K7Packet::Header*>(buffer);
+    header = *reinterpret_cast<const K7Packet::Header*>(buffer);
     //_printHeader(header);
 }
 
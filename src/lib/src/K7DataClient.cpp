@@ -1,14 +1,95 @@
 #include "K7DataClient.h"
 #include "K7Chunker.h"
+#include "SharedChunkRing.h"
+#include "pelican/core/AbstractStreamAdapter.h"
+#include "pelican/data/DataSpec.h"
+#include <QtCore/QBuffer>
+#include <QtCore/QByteArray>
+#include <iostream>
+#include <unistd.h>
 
 using namespace pelican;
 using namespace pelican::ampp;
 
-K7DataClient::K7DataClient(const ConfigNode& configNode, const DataTypes& types, const Config* config) : PelicanServerClient(configNode, types, config)
+K7DataClient::K7DataClient(const ConfigNode& configNode, const DataTypes& types, const Config* config) : PelicanServerClient(configNode, types, config),
+    _shm(0), _hasSequence(false), _sequence(0), _chunksLost(0)
 {
+    _shmName = configNode.getOption("shm", "name");
 }
 
 K7DataClient::~K7DataClient()
 {
+    delete _shm;
 }
 
+AbstractDataClient::DataBlobHash K7DataClient::getData(DataBlobHash& dataHash)
+{
+    if (_shmName.isEmpty())
+        return PelicanServerClient::getData(dataHash);
+    return _getSharedData(dataHash);
+}
+
+// Waits for the next chunk in the ring and has the stream adapter read it
+// straight from shared memory. The slot is released once the blob is filled.
+AbstractDataClient::DataBlobHash K7DataClient::_getSharedData(DataBlobHash& dataHash)
+{
+    size_t bytes;
+    quint64 sequence;
+    const char* chunk = 0;
+    while (!chunk)
+    {
+        // Attach once the server has created the ring.
+        while (!_shm)
+        {
+            try
+            {
+                _shm = new SharedChunkRing(_shmName);
+            }
+            catch (const QString&)
+            {
+                std::cout << "K7DataClient::getData(): waiting for shared memory " << _shmName.toStdString() << std::endl;
+                sleep(1);
+            }
+        }
+
+        // Attach again if the server has gone or has been restarted with a
+        // new ring; its sequence numbers start again.
+        chunk = _shm->next(bytes, sequence, 1000);
+        if (!chunk && _shm->stale())
+        {
+            std::cout << "K7DataClient::getData(): shared memory " << _shmName.toStdString()
+                      << " has been closed, attaching again" << std::endl;
+            delete _shm;
+            _shm = 0;
+            _hasSequence = false;
+        }
+    }
+    if (_hasSequence && sequence != _sequence + 1)
+    {
+        _chunksLost += sequence - _sequence - 1;
+        std::cerr << "K7DataClient::getData(): " << sequence - _sequence - 1 << " chunks lost ("
+                  << _chunksLost << " in total)" << std::endl;
+    }
+    _hasSequence = true;
+    _sequence = sequence;
+
+    DataBlobHash validHash;
+    foreach (const DataSpec& req, dataRequirements())
+    {
+        foreach (const QString& type, req.streamData())
+        {
+            if (!dataHash.contains(type))
+                throw QString("K7DataClient::getData(): called without DataBlob %1").arg(type);
+            // The adapter maps the QBuffer memory rather than copying it.
+            QByteArray data = QByteArray::fromRawData(chunk, bytes);
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::ReadOnly);
+            AbstractStreamAdapter* adapter = streamAdapter(type);
+            adapter->config(dataHash[type], bytes, QHash<QString, DataBlob*>());
+            adapter->deserialise(&buffer);
+            validHash.insert(type, dataHash.value(type));
+        }
+    }
+    _shm->release();
+    return validHash;
+}
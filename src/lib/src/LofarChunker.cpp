@@ -19,7 +19,9 @@ namespace ampp {
  *
  * TODO: this assumes variable packet size. make this a configuration option.
  */
-LofarChunker::LofarChunker(const ConfigNode& config) : AbstractChunker(config)
+LofarChunker::LofarChunker(const ConfigNode& config) : AbstractChunker(config),
+    _capture(config),
+    _metrics(QString("LofarChunker.") + QString::number(port()))
 {
     if (config.type() != "LofarChunker")
         throw QString("LofarChunker::LofarChunker(): Invalid configuration");
@@ -68,6 +70,16 @@ LofarChunker::LofarChunker(const ConfigNode& config) : AbstractChunker(config)
  */
 QIODevice* LofarChunker::newDevice()
 {
+    // With packet capture enabled a dedicated thread receives the packets
+    // into a ring which next() consumes.
+    if (_capture.enabled()) {
+        PacketCaptureDevice* capture = new PacketCaptureDevice(_capture, _packetSize);
+        if (!capture->bind(QString(), port()))
+            cerr << "LofarChunker::newDevice(): "
+                 << capture->bindError().toStdString() << endl;
+        return capture;
+    }
+
     QUdpSocket* socket = new QUdpSocket;
 
     if (!socket->bind(port()))
@@ -83,7 +95,8 @@ QIODevice* LofarChunker::newDevice()
  */
 void LofarChunker::next(QIODevice* device)
 {
-    QUdpSocket* socket = static_cast<QUdpSocket*>(device);
+    // Re-arm the packet capture notification (if capturing).
+    PacketCaptureDevice::acknowledge(device);
 
     unsigned offset = 0;
     unsigned prevSeqid = _startTime;
@@ -100,11 +113,9 @@ void LofarChunker::next(QIODevice* device)
             // Chunker sanity check.
             if (!isActive()) return;
 
-            // Wait for datagram to be available.
-            while (!socket -> hasPendingDatagrams())
-                socket -> waitForReadyRead(100);
-
-            if (socket->readDatagram(reinterpret_cast<char*>(&currPacket), _packetSize) <= 0) {
+            // Wait for datagram to be available and read it (from the socket or
+            // the capture ring).
+            if (PacketCaptureDevice::receiveDatagram(device, reinterpret_cast<char*>(&currPacket), _packetSize) <= 0) {
                 cout << "LofarChunker::next(): Error while receiving UDP Packet!" << endl;
                 i--;
                 continue;
@@ -132,6 +143,7 @@ void LofarChunker::next(QIODevice* device)
             // the data cannot be trusted (ignore)
             if (seqid == ~0U || prevSeqid + 10 < seqid) {
                 ++_packetsRejected;
+                _metrics.packetsRejected.add();
                 i -= 1;
                 continue;
             }
@@ -146,6 +158,7 @@ void LofarChunker::next(QIODevice* device)
 
             if (diff < _samplesPerPacket) { // Duplicated packets... ignore
                 ++_packetsRejected;
+                _metrics.packetsDuplicated.add();
                 i -= 1;
                 continue;
             }
@@ -171,20 +184,24 @@ void LofarChunker::next(QIODevice* device)
             }
 
             i += packetCounter;
+            _metrics.packetsLost.add(packetCounter);
 
             // Write received packet
             // FIXME: Packet will be lost if we fill up the buffer with sufficient empty packets...
             if (i != _nPackets) {
                 ++_packetsAccepted;
+                _metrics.packetsAccepted.add();
                 offset = writePacket(&writableData, currPacket, offset);
                 prevSeqid = seqid;
                 prevBlockid = blockid;
             }
         }
+        _metrics.chunks.add();
     }
     else {
         // Must discard the datagram if there is no available space.
-        socket->readDatagram(0, 0);
+        PacketCaptureDevice::discardDatagram(device);
+        _metrics.packetsDiscarded.add();
         cout << "LofarChunker::LofarChunker(): "
                 "Writable data not valid, discarding packets." << endl;
     }
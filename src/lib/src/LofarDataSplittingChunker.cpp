@@ -44,7 +44,8 @@ namespace ampp {
  *
  */
 LofarDataSplittingChunker::LofarDataSplittingChunker(const ConfigNode& config)
-: AbstractChunker(config)
+: AbstractChunker(config), _capture(config),
+  _metrics(QString("LofarDataSplittingChunker.") + QString::number(port()))
 {
     // Check the configuration type matches the class name.
     if (config.type() != "LofarDataSplittingChunker")
@@ -142,6 +143,16 @@ LofarDataSplittingChunker::LofarDataSplittingChunker(const ConfigNode& config)
  */
 QIODevice* LofarDataSplittingChunker::newDevice()
 {
+    // With packet capture enabled a dedicated thread receives the packets
+    // into a ring which next() consumes.
+    if (_capture.enabled()) {
+        PacketCaptureDevice* capture = new PacketCaptureDevice(_capture, _packetSize);
+        if (!capture->bind(QString(), port()))
+            cerr << "LofarDataSplittingChunker::newDevice(): "
+                 << capture->bindError().toStdString() << endl;
+        return capture;
+    }
+
     QUdpSocket* socket = new QUdpSocket;
 
     if (!socket->bind(port(), QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint ))
@@ -159,7 +170,8 @@ QIODevice* LofarDataSplittingChunker::newDevice()
  */
 void LofarDataSplittingChunker::next(QIODevice* device)
 {
-    QUdpSocket* socket = static_cast<QUdpSocket*>(device);
+    // Re-arm the packet capture notification (if capturing).
+    PacketCaptureDevice::acknowledge(device);
 
     unsigned offsetStream1 = 0;
     unsigned offsetStream2 = 0;
@@ -188,12 +200,9 @@ void LofarDataSplittingChunker::next(QIODevice* device)
             // Chunker sanity check.
             if (!isActive()) return;
 
-            // Wait for datagram to be available.
-            while (!socket->hasPendingDatagrams())
-                socket->waitForReadyRead(100);
-
-            // Read the current packet from the socket.
-            if (socket->readDatagram(reinterpret_cast<char*>(&currPacket), _packetSize) <= 0)
+            // Wait for datagram to be available and read it (from the socket or
+            // the capture ring).
+            if (PacketCaptureDevice::receiveDatagram(device, reinterpret_cast<char*>(&currPacket), _packetSize) <= 0)
             {
                 cerr << "LofarDataSplittingChunker::next(): "
                         "Error while receiving UDP Packet!" << endl;
@@ -224,6 +233,7 @@ void LofarDataSplittingChunker::next(QIODevice* device)
             if (seqid == ~0U || prevSeqid + 10 < seqid)
             {
                 _packetsRejected++;
+                _metrics.packetsRejected.add();
                 i--;
                 continue;
             }
@@ -242,6 +252,7 @@ void LofarDataSplittingChunker::next(QIODevice* device)
             if (diff < _nSamples)
             {
                 ++_packetsRejected;
+                _metrics.packetsDuplicated.add();
                 i -= 1;
                 continue;
             }
@@ -285,11 +296,13 @@ void LofarDataSplittingChunker::next(QIODevice* device)
             }
 
             i += packetCounter;
+            _metrics.packetsLost.add(packetCounter);
 
             // Write received packet to 2 streams after updating header and data
             if (i != _nPackets)
             {
                 ++_packetsAccepted;
+                _metrics.packetsAccepted.add();
 
                 // Generate Stream 1 packet
                 outputPacket1.header = currPacket.header;
@@ -308,12 +321,14 @@ void LofarDataSplittingChunker::next(QIODevice* device)
                 prevBlockid = blockid;
             }
         }
+        _metrics.chunks.add();
     }
 
     else {
         // Must discard the datagram if there is no available space.
         if (!isActive()) return;
-        socket->readDatagram(0, 0);
+        PacketCaptureDevice::discardDatagram(device);
+        _metrics.packetsDiscarded.add();
         cout << "LofarDataSplittingChunker::next(): "
                 "Writable data not valid, discarding packets." << endl;
     }
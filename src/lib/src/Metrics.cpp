@@ -0,0 +1,382 @@
+#include "Metrics.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+
+namespace pelican {
+
+namespace ampp {
+
+const unsigned MetricHistogram::nBuckets;
+
+// -----------------------------------------------------------------------------
+// MetricHistogram
+//
+
+MetricHistogram::MetricHistogram()
+    : _count(0), _total(0), _max(0)
+{
+    for( unsigned k = 0; k < nBuckets; ++k ) _buckets[k] = 0;
+}
+
+void MetricHistogram::record(double seconds)
+{
+    quint64 us = seconds > 0.0 ? (quint64)(seconds * 1.0e6) : 0;
+    unsigned k = 0;
+    while( k < nBuckets - 1 && (us >> (k + 1)) != 0 ) ++k;
+    __sync_fetch_and_add(&_buckets[k], (quint64)1);
+    __sync_fetch_and_add(&_count, (quint64)1);
+    __sync_fetch_and_add(&_total, us);
+    quint64 max = _max;
+    while( us > max ) {
+        quint64 previous = __sync_val_compare_and_swap(&_max, max, us);
+        if( previous == max ) break;
+        max = previous;
+    }
+}
+
+quint64 MetricHistogram::percentile(double fraction) const
+{
+    quint64 n = count();
+    if( n == 0 ) return 0;
+    quint64 target = (quint64)(fraction * n);
+    quint64 seen = 0;
+    for( unsigned k = 0; k < nBuckets; ++k ) {
+        seen += bucket(k);
+        if( seen > target ) return (quint64)1 << (k + 1);
+    }
+    return max();
+}
+
+// -----------------------------------------------------------------------------
+// MetricProfile
+//
+
+const unsigned MetricProfile::nBuckets;
+const unsigned MetricProfile::nShards;
+
+namespace {
+bool profilingRequested()
+{
+    const char* profile = getenv("AMPP_PROFILE");
+    return profile && *profile && strcmp(profile, "0") != 0;
+}
+} // namespace
+
+volatile bool MetricProfile::_enabled = profilingRequested();
+
+MetricProfile::MetricProfile()
+    : _shards(new Shard[nShards]), _budget(0)
+{
+    memset(_shards, 0, nShards * sizeof(Shard));
+}
+
+MetricProfile::~MetricProfile()
+{
+    delete [] _shards;
+}
+
+unsigned MetricProfile::_shardIndex()
+{
+    // threads take the shards in turn, the first time they record
+    static unsigned next = 0;
+    static __thread int shard = -1;
+    if( shard < 0 ) shard = __sync_fetch_and_add(&next, 1) % nShards;
+    return shard;
+}
+
+unsigned MetricProfile::bucketOf(quint64 ns)
+{
+    if( ns < nSubBuckets ) return (unsigned)ns;
+    unsigned e = 63 - __builtin_clzll(ns);
+    unsigned k = (e - nSubBits + 1) * nSubBuckets
+                 + (unsigned)((ns >> (e - nSubBits)) & (nSubBuckets - 1));
+    return k < nBuckets ? k : nBuckets - 1;
+}
+
+quint64 MetricProfile::upperBound(unsigned k)
+{
+    if( k < nSubBuckets ) return k + 1;
+    unsigned e = k / nSubBuckets + nSubBits - 1;
+    return (quint64)(nSubBuckets + k % nSubBuckets + 1) << (e - nSubBits);
+}
+
+void MetricProfile::record(quint64 ns)
+{
+    Shard& shard = _shards[_shardIndex()];
+    __sync_fetch_and_add(&shard.buckets[bucketOf(ns)], (quint64)1);
+    __sync_fetch_and_add(&shard.count, (quint64)1);
+    __sync_fetch_and_add(&shard.total, ns);
+    quint64 max = shard.max;
+    while( ns > max ) {
+        quint64 previous = __sync_val_compare_and_swap(&shard.max, max, ns);
+        if( previous == max ) break;
+        max = previous;
+    }
+    quint64 budget = _budget;
+    if( budget && ns > budget ) __sync_fetch_and_add(&shard.over, (quint64)1);
+}
+
+quint64 MetricProfile::count() const
+{
+    quint64 n = 0;
+    for( unsigned s = 0; s < nShards; ++s ) n += _read(_shards[s].count);
+    return n;
+}
+
+quint64 MetricProfile::total() const
+{
+    quint64 n = 0;
+    for( unsigned s = 0; s < nShards; ++s ) n += _read(_shards[s].total);
+    return n;
+}
+
+quint64 MetricProfile::max() const
+{
+    quint64 n = 0;
+    for( unsigned s = 0; s < nShards; ++s ) n = qMax(n, _read(_shards[s].max));
+    return n;
+}
+
+quint64 MetricProfile::overBudget() const
+{
+    quint64 n = 0;
+    for( unsigned s = 0; s < nShards; ++s ) n += _read(_shards[s].over);
+    return n;
+}
+
+quint64 MetricProfile::percentile(double fraction) const
+{
+    quint64 buckets[nBuckets];
+    quint64 n = 0;
+    for( unsigned k = 0; k < nBuckets; ++k ) {
+        buckets[k] = 0;
+        for( unsigned s = 0; s < nShards; ++s ) buckets[k] += _read(_shards[s].buckets[k]);
+        n += buckets[k];
+    }
+    if( n == 0 ) return 0;
+    quint64 target = (quint64)(fraction * n);
+    quint64 seen = 0;
+    for( unsigned k = 0; k < nBuckets; ++k ) {
+        seen += buckets[k];
+        if( seen > target ) return qMin(upperBound(k), max());
+    }
+    return max();
+}
+
+// -----------------------------------------------------------------------------
+// MetricTimer
+//
+
+double MetricTimer::stop()
+{
+    if( ! _running ) return 0.0;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - _start.tv_sec)
+                     + (end.tv_nsec - _start.tv_nsec) * 1.0e-9;
+    _histogram.record(elapsed);
+    _running = false;
+    return elapsed;
+}
+
+// -----------------------------------------------------------------------------
+// MetricsRegistry
+//
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+/**
+ *@details MetricsRegistry
+ */
+MetricsRegistry::MetricsRegistry()
+    : _writer(0)
+{
+    const char* fileName = getenv("AMPP_METRICS_FILE");
+    if( fileName && *fileName ) {
+        QString name(fileName);
+        name.replace("%p", QString::number(getpid()));
+        const char* interval = getenv("AMPP_METRICS_INTERVAL");
+        startWriter(name, interval ? atof(interval) : 1.0);
+    }
+}
+
+/**
+ *@details
+ */
+MetricsRegistry::~MetricsRegistry()
+{
+    stopWriter();
+    qDeleteAll(_counters);
+    qDeleteAll(_gauges);
+    qDeleteAll(_histograms);
+    qDeleteAll(_profiles);
+}
+
+MetricCounter& MetricsRegistry::counter(const QString& name)
+{
+    QMutexLocker lock(&_mutex);
+    MetricCounter*& metric = _counters[name];
+    if( ! metric ) metric = new MetricCounter;
+    return *metric;
+}
+
+MetricGauge& MetricsRegistry::gauge(const QString& name)
+{
+    QMutexLocker lock(&_mutex);
+    MetricGauge*& metric = _gauges[name];
+    if( ! metric ) metric = new MetricGauge;
+    return *metric;
+}
+
+MetricHistogram& MetricsRegistry::histogram(const QString& name)
+{
+    QMutexLocker lock(&_mutex);
+    MetricHistogram*& metric = _histograms[name];
+    if( ! metric ) metric = new MetricHistogram;
+    return *metric;
+}
+
+MetricProfile& MetricsRegistry::profile(const QString& name)
+{
+    QMutexLocker lock(&_mutex);
+    MetricProfile*& metric = _profiles[name];
+    if( ! metric ) metric = new MetricProfile;
+    return *metric;
+}
+
+void MetricsRegistry::write(std::ostream& stream) const
+{
+    QMutexLocker lock(&_mutex);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    char stamp[32];
+    snprintf(stamp, sizeof(stamp), "%ld.%03ld", (long)now.tv_sec, now.tv_nsec / 1000000);
+    stream << "# time " << stamp << "\n";
+
+    QMap<QString, MetricCounter*>::const_iterator c;
+    for( c = _counters.constBegin(); c != _counters.constEnd(); ++c )
+        stream << "counter " << c.key().toStdString() << " " << c.value()->value() << "\n";
+
+    QMap<QString, MetricGauge*>::const_iterator g;
+    for( g = _gauges.constBegin(); g != _gauges.constEnd(); ++g )
+        stream << "gauge " << g.key().toStdString() << " " << g.value()->value()
+               << " max " << g.value()->max() << "\n";
+
+    QMap<QString, MetricHistogram*>::const_iterator h;
+    for( h = _histograms.constBegin(); h != _histograms.constEnd(); ++h ) {
+        const MetricHistogram& histogram = *h.value();
+        quint64 n = histogram.count();
+        stream << "histogram " << h.key().toStdString() << " count " << n
+               << " mean_us " << (n ? histogram.total() / n : 0)
+               << " p50_us " << histogram.percentile(0.5)
+               << " p99_us " << histogram.percentile(0.99)
+               << " max_us " << histogram.max() << " buckets";
+        for( unsigned k = 0; k < MetricHistogram::nBuckets; ++k )
+            stream << " " << histogram.bucket(k);
+        stream << "\n";
+    }
+
+    QMap<QString, MetricProfile*>::const_iterator p;
+    for( p = _profiles.constBegin(); p != _profiles.constEnd(); ++p ) {
+        const MetricProfile& profile = *p.value();
+        quint64 n = profile.count();
+        char line[256];
+        snprintf(line, sizeof(line),
+                 " count %llu mean_us %.3f p50_us %.3f p99_us %.3f p999_us %.3f max_us %.3f",
+                 (unsigned long long)n, n ? profile.total() * 1.0e-3 / n : 0.0,
+                 profile.percentile(0.5) * 1.0e-3, profile.percentile(0.99) * 1.0e-3,
+                 profile.percentile(0.999) * 1.0e-3, profile.max() * 1.0e-3);
+        stream << "profile " << p.key().toStdString() << line;
+        if( profile.budget() )
+            stream << " budget_us " << profile.budget() / 1000
+                   << " over " << profile.overBudget();
+        stream << "\n";
+    }
+}
+
+bool MetricsRegistry::writeFile(const QString& fileName) const
+{
+    std::ostringstream text;
+    write(text);
+
+    // Write next to the target and rename so readers never see a partial file.
+    QString temporary = fileName + ".tmp";
+    QFile file(temporary);
+    if( ! file.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+        return false;
+    std::string data = text.str();
+    file.write(data.data(), data.size());
+    file.close();
+    return ::rename(temporary.toLocal8Bit().constData(),
+                    fileName.toLocal8Bit().constData()) == 0;
+}
+
+void MetricsRegistry::startWriter(const QString& fileName, double interval)
+{
+    stopWriter();
+    _writer = new Writer(this, fileName, interval);
+    _writer->start(QThread::LowPriority);
+}
+
+void MetricsRegistry::stopWriter()
+{
+    delete _writer;
+    _writer = 0;
+}
+
+// -----------------------------------------------------------------------------
+// ChunkerMetrics
+//
+
+ChunkerMetrics::ChunkerMetrics(const QString& prefix)
+    : packetsAccepted(MetricsRegistry::instance().counter(prefix + ".packetsAccepted")),
+      packetsRejected(MetricsRegistry::instance().counter(prefix + ".packetsRejected")),
+      packetsLost(MetricsRegistry::instance().counter(prefix + ".packetsLost")),
+      packetsDuplicated(MetricsRegistry::instance().counter(prefix + ".packetsDuplicated")),
+      packetsLate(MetricsRegistry::instance().counter(prefix + ".packetsLate")),
+      chunks(MetricsRegistry::instance().counter(prefix + ".chunks")),
+      packetsDiscarded(MetricsRegistry::instance().counter(prefix + ".packetsDiscarded"))
+{
+}
+
+// -----------------------------------------------------------------------------
+// MetricsRegistry::Writer
+//
+
+MetricsRegistry::Writer::Writer(const MetricsRegistry* registry,
+                                const QString& fileName, double interval)
+    : QThread(), _registry(registry), _fileName(fileName), _halt(false)
+{
+    _intervalMs = interval > 0.0 ? (unsigned long)(interval * 1000.0) : 1000;
+}
+
+MetricsRegistry::Writer::~Writer()
+{
+    stop();
+    wait();
+}
+
+void MetricsRegistry::Writer::run()
+{
+    while( ! _halt ) {
+        for( unsigned long slept = 0; slept < _intervalMs && ! _halt; slept += 100 )
+            msleep(qMin<unsigned long>(100, _intervalMs - slept));
+        if( ! _registry->writeFile(_fileName) )
+            std::cerr << "MetricsRegistry: unable to write " << _fileName.toStdString() << std::endl;
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
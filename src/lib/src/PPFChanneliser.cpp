@@ -4,15 +4,20 @@
 
 #include "TimeSeriesDataSet.h"
 #include "SpectrumDataSet.h"
+#include "ChannelKernels.h"
 
 #include <QtCore/QString>
+#include <QtCore/QByteArray>
 #include <QtCore/QTime>
 #include <QtCore/QFile>
+#include <QtCore/QDir>
 
 #include <omp.h>
 
 #include <cfloat>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <iostream>
 
@@ -27,13 +32,21 @@ namespace ampp {
  * @param[in] config XML configuration node.
  */
 PPFChanneliser::PPFChanneliser(const ConfigNode& config)
-: AbstractModule(config), _buffersInitialised(false)
+: AbstractModule(config), _buffersInitialised(false),
+  _layout(SpectrumDataSetC32::PolarisationBlocks), _fftPlanInterleaved(0),
+  _interleavedStride(0)
 {
     // Get options from the XML configuration node.
     _nChannels = config.getOption("outputChannelsPerSubband", "value", "512").toUInt();
     _nThreads  = config.getOption("processingThreads", "value", "2").toUInt();
     unsigned nTaps = config.getOption("filter", "nTaps", "8").toUInt();
     QString window = config.getOption("filter", "filterWindow", "kaiser").toLower();
+    _cacheDir = config.getOption("cache", "directory", "");
+    QString layout = config.getOption("outputLayout", "value", "blocks").toLower();
+    if (layout == "interleaved")
+        _layout = SpectrumDataSetC32::PolarisationInterleaved;
+    else if (layout != "blocks")
+        throw _err("Unknown output layout '%1'.").arg(layout);
 
     // Set the number of processing threads.
     omp_set_num_threads(_nThreads);
@@ -46,6 +59,9 @@ PPFChanneliser::PPFChanneliser(const ConfigNode& config)
     // Generate the FIR coefficients;
     _generateFIRCoefficients(window, nTaps);
 
+    // Select the FIR kernel for the output channel count.
+    _firKernel = ChannelKernels::select<FirKernel>(_nChannels);
+
     // Allocate buffers used for holding the output of the FIR stage.
     _filteredData.resize(_nThreads);
     for (unsigned i = 0; i < _nThreads; ++i)
@@ -62,6 +78,8 @@ PPFChanneliser::PPFChanneliser(const ConfigNode& config)
 PPFChanneliser::~PPFChanneliser()
 {
     fftwf_destroy_plan(_fftPlan);
+    if (_fftPlanInterleaved)
+        fftwf_destroy_plan(_fftPlanInterleaved);
 }
 
 
@@ -92,6 +110,17 @@ void PPFChanneliser::run(const TimeSeriesDataSetC32* timeSeries,
 
     // Resize the output spectra blob (if required).
     spectra->resize(nTimeBlocks, nSubbands, nPolarisations, _nChannels);
+    spectra->setLayout(_layout);
+    bool interleaved = (_layout == SpectrumDataSetC32::PolarisationInterleaved);
+
+    // The interleaved layout needs a plan with the output strided by the
+    // number of polarisations (created here, outside the parallel region).
+    if (interleaved && _nChannels != 1 && _interleavedStride != nPolarisations) {
+        if (_fftPlanInterleaved)
+            fftwf_destroy_plan(_fftPlanInterleaved);
+        _createStridedFFTWPlan(_nChannels, nPolarisations, _fftPlanInterleaved);
+        _interleavedStride = nPolarisations;
+    }
 
     // Set the timing parameters - Only need the timestamp of the first packet
     // for this version of the Channeliser.
@@ -120,8 +149,8 @@ void PPFChanneliser::run(const TimeSeriesDataSetC32* timeSeries,
                      timeData = &timeStart[index];
                      for (unsigned t = 0; t < nTimesPerBlock; ++t) {
                          // FFT the filtered sub-band data to form a new spectrum.
-                         unsigned indexSpectra = spectra->index(subband, nSubbands,
-                                 pol, nPolarisations, (nTimesPerBlock*block)+t, _nChannels);
+                         unsigned indexSpectra = spectra->sampleIndex(
+                                 (nTimesPerBlock*block)+t, subband, pol, 0);
 //                         spectraStart = &spectra->data()[indexSpectra];
                          spectraStart[indexSpectra] = timeData[t];
                      }
@@ -138,7 +167,7 @@ void PPFChanneliser::run(const TimeSeriesDataSetC32* timeSeries,
         // Channeliser processing.
         #pragma omp parallel \
             shared(nTimeBlocks, nPolarisations, nSubbands, nFilterTaps, coeffs,\
-                    timeStart, spectraStart) \
+                    timeStart, spectraStart, interleaved) \
             private(threadId, nThreads, start, end, workBuffer, filteredSamples, \
                     timeData)
         {
@@ -173,9 +202,12 @@ void PPFChanneliser::run(const TimeSeriesDataSetC32* timeSeries,
                         _filter(workBuffer, nFilterTaps, _nChannels, coeffs, filteredSamples);
 
                         // FFT the filtered sub-band data to form a new spectrum.
-                        unsigned indexSpectra = spectra->index(subband, nSubbands,
-                                pol, nPolarisations, block, _nChannels);
-                        _fft(filteredSamples, &spectraStart[indexSpectra]);
+                        unsigned indexSpectra = spectra->sampleIndex(block,
+                                subband, pol, 0);
+                        if (interleaved)
+                            _fftInterleaved(filteredSamples, &spectraStart[indexSpectra]);
+                        else
+                            _fft(filteredSamples, &spectraStart[indexSpectra]);
                     }
                 }
             }
@@ -207,7 +239,25 @@ void PPFChanneliser::_generateFIRCoefficients(const QString& window, unsigned nT
     else
         throw _err("Unknown coefficient window type '%1'.").arg(window);
 
-    _ppfCoeffs.genereateFilter(nTaps, _nChannels, windowType);
+    // Use cached coefficients if available, otherwise generate them and
+    // populate the cache for the next start up.
+    QString cacheFile;
+    if (!_cacheDir.isEmpty())
+        cacheFile = PolyphaseCoefficients::cacheFileName(_cacheDir, nTaps,
+                _nChannels, windowType);
+    if (cacheFile.isEmpty() ||
+            !_ppfCoeffs.loadCache(cacheFile, nTaps, _nChannels, windowType))
+    {
+        _ppfCoeffs.genereateFilter(nTaps, _nChannels, windowType);
+        if (!cacheFile.isEmpty()) {
+            try {
+                _ppfCoeffs.saveCache(cacheFile, windowType);
+            }
+            catch (const QString& e) {
+                std::cerr << _err(e).toStdString() << std::endl;
+            }
+        }
+    }
 
     // Convert Coefficients to single precision.
     _coeffs.resize(_ppfCoeffs.size());
@@ -266,27 +316,11 @@ void PPFChanneliser::_updateBuffer(const Complex* samples, unsigned nSamples,
 void PPFChanneliser::_filter(const Complex* sampleBuffer, unsigned nTaps,
         unsigned nChannels, const float* coeffs, Complex* filteredSamples)
 {
-    for (unsigned i = 0; i < nChannels; ++i)
-        filteredSamples[i] = Complex(0.0, 0.0);
-
-    unsigned iBuffer = 0, idx = 0;
-    float re, im, coeff;
     unsigned tId = omp_get_thread_num();
-
-    for (unsigned i = 0, t = 0; t < nTaps; ++t)
-    {
-        iBuffer = ((_iOldestSamples[tId] + t) % nTaps) * nChannels;
-        for (unsigned c = 0; c < nChannels; ++c)
-        {
-            idx = iBuffer + c;
-            coeff = coeffs[i];
-            re = sampleBuffer[idx].real() * coeff;
-            im = sampleBuffer[idx].imag() * coeff;
-            filteredSamples[c].real() += re;
-            filteredSamples[c].imag() += im;
-            i++;
-        }
-    }
+    FirKernel<RuntimeChannels>::Function fir = (nChannels == _nChannels) ?
+            _firKernel : ChannelKernels::select<FirKernel>(nChannels);
+    fir(sampleBuffer, _iOldestSamples[tId], nTaps, coeffs, filteredSamples,
+            nChannels);
 }
 
 
@@ -345,12 +379,103 @@ unsigned PPFChanneliser::_setupWorkBuffers(unsigned nSubbands,
 
 void PPFChanneliser::_createFFTWPlan(unsigned nChannels, fftwf_plan& plan)
 {
+    QByteArray wisdom = _loadWisdom(nChannels);
     size_t fftSize = nChannels * sizeof(fftwf_complex);
     fftwf_complex* in  = (fftwf_complex*) fftwf_malloc(fftSize);
     fftwf_complex* out = (fftwf_complex*) fftwf_malloc(fftSize);
     plan = fftwf_plan_dft_1d(_nChannels, in, out, FFTW_FORWARD, FFTW_MEASURE);
     fftwf_free(in);
     fftwf_free(out);
+    _saveWisdom(nChannels, wisdom);
+}
+
+
+/**
+ * @details
+ * Creates a plan for an nChannels point FFT with contiguous input and the
+ * output written every @p stride elements. The output of all but the first
+ * polarisation is not aligned as the planning arrays are, so the plan
+ * must not rely on alignment.
+ */
+void PPFChanneliser::_createStridedFFTWPlan(unsigned nChannels,
+        unsigned stride, fftwf_plan& plan)
+{
+    QByteArray wisdom = _loadWisdom(nChannels);
+    int n = nChannels;
+    fftwf_complex* in  = (fftwf_complex*) fftwf_malloc(nChannels * sizeof(fftwf_complex));
+    fftwf_complex* out = (fftwf_complex*) fftwf_malloc(nChannels * stride * sizeof(fftwf_complex));
+    plan = fftwf_plan_many_dft(1, &n, 1, in, NULL, 1, n, out, NULL, stride,
+            n * stride, FFTW_FORWARD, FFTW_MEASURE | FFTW_UNALIGNED);
+    fftwf_free(in);
+    fftwf_free(out);
+    _saveWisdom(nChannels, wisdom);
+}
+
+
+/**
+ * @details
+ * Returns the FFTW wisdom accumulated so far.
+ */
+static QByteArray exportedWisdom()
+{
+    char* wisdom = fftwf_export_wisdom_to_string();
+    QByteArray exported(wisdom);
+    free(wisdom);
+    return exported;
+}
+
+
+/**
+ * @details
+ * Imports any saved wisdom so that FFTW_MEASURE does not need to re-time
+ * the candidate plans, and returns the wisdom held before planning.
+ */
+QByteArray PPFChanneliser::_loadWisdom(unsigned nChannels)
+{
+    QString wisdomFile = _wisdomFileName(nChannels);
+    if (wisdomFile.isEmpty()) return QByteArray();
+    FILE* fp = fopen(wisdomFile.toLocal8Bit().constData(), "r");
+    if (fp) {
+        fftwf_import_wisdom_from_file(fp);
+        fclose(fp);
+    }
+    return exportedWisdom();
+}
+
+
+/**
+ * @details
+ * Rewrites the wisdom file if planning has added to the wisdom held
+ * before (@p wisdom), so that every plan measured is saved.
+ */
+void PPFChanneliser::_saveWisdom(unsigned nChannels, const QByteArray& wisdom)
+{
+    QString wisdomFile = _wisdomFileName(nChannels);
+    if (wisdomFile.isEmpty() || exportedWisdom() == wisdom) return;
+    QString tmpName = wisdomFile + ".tmp";
+    FILE* fp = fopen(tmpName.toLocal8Bit().constData(), "w");
+    if (fp) {
+        fftwf_export_wisdom_to_file(fp);
+        fclose(fp);
+        QFile::remove(wisdomFile);
+        QFile::rename(tmpName, wisdomFile);
+    }
+    else {
+        std::cerr << _err("Unable to write FFTW wisdom file %1.")
+                .arg(wisdomFile).toStdString() << std::endl;
+    }
+}
+
+
+/**
+ * @details
+ * Returns the FFTW wisdom file for the given number of channels, or an
+ * empty string if no cache directory is configured.
+ */
+QString PPFChanneliser::_wisdomFileName(unsigned nChannels) const
+{
+    if (_cacheDir.isEmpty()) return QString();
+    return QDir(_cacheDir).filePath(QString("ppf_fftwf_%1.wisdom").arg(nChannels));
 }
 
 
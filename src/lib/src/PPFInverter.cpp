@@ -0,0 +1,395 @@
+#include "PPFInverter.h"
+
+#include "pelican/utility/ConfigNode.h"
+
+#include <QtCore/QString>
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace pelican {
+namespace ampp {
+
+
+/**
+ * @details
+ * Constructor.
+ *
+ * @param[in] config XML configuration node.
+ */
+PPFInverter::PPFInverter(const ConfigNode& config)
+: AbstractModule(config), _nChannels(0), _nStreams(0), _ifftPlan(0),
+  _fftPlan(0)
+{
+    // Get options from the XML configuration node.
+    _nOutChannels = config.getOption("outputChannelsPerSubband", "value", "16").toUInt();
+    _nThreads = config.getOption("processingThreads", "value", "2").toUInt();
+    _nTaps = config.getOption("filter", "nTaps", "8").toUInt();
+    _passband = config.getOption("synthesis", "passband", "0.5").toDouble();
+    QString window = config.getOption("filter", "filterWindow", "kaiser").toLower();
+    _cacheDir = config.getOption("cache", "directory", "");
+
+    if (window == "kaiser")
+        _window = PolyphaseCoefficients::KAISER;
+    else if (window == "gaussian")
+        _window = PolyphaseCoefficients::GAUSSIAN;
+    else if (window == "blackman")
+        _window = PolyphaseCoefficients::BLACKMAN;
+    else if (window == "hamming")
+        _window = PolyphaseCoefficients::HAMMING;
+    else
+        throw _err("Unknown coefficient window type '%1'.").arg(window);
+
+    if (_nOutChannels == 0)
+        throw _err("Number of output channels must be greater than zero.");
+    if (_nOutChannels != 1 && _nOutChannels % 2 == 1)
+        throw _err("Number of output channels needs to be even.");
+    if (_passband <= 0.0 || _passband > 1.0)
+        throw _err("Synthesis passband must be in (0, 1].");
+    if (_nTaps == 0)
+        throw _err("Number of filter taps must be greater than zero.");
+
+    _scratch.resize(_nThreads);
+}
+
+
+/**
+ * @details
+ * Destroys the inverter module.
+ */
+PPFInverter::~PPFInverter()
+{
+    if (_ifftPlan) fftwf_destroy_plan(_ifftPlan);
+    if (_fftPlan) fftwf_destroy_plan(_fftPlan);
+}
+
+
+/**
+ * @details
+ * Reconstructs the sub-band time series from the spectra.
+ *
+ * The output holds nTimeBlocks x nChannels samples per sub-band and
+ * polarisation, arranged in blocks of outputChannelsPerSubband samples.
+ * The first 2 (nTaps - 1) blocks after construction are a start-up
+ * transient: the channeliser and synthesis filters both start from an
+ * empty history.
+ *
+ * @param[in]  spectra    Spectra produced by the PPFChanneliser.
+ * @param[out] timeSeries Reconstructed sub-band time series.
+ */
+void PPFInverter::run(const SpectrumDataSetC32* spectra,
+        TimeSeriesDataSetC32* timeSeries)
+{
+    if (!spectra) throw _err("Spectrum data blob missing.");
+    if (!timeSeries) throw _err("Time series data blob missing.");
+    if (!spectra->size()) throw _err("Empty spectrum data blob.");
+
+    unsigned nTimeBlocks    = spectra->nTimeBlocks();
+    unsigned nSubbands      = spectra->nSubbands();
+    unsigned nPolarisations = spectra->nPolarisations();
+    unsigned nChannels      = spectra->nChannels();
+
+    unsigned nSamples = nTimeBlocks * nChannels;
+    if (nSamples % _nOutChannels != 0)
+        throw _err("Number of samples %1 is not a multiple of the output "
+                "block length %2.").arg(nSamples).arg(_nOutChannels);
+
+    _setup(nSubbands, nPolarisations, nChannels);
+
+    timeSeries->resize(nSamples / _nOutChannels, nSubbands, nPolarisations,
+            _nOutChannels);
+
+    // The output is delayed by the length of the synthesis filter.
+    double spectrumRate = spectra->getBlockRate();
+    timeSeries->setBlockRate(spectrumRate / nChannels);
+    timeSeries->setLofarTimestamp(spectra->getLofarTimestamp()
+            - (_nTaps - 1) * spectrumRate);
+
+    unsigned stride = spectra->channelStride();
+    int nStreams = nSubbands * nPolarisations;
+
+    // Each sub-band/polarisation stream carries its own filter history so
+    // the streams are independent and can be processed in any order.
+    #pragma omp parallel for num_threads(_nThreads) schedule(dynamic)
+    for (int i = 0; i < nStreams; ++i)
+    {
+        unsigned s = i / nPolarisations;
+        unsigned p = i % nPolarisations;
+        Complex* scratch = &_scratch[omp_get_thread_num()][0];
+        Complex* out = timeSeries->timeSeriesData(0, s, p);
+        for (unsigned b = 0; b < nTimeBlocks; ++b) {
+            _synthesise(spectra->spectrumData(b, s, p), stride, i, scratch,
+                    out + b * nChannels);
+        }
+    }
+}
+
+
+/**
+ * @details
+ * Reconstructs the sub-band time series from the spectra and forms new
+ * spectra of outputChannelsPerSubband channels from it.
+ *
+ * The new spectra are formed with a plain FFT of each block. As in the
+ * PPFChanneliser, each block is modulated by (-1)^t first so that the
+ * sub-band centre is in channel outputChannelsPerSubband / 2 (the
+ * channeliser folds this into its filter coefficients). For better channel
+ * isolation run the time series output through a PPFChanneliser instead.
+ *
+ * @param[in]  spectra        Spectra produced by the PPFChanneliser.
+ * @param[out] rechannelised  Spectra at the new resolution.
+ */
+void PPFInverter::run(const SpectrumDataSetC32* spectra,
+        SpectrumDataSetC32* rechannelised)
+{
+    if (!rechannelised) throw _err("Output spectrum data blob missing.");
+
+    run(spectra, &_timeSeries);
+
+    unsigned nBlocks        = _timeSeries.nTimeBlocks();
+    unsigned nSubbands      = _timeSeries.nSubbands();
+    unsigned nPolarisations = _timeSeries.nPolarisations();
+
+    rechannelised->resize(nBlocks, nSubbands, nPolarisations, _nOutChannels);
+    rechannelised->setLayout(SpectrumDataSetC32::PolarisationBlocks);
+    rechannelised->setBlockRate(_timeSeries.getBlockRate() * _nOutChannels);
+    rechannelised->setLofarTimestamp(_timeSeries.getLofarTimestamp());
+
+    // Plans are created outside the parallel region.
+    if (!_fftPlan) {
+        fftwf_complex* in  = (fftwf_complex*) fftwf_malloc(_nOutChannels * sizeof(fftwf_complex));
+        fftwf_complex* out = (fftwf_complex*) fftwf_malloc(_nOutChannels * sizeof(fftwf_complex));
+        _fftPlan = fftwf_plan_dft_1d(_nOutChannels, in, out, FFTW_FORWARD,
+                FFTW_MEASURE | FFTW_UNALIGNED);
+        fftwf_free(in);
+        fftwf_free(out);
+    }
+
+    int nSpectra = nBlocks * nSubbands * nPolarisations;
+
+    #pragma omp parallel for num_threads(_nThreads)
+    for (int i = 0; i < nSpectra; ++i)
+    {
+        unsigned b = i % nBlocks;
+        unsigned p = (i / nBlocks) % nPolarisations;
+        unsigned s = i / (nBlocks * nPolarisations);
+        Complex* scratch = &_scratch[omp_get_thread_num()][0];
+        const Complex* in = _timeSeries.timeSeriesData(b, s, p);
+
+        // Modulate by (-1)^t to put DC in the centre channel, as the
+        // channeliser does.
+        for (unsigned t = 0; t < _nOutChannels; ++t)
+            scratch[t] = (t & 1) ? -in[t] : in[t];
+
+        fftwf_execute_dft(_fftPlan, (fftwf_complex*)scratch,
+                (fftwf_complex*)rechannelised->spectrumData(b, s, p));
+    }
+}
+
+
+/**
+ * @details
+ * Sets up the synthesis filter, FFT plan and filter history for the input
+ * dimensions. Does nothing if these have not changed since the last call.
+ */
+void PPFInverter::_setup(unsigned nSubbands, unsigned nPolarisations,
+        unsigned nChannels)
+{
+    unsigned nStreams = nSubbands * nPolarisations;
+    if (nChannels == _nChannels && nStreams == _nStreams)
+        return;
+
+    // Generate (or load) the filter used by the channeliser.
+    if (nChannels != _nChannels)
+    {
+        PolyphaseCoefficients ppfCoeffs;
+        QString cacheFile;
+        if (!_cacheDir.isEmpty())
+            cacheFile = PolyphaseCoefficients::cacheFileName(_cacheDir, _nTaps,
+                    nChannels, _window);
+        if (cacheFile.isEmpty() ||
+                !ppfCoeffs.loadCache(cacheFile, _nTaps, nChannels, _window))
+        {
+            ppfCoeffs.genereateFilter(_nTaps, nChannels, _window);
+            if (!cacheFile.isEmpty()) {
+                try {
+                    ppfCoeffs.saveCache(cacheFile, _window);
+                }
+                catch (const QString& e) {
+                    std::cerr << _err(e).toStdString() << std::endl;
+                }
+            }
+        }
+
+        // Design the synthesis filter of each sample position. The 1/N of
+        // the inverse FFT is folded into the coefficients.
+        const double* coeffs = ppfCoeffs.ptr();
+        _coeffs.resize(_nTaps * nChannels);
+        std::vector<double> f(_nTaps);
+        for (unsigned c = 0; c < nChannels; ++c) {
+            _designSynthesis(coeffs, nChannels, c, &f[0]);
+            for (unsigned j = 0; j < _nTaps; ++j)
+                _coeffs[j * nChannels + c] = (float)(f[j] / nChannels);
+        }
+
+        // Create the inverse FFT plan.
+        if (_ifftPlan) fftwf_destroy_plan(_ifftPlan);
+        fftwf_complex* in  = (fftwf_complex*) fftwf_malloc(nChannels * sizeof(fftwf_complex));
+        fftwf_complex* out = (fftwf_complex*) fftwf_malloc(nChannels * sizeof(fftwf_complex));
+        _ifftPlan = fftwf_plan_dft_1d(nChannels, in, out, FFTW_BACKWARD,
+                FFTW_MEASURE | FFTW_UNALIGNED);
+        fftwf_free(in);
+        fftwf_free(out);
+
+        for (unsigned i = 0; i < _nThreads; ++i)
+            _scratch[i].resize(std::max(nChannels, _nOutChannels));
+    }
+
+    // Reset the filter history.
+    _history.resize(nStreams);
+    for (unsigned i = 0; i < nStreams; ++i)
+        _history[i].assign(_nTaps * nChannels, Complex(0.0f, 0.0f));
+    _iNewest.assign(nStreams, _nTaps - 1);
+
+    _nChannels = nChannels;
+    _nStreams = nStreams;
+}
+
+
+/**
+ * @details
+ * Designs the synthesis filter for sample position @p c of the block.
+ *
+ * The channeliser filters the samples at position c across blocks with
+ * g_m = h_{nTaps-1-m}[c], h_t being tap t of the analysis filter, so the
+ * inverse FFT of spectrum b is y_b[c] = N sum_m g_m x_{b-m}[c]. The
+ * synthesis filter f (f_0 applied to the newest block) minimises
+ *
+ *   sum_w W(w) |G(w) F(w) - exp(-i w (nTaps - 1))|^2
+ *
+ * over frequencies w across blocks, with W = 1 within the passband and
+ * nearly 0 outside it (at the channel edges G has near zeros and cannot be
+ * inverted). This is a small symmetric system, solved directly.
+ *
+ * @param[in]  coeffs    The nTaps x nChannels analysis filter.
+ * @param[in]  nChannels The number of channels.
+ * @param[in]  c         The sample position.
+ * @param[out] f         The nTaps synthesis coefficients (without 1/N).
+ */
+void PPFInverter::_designSynthesis(const double* coeffs, unsigned nChannels,
+        unsigned c, double* f) const
+{
+    const unsigned nTaps = _nTaps;
+    const unsigned nFreqs = 256;
+    const double stopWeight = 1.0e-6;
+    const double delay = nTaps - 1;
+
+    std::vector<double> g(nTaps);
+    for (unsigned m = 0; m < nTaps; ++m)
+        g[m] = coeffs[(nTaps - 1 - m) * nChannels + c];
+
+    // Normal equations A f = r, accumulated over (0, pi); G is real so the
+    // negative frequencies add the same again.
+    std::vector<double> a(nTaps * nTaps, 0.0);
+    std::vector<double> r(nTaps, 0.0);
+    for (unsigned q = 0; q < nFreqs; ++q) {
+        double w = M_PI * (q + 0.5) / nFreqs;
+        double weight = (w <= _passband * M_PI) ? 1.0 : stopWeight;
+        std::complex<double> G(0.0, 0.0);
+        for (unsigned m = 0; m < nTaps; ++m)
+            G += g[m] * std::polar(1.0, -w * m);
+        double G2 = std::norm(G);
+        for (unsigned i = 0; i < nTaps; ++i) {
+            for (unsigned j = 0; j < nTaps; ++j)
+                a[i * nTaps + j] += weight * G2 * std::cos(w * ((double)i - j));
+            r[i] += weight * (std::conj(G) * std::polar(1.0, w * (i - delay))).real();
+        }
+    }
+
+    // Gaussian elimination with partial pivoting.
+    for (unsigned i = 0; i < nTaps; ++i) {
+        unsigned pivot = i;
+        for (unsigned k = i + 1; k < nTaps; ++k)
+            if (std::fabs(a[k * nTaps + i]) > std::fabs(a[pivot * nTaps + i]))
+                pivot = k;
+        for (unsigned k = 0; k < nTaps; ++k)
+            std::swap(a[i * nTaps + k], a[pivot * nTaps + k]);
+        std::swap(r[i], r[pivot]);
+        for (unsigned k = i + 1; k < nTaps; ++k) {
+            double factor = a[k * nTaps + i] / a[i * nTaps + i];
+            for (unsigned j = i; j < nTaps; ++j)
+                a[k * nTaps + j] -= factor * a[i * nTaps + j];
+            r[k] -= factor * r[i];
+        }
+    }
+    for (int i = nTaps - 1; i >= 0; --i) {
+        double sum = r[i];
+        for (unsigned k = i + 1; k < nTaps; ++k)
+            sum -= a[i * nTaps + k] * f[k];
+        f[i] = sum / a[i * nTaps + i];
+    }
+}
+
+
+/**
+ * @details
+ * Inverse FFTs one spectrum into the filter history of the stream and
+ * forms nChannels output samples from the synthesis filter:
+ *
+ *   z[c] = sum_j f_j[c] y_{b-j}[c]
+ *
+ * where y_b is the most recent inverse FFT output and f_j the synthesis
+ * coefficients (see _designSynthesis()).
+ */
+void PPFInverter::_synthesise(const Complex* spectrum, unsigned stride,
+        unsigned iStream, Complex* scratch, Complex* output)
+{
+    unsigned nChannels = _nChannels;
+    Complex* history = &_history[iStream][0];
+
+    // Copy the (possibly strided) spectrum into contiguous memory.
+    if (stride == 1)
+        memcpy(scratch, spectrum, nChannels * sizeof(Complex));
+    else
+        for (unsigned c = 0; c < nChannels; ++c)
+            scratch[c] = spectrum[c * stride];
+
+    // Inverse FFT into the next history slot.
+    unsigned newest = (_iNewest[iStream] + 1) % _nTaps;
+    _iNewest[iStream] = newest;
+    fftwf_execute_dft(_ifftPlan, (fftwf_complex*)scratch,
+            (fftwf_complex*)&history[newest * nChannels]);
+
+    // Apply the synthesis filter.
+    float* out = reinterpret_cast<float*>(output);
+    for (unsigned c = 0; c < 2 * nChannels; ++c)
+        out[c] = 0.0f;
+
+    for (unsigned j = 0; j < _nTaps; ++j) {
+        unsigned slot = (newest + _nTaps - j) % _nTaps;
+        const float* y = reinterpret_cast<const float*>(&history[slot * nChannels]);
+        const float* h = &_coeffs[j * nChannels];
+        for (unsigned c = 0; c < nChannels; ++c) {
+            out[2*c]   += y[2*c]   * h[c];
+            out[2*c+1] += y[2*c+1] * h[c];
+        }
+    }
+}
+
+
+/**
+ * @details
+ * Returns a message use for errors and throws from the inverter.
+ */
+inline QString PPFInverter::_err(const QString& message)
+{
+    return QString("PPFInverter: ") + message;
+}
+
+
+}// namespace ampp
+}// namespace pelican
@@ -0,0 +1,438 @@
+#include "PacketCaptureDevice.h"
+#include "pelican/utility/ConfigNode.h"
+
+#include <QtNetwork/QUdpSocket>
+#include <QtNetwork/QHostAddress>
+#include <QtCore/QMetaObject>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <cstring>
+#include <iostream>
+
+namespace pelican {
+
+namespace ampp {
+
+
+// -----------------------------------------------------------------------------
+// PacketCaptureThread
+//
+
+/**
+ *@details PacketCaptureThread
+ */
+PacketCaptureThread::PacketCaptureThread(PacketCaptureDevice* device,
+                                         int socketDescriptor, int cpu)
+    : QThread(), _device(device), _socket(socketDescriptor), _cpu(cpu),
+      _halt(false)
+{
+}
+
+/**
+ *@details
+ */
+PacketCaptureThread::~PacketCaptureThread()
+{
+    stop();
+    wait();
+}
+
+void PacketCaptureThread::stop()
+{
+    _halt = true;
+}
+
+bool PacketCaptureThread::pinCurrentThread(int cpu)
+{
+    if( cpu < 0 ) return true;
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if( sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) != 0 ) {
+        std::cerr << "PacketCaptureThread: unable to set affinity to cpu " << cpu << std::endl;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PacketCaptureThread::run()
+{
+    pinCurrentThread(_cpu);
+
+    UdpBatchReceiver& receiver = _device->_receiver;
+    PacketRing& ring = *_device->_ring;
+    unsigned batch = receiver.maxBatch();
+    std::vector<unsigned> lengths(batch);
+    std::vector<char> overflow((size_t)batch * receiver.slotSize());
+
+    while( ! _halt ) {
+        unsigned n = batch;
+        char* dest = ring.writeSlots(n);
+        if( n == 0 ) {
+            // Ring full: keep draining the socket so that the loss is
+            // accounted for here rather than in the kernel.
+            int lost = receiver.receive(_socket, &overflow[0], batch, 100);
+            if( lost > 0 ) {
+                ring.countDropped(lost);
+                _device->_ringDropped->add(lost);
+            }
+            continue;
+        }
+        int received = receiver.receive(_socket, dest, n, 100);
+        if( received <= 0 ) continue;
+        for( int i = 0; i < received; ++i )
+            lengths[i] = receiver.length(i);
+        ring.commit(received, &lengths[0]);
+        _device->_notify();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// PacketReplayThread
+//
+
+/**
+ *@details PacketReplayThread
+ */
+PacketReplayThread::PacketReplayThread(PacketCaptureDevice* device, int cpu)
+    : QThread(), _device(device), _cpu(cpu), _halt(false)
+{
+}
+
+/**
+ *@details
+ */
+PacketReplayThread::~PacketReplayThread()
+{
+    stop();
+    wait();
+}
+
+void PacketReplayThread::stop()
+{
+    _halt = true;
+}
+
+quint64 PacketReplayThread::_now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (quint64)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+bool PacketReplayThread::_sleepUntil(quint64 time)
+{
+    for( quint64 now = _now(); now < time && ! _halt; now = _now() ) {
+        // Sleep for most of the wait and spin for the last part, as the
+        // scheduler wakes us up late by tens of microseconds.
+        quint64 wait = time - now;
+        if( wait > 200000 ) {
+            wait = qMin<quint64>(wait - 100000, 100000000);
+            struct timespec t = { (time_t)(wait / 1000000000), (long)(wait % 1000000000) };
+            nanosleep(&t, 0);
+        }
+    }
+    return ! _halt;
+}
+
+void PacketReplayThread::run()
+{
+    PacketCaptureThread::pinCurrentThread(_cpu);
+
+    const PacketCaptureDevice::Config& config = _device->_config;
+    PacketCaptureReader& reader = *_device->_reader;
+    UdpBatchReceiver& receiver = _device->_receiver;
+    PacketRing& ring = *_device->_ring;
+    unsigned batch = receiver.maxBatch();
+    unsigned slotSize = receiver.slotSize();
+    std::vector<unsigned> lengths(batch);
+
+    // Packet k is due at start + k / rate or, for the recorded rate, at start
+    // plus its recorded time (offset by the length of the previous passes).
+    bool paced = config.replayRate != 0.0;
+    quint64 interval = config.replayRate > 0.0 ? (quint64)(1.0e9 / config.replayRate) : 0;
+    quint64 start = _now();
+    quint64 offset = 0, first = 0, last = 0, index = 0, passPackets = 0;
+    unsigned pass = 0;
+
+    PacketCaptureReader::Record record;
+    bool pending = reader.read(record);
+    if( pending ) first = record.time;
+
+    while( pending && ! _halt ) {
+        quint64 due = interval ? start + index * interval
+                               : start + offset + (record.time - first);
+        if( paced && ! _sleepUntil(due) ) break;
+
+        unsigned n = batch;
+        char* dest = ring.writeSlots(n);
+        if( n == 0 ) {
+            // Ring full: wait for the assembler rather than drop packets.
+            ring.waitForSpace(100);
+            continue;
+        }
+
+        // Take this packet and any others already due.
+        quint64 now = paced ? _now() : 0;
+        unsigned filled = 0;
+        while( pending && filled < n ) {
+            if( paced && filled > 0 ) {
+                due = interval ? start + index * interval
+                               : start + offset + (record.time - first);
+                if( due > now ) break;
+            }
+            lengths[filled] = receiver.gather(record.data, record.captured,
+                                              dest + (size_t)filled * slotSize);
+            ++filled;
+            ++index;
+            ++passPackets;
+            last = record.time;
+            pending = reader.read(record);
+            if( ! pending && ++pass != config.replayLoops ) {
+                // Start the next pass one mean packet interval after the last.
+                reader.rewind();
+                pending = reader.read(record);
+                offset += (last - first)
+                          + (passPackets > 1 ? (last - first) / (passPackets - 1) : 0);
+                passPackets = 0;
+            }
+        }
+        ring.commit(filled, &lengths[0]);
+        _device->_replayed->add(filled);
+        _device->_notify();
+    }
+    std::cout << "PacketReplayThread: replayed " << index << " packets from "
+              << config.replayFile.toStdString() << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+// PacketCaptureDevice
+//
+
+PacketCaptureDevice::Config::Config(const ConfigNode& config)
+{
+    ringSlots = config.getOption("capture", "ringSlots", "0").toUInt();
+    cpu = config.getOption("capture", "cpu", "-1").toInt();
+    assemblerCpu = config.getOption("capture", "assemblerCpu", "-1").toInt();
+    batch = config.getOption("socket", "batch", "64").toUInt();
+    receiveBuffer = config.getOption("socket", "receiveBuffer", "67108864").toInt();
+
+    replayFile = config.getOption("replay", "file");
+    QString rate = config.getOption("replay", "rate", "max");
+    if( rate == "max" ) replayRate = 0.0;
+    else if( rate == "recorded" ) replayRate = -1.0;
+    else replayRate = rate.toDouble();
+    replayLoops = config.getOption("replay", "loops", "1").toUInt();
+    if( replay() && ringSlots == 0 ) ringSlots = 65536;
+}
+
+/**
+ *@details PacketCaptureDevice
+ */
+PacketCaptureDevice::PacketCaptureDevice(const Config& config, unsigned packetSize)
+    : QIODevice(), _config(config), _receiver(config.batch), _ring(0),
+      _reader(0), _thread(0), _socket(-1), _signalled(0),
+      _assemblerPinned(false), _ringDepth(0), _ringDropped(0), _replayed(0)
+{
+    // Whole packets are kept unless the chunker describes segments itself.
+    _packetSize = packetSize;
+    open(QIODevice::ReadOnly);
+}
+
+/**
+ *@details
+ */
+PacketCaptureDevice::~PacketCaptureDevice()
+{
+    delete _thread;
+    if( _socket >= 0 ) ::close(_socket);
+    delete _reader;
+    delete _ring;
+}
+
+bool PacketCaptureDevice::bind(const QString& host, quint16 port)
+{
+    if( _receiver.packetSize() == 0 )
+        _receiver.addSegment(_packetSize, true);
+    if( _config.replay() )
+        return _bindReplay(port);
+
+    _socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if( _socket < 0 ) {
+        _error = QString("PacketCaptureDevice: unable to create socket: %1")
+                 .arg(strerror(errno));
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    int granted = UdpBatchReceiver::setReceiveBufferSize(_socket, _config.receiveBuffer);
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    QHostAddress hostAddress(host);
+    address.sin_addr.s_addr = (host.isEmpty() || hostAddress.isNull())
+                              ? htonl(INADDR_ANY) : htonl(hostAddress.toIPv4Address());
+    if( ::bind(_socket, (sockaddr*)&address, sizeof(address)) != 0 ) {
+        _error = QString("PacketCaptureDevice: unable to bind to %1:%2: %3")
+                 .arg(host).arg(port).arg(strerror(errno));
+        return false;
+    }
+
+    _ring = new PacketRing(_config.ringSlots, _receiver.slotSize());
+    QString prefix = QString("PacketCapture.") + QString::number(port);
+    _ringDepth = &MetricsRegistry::instance().gauge(prefix + ".ringDepth");
+    _ringDropped = &MetricsRegistry::instance().counter(prefix + ".dropped");
+    std::cout << "PacketCaptureDevice: " << _ring->capacity() << " slots of "
+              << _ring->slotSize() << " bytes, receive buffer " << granted
+              << " bytes, capture cpu " << _config.cpu << std::endl;
+
+    _thread = new PacketCaptureThread(this, _socket, _config.cpu);
+    _thread->start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+bool PacketCaptureDevice::_bindReplay(quint16 port)
+{
+    _reader = new PacketCaptureReader;
+    if( ! _reader->open(_config.replayFile) ) {
+        _error = _reader->error();
+        return false;
+    }
+    if( _reader->header().snapLength < _receiver.packetSize() )
+        std::cerr << "PacketCaptureDevice: " << _config.replayFile.toStdString()
+                  << " holds only " << _reader->header().snapLength
+                  << " bytes of each packet" << std::endl;
+
+    _ring = new PacketRing(_config.ringSlots, _receiver.slotSize());
+    QString prefix = QString("PacketCapture.") + QString::number(port);
+    _ringDepth = &MetricsRegistry::instance().gauge(prefix + ".ringDepth");
+    _ringDropped = &MetricsRegistry::instance().counter(prefix + ".dropped");
+    _replayed = &MetricsRegistry::instance().counter(prefix + ".replayed");
+    std::cout << "PacketCaptureDevice: replaying " << _config.replayFile.toStdString()
+              << " into " << _ring->capacity() << " slots of " << _ring->slotSize()
+              << " bytes" << std::endl;
+
+    _thread = new PacketReplayThread(this, _config.cpu);
+    _thread->start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void PacketCaptureDevice::acknowledge()
+{
+    if( ! _assemblerPinned ) {
+        PacketCaptureThread::pinCurrentThread(_config.assemblerCpu);
+        _assemblerPinned = true;
+    }
+    _signalled.fetchAndStoreRelease(0);
+}
+
+void PacketCaptureDevice::_notify()
+{
+    // Queue a single readyRead() in the assembler's thread until the chunker
+    // acknowledges it.
+    if( _signalled.testAndSetOrdered(0, 1) )
+        QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection);
+}
+
+qint64 PacketCaptureDevice::bytesAvailable() const
+{
+    return (_ring ? (qint64)_ring->size() * _ring->slotSize() : 0)
+           + QIODevice::bytesAvailable();
+}
+
+bool PacketCaptureDevice::waitForReadyRead(int msecs)
+{
+    // The ring is filled by another thread: sleep until it commits packets.
+    if( ! _ring ) return false;
+    return _ring->waitForData(msecs < 0 ? ULONG_MAX : (unsigned long)msecs);
+}
+
+qint64 PacketCaptureDevice::readDatagram(char* data, qint64 maxSize)
+{
+    if( ! _ring ) return -1;
+    unsigned count = 1;
+    const unsigned* lengths;
+    const char* slot = _ring->readSlots(count, lengths);
+    if( count == 0 ) return 0;
+    qint64 length = lengths[0];
+    if( data ) {
+        qint64 copy = qMin<qint64>(qMin<qint64>(length, maxSize), _ring->slotSize());
+        std::memcpy(data, slot, copy);
+    }
+    _ring->release(1);
+    return length;
+}
+
+int PacketCaptureDevice::readDatagrams(char* dest, unsigned maxPackets,
+                                       unsigned* lengths, int timeoutMs)
+{
+    if( ! _ring ) return -1;
+    if( ! waitForReadyRead(timeoutMs) ) return 0;
+    _ringDepth->set(_ring->size());
+
+    unsigned slotSize = _ring->slotSize();
+    unsigned total = 0;
+    // At most two runs of contiguous slots either side of the wrap.
+    while( total < maxPackets ) {
+        unsigned count = maxPackets - total;
+        const unsigned* slotLengths;
+        const char* slots = _ring->readSlots(count, slotLengths);
+        if( count == 0 ) break;
+        std::memcpy(dest + (size_t)total * slotSize, slots, (size_t)count * slotSize);
+        std::memcpy(lengths + total, slotLengths, count * sizeof(unsigned));
+        _ring->release(count);
+        total += count;
+    }
+    return total;
+}
+
+qint64 PacketCaptureDevice::readData(char* data, qint64 maxSize)
+{
+    return readDatagram(data, maxSize);
+}
+
+qint64 PacketCaptureDevice::receiveDatagram(QIODevice* device, char* data,
+                                            qint64 maxSize)
+{
+    PacketCaptureDevice* capture = dynamic_cast<PacketCaptureDevice*>(device);
+    if( capture ) {
+        while( ! capture->hasPendingDatagrams() )
+            capture->waitForReadyRead(100);
+        return capture->readDatagram(data, maxSize);
+    }
+    QUdpSocket* socket = static_cast<QUdpSocket*>(device);
+    while( ! socket->hasPendingDatagrams() )
+        socket->waitForReadyRead(100);
+    return socket->readDatagram(data, maxSize);
+}
+
+void PacketCaptureDevice::discardDatagram(QIODevice* device)
+{
+    PacketCaptureDevice* capture = dynamic_cast<PacketCaptureDevice*>(device);
+    if( capture )
+        capture->readDatagram(0, 0);
+    else
+        static_cast<QUdpSocket*>(device)->readDatagram(0, 0);
+}
+
+void PacketCaptureDevice::acknowledge(QIODevice* device)
+{
+    PacketCaptureDevice* capture = dynamic_cast<PacketCaptureDevice*>(device);
+    if( capture ) capture->acknowledge();
+}
+
+} // namespace ampp
+} // namespace pelican
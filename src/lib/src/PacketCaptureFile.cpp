@@ -0,0 +1,170 @@
+#include "PacketCaptureFile.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <cstring>
+
+
+namespace pelican {
+
+namespace ampp {
+
+const quint32 PacketCaptureFile::version;
+
+quint64 PacketCaptureFile::now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    return (quint64)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+// -----------------------------------------------------------------------------
+// PacketCaptureWriter
+//
+
+/**
+ *@details PacketCaptureWriter
+ */
+PacketCaptureWriter::PacketCaptureWriter()
+    : _file(0), _snapLength(0), _startTime(0), _packets(0)
+{
+}
+
+/**
+ *@details
+ */
+PacketCaptureWriter::~PacketCaptureWriter()
+{
+    close();
+}
+
+bool PacketCaptureWriter::open(const QString& fileName, quint32 snapLength)
+{
+    close();
+    _file = std::fopen(fileName.toLocal8Bit().constData(), "wb");
+    if( ! _file ) return false;
+    // Large buffer: the writer is fed from a receive loop.
+    std::setvbuf(_file, 0, _IOFBF, 4 << 20);
+
+    PacketCaptureFile::FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::strncpy(header.magic, PacketCaptureFile::magic(), sizeof(header.magic));
+    header.version = PacketCaptureFile::version;
+    header.snapLength = _snapLength = snapLength;
+    header.startTime = _startTime = PacketCaptureFile::now();
+    _packets = 0;
+    return std::fwrite(&header, sizeof(header), 1, _file) == 1;
+}
+
+bool PacketCaptureWriter::write(const char* data, quint32 length, quint64 time)
+{
+    if( ! _file ) return false;
+    PacketCaptureFile::RecordHeader record;
+    record.time = time > _startTime ? time - _startTime : 0;
+    record.length = length;
+    record.captured = length < _snapLength ? length : _snapLength;
+    static const char padding[8] = { 0 };
+    size_t pad = PacketCaptureFile::recordSize(record.captured)
+                 - sizeof(record) - record.captured;
+    if( std::fwrite(&record, sizeof(record), 1, _file) != 1 ) return false;
+    if( std::fwrite(data, 1, record.captured, _file) != record.captured ) return false;
+    if( pad && std::fwrite(padding, 1, pad, _file) != pad ) return false;
+    ++_packets;
+    return true;
+}
+
+void PacketCaptureWriter::close()
+{
+    if( _file ) std::fclose(_file);
+    _file = 0;
+}
+
+// -----------------------------------------------------------------------------
+// PacketCaptureReader
+//
+
+/**
+ *@details PacketCaptureReader
+ */
+PacketCaptureReader::PacketCaptureReader()
+    : _map(0), _size(0), _position(0)
+{
+    std::memset(&_header, 0, sizeof(_header));
+}
+
+/**
+ *@details
+ */
+PacketCaptureReader::~PacketCaptureReader()
+{
+    close();
+}
+
+bool PacketCaptureReader::open(const QString& fileName)
+{
+    close();
+    int fd = ::open(fileName.toLocal8Bit().constData(), O_RDONLY);
+    if( fd < 0 ) {
+        _error = QString("PacketCaptureReader: unable to open %1: %2")
+                 .arg(fileName).arg(strerror(errno));
+        return false;
+    }
+    struct stat info;
+    if( fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(_header) ) {
+        ::close(fd);
+        _error = QString("PacketCaptureReader: %1 is not a capture file").arg(fileName);
+        return false;
+    }
+    void* map = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if( map == MAP_FAILED ) {
+        _error = QString("PacketCaptureReader: unable to map %1: %2")
+                 .arg(fileName).arg(strerror(errno));
+        return false;
+    }
+    // Replay reads the file front to back.
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+    _map = static_cast<const char*>(map);
+    _size = info.st_size;
+
+    std::memcpy(&_header, _map, sizeof(_header));
+    if( std::strncmp(_header.magic, PacketCaptureFile::magic(), sizeof(_header.magic)) != 0
+        || _header.version != PacketCaptureFile::version ) {
+        close();
+        _error = QString("PacketCaptureReader: %1 is not a capture file").arg(fileName);
+        return false;
+    }
+    rewind();
+    return true;
+}
+
+void PacketCaptureReader::close()
+{
+    if( _map ) munmap(const_cast<char*>(_map), _size);
+    _map = 0;
+    _size = _position = 0;
+}
+
+bool PacketCaptureReader::read(Record& record)
+{
+    if( ! _map || _position + sizeof(PacketCaptureFile::RecordHeader) > _size )
+        return false;
+    const PacketCaptureFile::RecordHeader* header =
+        reinterpret_cast<const PacketCaptureFile::RecordHeader*>(_map + _position);
+    size_t size = PacketCaptureFile::recordSize(header->captured);
+    if( _position + sizeof(*header) + header->captured > _size )
+        return false;
+    record.data = _map + _position + sizeof(*header);
+    record.length = header->length;
+    record.captured = header->captured;
+    record.time = header->time;
+    _position += size;
+    return true;
+}
+
+} // namespace ampp
+} // namespace pelican
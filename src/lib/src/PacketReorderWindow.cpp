@@ -0,0 +1,171 @@
+#include "PacketReorderWindow.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace pelican {
+
+namespace ampp {
+
+
+/**
+ *@details PacketReorderWindow
+ */
+PacketReorderWindow::PacketReorderWindow(unsigned slots, unsigned slotSize,
+                                         unsigned window, unsigned carrySlots)
+    : _chunk(0), _slots(slots), _slotSize(slotSize), _window(window),
+      _first(0), _next(slots), _latest(0), _origin(0), _originSequence(0),
+      _step(1), _nextOrigin(0), _nextOriginSequence(0), _nextStep(1),
+      _hasLatest(false), _closed(false),
+      _placed(0), _end(0), _nCarried(0), _duplicates(0), _late(0),
+      _overflows(0)
+{
+    _filled.resize(slots, 0);
+    _carry.resize((size_t)carrySlots * slotSize);
+    _carrySequence.resize(carrySlots, 0);
+    _carryUsed.resize(carrySlots, 0);
+}
+
+/**
+ *@details
+ */
+PacketReorderWindow::~PacketReorderWindow()
+{
+}
+
+void PacketReorderWindow::start(char* chunk)
+{
+    _chunk = chunk;
+    _first = _next;
+    _next = _first + _slots;
+    _origin = _nextOrigin;
+    _originSequence = _nextOriginSequence;
+    _step = _nextStep;
+    _closed = false;
+    _hasLatest = false;
+    _placed = 0;
+    _end = 0;
+    std::fill(_filled.begin(), _filled.end(), 0);
+
+    for( unsigned c = 0; _nCarried > 0 && c < _carryUsed.size(); ++c ) {
+        if( ! _carryUsed[c] ) continue;
+        quint64 sequence = _carrySequence[c];
+        if( sequence < _first ) {
+            ++_late;
+        }
+        else if( sequence < _next ) {
+            unsigned slot = (unsigned)(sequence - _first);
+            std::memcpy(_chunk + (size_t)slot * _slotSize,
+                        &_carry[(size_t)c * _slotSize], _slotSize);
+            _fill(slot, sequence);
+        }
+        else {
+            _seen(sequence);
+            continue;
+        }
+        _carryUsed[c] = 0;
+        --_nCarried;
+    }
+    // Packets kept from before may land anywhere in the chunk, so expect the
+    // stream to continue from the start.
+    _end = 0;
+}
+
+void PacketReorderWindow::resync(quint64 sequence, quint64 position,
+                                 unsigned step)
+{
+    std::fill(_carryUsed.begin(), _carryUsed.end(), 0);
+    _nCarried = 0;
+    _nextOrigin = position;
+    _nextOriginSequence = sequence;
+    _nextStep = step;
+    if( _placed == 0 ) {
+        _origin = position;
+        _originSequence = sequence;
+        _step = step;
+        _first = sequence;
+        _next = _first + _slots;
+        _hasLatest = false;
+        _end = 0;
+    }
+    else {
+        _closed = true;
+        _next = sequence;
+    }
+}
+
+PacketReorderWindow::Status PacketReorderWindow::place(quint64 sequence,
+                                                       const char* packet)
+{
+    if( ! _closed && sequence >= _first && sequence < _first + _slots ) {
+        unsigned slot = (unsigned)(sequence - _first);
+        if( _filled[slot] ) {
+            ++_duplicates;
+            return Duplicate;
+        }
+        std::memcpy(_chunk + (size_t)slot * _slotSize, packet, _slotSize);
+        _fill(slot, sequence);
+        return Placed;
+    }
+    if( sequence < _next ) {
+        ++_late;
+        return Late;
+    }
+
+    // Keep the packet for a later chunk.
+    unsigned free = _carryUsed.size();
+    for( unsigned c = 0; c < _carryUsed.size(); ++c ) {
+        if( ! _carryUsed[c] ) {
+            if( free == _carryUsed.size() ) free = c;
+        }
+        else if( _carrySequence[c] == sequence ) {
+            ++_duplicates;
+            return Duplicate;
+        }
+    }
+    if( free == _carryUsed.size() ) {
+        ++_overflows;
+        return Overflow;
+    }
+    std::memcpy(&_carry[(size_t)free * _slotSize], packet, _slotSize);
+    _carrySequence[free] = sequence;
+    _carryUsed[free] = 1;
+    ++_nCarried;
+    _seen(sequence);
+    return Carried;
+}
+
+bool PacketReorderWindow::complete() const
+{
+    if( _closed || _placed == _slots ) return true;
+    return _hasLatest && _latest >= _first + _slots - 1 + _window;
+}
+
+unsigned PacketReorderWindow::freeRun(unsigned& count) const
+{
+    unsigned slot = _end;
+    while( slot < _slots && _filled[slot] ) ++slot;
+    count = 0;
+    while( slot + count < _slots && ! _filled[slot + count] ) ++count;
+    return slot;
+}
+
+void PacketReorderWindow::_fill(unsigned slot, quint64 sequence)
+{
+    _filled[slot] = 1;
+    ++_placed;
+    if( slot >= _end ) _end = slot + 1;
+    _seen(sequence);
+}
+
+void PacketReorderWindow::_seen(quint64 sequence)
+{
+    if( ! _hasLatest || sequence > _latest ) {
+        _latest = sequence;
+        _hasLatest = true;
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
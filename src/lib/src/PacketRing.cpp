@@ -0,0 +1,82 @@
+#include "PacketRing.h"
+#include "CompletionCounter.h"
+
+#include <QtCore/QMutexLocker>
+
+
+namespace pelican {
+
+namespace ampp {
+
+
+/**
+ *@details PacketRing
+ */
+PacketRing::PacketRing(unsigned nSlots, unsigned slotSize)
+    : _slotSize(slotSize), _head(0), _cachedTail(0), _tail(0), _cachedHead(0),
+      _dropped(0), _consumerWaiting(0), _producerWaiting(0)
+{
+    unsigned capacity = 1;
+    while( capacity < nSlots ) capacity <<= 1;
+    _mask = capacity - 1;
+    _data.resize((size_t)capacity * slotSize);
+    _lengths.resize(capacity, 0);
+}
+
+/**
+ *@details
+ */
+PacketRing::~PacketRing()
+{
+}
+
+unsigned PacketRing::size() const
+{
+    QAtomicInt& head = const_cast<QAtomicInt&>(_head);
+    QAtomicInt& tail = const_cast<QAtomicInt&>(_tail);
+    return _acquire(head) - _acquire(tail);
+}
+
+bool PacketRing::waitForSpace(unsigned long msecs)
+{
+    unsigned capacity = _mask + 1;
+    unsigned head = (unsigned)(int)_head;
+    if( head - _acquire(_tail) < capacity ) return true;
+    QMutexLocker lock(&_mutex);
+    Deadline deadline(msecs);
+    // The flag is raised before the tail is read again, so a release()
+    // after that read sees it and wakes us once we are waiting.
+    _producerWaiting.fetchAndStoreOrdered(1);
+    while( head - _acquire(_tail) >= capacity ) {
+        unsigned long ms = deadline.remaining();
+        if( ms == 0 ) break;
+        _spaceReady.wait(&_mutex, ms);
+    }
+    _producerWaiting.fetchAndStoreRelaxed(0);
+    return head - _acquire(_tail) < capacity;
+}
+
+bool PacketRing::waitForData(unsigned long msecs)
+{
+    unsigned tail = (unsigned)(int)_tail;
+    if( _acquire(_head) != tail ) return true;
+    QMutexLocker lock(&_mutex);
+    Deadline deadline(msecs);
+    _consumerWaiting.fetchAndStoreOrdered(1);
+    while( _acquire(_head) == tail ) {
+        unsigned long ms = deadline.remaining();
+        if( ms == 0 ) break;
+        _dataReady.wait(&_mutex, ms);
+    }
+    _consumerWaiting.fetchAndStoreRelaxed(0);
+    return _acquire(_head) != tail;
+}
+
+void PacketRing::_wake(QWaitCondition& condition)
+{
+    QMutexLocker lock(&_mutex);
+    condition.wakeAll();
+}
+
+} // namespace ampp
+} // namespace pelican
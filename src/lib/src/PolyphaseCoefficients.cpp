@@ -3,6 +3,8 @@
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
 #include <QtCore/QStringList>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
 
 #include <fftw3.h>
 
@@ -12,6 +14,9 @@
 namespace pelican {
 namespace ampp {
 
+const quint32 PolyphaseCoefficients::_cacheMagic;
+const quint32 PolyphaseCoefficients::_cacheVersion;
+
 /**
  * @details
  * Loads coefficients from matlab coefficient dump file written using
@@ -63,6 +68,89 @@ void PolyphaseCoefficients::load(const QString& fileName,
 
 
 
+/**
+ * @details
+ * Loads coefficients written by saveCache(). The file header records the
+ * parameters the coefficients were generated for; if these do not match
+ * the requested ones the coefficients are left untouched and false is
+ * returned so the caller can regenerate them.
+ */
+bool PolyphaseCoefficients::loadCache(const QString& fileName,
+        unsigned nTaps, unsigned nChannels, FirWindow windowType)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    quint32 magic, version, taps, channels, window;
+    in >> magic >> version >> taps >> channels >> window;
+    if (in.status() != QDataStream::Ok || magic != _cacheMagic ||
+            version != _cacheVersion || taps != nTaps ||
+            channels != nChannels || window != (quint32)windowType)
+        return false;
+
+    std::vector<double> coeff(nTaps * nChannels);
+    for (unsigned i = 0; i < coeff.size(); ++i)
+        in >> coeff[i];
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    _nTaps = nTaps;
+    _nChannels = nChannels;
+    _coeff.swap(coeff);
+    return true;
+}
+
+
+/**
+ * @details
+ * Writes the coefficients to a binary cache file. The file is written under
+ * a temporary name and renamed into place so a concurrent reader never sees
+ * a partially written cache.
+ */
+void PolyphaseCoefficients::saveCache(const QString& fileName,
+        FirWindow windowType) const
+{
+    QString tmpName = fileName + ".tmp";
+    QFile file(tmpName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        throw QString("PolyphaseCoefficients::saveCache(): "
+                "Unable to open cache file %1.").arg(tmpName);
+    }
+
+    QDataStream out(&file);
+    out.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    out << _cacheMagic << _cacheVersion << (quint32)_nTaps
+        << (quint32)_nChannels << (quint32)windowType;
+    for (unsigned i = 0; i < _coeff.size(); ++i)
+        out << _coeff[i];
+    file.close();
+
+    QFile::remove(fileName);
+    if (!QFile::rename(tmpName, fileName)) {
+        QFile::remove(tmpName);
+        throw QString("PolyphaseCoefficients::saveCache(): "
+                "Unable to write cache file %1.").arg(fileName);
+    }
+}
+
+
+/**
+ * @details
+ * Cache files are keyed on (nTaps, nChannels, window).
+ */
+QString PolyphaseCoefficients::cacheFileName(const QString& directory,
+        unsigned nTaps, unsigned nChannels, FirWindow windowType)
+{
+    static const char* windowNames[] =
+            { "hamming", "blackman", "gaussian", "kaiser" };
+    return QDir(directory).filePath(QString("ppf_%1_%2x%3.coeff")
+            .arg(windowNames[windowType]).arg(nTaps).arg(nChannels));
+}
+
+
 //==============================================================================
 // The following are taken from LOFAR CNProc FIR.cc under GNU GPL
 // (TODO: check this)
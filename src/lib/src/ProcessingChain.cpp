@@ -10,8 +10,8 @@ namespace ampp {
 /**
  *@details ProcessingChain 
  */
-ProcessingChain::ProcessingChain()
-        : _taskId(0)
+ProcessingChain::ProcessingChain( const QString& name )
+        : _taskId(0), _running(name)
 {
 }
 
@@ -24,10 +24,8 @@ ProcessingChain::~ProcessingChain()
     waitTaskCompletion();
 }
 
-void ProcessingChain::waitTaskCompletion() const {
-    while( _processCount.size() ) {
-        usleep(10);
-    }
+bool ProcessingChain::waitTaskCompletion( unsigned long timeout ) const {
+    return _running.wait( timeout );
 }
 
 void ProcessingChain::exec( const QList<CallBackT>& parallelTasks,
@@ -37,6 +35,7 @@ void ProcessingChain::exec( const QList<CallBackT>& parallelTasks,
         _finished( postProcessingTasks );
      }
      else {
+        _running.add();
         QMutexLocker lock(&_mutex);
         _processCount[++_taskId]=0;
         // each task is launched in a separate thread
@@ -53,6 +52,7 @@ void ProcessingChain::_runTask( const CallBackT& functor, unsigned taskId, const
      if( --_processCount[taskId] == 0) {
         _finished( postProcessingTasks );
         _processCount.remove(taskId); // mark processing chain complete
+        _running.done();
      }
 }
 
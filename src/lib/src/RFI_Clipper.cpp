@@ -6,6 +6,7 @@
 #include "BandPassAdapter.h"
 #include "BandPass.h"
 #include "BinMap.h"
+#include "ChannelKernels.h"
 #include "pelican/utility/ConfigNode.h"
 #include "pelican/utility/pelicanTimer.h"
 #include "omp.h"
@@ -177,6 +178,8 @@ void RFI_Clipper::run( WeightedSpectrumDataSet* weightedStokes )
     _map.setStart( _startFrequency );
     _map.setBinWidthFromEndFreq( _endFrequency );
     _bandPass.reBin(_map);
+    SubtractKernel<RuntimeChannels>::Function subtractModel =
+      ChannelKernels::select<SubtractKernel>(nChannels);
     // -------------------------------------------------------------
     // Processing next chunk 
       ////////////////std::vector<float> foo(nSubbands, 0.0);
@@ -203,10 +206,8 @@ void RFI_Clipper::run( WeightedSpectrumDataSet* weightedStokes )
         long index = stokesAll->index(s, nSubbands,
                                     0, nPolarisations,
                                     t, nChannels );
-        for (unsigned c = 0; c < nChannels ; ++c) {
-          int binLocal = s*nChannels +c; 
-          copyI[binLocal]=I[index + c] - bandPass[binLocal];
-        }
+        subtractModel( &I[index], bandPass.constData() + s*nChannels,
+                       &copyI[s*nChannels], nChannels );
       }
 
 #if 0
@@ -0,0 +1,160 @@
+#include "RealTimeWatchdog.h"
+#include "pelican/utility/ConfigNode.h"
+#include <iostream>
+
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ *@details RealTimeWatchdog
+ */
+RealTimeWatchdog::RealTimeWatchdog( const QString& name )
+    : _name(name), _enabled(false), _overload(2.0), _sustain(10), _recover(100),
+      _chosen(false), _deficit(0.0), _overloaded(0), _caughtUp(0), _level(0),
+      _running(false),
+      _deficitGauge(MetricsRegistry::instance().gauge(name + ".deficit_us")),
+      _levelGauge(MetricsRegistry::instance().gauge(name + ".shedLevel")),
+      _overBudget(MetricsRegistry::instance().counter(name + ".overBudget")),
+      _shedCount(MetricsRegistry::instance().counter(name + ".shed"))
+{
+}
+
+/**
+ *@details
+ */
+RealTimeWatchdog::~RealTimeWatchdog()
+{
+    while( _level > 0 ) _restore();
+}
+
+void RealTimeWatchdog::addPolicy( const QString& name, const PolicyT& shed )
+{
+    Policy policy;
+    policy.name = name;
+    policy.shed = shed;
+    _registered.append( policy );
+    if( ! _chosen ) _active.append( policy );
+}
+
+void RealTimeWatchdog::configure( const ConfigNode& config )
+{
+    setEnabled( config.getOption("watchdog", "enable", "false") == "true" );
+    setThresholds( config.getOption("watchdog", "overload", "2").toDouble(),
+                   config.getOption("watchdog", "sustain", "10").toUInt(),
+                   config.getOption("watchdog", "recover", "100").toUInt() );
+    QStringList names = config.getOptionList("shed", "policy");
+    if( ! names.isEmpty() ) setPolicies( names );
+}
+
+void RealTimeWatchdog::setThresholds( double overload, unsigned sustain, unsigned recover )
+{
+    _overload = overload;
+    _sustain = sustain ? sustain : 1;
+    _recover = recover ? recover : 1;
+}
+
+void RealTimeWatchdog::setPolicies( const QStringList& names )
+{
+    while( _level > 0 ) _restore();
+    _active.clear();
+    _chosen = true;
+    foreach( const QString& name, names ) {
+        bool found = false;
+        foreach( const Policy& policy, _registered ) {
+            if( policy.name != name ) continue;
+            _active.append( policy );
+            found = true;
+            break;
+        }
+        if( ! found )
+            std::cerr << "RealTimeWatchdog " << _name.toStdString()
+                      << ": ignoring unknown policy \"" << name.toStdString()
+                      << "\"" << std::endl;
+    }
+}
+
+QStringList RealTimeWatchdog::policies() const
+{
+    QStringList names;
+    foreach( const Policy& policy, _active ) {
+        names.append( policy.name );
+    }
+    return names;
+}
+
+void RealTimeWatchdog::start()
+{
+    clock_gettime(CLOCK_MONOTONIC, &_start);
+    _running = true;
+}
+
+void RealTimeWatchdog::stop( double budget )
+{
+    if( ! _running ) return;
+    _running = false;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    record( (end.tv_sec - _start.tv_sec) + (end.tv_nsec - _start.tv_nsec) * 1.0e-9,
+            budget );
+}
+
+void RealTimeWatchdog::record( double elapsed, double budget )
+{
+    if( budget <= 0.0 ) return;
+    bool over = elapsed > budget;
+    if( over ) _overBudget.add();
+    _deficit += elapsed - budget;
+    if( _deficit < 0.0 ) _deficit = 0.0;
+    _deficitGauge.set( (qint64)( _deficit * 1.0e6 ) );
+    if( ! _enabled ) return;
+
+    if( _deficit > _overload * budget ) {
+        // only while still not keeping up: once shedding has brought the
+        // iterations under budget the backlog is left to drain
+        _caughtUp = 0;
+        if( over && ++_overloaded >= _sustain ) {
+            _overloaded = 0;
+            _shed();
+        }
+    }
+    else if( _deficit > 0.0 ) {
+        _overloaded = 0;
+        _caughtUp = 0;
+    }
+    else {
+        _overloaded = 0;
+        if( _level > 0 && ++_caughtUp >= _recover ) {
+            _caughtUp = 0;
+            _restore();
+        }
+    }
+}
+
+void RealTimeWatchdog::_shed()
+{
+    if( _level >= _active.size() ) return; // nothing left to shed
+    const Policy& policy = _active[_level];
+    std::cout << "RealTimeWatchdog " << _name.toStdString() << ": "
+              << _deficit << " s behind real time, shedding \""
+              << policy.name.toStdString() << "\"" << std::endl;
+    policy.shed( true );
+    ++_level;
+    _shedCount.add();
+    _levelGauge.set( _level );
+}
+
+void RealTimeWatchdog::_restore()
+{
+    if( _level == 0 ) return;
+    const Policy& policy = _active[--_level];
+    std::cout << "RealTimeWatchdog " << _name.toStdString()
+              << ": caught up with real time, restoring \""
+              << policy.name.toStdString() << "\"" << std::endl;
+    policy.shed( false );
+    _levelGauge.set( _level );
+}
+
+} // namespace ampp
+} // namespace pelican
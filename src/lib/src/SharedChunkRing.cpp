@@ -0,0 +1,299 @@
+#include "SharedChunkRing.h"
+#include "CompletionCounter.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <climits>
+#include <cstring>
+
+
+namespace pelican {
+
+namespace ampp {
+
+// Layout of the start of the segment. The counters of the two sides are on
+// separate cache lines.
+struct SharedChunkRing::Header {
+    char magic[8];
+    quint32 version;
+    quint32 nSlots;
+    quint64 slotSize;
+    quint64 slotStride;
+    quint64 dataOffset;
+    quint64 generation;         // Creation time of the segment (ns).
+    quint32 pid;                // The producer's process.
+    volatile quint32 closed;    // Set when the producer destroys the ring.
+    char pad0[8];
+    volatile quint64 head;      // Chunks published by the producer.
+    volatile quint64 sequence;  // Next sequence number (counts skipped chunks).
+    volatile quint64 skipped;
+    volatile quint32 published; // Futex the consumer waits on.
+    char pad1[36];
+    volatile quint64 tail;      // Chunks released by the consumer.
+    volatile quint32 released;  // Futex the producer waits on.
+    char pad2[52];
+};
+
+// Description of the chunk in a slot.
+struct SharedChunkRing::Slot {
+    quint64 sequence;
+    quint64 bytes;
+};
+
+static const char ringMagic[8] = "AMPPSHM";
+static const quint32 ringVersion = 2;
+static const size_t pageSize = 4096;
+
+static size_t roundUp(size_t n, size_t to)
+{
+    return (n + to - 1) / to * to;
+}
+
+// Milliseconds to wait for a timeout argument (-1 for ever).
+static unsigned long waitMs(int timeoutMs)
+{
+    return timeoutMs < 0 ? ULONG_MAX : (unsigned long)timeoutMs;
+}
+
+/**
+ *@details SharedChunkRing
+ */
+SharedChunkRing::SharedChunkRing(const QString& name, unsigned nSlots,
+                                 size_t slotSize)
+    : _name(name), _owner(true), _map(0), _size(0), _header(0)
+{
+    if( nSlots == 0 || slotSize == 0 )
+        throw QString("SharedChunkRing: %1 needs at least one slot").arg(name);
+    QByteArray path = ("/" + name).toLocal8Bit();
+    shm_unlink(path.constData());
+    int fd = shm_open(path.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if( fd < 0 )
+        throw QString("SharedChunkRing: unable to create %1: %2").arg(name).arg(strerror(errno));
+
+    size_t stride = roundUp(slotSize, pageSize);
+    size_t dataOffset = roundUp(sizeof(Header) + nSlots * sizeof(Slot), pageSize);
+    size_t size = dataOffset + nSlots * stride;
+    if( ftruncate(fd, size) != 0 ) {
+        ::close(fd);
+        shm_unlink(path.constData());
+        throw QString("SharedChunkRing: unable to size %1: %2").arg(name).arg(strerror(errno));
+    }
+    _attach(fd, size, true);
+
+    std::memset(_header, 0, sizeof(Header));
+    _header->nSlots = nSlots;
+    _header->slotSize = slotSize;
+    _header->slotStride = stride;
+    _header->dataOffset = dataOffset;
+    _header->version = ringVersion;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    _header->generation = (quint64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    _header->pid = getpid();
+    // The magic goes last so a consumer never sees a half written header.
+    __sync_synchronize();
+    std::memcpy(_header->magic, ringMagic, sizeof(ringMagic));
+}
+
+/**
+ *@details
+ */
+SharedChunkRing::SharedChunkRing(const QString& name)
+    : _name(name), _owner(false), _map(0), _size(0), _header(0)
+{
+    QByteArray path = ("/" + name).toLocal8Bit();
+    int fd = shm_open(path.constData(), O_RDWR, 0);
+    if( fd < 0 )
+        throw QString("SharedChunkRing: unable to open %1: %2").arg(name).arg(strerror(errno));
+    struct stat info;
+    if( fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header) ) {
+        ::close(fd);
+        throw QString("SharedChunkRing: %1 is not a chunk ring").arg(name);
+    }
+    _attach(fd, info.st_size, false);
+    __sync_synchronize();
+    if( std::memcmp(_header->magic, ringMagic, sizeof(ringMagic)) != 0
+        || _header->version != ringVersion
+        || _header->dataOffset + (size_t)_header->nSlots * _header->slotStride > _size ) {
+        munmap(_map, _size);
+        _map = 0;
+        throw QString("SharedChunkRing: %1 is not a chunk ring").arg(name);
+    }
+}
+
+/**
+ *@details
+ */
+SharedChunkRing::~SharedChunkRing()
+{
+    if( ! _map ) return;
+    if( _owner ) {
+        // Let a waiting consumer know, and leave a segment that has replaced
+        // this one alone.
+        _header->closed = 1;
+        __sync_fetch_and_add(&_header->published, 1);
+        _wake(_header->published);
+        if( _current() ) shm_unlink(("/" + _name).toLocal8Bit().constData());
+    }
+    munmap(_map, _size);
+}
+
+void SharedChunkRing::_attach(int fd, size_t size, bool create)
+{
+    void* map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if( map == MAP_FAILED ) {
+        if( create ) shm_unlink(("/" + _name).toLocal8Bit().constData());
+        throw QString("SharedChunkRing: unable to map %1: %2").arg(_name).arg(strerror(errno));
+    }
+    _map = static_cast<char*>(map);
+    _size = size;
+    _header = reinterpret_cast<Header*>(_map);
+}
+
+// Whether the segment of our name is still the one we have mapped.
+bool SharedChunkRing::_current() const
+{
+    int fd = shm_open(("/" + _name).toLocal8Bit().constData(), O_RDONLY, 0);
+    if( fd < 0 ) return false;
+    Header header;
+    ssize_t n = pread(fd, &header, sizeof(Header), 0);
+    ::close(fd);
+    return n == (ssize_t)sizeof(Header)
+           && std::memcmp(header.magic, ringMagic, sizeof(ringMagic)) == 0
+           && header.generation == _header->generation
+           && header.pid == _header->pid;
+}
+
+bool SharedChunkRing::stale() const
+{
+    if( _header->closed ) return true;
+    if( kill((pid_t)_header->pid, 0) != 0 && errno == ESRCH ) return true;
+    return ! _current();
+}
+
+unsigned SharedChunkRing::slots() const
+{
+    return _header->nSlots;
+}
+
+size_t SharedChunkRing::slotSize() const
+{
+    return _header->slotSize;
+}
+
+unsigned SharedChunkRing::size() const
+{
+    return (unsigned)(_load(_header->head) - _load(_header->tail));
+}
+
+quint64 SharedChunkRing::skipped() const
+{
+    return _load(_header->skipped);
+}
+
+SharedChunkRing::Slot* SharedChunkRing::_slot(quint64 index) const
+{
+    return reinterpret_cast<Slot*>(_map + sizeof(Header)) + index % _header->nSlots;
+}
+
+char* SharedChunkRing::_data(quint64 index) const
+{
+    return _map + _header->dataOffset + (index % _header->nSlots) * _header->slotStride;
+}
+
+quint64 SharedChunkRing::_load(const volatile quint64& value)
+{
+    return __sync_fetch_and_add(const_cast<quint64*>(&value), 0);
+}
+
+void SharedChunkRing::_store(volatile quint64& value, quint64 v)
+{
+    // Everything written before is visible to the other process first.
+    __sync_synchronize();
+    value = v;
+}
+
+void SharedChunkRing::_wait(volatile quint32& word, quint32 value, unsigned long ms)
+{
+    // Returns at once if the word is no longer value, so a wake up between
+    // reading it and waiting is not lost.
+    struct timespec timeout = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+    syscall(SYS_futex, &word, FUTEX_WAIT, value,
+            ms == ULONG_MAX ? 0 : &timeout, 0, 0);
+}
+
+void SharedChunkRing::_wake(volatile quint32& word)
+{
+    syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+}
+
+char* SharedChunkRing::acquire(int timeoutMs)
+{
+    quint64 head = _header->head;
+    Deadline deadline(waitMs(timeoutMs));
+    for( ;; ) {
+        // The futex is read before the tail, so a release() after the tail
+        // is read changes it.
+        quint32 released = __sync_fetch_and_add(&_header->released, 0);
+        if( head - _load(_header->tail) < _header->nSlots ) break;
+        unsigned long ms = timeoutMs == 0 ? 0 : deadline.remaining();
+        if( ms == 0 ) return 0;
+        _wait(_header->released, released, ms);
+    }
+    return _data(head);
+}
+
+quint64 SharedChunkRing::publish(size_t bytes)
+{
+    quint64 head = _header->head;
+    quint64 sequence = _header->sequence;
+    Slot* slot = _slot(head);
+    slot->sequence = sequence;
+    slot->bytes = bytes < _header->slotSize ? bytes : _header->slotSize;
+    _header->sequence = sequence + 1;
+    _store(_header->head, head + 1);
+    __sync_fetch_and_add(&_header->published, 1);
+    _wake(_header->published);
+    return sequence;
+}
+
+void SharedChunkRing::skip()
+{
+    _header->sequence = _header->sequence + 1;
+    _store(_header->skipped, _header->skipped + 1);
+}
+
+const char* SharedChunkRing::next(size_t& bytes, quint64& sequence, int timeoutMs)
+{
+    quint64 tail = _header->tail;
+    Deadline deadline(waitMs(timeoutMs));
+    for( ;; ) {
+        quint32 published = __sync_fetch_and_add(&_header->published, 0);
+        if( _load(_header->head) != tail ) break;
+        unsigned long ms = timeoutMs == 0 || _header->closed ? 0 : deadline.remaining();
+        if( ms == 0 ) return 0;
+        _wait(_header->published, published, ms);
+    }
+    const Slot* slot = _slot(tail);
+    bytes = slot->bytes;
+    sequence = slot->sequence;
+    return _data(tail);
+}
+
+void SharedChunkRing::release()
+{
+    _store(_header->tail, _header->tail + 1);
+    __sync_fetch_and_add(&_header->released, 1);
+    _wake(_header->released);
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -1,6 +1,7 @@
 #include "SpectrumDataSet.h"
 #include "SigprocStokesWriter.h"
 #include "time.h"
+#include <vector>
 #include <iomanip>
 #include <cmath>
 #include <string>
@@ -199,13 +200,23 @@ void SigprocStokesWriter::sendStream(const QString& /*streamName*/, const DataBl
         unsigned nChannels = stokes->nChannels();
         unsigned nPolarisations = stokes->nPolarisations();
         float const * data = stokes->data();
+        // a chunk with fewer polarisations than the header (Stokes I only,
+        // when the pipeline is shedding load) is padded with zeros
+        float zero = 0.0f;
 
         switch (_nBits) {
             case 32: {
+                    std::vector<float> zeros;
+                    if (nPolarisations < _nPols) zeros.resize(nSubbands * nChannels, zero);
                     for (unsigned t = 0; t < nSamples; ++t)
                     {
                         for (unsigned p = 0; p < _nPols; ++p)
                         {
+                            if (p >= nPolarisations)
+                            {
+                                _file.write(reinterpret_cast<const char*>(&zeros[0]), zeros.size() * sizeof(float));
+                                continue;
+                            }
                             for (int s = nSubbands - 1; s >= 0 ; --s)
                             {
                                 long index = stokes->index(s, nSubbands, p, nPolarisations, t, nChannels );
@@ -219,10 +230,21 @@ void SigprocStokesWriter::sendStream(const QString& /*streamName*/, const DataBl
                 }
                 break;
             case 8:{
+                    std::vector<char> zeros;
+                    if (nPolarisations < _nPols) {
+                        int ci;
+                        _float2int(&zero, &ci);
+                        zeros.resize(nSubbands * nChannels, (char)ci);
+                    }
                     for (unsigned t = 0; t < nSamples; ++t)
                     {
                         for (unsigned p = 0; p < _nPols; ++p)
                         {
+                            if (p >= nPolarisations)
+                            {
+                                _file.write(&zeros[0], zeros.size());
+                                continue;
+                            }
                             for (int s = nSubbands - 1; s >= 0 ; --s)
                             {
                                 long index = stokes->index(s, nSubbands, p, nPolarisations, t, nChannels );
@@ -45,11 +45,12 @@ void SpectrumDataSetC32::write(const QString& fileName, int s, int p, int b) con
 
                 // Get a pointer the the spectrum.
                 data = spectrumData(b, s, p);
+                unsigned stride = channelStride();
 
                 for (unsigned c = 0; c < nChan; ++c)
                 {
-                    out << QString::number(data[c].real(), 'g', 8) << " ";
-                    out << QString::number(data[c].imag(), 'g', 8) << endl;
+                    out << QString::number(data[c * stride].real(), 'g', 8) << " ";
+                    out << QString::number(data[c * stride].imag(), 'g', 8) << endl;
                 }
 
                 out << endl;
@@ -100,8 +101,23 @@ void SpectrumDataSetC32::serialise(QIODevice& out) const
     out.write((char*)&blockRate, sizeof(double));
     out.write((char*)&timeStamp, sizeof(double));
 
-    // Write the data.
-    out.write((char*)&_data[0], sizeof(std::complex<float>) * _data.size());
+    // Write the data (always in PolarisationBlocks order).
+    if (_layout == PolarisationBlocks) {
+        out.write((char*)&_data[0], sizeof(std::complex<float>) * _data.size());
+    }
+    else {
+        std::vector<std::complex<float> > spectrum(nChan);
+        for (unsigned b = 0; b < nBlocks; ++b) {
+            for (unsigned s = 0; s < nSubs; ++s) {
+                for (unsigned p = 0; p < nPols; ++p) {
+                    for (unsigned c = 0; c < nChan; ++c)
+                        spectrum[c] = sample(b, s, p, c);
+                    out.write((char*)&spectrum[0],
+                            sizeof(std::complex<float>) * nChan);
+                }
+            }
+        }
+    }
 }
 
 
@@ -134,6 +150,7 @@ void SpectrumDataSetC32::deserialise(QIODevice& in, QSysInfo::Endian endian)
 
     // read the data
     resize(nBlocks, nSubs, nPols, nChan);
+    setLayout(PolarisationBlocks);
     in.read((char*)&_data[0], sizeof(std::complex<float>) * _data.size());
 }
 
@@ -0,0 +1,254 @@
+#include "StageGraph.h"
+#include "pelican/utility/ConfigNode.h"
+#include <QtCore/QMutexLocker>
+#include <QtCore/QStringList>
+#include <iostream>
+#include <exception>
+
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ *@details StageGraph
+ */
+StageGraph::StageGraph( const QString& name )
+    : _name(name), _async(true), _started(false), _inFlight(name + ".inFlight")
+{
+}
+
+/**
+ *@details
+ */
+StageGraph::~StageGraph()
+{
+    waitForCompletion();
+    foreach( Stage* stage, _stages ) {
+        stage->stop();
+    }
+    foreach( Stage* stage, _stages ) {
+        delete stage;
+    }
+}
+
+void StageGraph::addStage( const QString& name, const TaskT& task,
+                           unsigned threads, unsigned queueDepth )
+{
+    if( _started )
+        throw QString("StageGraph %1: cannot add stage \"%2\" once running").arg(_name).arg(name);
+    _stages.append( new Stage( this, _stages.size(), _name, name, task, threads, queueDepth ) );
+}
+
+StageGraph::Stage* StageGraph::_stage( const QString& name ) const
+{
+    foreach( Stage* stage, _stages ) {
+        if( stage->name() == name ) return stage;
+    }
+    return 0;
+}
+
+void StageGraph::setStage( const QString& name, unsigned threads, unsigned queueDepth )
+{
+    Stage* stage = _stage( name );
+    if( ! stage )
+        throw QString("StageGraph %1: unknown stage \"%2\"").arg(_name).arg(name);
+    if( _started )
+        throw QString("StageGraph %1: cannot change stage \"%2\" once running").arg(_name).arg(name);
+    stage->setThreads( threads );
+    stage->setQueueDepth( queueDepth );
+}
+
+void StageGraph::configure( const ConfigNode& config )
+{
+    setAsync( config.getOption("stages", "async", "true") == "true" );
+    QStringList names = config.getOptionList("stage", "name");
+    QStringList threads = config.getOptionList("stage", "threads");
+    QStringList depths = config.getOptionList("stage", "queueDepth");
+    for( int i = 0; i < names.size(); ++i ) {
+        Stage* stage = _stage( names[i] );
+        if( ! stage ) {
+            std::cerr << "StageGraph " << _name.toStdString()
+                      << ": ignoring unknown stage \"" << names[i].toStdString()
+                      << "\"" << std::endl;
+            continue;
+        }
+        // missing attributes leave the stage's defaults
+        unsigned t = stage->threads();
+        unsigned d = stage->queueDepth();
+        if( i < threads.size() && ! threads[i].isEmpty() ) t = threads[i].toUInt();
+        if( i < depths.size() && ! depths[i].isEmpty() ) d = depths[i].toUInt();
+        setStage( names[i], t, d );
+    }
+}
+
+void StageGraph::setAsync( bool async )
+{
+    if( _started && ! async )
+        throw QString("StageGraph %1: cannot run synchronously once started").arg(_name);
+    _async = async;
+}
+
+int StageGraph::capacity() const
+{
+    if( ! _async ) return 1;
+    int n = 0;
+    foreach( const Stage* stage, _stages ) {
+        n += stage->threads() + stage->queueDepth();
+    }
+    return n;
+}
+
+void StageGraph::_start()
+{
+    _started = true;
+    foreach( Stage* stage, _stages ) {
+        stage->start();
+    }
+}
+
+void StageGraph::push( DataBlob* blob )
+{
+    _inFlight.add();
+    if( ! _async || _stages.isEmpty() ) {
+        for( int i = 0; i < _stages.size() && _run( i, blob ); ++i ) {}
+        _complete( blob );
+        return;
+    }
+    if( ! _started ) _start();
+    _stages[0]->put( blob );
+}
+
+void StageGraph::setBudget( double seconds )
+{
+    foreach( Stage* stage, _stages ) {
+        stage->profile.setBudget( seconds );
+    }
+}
+
+bool StageGraph::_run( int index, DataBlob* blob )
+{
+    Stage* stage = _stages[index];
+    QString error;
+    try {
+        MetricTimer timer( stage->time );
+        ProfileTimer profile( stage->profile );
+        stage->task()( blob );
+        return true;
+    }
+    catch( const QString& e ) {
+        error = e;
+    }
+    catch( const std::exception& e ) {
+        error = e.what();
+    }
+    catch( ... ) {
+        error = "unknown error";
+    }
+    stage->errors.add();
+    std::cerr << "StageGraph " << _name.toStdString() << ": stage "
+              << stage->name().toStdString() << " failed: "
+              << error.toStdString() << std::endl;
+    foreach( const FailureT& fn, _failure ) {
+        fn( blob, stage->name() );
+    }
+    return false;
+}
+
+void StageGraph::_complete( DataBlob* blob )
+{
+    foreach( const TaskT& fn, _completion ) {
+        fn( blob );
+    }
+    _inFlight.done();
+}
+
+bool StageGraph::waitForCompletion( unsigned long timeout ) const
+{
+    return _inFlight.wait( timeout );
+}
+
+// -----------------------------------------------------------------------------
+// StageGraph::Stage
+//
+
+StageGraph::Stage::Stage( StageGraph* graph, int index, const QString& graphName,
+                          const QString& name, const TaskT& task,
+                          unsigned threads, unsigned queueDepth )
+    : time(MetricsRegistry::instance().histogram(graphName + "." + name)),
+      profile(MetricsRegistry::instance().profile(graphName + "." + name)),
+      errors(MetricsRegistry::instance().counter(graphName + "." + name + ".errors")),
+      _graph(graph), _index(index), _name(name), _task(task), _halt(false),
+      _queued(MetricsRegistry::instance().gauge(graphName + "." + name + ".queued"))
+{
+    setThreads( threads );
+    setQueueDepth( queueDepth );
+}
+
+StageGraph::Stage::~Stage()
+{
+    stop();
+    foreach( Worker* worker, _workers ) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+void StageGraph::Stage::start()
+{
+    for( unsigned i = 0; i < _threads; ++i ) {
+        Worker* worker = new Worker( _graph, this, _index );
+        _workers.append( worker );
+        worker->start();
+    }
+}
+
+void StageGraph::Stage::stop()
+{
+    QMutexLocker lock(&_mutex);
+    _halt = true;
+    _notEmpty.wakeAll();
+    _notFull.wakeAll();
+}
+
+void StageGraph::Stage::put( DataBlob* blob )
+{
+    QMutexLocker lock(&_mutex);
+    while( (unsigned)_queue.size() >= _queueDepth && ! _halt ) {
+        _notFull.wait(&_mutex);
+    }
+    _queue.append( blob );
+    _queued.set( _queue.size() );
+    _notEmpty.wakeOne();
+}
+
+DataBlob* StageGraph::Stage::take()
+{
+    QMutexLocker lock(&_mutex);
+    while( _queue.isEmpty() && ! _halt ) {
+        _notEmpty.wait(&_mutex);
+    }
+    if( _queue.isEmpty() ) return 0;
+    DataBlob* blob = _queue.takeFirst();
+    _queued.set( _queue.size() );
+    _notFull.wakeOne();
+    return blob;
+}
+
+// -----------------------------------------------------------------------------
+// StageGraph::Worker
+//
+
+void StageGraph::Worker::run()
+{
+    while( DataBlob* blob = _stage->take() ) {
+        // a blob that failed goes no further
+        if( _graph->_run( _index, blob ) && _index + 1 < _graph->_stages.size() )
+            _graph->_stages[_index + 1]->put( blob );
+        else
+            _graph->_complete( blob );
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
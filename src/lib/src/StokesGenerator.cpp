@@ -1,5 +1,6 @@
 #include "StokesGenerator.h"
 #include "SpectrumDataSet.h"
+#include "ChannelKernels.h"
 
 #include "pelican/utility/ConfigNode.h"
 
@@ -15,7 +16,7 @@ namespace ampp {
 
 ///
 StokesGenerator::StokesGenerator(const ConfigNode& config)
-: AbstractModule(config)
+: AbstractModule(config), _stokesIOnly(false)
 {
   // Get the number of Stokes to produce, which can either be 1 or 4
   _numberOfStokes = config.getOption("numberOfStokes", "value", "4").toUInt();
@@ -48,60 +49,63 @@ void StokesGenerator::run(const SpectrumDataSetC32* channeliserOutput,
   
   stokes->setLofarTimestamp(channeliserOutput->getLofarTimestamp());
   stokes->setBlockRate(channeliserOutput->getBlockRate());
-  stokes->resize(nSamples, nSubbands, _numberOfStokes, nChannels);
+  unsigned nStokes = _stokesIOnly ? 1 : _numberOfStokes;
+  stokes->resize(nSamples, nSubbands, nStokes, nChannels);
   
   const Complex* dataPolDataBlock = channeliserOutput->data();
 
+  if (channeliserOutput->layout() == SpectrumDataSetC32::PolarisationInterleaved) {
+    // X and Y are adjacent per channel, so each (t, s) spectrum is read in a
+    // single sequential pass.
+    Q_ASSERT( channeliserOutput->nPolarisations() == 2 );
+    InterleavedStokesKernel<RuntimeChannels>::Function stokesKernel =
+        ChannelKernels::select<InterleavedStokesKernel>(nChannels);
+    InterleavedStokesIKernel<RuntimeChannels>::Function stokesIKernel =
+        ChannelKernels::select<InterleavedStokesIKernel>(nChannels);
+
+    for (unsigned t = 0; t < nSamples; ++t) {
+#pragma omp parallel for num_threads(4)
+      for (unsigned s = 0; s < nSubbands; ++s) {
+        const Complex* dataPolXY = channeliserOutput->spectrumData(t, s, 0);
+        if (nStokes == 4){
+          stokesKernel(dataPolXY,
+                       stokes->spectrumData(t, s, 0), stokes->spectrumData(t, s, 1),
+                       stokes->spectrumData(t, s, 2), stokes->spectrumData(t, s, 3),
+                       nChannels);
+        }
+        else {
+          stokesIKernel(dataPolXY, stokes->spectrumData(t, s, 0), nChannels);
+        }
+      }
+    }
+    return;
+  }
+
+  // Select the channel loop kernels for this channel count once per call.
+  StokesKernel<RuntimeChannels>::Function stokesKernel =
+      ChannelKernels::select<StokesKernel>(nChannels);
+  StokesIKernel<RuntimeChannels>::Function stokesIKernel =
+      ChannelKernels::select<StokesIKernel>(nChannels);
+
   for (unsigned t = 0; t < nSamples; ++t) {
 #pragma omp parallel for num_threads(4)
     for (unsigned s = 0; s < nSubbands; ++s) {
-      const Complex* dataPolX, *dataPolY;
-      float *I, *Q, *U, *V;
-      float powerX, powerY;
-      float XxYstarReal;
-      float XxYstarImag;
-      
       unsigned dataPolIndexX = channeliserOutput->index( s, nSubbands, 
                                                          0,2,
                                                          t, nChannels);
       unsigned dataPolIndexY = channeliserOutput->index( s, nSubbands, 
                                                          1,2,
                                                          t, nChannels);
-      //unsigned indexStokes = stokes->index( s, nSubbands,
-      //                                      0,2,
-      //                                      t, nChannels );
-      //dataPolX = channeliserOutput->spectrumData(t, s, 0);
-      //dataPolY = channeliserOutput->spectrumData(t, s, 1);
-      dataPolX = &dataPolDataBlock[dataPolIndexX];
-      dataPolY = &dataPolDataBlock[dataPolIndexY];
-      // TODO speed up
-      I = stokes->spectrumData(t, s, 0);
-      if (_numberOfStokes == 4){
-        Q = stokes->spectrumData(t, s, 1);
-        U = stokes->spectrumData(t, s, 2);
-        V = stokes->spectrumData(t, s, 3);
+      const Complex* dataPolX = &dataPolDataBlock[dataPolIndexX];
+      const Complex* dataPolY = &dataPolDataBlock[dataPolIndexY];
+      if (nStokes == 4){
+        stokesKernel(dataPolX, dataPolY,
+                     stokes->spectrumData(t, s, 0), stokes->spectrumData(t, s, 1),
+                     stokes->spectrumData(t, s, 2), stokes->spectrumData(t, s, 3),
+                     nChannels);
       }
-      //std::cout << "nSamples=" << nSamples << " t=" << t << " s=" << s;
-      //std::cout << "  dataPolIndexX=" << dataPolIndexX;
-      //std::cout << "  dataPolIndexY=" << dataPolIndexY << std::endl;
-      // std::cout << I << " "<< Q <<" "<< U << " "<< V <<std::endl;
-      for (unsigned c = 0; c < nChannels; ++c) {
-        float Xr = dataPolX[c].real();
-        float Xi = dataPolX[c].imag();
-        float Yr = dataPolY[c].real();
-        float Yi = dataPolY[c].imag();
-        XxYstarReal = Xr*Yr + Xi*Yi;
-        XxYstarImag = Xi*Yr - Xr*Yi;
-        
-        powerX = _sqr(Xr) + _sqr(Xi);
-        powerY = _sqr(Yr) + _sqr(Yi);
-        
-        I[c] = powerX + powerY;
-        if (_numberOfStokes == 4){
-          Q[c] = powerX - powerY;
-          U[c] = 2.0f * XxYstarReal;
-          V[c] = 2.0f * XxYstarImag;
-        }
+      else {
+        stokesIKernel(dataPolX, dataPolY, stokes->spectrumData(t, s, 0), nChannels);
       }
     }
   }
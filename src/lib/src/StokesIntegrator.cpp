@@ -1,5 +1,6 @@
 #include "StokesIntegrator.h"
 #include "SpectrumDataSet.h"
+#include "ChannelKernels.h"
 
 #include "pelican/utility/pelicanTimer.h"
 #include "pelican/utility/ConfigNode.h"
@@ -91,8 +92,9 @@ void StokesIntegrator::run(const SpectrumDataSetStokes* stokesGeneratorOutput,
         timeStart=timeStart+_windowSize;
     }
     */
+    IntegrateKernel<RuntimeChannels>::Function integrate =
+        ChannelKernels::select<IntegrateKernel>(nChannels);
     unsigned timeStart=0;
-    unsigned channelStart=0;
 
     for (unsigned u = 0; u < newSamples; ++u) {
       for (unsigned t = timeStart; t < _windowSize+timeStart; ++t) {
@@ -100,13 +102,7 @@ void StokesIntegrator::run(const SpectrumDataSetStokes* stokesGeneratorOutput,
 	  for (unsigned p = 0; p < nPols; ++p) {
 	    value = stokesGeneratorOutput->spectrumData(t, s, p);
 	    float* timeBuffer = intStokes->spectrumData(u,s,p);
-	    channelStart = 0;
-	    for (unsigned nc = 0; nc < newChannels; ++nc){
-	      for (unsigned c = channelStart; c < channelStart + _binChannels; ++c){
-		timeBuffer[nc]+= value[c];
-	      }
-	      channelStart += _binChannels;
-	    }
+	    integrate(value, timeBuffer, nChannels, _binChannels);
 	  }
 	}
       }
@@ -0,0 +1,42 @@
+#include "StreamChunk.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QString>
+
+
+namespace pelican {
+
+namespace ampp {
+
+
+const char* StreamChunk::map(QIODevice* device, size_t bytes,
+                             std::vector<char>& buffer)
+{
+    QBuffer* memory = qobject_cast<QBuffer*>(device);
+    if( memory && memory->pos() + (qint64)bytes <= memory->size() ) {
+        const char* chunk = memory->buffer().constData() + memory->pos();
+        memory->seek(memory->pos() + bytes);
+        return chunk;
+    }
+
+    buffer.resize(bytes);
+    size_t bytesRead = 0;
+    while( bytesRead < bytes ) {
+        qint64 n = device->read(&buffer[bytesRead], bytes - bytesRead);
+        if( n > 0 ) {
+            bytesRead += n;
+            continue;
+        }
+        // nothing to wait for at the end of a file, or once a stream has
+        // closed or failed
+        if( n < 0 || ( ! device->isSequential() && device->atEnd() )
+            || ! device->waitForReadyRead(-1) ) {
+            throw QString("StreamChunk: device ended %1 bytes into a %2 byte chunk")
+                    .arg(bytesRead).arg(bytes);
+        }
+    }
+    return bytes ? &buffer[0] : 0;
+}
+
+} // namespace ampp
+} // namespace pelican
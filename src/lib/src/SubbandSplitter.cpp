@@ -0,0 +1,70 @@
+#include "SubbandSplitter.h"
+
+#include <QtCore/QString>
+#include <cstring>
+
+
+namespace pelican {
+
+namespace ampp {
+
+
+/**
+ *@details SubbandSplitter
+ */
+SubbandSplitter::SubbandSplitter(unsigned nSubbands, unsigned subbandBytes)
+    : _nSubbands(nSubbands), _subbandBytes(subbandBytes)
+{
+    if( inputPacketSize() > sizeof(UDPPacket) )
+        throw QString("SubbandSplitter: %1 sub-bands do not fit in a UDP packet")
+                .arg(nSubbands);
+}
+
+/**
+ *@details
+ */
+SubbandSplitter::~SubbandSplitter()
+{
+}
+
+unsigned SubbandSplitter::addStream(unsigned start, unsigned end)
+{
+    if( start > end || end >= _nSubbands )
+        throw QString("SubbandSplitter: sub-band range %1-%2 outside 0-%3")
+                .arg(start).arg(end).arg(_nSubbands - 1);
+    Range range;
+    range.nSubbands = end - start + 1;
+    range.offset = (size_t)start * _subbandBytes;
+    range.bytes = (size_t)range.nSubbands * _subbandBytes;
+    _ranges.push_back(range);
+    return _ranges.size() - 1;
+}
+
+void SubbandSplitter::scatter(const UDPPacket& packet, char* const* outputs,
+                              unsigned slot) const
+{
+    for( unsigned s = 0; s < _ranges.size(); ++s ) {
+        const Range& range = _ranges[s];
+        char* out = outputs[s] + (size_t)slot * (_headerSize + range.bytes);
+        UDPPacket::Header* header = reinterpret_cast<UDPPacket::Header*>(out);
+        *header = packet.header;
+        header->nrBeamlets = range.nSubbands;
+        std::memcpy(out + _headerSize, packet.data + range.offset, range.bytes);
+    }
+}
+
+void SubbandSplitter::fill(const UDPPacket::Header& header, char* const* outputs,
+                           unsigned slot) const
+{
+    for( unsigned s = 0; s < _ranges.size(); ++s ) {
+        const Range& range = _ranges[s];
+        char* out = outputs[s] + (size_t)slot * (_headerSize + range.bytes);
+        UDPPacket::Header* empty = reinterpret_cast<UDPPacket::Header*>(out);
+        *empty = header;
+        empty->nrBeamlets = range.nSubbands;
+        std::memset(out + _headerSize, 0, range.bytes);
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
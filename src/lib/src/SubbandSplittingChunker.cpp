@@ -0,0 +1,229 @@
+#include "SubbandSplittingChunker.h"
+
+#include "LofarTypes.h"
+
+#include <QtNetwork/QUdpSocket>
+#include <QtCore/QStringList>
+
+#include <iostream>
+#include <vector>
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+namespace pelican {
+namespace ampp {
+
+/**
+ * @details
+ * Constructor
+ *
+ * XML options.
+ * ================================
+ *
+ * Read from base class:
+ *  - data (type)  LIST.
+ *  - connection (host, port)
+ *
+ * Class Specific options:
+ *  - stream (subbandStart, subbandEnd) LIST, one per data type.
+ *  - samplesPerPacket (value)
+ *  - subbandsPerPacket (value)
+ *  - nRawPolarisations (value)
+ *
+ *  - udpPacketsPerIteration (value)
+ *  - clock (value)
+ *  - dataBitSize (value)
+ */
+SubbandSplittingChunker::SubbandSplittingChunker(const ConfigNode& config)
+: AbstractChunker(config), _splitter(0), _capture(config),
+  _metrics(QString("SubbandSplittingChunker.") + QString::number(port()))
+{
+    // Check the configuration type matches the class name.
+    if (config.type() != "SubbandSplittingChunker")
+        throw _err("SubbandSplittingChunker(): "
+                "Invalid or missing XML configuration.");
+
+    // Packet dimensions.
+    _nSamples = config.getOption("samplesPerPacket", "value").toUInt();
+    unsigned nSubbands = config.getOption("subbandsPerPacket", "value").toUInt();
+    unsigned nPolarisations = config.getOption("nRawPolarisations", "value").toUInt();
+    unsigned sampleBits = config.getOption("dataBitSize", "value").toUInt();
+    // Number of UDP packets collected into one chunk (iteration of the pipeline).
+    _nPackets = config.getOption("udpPacketsPerIteration", "value").toUInt();
+    // Clock => sample rate.
+    _clock = config.getOption("clock", "value").toUInt();
+
+    if (sampleBits != 4 && sampleBits != 8 && sampleBits != 16)
+        throw _err("SubbandSplittingChunker(): "
+                "Unsupported number of data bits.");
+    unsigned subbandBytes = _nSamples * nPolarisations * sampleBits * 2 / 8;
+
+    // The streams, in the order of the data types they are written to.
+    QStringList starts = config.getOptionList("stream", "subbandStart");
+    QStringList ends = config.getOptionList("stream", "subbandEnd");
+    if (chunkTypes().isEmpty())
+        throw _err("SubbandSplittingChunker(): Data type unspecified.");
+    if (starts.size() != chunkTypes().size() || ends.size() != starts.size())
+        throw _err("SubbandSplittingChunker(): "
+                "Expecting one stream (subbandStart, subbandEnd) per data type.");
+
+    _splitter = new SubbandSplitter(nSubbands, subbandBytes);
+    for (int s = 0; s < starts.size(); ++s)
+        _splitter->addStream(starts[s].toUInt(), ends[s].toUInt());
+
+    _startTime = _startBlockid = 0;
+}
+
+
+/**
+ * @details
+ * Destructor
+ */
+SubbandSplittingChunker::~SubbandSplittingChunker()
+{
+    delete _splitter;
+}
+
+
+/**
+ * @details
+ * Constructs a new QIODevice (in this case a QUdpSocket) and returns it
+ * after binding the socket to the port specified in the XML node and read by
+ * the constructor of the abstract chunker.
+ */
+QIODevice* SubbandSplittingChunker::newDevice()
+{
+    // With packet capture enabled a dedicated thread receives the packets
+    // into a ring which next() consumes.
+    if (_capture.enabled()) {
+        PacketCaptureDevice* capture =
+                new PacketCaptureDevice(_capture, _splitter->inputPacketSize());
+        if (!capture->bind(QString(), port()))
+            cerr << "SubbandSplittingChunker::newDevice(): "
+                 << capture->bindError().toStdString() << endl;
+        return capture;
+    }
+
+    QUdpSocket* socket = new QUdpSocket;
+    if (!socket->bind(port(), QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint))
+        cerr << "SubbandSplittingChunker::newDevice(): "
+        "Unable to bind to UDP port!" <<
+        socket->errorString().toStdString() << std::endl;
+
+    return socket;
+}
+
+
+/**
+ * @details
+ * Gets the next chunk of data from the UDP socket, writing one chunk for
+ * each stream.
+ */
+void SubbandSplittingChunker::next(QIODevice* device)
+{
+    // Re-arm the packet capture notification (if capturing).
+    PacketCaptureDevice::acknowledge(device);
+
+    unsigned nStreams = _splitter->streams();
+    unsigned prevSeqid = _startTime;
+    unsigned prevBlockid = _startBlockid;
+    unsigned packetSize = _splitter->inputPacketSize();
+    UDPPacket currPacket;
+
+    std::vector<WritableData> writableData(nStreams);
+    std::vector<char*> chunks(nStreams);
+    bool valid = true;
+    for (unsigned s = 0; s < nStreams; ++s) {
+        writableData[s] = getDataStorage(_nPackets * _splitter->packetSize(s),
+                chunkTypes().at(s));
+        valid = valid && writableData[s].isValid();
+        chunks[s] = static_cast<char*>(writableData[s].ptr());
+    }
+
+    if (!valid) {
+        // Must discard the datagram if there is no available space.
+        if (!isActive()) return;
+        PacketCaptureDevice::discardDatagram(device);
+        _metrics.packetsDiscarded.add();
+        cout << "SubbandSplittingChunker::next(): "
+                "Writable data not valid, discarding packets." << endl;
+        return;
+    }
+
+    unsigned seqid, blockid, totBlocks, lostPackets, diff;
+
+    // Loop over the number of UDP packets to put in a chunk.
+    for (unsigned i = 0; i < _nPackets; ) {
+        // Chunker sanity check.
+        if (!isActive()) return;
+
+        // Wait for datagram to be available and read it (from the socket or
+        // the capture ring).
+        if (PacketCaptureDevice::receiveDatagram(device,
+                reinterpret_cast<char*>(&currPacket), packetSize) <= 0) {
+            cerr << "SubbandSplittingChunker::next(): "
+                    "Error while receiving UDP Packet!" << endl;
+            continue;
+        }
+
+        seqid   = currPacket.header.timestamp;
+        blockid = currPacket.header.blockSequenceNumber;
+
+        // First packet ever received, initialise startTime and startBlockId.
+        bool initial = _startTime == 0;
+        if (initial) {
+            prevSeqid = _startTime = seqid;
+            prevBlockid = _startBlockid = blockid;
+        }
+
+        // Sanity check in seqid. If the seconds counter is 0xFFFFFFFF,
+        // the data cannot be trusted (ignore).
+        if (seqid == ~0U || prevSeqid + 10 < seqid) {
+            _metrics.packetsRejected.add();
+            continue;
+        }
+
+        // Check that the packets are contiguous (see LofarDataSplittingChunker).
+        totBlocks = (_clock == 160) ?
+                156250 : (prevSeqid % 2 == 0 ? 195313 : 195312);
+        diff = (blockid >= prevBlockid) ?
+                (blockid - prevBlockid) : (blockid + totBlocks - prevBlockid);
+
+        // Duplicated packets... ignore
+        if (diff < _nSamples && !initial) {
+            _metrics.packetsDuplicated.add();
+            continue;
+        }
+        lostPackets = (diff > _nSamples) ? (diff / _nSamples) - 1 : 0;
+
+        // Write empty packets for the ones missing to every stream.
+        UDPPacket::Header empty = currPacket.header;
+        for (; lostPackets > 0 && i < _nPackets; --lostPackets, ++i) {
+            prevSeqid = (prevBlockid + _nSamples < totBlocks) ?
+                    prevSeqid : prevSeqid + 1;
+            prevBlockid = (prevBlockid + _nSamples) % totBlocks;
+            empty.timestamp = prevSeqid;
+            empty.blockSequenceNumber = prevBlockid;
+            _splitter->fill(empty, &chunks[0], i);
+            _metrics.packetsLost.add();
+        }
+
+        // Scatter the received packet into the streams.
+        if (i < _nPackets) {
+            _splitter->scatter(currPacket, &chunks[0], i++);
+            _metrics.packetsAccepted.add();
+            prevSeqid = seqid;
+            prevBlockid = blockid;
+        }
+    }
+    _metrics.chunks.add();
+
+    // Update _startTime
+    _startTime = prevSeqid;
+    _startBlockid = prevBlockid;
+}
+
+} // namespace ampp
+} // namespace pelican
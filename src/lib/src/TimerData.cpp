@@ -10,7 +10,8 @@ namespace ampp {
 /**
  *@details TimerData 
  */
-TimerData::TimerData( const std::string name ) : _name(name) {
+TimerData::TimerData( const std::string name )
+    : _name(name), _histogram(0), _profile(0), _running(false) {
    reset();
 }
 
@@ -19,7 +20,6 @@ TimerData::TimerData( const std::string name ) : _name(name) {
  */
 TimerData::~TimerData()
 {
-     if( _name != "" ) report(_name.c_str());
 }
 
 void TimerData::reset() {
@@ -29,6 +29,23 @@ void TimerData::reset() {
     timeMin = DBL_MAX;
     timeMax = -DBL_MAX;
     timeAverage = 0.0;
+    _running = false;
+}
+
+MetricHistogram* TimerData::histogram()
+{
+    // looked up on first use, not when static timers are constructed
+    if( ! _histogram && _name != "" )
+        _histogram = &MetricsRegistry::instance().histogram( QString::fromStdString(_name) );
+    return _histogram;
+}
+
+MetricProfile* TimerData::profile()
+{
+    // looked up on first use, not when static timers are constructed
+    if( ! _profile && _name != "" )
+        _profile = &MetricsRegistry::instance().profile( QString::fromStdString(_name) );
+    return _profile;
 }
 
 } // namespace ampp
@@ -0,0 +1,162 @@
+#include "UdpBatchReceiver.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <errno.h>
+#include <cstring>
+
+#ifndef __linux__
+// recvmmsg() is Linux specific: provide the message header it uses so the
+// fallback path below can share the same bookkeeping.
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif
+
+namespace pelican {
+
+namespace ampp {
+
+
+/**
+ *@details UdpBatchReceiver
+ */
+UdpBatchReceiver::UdpBatchReceiver(unsigned maxBatch)
+    : _maxBatch(maxBatch ? maxBatch : 1), _slotSize(0), _packetSize(0),
+      _msgs(0), _iovecs(0)
+{
+    _msgs = new mmsghdr[_maxBatch];
+    _lengths.resize(_maxBatch, 0);
+}
+
+/**
+ *@details
+ */
+UdpBatchReceiver::~UdpBatchReceiver()
+{
+    delete [] _msgs;
+    delete [] _iovecs;
+}
+
+void UdpBatchReceiver::addSegment(unsigned length, bool keep)
+{
+    if( length == 0 ) return;
+    Segment seg;
+    seg.length = length;
+    seg.keep = keep;
+    _segments.push_back(seg);
+    _packetSize += length;
+    if( keep ) {
+        _slotSize += length;
+    }
+    else if( length > _discard.size() ) {
+        // Discarded segments of all datagrams share one scratch area.
+        _discard.resize(length);
+    }
+    delete [] _iovecs;
+    _iovecs = new iovec[_maxBatch * _segments.size()];
+}
+
+void UdpBatchReceiver::clearSegments()
+{
+    _segments.clear();
+    _slotSize = _packetSize = 0;
+}
+
+int UdpBatchReceiver::setReceiveBufferSize(int fd, int bytes)
+{
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    int granted = 0;
+    socklen_t len = sizeof(granted);
+    getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &granted, &len);
+    return granted;
+}
+
+bool UdpBatchReceiver::batched()
+{
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+int UdpBatchReceiver::receive(int fd, char* dest, unsigned maxPackets,
+                              int timeoutMs)
+{
+    unsigned n = (maxPackets < _maxBatch) ? maxPackets : _maxBatch;
+    if( n == 0 || _segments.empty() ) return 0;
+
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, timeoutMs);
+    if( ready <= 0 ) return (ready == 0 || errno == EINTR) ? 0 : -1;
+
+    // Describe where each segment of each datagram should go.
+    unsigned nSeg = _segments.size();
+    for( unsigned i = 0; i < n; ++i ) {
+        char* slot = dest + (size_t)i * _slotSize;
+        iovec* iov = _iovecs + i * nSeg;
+        for( unsigned s = 0; s < nSeg; ++s ) {
+            iov[s].iov_len = _segments[s].length;
+            if( _segments[s].keep ) {
+                iov[s].iov_base = slot;
+                slot += _segments[s].length;
+            }
+            else {
+                iov[s].iov_base = &_discard[0];
+            }
+        }
+        std::memset(&_msgs[i], 0, sizeof(mmsghdr));
+        _msgs[i].msg_hdr.msg_iov = iov;
+        _msgs[i].msg_hdr.msg_iovlen = nSeg;
+    }
+
+    int received = 0;
+#ifdef __linux__
+    // Return as soon as at least one datagram is available, taking whatever
+    // else is already queued up to the batch size. MSG_TRUNC has the full
+    // length of a datagram longer than the segments returned.
+    received = recvmmsg(fd, _msgs, n, MSG_WAITFORONE | MSG_TRUNC, 0);
+    if( received < 0 ) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+#else
+    for( ; received < (int)n; ++received ) {
+        ssize_t len = recvmsg(fd, &_msgs[received].msg_hdr,
+                              received ? MSG_DONTWAIT : 0);
+        if( len < 0 ) break;
+        _msgs[received].msg_len = len;
+    }
+#endif
+    for( int i = 0; i < received; ++i ) {
+        _lengths[i] = _msgs[i].msg_len;
+        // Where the full length is not available, still report a truncated
+        // datagram as too long.
+        if( (_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) && _lengths[i] <= _packetSize )
+            _lengths[i] = _packetSize + 1;
+    }
+    return received;
+}
+
+unsigned UdpBatchReceiver::gather(const char* packet, unsigned length,
+                                  char* slot) const
+{
+    unsigned offset = 0;
+    for( unsigned s = 0; s < _segments.size() && offset < length; ++s ) {
+        unsigned n = length - offset;
+        if( n > _segments[s].length ) n = _segments[s].length;
+        if( _segments[s].keep ) {
+            std::memcpy(slot, packet + offset, n);
+            slot += n;
+        }
+        offset += n;
+    }
+    return length;
+}
+
+} // namespace ampp
+} // namespace pelican
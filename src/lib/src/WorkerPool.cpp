@@ -0,0 +1,143 @@
+#include "WorkerPool.h"
+#include <QtCore/QMutexLocker>
+#include <iostream>
+#include <exception>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ *@details WorkerPool
+ */
+WorkerPool::WorkerPool( const QString& name, unsigned threads, unsigned queueDepth,
+                        QThread::Priority priority )
+    : _name(name), _queueDepth(queueDepth ? queueDepth : 1), _halt(false),
+      _queued(MetricsRegistry::instance().gauge(name + ".queued")),
+      _taskTime(MetricsRegistry::instance().histogram(name + ".task")),
+      _blocked(MetricsRegistry::instance().counter(name + ".blocked")),
+      _errors(MetricsRegistry::instance().counter(name + ".errors"))
+{
+    if( threads == 0 ) threads = 1;
+    // workers start with the nice value of this thread
+    errno = 0;
+    int nice = getpriority( PRIO_PROCESS, syscall(SYS_gettid) );
+    if( errno ) nice = 0;
+    nice = qMin( nice + niceIncrement( priority ), 19 );
+    for( unsigned i = 0; i < threads; ++i ) {
+        Worker* worker = new Worker( this, nice );
+        _workers.append( worker );
+        worker->start( priority );
+    }
+}
+
+/**
+ *@details
+ */
+WorkerPool::~WorkerPool()
+{
+    {
+        QMutexLocker lock(&_mutex);
+        _halt = true;
+        _notEmpty.wakeAll();
+    }
+    foreach( Worker* worker, _workers ) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+QThread::Priority WorkerPool::priority( const QString& name )
+{
+    if( name == "idle" ) return QThread::IdlePriority;
+    if( name == "normal" ) return QThread::NormalPriority;
+    if( name == "high" ) return QThread::HighPriority;
+    return QThread::LowPriority;
+}
+
+int WorkerPool::niceIncrement( QThread::Priority priority )
+{
+    switch( priority ) {
+        case QThread::IdlePriority:
+            return 19;
+        case QThread::LowestPriority:
+        case QThread::LowPriority:
+            return 10;
+        default:
+            return 0;
+    }
+}
+
+void WorkerPool::submit( const TaskT& task )
+{
+    QMutexLocker lock(&_mutex);
+    if( (unsigned)_queue.size() >= _queueDepth ) {
+        _blocked.add();
+        while( (unsigned)_queue.size() >= _queueDepth ) _notFull.wait(&_mutex);
+    }
+    _queue.append( task );
+    _queued.set( _queue.size() );
+    _notEmpty.wakeOne();
+}
+
+int WorkerPool::queued() const
+{
+    QMutexLocker lock(&_mutex);
+    return _queue.size();
+}
+
+bool WorkerPool::_take( TaskT& task )
+{
+    QMutexLocker lock(&_mutex);
+    // the queue is emptied before stopping
+    while( _queue.isEmpty() && ! _halt ) _notEmpty.wait(&_mutex);
+    if( _queue.isEmpty() ) return false;
+    task = _queue.takeFirst();
+    _queued.set( _queue.size() );
+    _notFull.wakeOne();
+    return true;
+}
+
+void WorkerPool::_run( const TaskT& task )
+{
+    try {
+        MetricTimer timer( _taskTime );
+        task();
+        return;
+    }
+    catch( const QString& e ) {
+        std::cerr << _name.toStdString() << ": " << e.toStdString() << std::endl;
+    }
+    catch( const std::exception& e ) {
+        std::cerr << _name.toStdString() << ": " << e.what() << std::endl;
+    }
+    catch( ... ) {
+        std::cerr << _name.toStdString() << ": unknown error in task" << std::endl;
+    }
+    _errors.add();
+}
+
+// -----------------------------------------------------------------------------
+// WorkerPool::Worker
+//
+
+void WorkerPool::Worker::run()
+{
+    // the nice value is per thread on Linux
+    if( setpriority( PRIO_PROCESS, syscall(SYS_gettid), _nice ) < 0 )
+        std::cerr << _pool->_name.toStdString() << ": unable to set nice value "
+                  << _nice << std::endl;
+    TaskT task;
+    while( _pool->_take( task ) ) {
+        _pool->_run( task );
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -33,6 +33,7 @@ class AdapterTimeSeriesDataSetTest : public CppUnit::TestFixture
         //CPPUNIT_TEST(test_checkDataFixedPacket);
         //CPPUNIT_TEST(test_checkDataVariablePacket);
         CPPUNIT_TEST(test_deserialise);
+        CPPUNIT_TEST(test_unpack);
         CPPUNIT_TEST(test_deserialise_timing);
         CPPUNIT_TEST_SUITE_END();
 
@@ -59,6 +60,10 @@ class AdapterTimeSeriesDataSetTest : public CppUnit::TestFixture
 
         void test_deserialise_timing();
 
+        /// Method to check the samples are unpacked into the right place
+        /// for each supported sample size.
+        void test_unpack();
+
     private:
         ConfigNode _configXml(const QString& fixedSizePackets,
                 unsigned dataBitSize, unsigned udpPacketsPerIteration,
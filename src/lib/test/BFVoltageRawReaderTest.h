@@ -0,0 +1,62 @@
+#ifndef BFVOLTAGERAWREADERTEST_H
+#define BFVOLTAGERAWREADERTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <QtCore/QStringList>
+
+/**
+ * @file BFVoltageRawReaderTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+namespace test {
+    class TestDir;
+}
+
+/**
+ * @class BFVoltageRawReaderTest
+ *
+ * @brief
+ *    Unit tests for the BFVoltageRawReader class
+ * @details
+ *
+ */
+
+class BFVoltageRawReaderTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( BFVoltageRawReaderTest );
+        CPPUNIT_TEST( test_read );
+        CPPUNIT_TEST( test_truncated );
+        CPPUNIT_TEST( test_files );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_read();
+        void test_truncated();
+        void test_files();
+
+    public:
+        BFVoltageRawReaderTest(  );
+        ~BFVoltageRawReaderTest();
+
+    private:
+        // write the component files as H5_LofarBFVoltageWriter does, with
+        // nBlocks[k] blocks in component k
+        QStringList _writeFiles( const unsigned* nBlocks );
+
+    private:
+        test::TestDir* _testDir;
+        unsigned _nSubbands;
+        unsigned _nChannels;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // BFVOLTAGERAWREADERTEST_H
@@ -0,0 +1,48 @@
+#ifndef BUFFERINGAGENTTEST_H
+#define BUFFERINGAGENTTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file BufferingAgentTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class BufferingAgentTest
+ *
+ * @brief
+ *    Unit test for the BufferingAgent class
+ * @details
+ *
+ */
+
+class BufferingAgentTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( BufferingAgentTest );
+        CPPUNIT_TEST( test_prefetch );
+        CPPUNIT_TEST( test_error );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_prefetch();
+        void test_error();
+
+    public:
+        BufferingAgentTest(  );
+        ~BufferingAgentTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // BUFFERINGAGENTTEST_H
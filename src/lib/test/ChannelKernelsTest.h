@@ -0,0 +1,60 @@
+#ifndef CHANNELKERNELSTEST_H
+#define CHANNELKERNELSTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file ChannelKernelsTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class ChannelKernelsTest
+ *  
+ * @brief
+ *    Unit test for the ChannelKernels registry
+ * @details
+ *    Checks the specialised kernels agree with the generic fallback
+ */
+
+class ChannelKernelsTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( ChannelKernelsTest );
+        CPPUNIT_TEST( test_select );
+        CPPUNIT_TEST( test_stokes );
+        CPPUNIT_TEST( test_power );
+        CPPUNIT_TEST( test_integrate );
+        CPPUNIT_TEST( test_transpose );
+        CPPUNIT_TEST( test_fir );
+        CPPUNIT_TEST( test_k7 );
+        CPPUNIT_TEST( test_ab );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_select();
+        void test_stokes();
+        void test_power();
+        void test_integrate();
+        void test_transpose();
+        void test_fir();
+        void test_k7();
+        void test_ab();
+
+    public:
+        ChannelKernelsTest(  );
+        ~ChannelKernelsTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // CHANNELKERNELSTEST_H 
@@ -0,0 +1,50 @@
+#ifndef COMPLETIONCOUNTERTEST_H
+#define COMPLETIONCOUNTERTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file CompletionCounterTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class CompletionCounterTest
+ *
+ * @brief
+ *    Unit test for the CompletionCounter class
+ * @details
+ *
+ */
+
+class CompletionCounterTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( CompletionCounterTest );
+        CPPUNIT_TEST( test_wait );
+        CPPUNIT_TEST( test_timeout );
+        CPPUNIT_TEST( test_chain );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_wait();
+        void test_timeout();
+        void test_chain();
+
+    public:
+        CompletionCounterTest(  );
+        ~CompletionCounterTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // COMPLETIONCOUNTERTEST_H
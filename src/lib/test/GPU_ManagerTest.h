@@ -27,6 +27,13 @@ class GPU_ManagerTest : public CppUnit::TestFixture
         CPPUNIT_TEST( test_submit );
         CPPUNIT_TEST( test_submitMultiCards );
         CPPUNIT_TEST( test_throw );
+        CPPUNIT_TEST( test_cpuResource );
+        CPPUNIT_TEST( test_heterogeneous );
+        CPPUNIT_TEST( test_priority );
+        CPPUNIT_TEST( test_queueDepth );
+        CPPUNIT_TEST( test_rejectedCleanUp );
+        CPPUNIT_TEST( test_phased );
+        CPPUNIT_TEST( test_cpuStaging );
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -37,6 +44,13 @@ class GPU_ManagerTest : public CppUnit::TestFixture
         void test_submit();
         void test_submitMultiCards();
         void test_throw();
+        void test_cpuResource();
+        void test_heterogeneous();
+        void test_priority();
+        void test_queueDepth();
+        void test_rejectedCleanUp();
+        void test_phased();
+        void test_cpuStaging();
 
         // test aids
         void callBackTest();
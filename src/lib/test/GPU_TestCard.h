@@ -5,6 +5,7 @@
 #include "GPU_Resource.h"
 #include <QWaitCondition>
 #include <QMutex>
+#include <QList>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 
@@ -22,20 +23,30 @@ namespace ampp {
  * @brief
  *    A dummy GPU_resource used for unit testing purposes
  * @details
- * 
+ *    Jobs block in compute until completeJob() is called. A phased card
+ *    records the jobs passing through its stage-in and stage-out phases,
+ *    which do not block.
  */
 
 class GPU_TestCard : public GPU_Resource
 {
     public:
-        GPU_TestCard( );
+        GPU_TestCard( bool phased = false );
         ~GPU_TestCard();
 
+        virtual void stageIn( GPU_Job* job );
+        virtual void stageOut( GPU_Job* job );
+        virtual bool phased() const { return _phased; }
+
         // methods to query state
         //
         /// return the currently processeing job
         GPU_Job* currentJob() const;
 
+        /// return the jobs that have been staged in and out, in order
+        QList<GPU_Job*> stagedIn() const;
+        QList<GPU_Job*> stagedOut() const;
+
         /// terminate the currently "processing" job
         void completeJob();
 
@@ -54,7 +65,10 @@ class GPU_TestCard : public GPU_Resource
 
     private:
         GPU_Job* _current;
-        QMutex _mutex;
+        bool _phased;
+        QList<GPU_Job*> _stagedIn;
+        QList<GPU_Job*> _stagedOut;
+        mutable QMutex _mutex;
         QWaitCondition _waitCondition;
         boost::function0<void> _object;
         bool _doThrow;
@@ -0,0 +1,50 @@
+#ifndef LOCKFREEQUEUETEST_H
+#define LOCKFREEQUEUETEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file LockFreeQueueTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class LockFreeQueueTest
+ *
+ * @brief
+ *    Unit test for the LockFreeQueue class
+ * @details
+ *
+ */
+
+class LockFreeQueueTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( LockFreeQueueTest );
+        CPPUNIT_TEST( test_fill );
+        CPPUNIT_TEST( test_popIf );
+        CPPUNIT_TEST( test_threaded );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_fill();
+        void test_popIf();
+        void test_threaded();
+
+    public:
+        LockFreeQueueTest(  );
+        ~LockFreeQueueTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // LOCKFREEQUEUETEST_H
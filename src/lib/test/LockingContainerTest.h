@@ -25,6 +25,10 @@ class LockingContainerTest : public CppUnit::TestFixture
     public:
         CPPUNIT_TEST_SUITE( LockingContainerTest );
         CPPUNIT_TEST( test_method );
+        CPPUNIT_TEST( test_timeout );
+        CPPUNIT_TEST( test_waitAllAvailable );
+        CPPUNIT_TEST( test_occupancy );
+        CPPUNIT_TEST( test_threaded );
         CPPUNIT_TEST_SUITE_END();
 
     public:
@@ -33,6 +37,10 @@ class LockingContainerTest : public CppUnit::TestFixture
 
         // Test Methods
         void test_method();
+        void test_timeout();
+        void test_waitAllAvailable();
+        void test_occupancy();
+        void test_threaded();
 
     public:
         LockingContainerTest(  );
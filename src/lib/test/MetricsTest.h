@@ -0,0 +1,54 @@
+#ifndef METRICSTEST_H
+#define METRICSTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file MetricsTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class MetricsTest
+ *
+ * @brief
+ *    Unit test for the metrics registry classes
+ * @details
+ *
+ */
+
+class MetricsTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( MetricsTest );
+        CPPUNIT_TEST( test_counter );
+        CPPUNIT_TEST( test_histogram );
+        CPPUNIT_TEST( test_registry );
+        CPPUNIT_TEST( test_profile );
+        CPPUNIT_TEST( test_timer );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_counter();
+        void test_histogram();
+        void test_registry();
+        void test_profile();
+        void test_timer();
+
+    public:
+        MetricsTest(  );
+        ~MetricsTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // METRICSTEST_H
@@ -0,0 +1,57 @@
+#ifndef PPF_INVERTER_TEST_H_
+#define PPF_INVERTER_TEST_H_
+
+/**
+ * @file PPFInverterTest.h
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <QtCore/QString>
+
+namespace pelican {
+namespace ampp {
+
+/**
+ * @class PPFInverterTest
+ *
+ * @brief
+ * CppUnit testing for the PPF inverter module.
+ */
+
+class PPFInverterTest : public CppUnit::TestFixture
+{
+    public:
+        PPFInverterTest() : CppUnit::TestFixture() {}
+        virtual ~PPFInverterTest() {}
+
+    public:
+        /// Register test methods.
+        CPPUNIT_TEST_SUITE(PPFInverterTest);
+        CPPUNIT_TEST(test_configuration);
+        CPPUNIT_TEST(test_reconstruct);
+        CPPUNIT_TEST(test_rechannelise);
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        /// Test module configuration.
+        void test_configuration();
+
+        /// Test that the channeliser followed by the inverter gives back the
+        /// input time series.
+        void test_reconstruct();
+
+        /// Test that the re-channelised spectra match those of a
+        /// channeliser at the same resolution.
+        void test_rechannelise();
+
+    private:
+        /// Generate configuration XML.
+        QString _configXml(const QString& module, unsigned nChannels,
+                unsigned nTaps);
+};
+
+} // namespace ampp
+} // namespace pelican
+
+#endif // PPF_INVERTER_TEST_H_
@@ -23,6 +23,7 @@ class PolyphaseCoefficientsTest : public CppUnit::TestFixture
         CPPUNIT_TEST_SUITE(PolyphaseCoefficientsTest);
         CPPUNIT_TEST(test_accessorMethods);
         CPPUNIT_TEST(test_loadCoeffFile);
+        CPPUNIT_TEST(test_cache);
         CPPUNIT_TEST_SUITE_END();
 
         /// Test accessor methods.
@@ -31,6 +32,9 @@ class PolyphaseCoefficientsTest : public CppUnit::TestFixture
         /// Test loading a coeff file.
         void test_loadCoeffFile();
 
+        /// Test the binary coefficient cache.
+        void test_cache();
+
         /// Test generating coefficients.
         void test_generate();
 };
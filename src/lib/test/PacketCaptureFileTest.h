@@ -0,0 +1,52 @@
+#ifndef PACKETCAPTUREFILETEST_H
+#define PACKETCAPTUREFILETEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <QtCore/QString>
+
+/**
+ * @file PacketCaptureFileTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class PacketCaptureFileTest
+ *
+ * @brief
+ *    Unit test for the PacketCaptureWriter and PacketCaptureReader classes
+ * @details
+ *
+ */
+
+class PacketCaptureFileTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( PacketCaptureFileTest );
+        CPPUNIT_TEST( test_roundTrip );
+        CPPUNIT_TEST( test_truncated );
+        CPPUNIT_TEST( test_gather );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_roundTrip();
+        void test_truncated();
+        void test_gather();
+
+    public:
+        PacketCaptureFileTest(  );
+        ~PacketCaptureFileTest();
+
+    private:
+        QString _fileName;
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETCAPTUREFILETEST_H
@@ -0,0 +1,54 @@
+#ifndef PACKETREORDERWINDOWTEST_H
+#define PACKETREORDERWINDOWTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file PacketReorderWindowTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class PacketReorderWindowTest
+ *
+ * @brief
+ *    Unit test for the PacketReorderWindow class
+ * @details
+ *
+ */
+
+class PacketReorderWindowTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( PacketReorderWindowTest );
+        CPPUNIT_TEST( test_inOrder );
+        CPPUNIT_TEST( test_reorder );
+        CPPUNIT_TEST( test_carry );
+        CPPUNIT_TEST( test_resync );
+        CPPUNIT_TEST( test_position );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_inOrder();
+        void test_reorder();
+        void test_carry();
+        void test_resync();
+        void test_position();
+
+    public:
+        PacketReorderWindowTest(  );
+        ~PacketReorderWindowTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETREORDERWINDOWTEST_H
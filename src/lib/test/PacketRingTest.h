@@ -0,0 +1,52 @@
+#ifndef PACKETRINGTEST_H
+#define PACKETRINGTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file PacketRingTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class PacketRingTest
+ *
+ * @brief
+ *    Unit test for the PacketRing class
+ * @details
+ *
+ */
+
+class PacketRingTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( PacketRingTest );
+        CPPUNIT_TEST( test_fill );
+        CPPUNIT_TEST( test_wrap );
+        CPPUNIT_TEST( test_threaded );
+        CPPUNIT_TEST( test_wait );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_fill();
+        void test_wrap();
+        void test_threaded();
+        void test_wait();
+
+    public:
+        PacketRingTest(  );
+        ~PacketRingTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // PACKETRINGTEST_H
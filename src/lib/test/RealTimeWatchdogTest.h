@@ -0,0 +1,50 @@
+#ifndef REALTIMEWATCHDOGTEST_H
+#define REALTIMEWATCHDOGTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file RealTimeWatchdogTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class RealTimeWatchdogTest
+ *
+ * @brief
+ *    Unit test for the RealTimeWatchdog class
+ * @details
+ *
+ */
+
+class RealTimeWatchdogTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( RealTimeWatchdogTest );
+        CPPUNIT_TEST( test_deficit );
+        CPPUNIT_TEST( test_shedding );
+        CPPUNIT_TEST( test_policies );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_deficit();
+        void test_shedding();
+        void test_policies();
+
+    public:
+        RealTimeWatchdogTest(  );
+        ~RealTimeWatchdogTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // REALTIMEWATCHDOGTEST_H
@@ -0,0 +1,54 @@
+#ifndef SHAREDCHUNKRINGTEST_H
+#define SHAREDCHUNKRINGTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file SharedChunkRingTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class SharedChunkRingTest
+ *
+ * @brief
+ *    Unit test for the SharedChunkRing class
+ * @details
+ *
+ */
+
+class SharedChunkRingTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( SharedChunkRingTest );
+        CPPUNIT_TEST( test_transfer );
+        CPPUNIT_TEST( test_backPressure );
+        CPPUNIT_TEST( test_attach );
+        CPPUNIT_TEST( test_wait );
+        CPPUNIT_TEST( test_stale );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_transfer();
+        void test_backPressure();
+        void test_attach();
+        void test_wait();
+        void test_stale();
+
+    public:
+        SharedChunkRingTest(  );
+        ~SharedChunkRingTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // SHAREDCHUNKRINGTEST_H
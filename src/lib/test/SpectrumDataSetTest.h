@@ -30,11 +30,13 @@ class SpectrumDataSetTest : public CppUnit::TestFixture
         /// Test accessor methods.
         void test_accessorMethods();
         void test_serialise_deserialise();
+        void test_layout();
         void test_access_performance();
 
         CPPUNIT_TEST_SUITE(SpectrumDataSetTest);
         CPPUNIT_TEST(test_accessorMethods);
         CPPUNIT_TEST(test_serialise_deserialise);
+        CPPUNIT_TEST(test_layout);
         CPPUNIT_TEST(test_access_performance);
         CPPUNIT_TEST_SUITE_END();
 };
@@ -0,0 +1,52 @@
+#ifndef STAGEGRAPHTEST_H
+#define STAGEGRAPHTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file StageGraphTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class StageGraphTest
+ *
+ * @brief
+ *    Unit test for the StageGraph class
+ * @details
+ *
+ */
+
+class StageGraphTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( StageGraphTest );
+        CPPUNIT_TEST( test_order );
+        CPPUNIT_TEST( test_overlap );
+        CPPUNIT_TEST( test_failure );
+        CPPUNIT_TEST( test_synchronous );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_order();
+        void test_overlap();
+        void test_failure();
+        void test_synchronous();
+
+    public:
+        StageGraphTest(  );
+        ~StageGraphTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // STAGEGRAPHTEST_H
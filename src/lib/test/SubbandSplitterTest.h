@@ -0,0 +1,50 @@
+#ifndef SUBBANDSPLITTERTEST_H
+#define SUBBANDSPLITTERTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file SubbandSplitterTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class SubbandSplitterTest
+ *
+ * @brief
+ *    Unit test for the SubbandSplitter class
+ * @details
+ *
+ */
+
+class SubbandSplitterTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( SubbandSplitterTest );
+        CPPUNIT_TEST( test_scatter );
+        CPPUNIT_TEST( test_fill );
+        CPPUNIT_TEST( test_ranges );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_scatter();
+        void test_fill();
+        void test_ranges();
+
+    public:
+        SubbandSplitterTest(  );
+        ~SubbandSplitterTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // SUBBANDSPLITTERTEST_H
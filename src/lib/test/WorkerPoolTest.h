@@ -0,0 +1,52 @@
+#ifndef WORKERPOOLTEST_H
+#define WORKERPOOLTEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * @file WorkerPoolTest.h
+ */
+
+namespace pelican {
+
+namespace ampp {
+
+/**
+ * @class WorkerPoolTest
+ *
+ * @brief
+ *    Unit test for the WorkerPool class
+ * @details
+ *
+ */
+
+class WorkerPoolTest : public CppUnit::TestFixture
+{
+    public:
+        CPPUNIT_TEST_SUITE( WorkerPoolTest );
+        CPPUNIT_TEST( test_run );
+        CPPUNIT_TEST( test_queueFull );
+        CPPUNIT_TEST( test_chain );
+        CPPUNIT_TEST( test_nice );
+        CPPUNIT_TEST_SUITE_END();
+
+    public:
+        void setUp();
+        void tearDown();
+
+        // Test Methods
+        void test_run();
+        void test_queueFull();
+        void test_chain();
+        void test_nice();
+
+    public:
+        WorkerPoolTest(  );
+        ~WorkerPoolTest();
+
+    private:
+};
+
+} // namespace ampp
+} // namespace pelican
+#endif // WORKERPOOLTEST_H
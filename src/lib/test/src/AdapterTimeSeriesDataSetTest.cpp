@@ -344,6 +344,81 @@ void AdapterTimeSeriesDataSetTest::test_deserialise_timing()
  * @details
  * Construct a config node for use with the adapter.
  */
+/**
+ * @details
+ * Method to check the samples of 4, 8 and 16 bit packets are unpacked into
+ * the right time series.
+ */
+void AdapterTimeSeriesDataSetTest::test_unpack()
+{
+    try {
+        unsigned nPackets = 4, nSamples = 16, nSubbands = 3;
+        unsigned bits[] = { 4, 8, 16 };
+        unsigned pols[] = { 1, 2 };
+        for (unsigned b = 0; b < 3; ++b) {
+            for (unsigned np = 0; np < 2; ++np) {
+                unsigned nPols = pols[np];
+                _config = _configXml("false", bits[b], nPackets, nSamples,
+                        8, nSubbands, nPols);
+                AdapterTimeSeriesDataSet adapter(_config);
+                TimeSeriesDataSetC32 timeSeries;
+
+                unsigned nData = nSubbands * nPols * nSamples;
+                size_t dataSize = (nData * bits[b] * 2) / 8;
+                size_t packetSize = sizeof(UDPPacket::Header) + dataSize;
+                adapter.config(&timeSeries, packetSize * nPackets,
+                        QHash<QString, DataBlob*>());
+
+                // Fill the packets (ordered by sub-band, time, polarisation)
+                // and remember the value expected for each sample.
+                std::vector<char> chunk(packetSize * nPackets, 0);
+                std::vector<std::complex<float> > expected(nPackets * nData);
+                for (unsigned p = 0, i = 0; p < nPackets; ++p) {
+                    char* data = &chunk[p * packetSize + sizeof(UDPPacket::Header)];
+                    for (unsigned k = 0; k < nData; ++k, ++i) {
+                        int re = int(i % 15) - 7, im = 3 - int(i % 7);
+                        if (bits[b] == 4) {
+                            TYPES::i4complex z = TYPES::makei4complex(re, im);
+                            reinterpret_cast<TYPES::i4complex*>(data)[k] = z;
+                            expected[i] = std::complex<float>(z.real(), z.imag());
+                        }
+                        else if (bits[b] == 8) {
+                            reinterpret_cast<TYPES::i8complex*>(data)[k] =
+                                    TYPES::i8complex(re, im);
+                            expected[i] = std::complex<float>(re, im);
+                        }
+                        else {
+                            reinterpret_cast<TYPES::i16complex*>(data)[k] =
+                                    TYPES::i16complex(re * 1000, im);
+                            expected[i] = std::complex<float>(re * 1000, im);
+                        }
+                    }
+                }
+
+                QBuffer buffer;
+                buffer.setData(&chunk[0], chunk.size());
+                buffer.open(QBuffer::ReadOnly);
+                adapter.deserialise(&buffer);
+
+                unsigned nPerBlock = 8;
+                for (unsigned p = 0, i = 0; p < nPackets; ++p)
+                    for (unsigned s = 0; s < nSubbands; ++s)
+                        for (unsigned t = 0; t < nSamples; ++t)
+                            for (unsigned pol = 0; pol < nPols; ++pol, ++i) {
+                                unsigned time = p * nSamples + t;
+                                const std::complex<float>* series =
+                                        timeSeries.timeSeriesData(time / nPerBlock, s, pol);
+                                CPPUNIT_ASSERT(expected[i] == series[time % nPerBlock]);
+                            }
+            }
+        }
+    }
+    catch (const QString& err) {
+        CPPUNIT_FAIL(err.toStdString().data());
+    }
+}
+
+
 ConfigNode AdapterTimeSeriesDataSetTest::_configXml(
         const QString& fixedSizePackets, unsigned dataBitSize,
         unsigned udpPacketsPerIteration, unsigned samplesPerPacket,
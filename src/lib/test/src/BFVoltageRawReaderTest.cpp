@@ -0,0 +1,132 @@
+#include "BFVoltageRawReaderTest.h"
+#include "BFVoltageRawReader.h"
+#include "SpectrumDataSet.h"
+#include "TestDir.h"
+
+#include <QtCore/QFile>
+#include <vector>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( BFVoltageRawReaderTest );
+/**
+ *@details BFVoltageRawReaderTest
+ */
+BFVoltageRawReaderTest::BFVoltageRawReaderTest()
+    : CppUnit::TestFixture(), _testDir(0), _nSubbands(3), _nChannels(4)
+{
+}
+
+/**
+ *@details
+ */
+BFVoltageRawReaderTest::~BFVoltageRawReaderTest()
+{
+}
+
+void BFVoltageRawReaderTest::setUp()
+{
+    _testDir = new test::TestDir( "BFVoltageRawReader", true );
+}
+
+void BFVoltageRawReaderTest::tearDown()
+{
+    delete _testDir;
+}
+
+namespace {
+// the value of component k (Xr, Xi, Yr, Yi) of block t, sub-band s, channel c
+float value( unsigned t, unsigned s, unsigned c, unsigned k ) {
+    return t * 1000.0f + s * 100.0f + c * 10.0f + k;
+}
+}
+
+QStringList BFVoltageRawReaderTest::_writeFiles( const unsigned* nBlocks )
+{
+    const char* names[] = { "Xr", "Xi", "Yr", "Yi" };
+    QStringList files;
+    for( unsigned k = 0; k < 4; ++k ) {
+        QString name = _testDir->absolutePath() + "/voltages_" + names[k] + ".raw";
+        QFile file(name);
+        CPPUNIT_ASSERT( file.open(QIODevice::WriteOnly) );
+        // time block -> sub-band -> channel, as H5_LofarBFVoltageWriter
+        std::vector<float> block;
+        for( unsigned t = 0; t < nBlocks[k]; ++t ) {
+            block.clear();
+            for( unsigned s = 0; s < _nSubbands; ++s )
+                for( unsigned c = 0; c < _nChannels; ++c )
+                    block.push_back( value(t, s, c, k) );
+            file.write( reinterpret_cast<const char*>(&block[0]),
+                        block.size() * sizeof(float) );
+        }
+        file.close();
+        files.append( name );
+    }
+    return files;
+}
+
+void BFVoltageRawReaderTest::test_read()
+{
+    // Use case:
+    // Read 5 blocks 3 at a time: the blocks come back in order with their
+    // timestamps, then nothing is left
+    unsigned nBlocks[] = { 5, 5, 5, 5 };
+    BFVoltageRawReader reader( _writeFiles( nBlocks ), _nSubbands, _nChannels );
+    reader.setTiming( 100.0, 0.5 );
+    SpectrumDataSetC32 data;
+    unsigned first = 0;
+    unsigned expected[] = { 3, 2 };
+    for( unsigned i = 0; i < 2; ++i ) {
+        CPPUNIT_ASSERT_EQUAL( expected[i], reader.read( &data, 3 ) );
+        CPPUNIT_ASSERT_EQUAL( expected[i], data.nTimeBlocks() );
+        CPPUNIT_ASSERT_EQUAL( _nSubbands, data.nSubbands() );
+        CPPUNIT_ASSERT_EQUAL( 2u, data.nPolarisations() );
+        CPPUNIT_ASSERT_EQUAL( _nChannels, data.nChannels() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0 + first * 0.5, data.getLofarTimestamp(), 1e-9 );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, data.getBlockRate(), 1e-9 );
+        for( unsigned t = 0; t < data.nTimeBlocks(); ++t ) {
+            for( unsigned s = 0; s < _nSubbands; ++s ) {
+                for( unsigned p = 0; p < 2; ++p ) {
+                    const std::complex<float>* spectrum = data.spectrumData(t, s, p);
+                    for( unsigned c = 0; c < _nChannels; ++c ) {
+                        CPPUNIT_ASSERT_EQUAL( value(first + t, s, c, 2*p), spectrum[c].real() );
+                        CPPUNIT_ASSERT_EQUAL( value(first + t, s, c, 2*p+1), spectrum[c].imag() );
+                    }
+                }
+            }
+        }
+        first += expected[i];
+    }
+    CPPUNIT_ASSERT_EQUAL( 0u, reader.read( &data, 3 ) );
+}
+
+void BFVoltageRawReaderTest::test_truncated()
+{
+    // Use case:
+    // One component file is short (e.g. still being written): only the
+    // blocks present in all of them are read
+    unsigned nBlocks[] = { 4, 4, 4, 2 };
+    BFVoltageRawReader reader( _writeFiles( nBlocks ), _nSubbands, _nChannels );
+    SpectrumDataSetC32 data;
+    CPPUNIT_ASSERT_EQUAL( 2u, reader.read( &data, 10 ) );
+    CPPUNIT_ASSERT_EQUAL( value(1, 2, 3, 3), data.spectrumData(1, 2, 1)[3].imag() );
+    CPPUNIT_ASSERT_EQUAL( 0u, reader.read( &data, 10 ) );
+}
+
+void BFVoltageRawReaderTest::test_files()
+{
+    // Use case:
+    // Anything but the four component files is an error
+    unsigned nBlocks[] = { 1, 1, 1, 1 };
+    QStringList files = _writeFiles( nBlocks );
+    files.removeLast();
+    CPPUNIT_ASSERT_THROW( BFVoltageRawReader( files, _nSubbands, _nChannels ), QString );
+    files.append( _testDir->absolutePath() + "/missing.raw" );
+    CPPUNIT_ASSERT_THROW( BFVoltageRawReader( files, _nSubbands, _nChannels ), QString );
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,130 @@
+#include "BufferingAgentTest.h"
+#include "BufferingAgent.h"
+#include "pelican/data/DataBlob.h"
+
+#include <QtCore/QThread>
+#include <boost/bind.hpp>
+#include <stdexcept>
+
+
+namespace pelican {
+
+namespace ampp {
+
+class BufferingAgentTestBlob : public DataBlob
+{
+    public:
+        BufferingAgentTestBlob() : DataBlob("BufferingAgentTestBlob"), sequence(-1) {}
+        int sequence;
+};
+PELICAN_DECLARE_DATABLOB(BufferingAgentTestBlob)
+
+CPPUNIT_TEST_SUITE_REGISTRATION( BufferingAgentTest );
+/**
+ *@details BufferingAgentTest
+ */
+BufferingAgentTest::BufferingAgentTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+BufferingAgentTest::~BufferingAgentTest()
+{
+}
+
+void BufferingAgentTest::setUp()
+{
+}
+
+void BufferingAgentTest::tearDown()
+{
+}
+
+namespace {
+typedef BufferingAgent::DataBlobHash DataBlobHash;
+
+// stands in for a data client: numbers the chunks it fills
+class Source
+{
+    public:
+        enum Failure { Message, Exception, Other };
+        Source() : count(0), sleep(0), failOn(-1), failure(Message) {}
+        DataBlobHash getData( DataBlobHash& hash ) {
+            if( sleep ) QThread::usleep( sleep );
+            int sequence = __sync_fetch_and_add( &count, 1 );
+            if( sequence == failOn ) {
+                if( failure == Exception ) throw std::runtime_error("no data");
+                if( failure == Other ) throw sequence;
+                throw QString("no data");
+            }
+            static_cast<BufferingAgentTestBlob*>(hash.value("BufferingAgentTestBlob"))->sequence = sequence;
+            return hash;
+        }
+        int count;
+        unsigned long sleep;
+        int failOn;
+        Failure failure;
+};
+}
+
+void BufferingAgentTest::test_prefetch()
+{
+    // chunks come out in order, in the agent's own blobs, and are
+    // fetched ahead while the caller works
+    Source source;
+    BufferingAgentTestBlob blob;
+    DataBlobHash hash;
+    hash.insert( "BufferingAgentTestBlob", &blob );
+    BufferingAgent agent( boost::bind( &Source::getData, &source, _1 ), 2,
+                          "BufferingAgentTest.prefetch" );
+    CPPUNIT_ASSERT_EQUAL( 2U, agent.depth() );
+    QList<DataBlob*> seen;
+    for( int i = 0; i < 10; ++i ) {
+        DataBlobHash valid = agent.getData( hash );
+        BufferingAgentTestBlob* b = static_cast<BufferingAgentTestBlob*>(valid.value("BufferingAgentTestBlob"));
+        CPPUNIT_ASSERT( b != &blob );
+        CPPUNIT_ASSERT_EQUAL( i, b->sequence );
+        if( ! seen.contains( b ) ) seen.append( b );
+        QThread::usleep( 10000 ); // "processing": the agent gets ahead
+    }
+    CPPUNIT_ASSERT_EQUAL( 3, seen.size() ); // depth + the one served
+    CPPUNIT_ASSERT_EQUAL( -1, blob.sequence );
+    CPPUNIT_ASSERT( agent.hits() >= 8 );
+    CPPUNIT_ASSERT_EQUAL( 10ULL, agent.hits() + agent.misses() );
+}
+
+void BufferingAgentTest::test_error()
+{
+    // a failed fetch is thrown to the caller in turn, as a QString
+    // whatever was thrown; later data still comes
+    Source::Failure failures[] = { Source::Message, Source::Exception, Source::Other };
+    for( int i = 0; i < 3; ++i ) {
+        Source source;
+        source.failOn = 1;
+        source.failure = failures[i];
+        BufferingAgentTestBlob blob;
+        DataBlobHash hash;
+        hash.insert( "BufferingAgentTestBlob", &blob );
+        BufferingAgent agent( boost::bind( &Source::getData, &source, _1 ), 3,
+                              "BufferingAgentTest.error" );
+        DataBlobHash valid = agent.getData( hash );
+        CPPUNIT_ASSERT_EQUAL( 0, static_cast<BufferingAgentTestBlob*>(valid.value("BufferingAgentTestBlob"))->sequence );
+        QString error;
+        try {
+            agent.getData( hash );
+        }
+        catch( const QString& e ) {
+            error = e;
+        }
+        CPPUNIT_ASSERT( ! error.isEmpty() );
+        if( failures[i] != Source::Other ) CPPUNIT_ASSERT( error.endsWith("no data") );
+        valid = agent.getData( hash );
+        CPPUNIT_ASSERT_EQUAL( 2, static_cast<BufferingAgentTestBlob*>(valid.value("BufferingAgentTestBlob"))->sequence );
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
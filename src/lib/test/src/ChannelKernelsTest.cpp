@@ -0,0 +1,207 @@
+#include "ChannelKernelsTest.h"
+#include "ChannelKernels.h"
+#include <vector>
+#include <complex>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ChannelKernelsTest );
+/**
+ *@details ChannelKernelsTest 
+ */
+ChannelKernelsTest::ChannelKernelsTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+ChannelKernelsTest::~ChannelKernelsTest()
+{
+}
+
+void ChannelKernelsTest::setUp()
+{
+}
+
+void ChannelKernelsTest::tearDown()
+{
+}
+
+void ChannelKernelsTest::test_select()
+{
+     // Use Case:
+     // common channel counts get a specialised kernel, others the fallback
+     CPPUNIT_ASSERT( ChannelKernels::isSpecialised(512) );
+     CPPUNIT_ASSERT( ! ChannelKernels::isSpecialised(500) );
+     CPPUNIT_ASSERT( ChannelKernels::select<SubtractKernel>(512)
+                     != &SubtractKernel<RuntimeChannels>::run );
+     CPPUNIT_ASSERT( ChannelKernels::select<SubtractKernel>(500)
+                     == &SubtractKernel<RuntimeChannels>::run );
+}
+
+void ChannelKernelsTest::test_stokes()
+{
+     unsigned nChannels = 64;
+     std::vector<std::complex<float> > x(nChannels), y(nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         x[c] = std::complex<float>(c, 1.0f);
+         y[c] = std::complex<float>(2.0f, c);
+     }
+     std::vector<float> I(nChannels), Q(nChannels), U(nChannels), V(nChannels);
+     std::vector<float> Ig(nChannels), Qg(nChannels), Ug(nChannels), Vg(nChannels);
+     ChannelKernels::select<StokesKernel>(nChannels)(&x[0], &y[0], &I[0], &Q[0], &U[0], &V[0], nChannels);
+     StokesKernel<RuntimeChannels>::run(&x[0], &y[0], &Ig[0], &Qg[0], &Ug[0], &Vg[0], nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( Ig[c], I[c], 1e-5 );
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( Qg[c], Q[c], 1e-5 );
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( Ug[c], U[c], 1e-5 );
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( Vg[c], V[c], 1e-5 );
+     }
+     // Use Case:
+     // Stokes-I only kernel agrees with the full Stokes kernel
+     std::vector<float> Ionly(nChannels);
+     ChannelKernels::select<StokesIKernel>(nChannels)(&x[0], &y[0], &Ionly[0], nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( I[c], Ionly[c], 1e-5 );
+     }
+}
+
+void ChannelKernelsTest::test_power()
+{
+     // Use Case:
+     // interleaved and block power kernels agree, and sum to Stokes-I
+     unsigned nChannels = 128;
+     std::vector<std::complex<float> > x(nChannels), y(nChannels), xy(2 * nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         x[c] = xy[2*c] = std::complex<float>(c, 3.0f);
+         y[c] = xy[2*c+1] = std::complex<float>(-1.0f, c);
+     }
+     std::vector<float> IX(nChannels), IY(nChannels), IXi(nChannels), IYi(nChannels);
+     std::vector<float> I(nChannels);
+     ChannelKernels::select<PowerKernel>(nChannels)(&x[0], &y[0], &IX[0], &IY[0], nChannels);
+     ChannelKernels::select<InterleavedPowerKernel>(nChannels)(&xy[0], &IXi[0], &IYi[0], nChannels);
+     ChannelKernels::select<InterleavedStokesIKernel>(nChannels)(&xy[0], &I[0], nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( std::norm(x[c]), IX[c], 1e-3 );
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( std::norm(y[c]), IY[c], 1e-3 );
+         CPPUNIT_ASSERT_EQUAL( IX[c], IXi[c] );
+         CPPUNIT_ASSERT_EQUAL( IY[c], IYi[c] );
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( IX[c] + IY[c], I[c], 1e-3 );
+     }
+}
+
+void ChannelKernelsTest::test_integrate()
+{
+     unsigned nChannels = 128;
+     unsigned binChannels = 4;
+     std::vector<float> in(nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) in[c] = c;
+     std::vector<float> out(nChannels/binChannels, 1.0f);
+     ChannelKernels::select<IntegrateKernel>(nChannels)(&in[0], &out[0], nChannels, binChannels);
+     for(unsigned nc = 0; nc < out.size(); ++nc ) {
+         float expected = 1.0f + 4 * (nc * binChannels) + 6;
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( expected, out[nc], 1e-5 );
+     }
+}
+
+void ChannelKernelsTest::test_transpose()
+{
+     unsigned nChannels = 32;
+     unsigned stride = 3;
+     std::vector<float> in(nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) in[c] = c;
+     std::vector<float> out(nChannels * stride, -1.0f);
+     ChannelKernels::select<TransposeKernel>(nChannels)(&in[0], &out[0], stride, false, nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_EQUAL( (float)c, out[c*stride] );
+         CPPUNIT_ASSERT_EQUAL( -1.0f, out[c*stride + 1] );
+     }
+     ChannelKernels::select<TransposeKernel>(nChannels)(&in[0], &out[0], stride, true, nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_EQUAL( (float)(nChannels - 1 - c), out[c*stride] );
+     }
+}
+
+void ChannelKernelsTest::test_fir()
+{
+     // Use Case:
+     // specialised and generic FIR kernels agree for a rotated ring buffer
+     unsigned nChannels = 256;
+     unsigned nTaps = 8;
+     std::vector<std::complex<float> > buffer(nChannels * nTaps);
+     std::vector<float> coeffs(nChannels * nTaps);
+     for(unsigned i = 0; i < buffer.size(); ++i ) {
+         buffer[i] = std::complex<float>(i % 7, i % 5);
+         coeffs[i] = 1.0f / (1 + i % 11);
+     }
+     std::vector<std::complex<float> > out(nChannels), outGeneric(nChannels);
+     ChannelKernels::select<FirKernel>(nChannels)(&buffer[0], 3, nTaps, &coeffs[0], &out[0], nChannels);
+     FirKernel<RuntimeChannels>::run(&buffer[0], 3, nTaps, &coeffs[0], &outGeneric[0], nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( outGeneric[c].real(), out[c].real(), 1e-4 );
+         CPPUNIT_ASSERT_DOUBLES_EQUAL( outGeneric[c].imag(), out[c].imag(), 1e-4 );
+     }
+}
+
+void ChannelKernelsTest::test_k7()
+{
+     // Use Case:
+     // K7 products decode to total power, or to the four products with
+     // signed cross terms
+     unsigned nChannels = 1024;
+     std::vector<unsigned short> in(4 * nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         in[4*c] = 60000 + c % 7;
+         in[4*c+1] = 50000;
+         in[4*c+2] = (unsigned short)(short)(-(int)c);
+         in[4*c+3] = c;
+     }
+     std::vector<float> I(nChannels + 1, -1.0f);
+     std::vector<float> XX(nChannels), YY(nChannels), XYre(nChannels), XYim(nChannels);
+     ChannelKernels::select<K7PowerKernel>(nChannels)(&in[0], &I[0], nChannels);
+     ChannelKernels::select<K7ProductsKernel>(nChannels)(&in[0], &XX[0], &YY[0],
+                                                         &XYre[0], &XYim[0], nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_EQUAL( (float)(110000 + c % 7), I[c] );
+         CPPUNIT_ASSERT_EQUAL( (float)(60000 + c % 7), XX[c] );
+         CPPUNIT_ASSERT_EQUAL( 50000.0f, YY[c] );
+         CPPUNIT_ASSERT_EQUAL( -(float)c, XYre[c] );
+         CPPUNIT_ASSERT_EQUAL( (float)c, XYim[c] );
+     }
+     // nothing is written past the last channel
+     CPPUNIT_ASSERT_EQUAL( -1.0f, I[nChannels] );
+}
+
+void ChannelKernelsTest::test_ab()
+{
+     // Use Case:
+     // big-endian AB products decode as the K7 (little-endian) ones
+     unsigned nChannels = 512;
+     std::vector<unsigned short> in(4 * nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         in[4*c] = byteSwap16(60000 + c);
+         in[4*c+1] = byteSwap16(5);
+         in[4*c+2] = byteSwap16((unsigned short)(short)(-(int)c));
+         in[4*c+3] = byteSwap16(c);
+     }
+     std::vector<float> I(nChannels);
+     std::vector<float> XX(nChannels), YY(nChannels), XYre(nChannels), XYim(nChannels);
+     ChannelKernels::select<ABPowerKernel>(nChannels)(&in[0], &I[0], nChannels);
+     ChannelKernels::select<ABProductsKernel>(nChannels)(&in[0], &XX[0], &YY[0],
+                                                         &XYre[0], &XYim[0], nChannels);
+     for(unsigned c = 0; c < nChannels; ++c ) {
+         CPPUNIT_ASSERT_EQUAL( (float)(60005 + c), I[c] );
+         CPPUNIT_ASSERT_EQUAL( (float)(60000 + c), XX[c] );
+         CPPUNIT_ASSERT_EQUAL( 5.0f, YY[c] );
+         CPPUNIT_ASSERT_EQUAL( -(float)c, XYre[c] );
+         CPPUNIT_ASSERT_EQUAL( (float)c, XYim[c] );
+     }
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,128 @@
+#include "CompletionCounterTest.h"
+#include "CompletionCounter.h"
+#include "ProcessingChain1.h"
+
+#include <QtCore/QThread>
+#include <boost/bind.hpp>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CompletionCounterTest );
+/**
+ *@details CompletionCounterTest
+ */
+CompletionCounterTest::CompletionCounterTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+CompletionCounterTest::~CompletionCounterTest()
+{
+}
+
+void CompletionCounterTest::setUp()
+{
+}
+
+void CompletionCounterTest::tearDown()
+{
+}
+
+namespace {
+class Finisher : public QThread
+{
+    public:
+        Finisher(CompletionCounter* counter, unsigned n, unsigned long ms)
+            : _counter(counter), _n(n), _ms(ms) {}
+        void run() {
+            for( unsigned i = 0; i < _n; ++i ) {
+                msleep(_ms);
+                _counter->done();
+            }
+        }
+    private:
+        CompletionCounter* _counter;
+        unsigned _n;
+        unsigned long _ms;
+};
+}
+
+void CompletionCounterTest::test_wait()
+{
+    CompletionCounter counter( "CompletionCounterTest.wait" );
+    // nothing outstanding: no wait
+    CPPUNIT_ASSERT( counter.wait(0) );
+    CPPUNIT_ASSERT_EQUAL( 0UL, counter.blockedWaits() );
+
+    counter.add(3);
+    CPPUNIT_ASSERT_EQUAL( 3, counter.pending() );
+    Finisher finisher(&counter, 3, 20);
+    finisher.start();
+    CPPUNIT_ASSERT( counter.wait() );
+    CPPUNIT_ASSERT_EQUAL( 0, counter.pending() );
+    CPPUNIT_ASSERT_EQUAL( 3, counter.maxPending() );
+    CPPUNIT_ASSERT_EQUAL( 1UL, counter.blockedWaits() );
+    CPPUNIT_ASSERT_EQUAL( 0UL, counter.timeouts() );
+    finisher.wait();
+
+    // the same figures are in the registry
+    MetricsRegistry& metrics = MetricsRegistry::instance();
+    CPPUNIT_ASSERT_EQUAL( (qint64)0, metrics.gauge( "CompletionCounterTest.wait.pending" ).value() );
+    CPPUNIT_ASSERT_EQUAL( (qint64)3, metrics.gauge( "CompletionCounterTest.wait.pending" ).max() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, metrics.counter( "CompletionCounterTest.wait.blockedWaits" ).value() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)0, metrics.counter( "CompletionCounterTest.wait.timeouts" ).value() );
+}
+
+void CompletionCounterTest::test_timeout()
+{
+    CompletionCounter counter( "CompletionCounterTest.timeout" );
+    counter.add();
+    Deadline deadline(1000);
+    CPPUNIT_ASSERT( ! counter.wait(50) );
+    CPPUNIT_ASSERT( deadline.remaining() <= 951 );
+    CPPUNIT_ASSERT_EQUAL( 1UL, counter.timeouts() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1,
+            MetricsRegistry::instance().counter( "CompletionCounterTest.timeout.timeouts" ).value() );
+    counter.done();
+    CPPUNIT_ASSERT( counter.wait(0) );
+    CPPUNIT_ASSERT_EQUAL( ULONG_MAX, Deadline(ULONG_MAX).remaining() );
+}
+
+namespace {
+void slowTask( int ms ) {
+    QThread::usleep( ms * 1000 );
+}
+void countPost( int* count ) {
+    __sync_fetch_and_add( count, 1 );
+}
+}
+
+void CompletionCounterTest::test_chain()
+{
+    // waitTaskCompletion() returns once the post tasks of every exec()
+    // have run
+    int posts = 0;
+    {
+        ProcessingChain1<int> chain( "CompletionCounterTest.chain" );
+        QList<boost::function1<void, int> > tasks;
+        tasks << boost::bind( &slowTask, _1 ) << boost::bind( &slowTask, _1 );
+        QList<boost::function0<void> > post;
+        post << boost::bind( &countPost, &posts );
+        chain.exec( tasks, post, 100 );
+        chain.exec( tasks, post, 50 );
+        CPPUNIT_ASSERT( ! chain.waitTaskCompletion(10) );
+        CPPUNIT_ASSERT( chain.waitTaskCompletion() );
+        CPPUNIT_ASSERT_EQUAL( 2, posts );
+        CPPUNIT_ASSERT_EQUAL( 0, chain.running().pending() );
+        CPPUNIT_ASSERT_EQUAL( 2, chain.running().maxPending() );
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
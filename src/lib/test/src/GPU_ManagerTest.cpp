@@ -2,7 +2,11 @@
 #include "GPU_Manager.h"
 #include "GPU_Job.h"
 #include "GPU_TestCard.h"
+#include "GPU_CPU.h"
+#include "GPU_Kernel.h"
+#include "GPU_MemoryMap.h"
 #include <boost/bind.hpp>
+#include <vector>
 
 
 namespace pelican {
@@ -10,6 +14,82 @@ namespace pelican {
 namespace ampp {
 
 CPPUNIT_TEST_SUITE_REGISTRATION( GPU_ManagerTest );
+
+// kernels for the CPU resource tests
+class TestCpuVectorAdd : public GPU_Kernel
+{
+    public:
+        TestCpuVectorAdd( std::vector<float>& a, std::vector<float>& b, std::vector<float>& out )
+            : _a(GPU_MemoryMap(a)), _b(b), _out(GPU_MemoryMap(out)) {}
+        void run( GPU_NVidia& ) {}
+        void run( GPU_CPU& cpu ) {
+            const float* a = (const float*)cpu.devicePtr(_a);
+            const float* b = (const float*)cpu.devicePtr(_b);
+            float* out = (float*)cpu.devicePtr(_out);
+            for( unsigned i = 0; i < _out.size() / sizeof(float); ++i )
+                out[i] = a[i] + b[i];
+        }
+        bool runsOnCpu() const { return true; }
+
+    private:
+        GPU_MemoryMapConst _a;
+        GPU_MemoryMap _b;
+        GPU_MemoryMapOutput _out;
+};
+
+// copies its input on stage in, releasing it straight away
+class TestCpuStagedCopy : public GPU_Kernel
+{
+    public:
+        TestCpuStagedCopy( std::vector<float>& in, std::vector<float>& out,
+                           const GPU_MemoryMap::CallBackT& uploaded )
+            : _in(GPU_MemoryMap(in)), _out(GPU_MemoryMap(out)) { _in.addCallBack( uploaded ); }
+        void run( GPU_NVidia& ) {}
+        void stageIn( GPU_CPU& cpu ) {
+            const float* in = (const float*)cpu.devicePtr(_in);
+            _staged.assign( in, in + _in.size() / sizeof(float) );
+            _in.runCallBacks();
+        }
+        void run( GPU_CPU& cpu ) {
+            float* out = (float*)cpu.devicePtr(_out);
+            for( unsigned i = 0; i < _staged.size(); ++i ) out[i] = 2 * _staged[i];
+        }
+        bool runsOnCpu() const { return true; }
+
+    private:
+        GPU_MemoryMap _in;
+        GPU_MemoryMapOutput _out;
+        std::vector<float> _staged;
+};
+
+// holds its input until the job is done with, as the dedispersion
+// kernel holds its buffer
+class TestHoldingKernel : public GPU_Kernel
+{
+    public:
+        TestHoldingKernel( std::vector<float>& in, const GPU_MemoryMap::CallBackT& released )
+            : _in(GPU_MemoryMap(in)) { _in.addCallBack( released ); }
+        void run( GPU_NVidia& ) {}
+        void cleanUp() { _in.runCallBacks(); }
+
+    private:
+        GPU_MemoryMap _in;
+};
+
+static void release( int* count ) {
+     ++*count;
+}
+
+static void overwrite( std::vector<float>* v ) {
+     v->assign( v->size(), -1.0 );
+}
+
+class TestGpuOnlyKernel : public GPU_Kernel
+{
+    public:
+        void run( GPU_NVidia& ) {}
+};
+
 /**
  *@details GPU_ManagerTest 
  */
@@ -133,5 +213,261 @@ void GPU_ManagerTest::test_submitMultiCards()
      CPPUNIT_ASSERT_EQUAL( 0, m.jobsQueued() );
 
 }
+void GPU_ManagerTest::test_cpuResource()
+{
+     // Use Case:
+     // A CPU resource only
+     // Submit a job with a CPU implementation
+     // - ensure it is run
+     // Submit a job without
+     // - ensure it fails at once rather than waiting in the queue
+     GPU_Manager m;
+     GPU_CPU::initialiseResources( &m, 1, 2 );
+     CPPUNIT_ASSERT_EQUAL( 1, m.resources() );
+     std::vector<float> a(100, 1.0), b(100, 2.0), out(100, 0.0);
+     TestCpuVectorAdd kernel( a, b, out );
+     GPU_Job job;
+     job.addKernel( &kernel );
+     m.submit( &job );
+     job.wait();
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Finished, job.status() );
+     CPPUNIT_ASSERT_EQUAL( 3.0f, out[0] );
+     CPPUNIT_ASSERT_EQUAL( 3.0f, out[99] );
+
+     TestGpuOnlyKernel gpuKernel;
+     GPU_Job gpuJob;
+     gpuJob.addKernel( &gpuKernel );
+     m.submit( &gpuJob );
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Failed, gpuJob.status() );
+     CPPUNIT_ASSERT_EQUAL( 0, m.jobsQueued() );
+}
+
+void GPU_ManagerTest::test_heterogeneous()
+{
+     // Use Case:
+     // A test card and a CPU resource
+     // - a job only a card can run waits for the card, even with
+     //   the CPU idle
+     // - a job with a CPU implementation runs on the CPU while the card
+     //   is busy
+     GPU_Manager m;
+     GPU_TestCard* card = new GPU_TestCard;
+     m.addResource( card );
+     GPU_CPU::initialiseResources( &m, 1 );
+     CPPUNIT_ASSERT_EQUAL( 2, m.freeResources() );
+
+     TestGpuOnlyKernel gpuKernel;
+     GPU_Job testJob1;
+     testJob1.addKernel( &gpuKernel );
+     m.submit(&testJob1);
+     do{ sleep(1); } while( testJob1.status() == GPU_Job::Queued );
+     CPPUNIT_ASSERT_EQUAL( &testJob1, card->currentJob() );
+
+     std::vector<float> a(10, 1.0), b(10, 2.0), out(10, 0.0);
+     TestCpuVectorAdd cpuKernel( a, b, out );
+     GPU_Job testJob2;
+     testJob2.addKernel( &cpuKernel );
+     m.submit(&testJob2);
+     do{ sleep(1); } while( testJob2.status() != GPU_Job::Finished );
+     CPPUNIT_ASSERT_EQUAL( 3.0f, out[9] );
+
+     GPU_Job testJob3;
+     testJob3.addKernel( &gpuKernel );
+     m.submit(&testJob3);
+     CPPUNIT_ASSERT_EQUAL( 1, m.jobsQueued() );
+     CPPUNIT_ASSERT_EQUAL( 1, m.freeResources() );
+     card->completeJob();
+     do{ sleep(1); } while( testJob3.status() == GPU_Job::Queued );
+     CPPUNIT_ASSERT_EQUAL( &testJob3, card->currentJob() );
+     card->completeJob();
+     do{ sleep(1); } while( testJob3.status() != GPU_Job::Finished );
+     CPPUNIT_ASSERT_EQUAL( 0, m.jobsQueued() );
+}
+
+void GPU_ManagerTest::test_priority()
+{
+     // Use Case:
+     // Single gpu card, busy
+     // Submit a low, a normal and a high priority job
+     // Expect:
+     // the jobs to be run highest priority first, and their queue and
+     // execution times to be kept
+     GPU_Manager m;
+     GPU_TestCard* card = new GPU_TestCard;
+     m.addResource( card );
+     GPU_Job testJob1;
+     m.submit(&testJob1);
+     do{ sleep(1); } while( testJob1.status() == GPU_Job::Queued );
+
+     GPU_Job low, normal, high;
+     low.setPriority( GPU_Job::Low );
+     high.setPriority( GPU_Job::High );
+     m.submit(&low);
+     m.submit(&normal);
+     m.submit(&high);
+     CPPUNIT_ASSERT_EQUAL( 3, m.jobsQueued() );
+
+     card->completeJob();
+     do{ sleep(1); } while( high.status() == GPU_Job::Queued );
+     CPPUNIT_ASSERT_EQUAL( &high, card->currentJob() );
+     card->completeJob();
+     do{ sleep(1); } while( normal.status() == GPU_Job::Queued );
+     CPPUNIT_ASSERT_EQUAL( &normal, card->currentJob() );
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Queued, low.status() );
+     card->completeJob();
+     do{ sleep(1); } while( low.status() == GPU_Job::Queued );
+     CPPUNIT_ASSERT_EQUAL( &low, card->currentJob() );
+     card->completeJob();
+     low.wait();
+     CPPUNIT_ASSERT( low.queueTime() >= 2.0 );
+     CPPUNIT_ASSERT( low.execTime() > 0.0 );
+     CPPUNIT_ASSERT( testJob1.queueTime() < 1.0 );
+     CPPUNIT_ASSERT( testJob1.execTime() >= 1.0 );
+}
+
+void GPU_ManagerTest::test_queueDepth()
+{
+     // Use Case:
+     // Single gpu card, busy, and a queue of at most 2 jobs
+     // Expect:
+     // a third job waiting to fail at once
+     GPU_Manager m(2);
+     GPU_TestCard* card = new GPU_TestCard;
+     m.addResource( card );
+     GPU_Job testJob1;
+     m.submit(&testJob1);
+     do{ sleep(1); } while( testJob1.status() == GPU_Job::Queued );
+
+     GPU_Job testJob2, testJob3, testJob4;
+     m.submit(&testJob2);
+     m.submit(&testJob3);
+     m.submit(&testJob4);
+     CPPUNIT_ASSERT_EQUAL( 2, m.jobsQueued() );
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Failed, testJob4.status() );
+     CPPUNIT_ASSERT_EQUAL( std::string("GPU_Manager: job queue full"), testJob4.error() );
+
+     for( int i = 0; i < 3; ++i ) {
+         do{ sleep(1); } while( card->currentJob() == 0 );
+         card->completeJob();
+     }
+     testJob3.wait();
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Finished, testJob3.status() );
+     CPPUNIT_ASSERT_EQUAL( 0, m.jobsQueued() );
+}
+
+void GPU_ManagerTest::test_rejectedCleanUp()
+{
+     // Use Case:
+     // Single gpu card, busy, and a queue of at most 1 job
+     // Submit more jobs than will fit, each holding an input
+     // Expect:
+     // the inputs of the jobs rejected to be released at once
+     GPU_Manager m(1);
+     GPU_TestCard* card = new GPU_TestCard;
+     m.addResource( card );
+     GPU_Job testJob1;
+     m.submit(&testJob1);
+     do{ sleep(1); } while( testJob1.status() == GPU_Job::Queued );
+
+     int released = 0;
+     std::vector<float> in(10, 1.0);
+     TestHoldingKernel kernel2( in, boost::bind( &release, &released ) );
+     TestHoldingKernel kernel3( in, boost::bind( &release, &released ) );
+     TestHoldingKernel kernel4( in, boost::bind( &release, &released ) );
+     GPU_Job testJob2, testJob3, testJob4;
+     testJob2.addKernel( &kernel2 );
+     testJob3.addKernel( &kernel3 );
+     testJob4.addKernel( &kernel4 );
+     m.submit(&testJob2);
+     m.submit(&testJob3);
+     m.submit(&testJob4);
+     CPPUNIT_ASSERT_EQUAL( 1, m.jobsQueued() );
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Failed, testJob3.status() );
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Failed, testJob4.status() );
+     CPPUNIT_ASSERT_EQUAL( 2, released );
+
+     for( int i = 0; i < 2; ++i ) {
+         do{ sleep(1); } while( card->currentJob() == 0 );
+         card->completeJob();
+     }
+     testJob2.wait();
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Finished, testJob2.status() );
+     CPPUNIT_ASSERT_EQUAL( 2, released );
+
+     // and of a job no resource can run
+     GPU_Manager cpuOnly;
+     GPU_CPU::initialiseResources( &cpuOnly, 1 );
+     TestHoldingKernel kernel5( in, boost::bind( &release, &released ) );
+     GPU_Job testJob5;
+     testJob5.addKernel( &kernel5 );
+     cpuOnly.submit(&testJob5);
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Failed, testJob5.status() );
+     CPPUNIT_ASSERT_EQUAL( 3, released );
+}
+
+void GPU_ManagerTest::test_phased()
+{
+     // Use Case:
+     // A phased test card and four jobs
+     // Expect:
+     // the second job to be staged in whilst the first computes, and no
+     // more than three jobs in flight on the card
+     GPU_Manager m;
+     GPU_TestCard* card = new GPU_TestCard( true );
+     m.addResource( card );
+     GPU_Job testJob1, testJob2, testJob3, testJob4;
+     m.submit(&testJob1);
+     do{ sleep(1); } while( card->currentJob() == 0 );
+     m.submit(&testJob2);
+     m.submit(&testJob3);
+     m.submit(&testJob4);
+     do{ sleep(1); } while( card->stagedIn().size() < 2 );
+     CPPUNIT_ASSERT_EQUAL( &testJob1, card->currentJob() );
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Running, testJob2.status() );
+     CPPUNIT_ASSERT_EQUAL( 2, m.jobsQueued() );
+     CPPUNIT_ASSERT_EQUAL( 0, card->stagedOut().size() );
+
+     // the first job is staged out and finishes, the second computes
+     // and the third is staged in
+     card->completeJob();
+     testJob1.wait();
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Finished, testJob1.status() );
+     CPPUNIT_ASSERT_EQUAL( &testJob1, card->stagedOut().value(0) );
+     do{ sleep(1); } while( card->stagedIn().size() < 3 );
+     CPPUNIT_ASSERT_EQUAL( &testJob2, card->currentJob() );
+     CPPUNIT_ASSERT_EQUAL( &testJob3, card->stagedIn().value(2) );
+     CPPUNIT_ASSERT_EQUAL( 1, m.jobsQueued() );
+
+     for( int i = 0; i < 3; ++i ) {
+         do{ sleep(1); } while( card->currentJob() == 0 );
+         card->completeJob();
+     }
+     testJob4.wait();
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Finished, testJob4.status() );
+     CPPUNIT_ASSERT_EQUAL( 4, card->stagedOut().size() );
+     CPPUNIT_ASSERT_EQUAL( 0, m.jobsQueued() );
+}
+
+void GPU_ManagerTest::test_cpuStaging()
+{
+     // Use Case:
+     // A CPU resource and a kernel that stages its input in
+     // Expect:
+     // the input to be released (its callback run) at the end of the
+     // stage in, so that changes made to it afterwards do not matter
+     GPU_Manager m;
+     GPU_CPU::initialiseResources( &m, 1, 1 );
+     std::vector<float> in(50, 1.5), out(50, 0.0);
+     TestCpuStagedCopy kernel( in, out, boost::bind( &overwrite, &in ) );
+     GPU_Job job;
+     job.addKernel( &kernel );
+     m.submit( &job );
+     job.wait();
+     CPPUNIT_ASSERT_EQUAL( GPU_Job::Finished, job.status() );
+     CPPUNIT_ASSERT_EQUAL( -1.0f, in[0] );
+     CPPUNIT_ASSERT_EQUAL( 3.0f, out[0] );
+     CPPUNIT_ASSERT_EQUAL( 3.0f, out[49] );
+}
+
 } // namespace ampp
 } // namespace pelican
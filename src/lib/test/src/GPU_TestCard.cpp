@@ -10,8 +10,8 @@ namespace ampp {
 /**
  *@details GPU_TestCard 
  */
-GPU_TestCard::GPU_TestCard()
-    : _current(0), _doThrow(false)
+GPU_TestCard::GPU_TestCard( bool phased )
+    : _current(0), _phased(phased), _doThrow(false)
 {
 }
 
@@ -48,5 +48,25 @@ GPU_Job* GPU_TestCard::currentJob() const {
     return _current;
 }
 
+void GPU_TestCard::stageIn( GPU_Job* job ) {
+    QMutexLocker lock(&_mutex);
+    _stagedIn.append( job );
+}
+
+void GPU_TestCard::stageOut( GPU_Job* job ) {
+    QMutexLocker lock(&_mutex);
+    _stagedOut.append( job );
+}
+
+QList<GPU_Job*> GPU_TestCard::stagedIn() const {
+    QMutexLocker lock(&_mutex);
+    return _stagedIn;
+}
+
+QList<GPU_Job*> GPU_TestCard::stagedOut() const {
+    QMutexLocker lock(&_mutex);
+    return _stagedOut;
+}
+
 } // namespace ampp
 } // namespace pelican
@@ -0,0 +1,150 @@
+#include "LockFreeQueueTest.h"
+#include "LockFreeQueue.h"
+
+#include <QtCore/QThread>
+#include <vector>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LockFreeQueueTest );
+/**
+ *@details LockFreeQueueTest
+ */
+LockFreeQueueTest::LockFreeQueueTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+LockFreeQueueTest::~LockFreeQueueTest()
+{
+}
+
+void LockFreeQueueTest::setUp()
+{
+}
+
+void LockFreeQueueTest::tearDown()
+{
+}
+
+void LockFreeQueueTest::test_fill()
+{
+    // capacity is rounded up to a power of 2
+    LockFreeQueue<int> queue(6);
+    CPPUNIT_ASSERT_EQUAL( 8U, queue.capacity() );
+    CPPUNIT_ASSERT( queue.empty() );
+    int value;
+    CPPUNIT_ASSERT( ! queue.pop(value) );
+
+    // fill it
+    for( int i = 0; i < 8; ++i )
+        CPPUNIT_ASSERT( queue.push(i) );
+    CPPUNIT_ASSERT( ! queue.push(8) );
+    CPPUNIT_ASSERT_EQUAL( 8U, queue.size() );
+
+    // read back in order, several times round
+    for( int i = 0; i < 20; ++i ) {
+        CPPUNIT_ASSERT( queue.pop(value) );
+        CPPUNIT_ASSERT_EQUAL( i, value );
+        CPPUNIT_ASSERT( queue.push(i + 8) );
+    }
+    CPPUNIT_ASSERT_EQUAL( 8U, queue.size() );
+}
+
+namespace {
+struct IsEven {
+    bool operator()(const int& v) const { return v % 2 == 0; }
+};
+}
+
+void LockFreeQueueTest::test_popIf()
+{
+    // only the head is ever taken
+    LockFreeQueue<int> queue(4);
+    queue.push(1);
+    queue.push(2);
+    int value = -1;
+    CPPUNIT_ASSERT( ! queue.popIf(value, IsEven()) );
+    CPPUNIT_ASSERT_EQUAL( -1, value );
+    CPPUNIT_ASSERT_EQUAL( 2U, queue.size() );
+    CPPUNIT_ASSERT( queue.pop(value) );
+    CPPUNIT_ASSERT_EQUAL( 1, value );
+    CPPUNIT_ASSERT( queue.popIf(value, IsEven()) );
+    CPPUNIT_ASSERT_EQUAL( 2, value );
+    CPPUNIT_ASSERT( queue.empty() );
+}
+
+namespace {
+class QueueProducer : public QThread
+{
+    public:
+        QueueProducer(LockFreeQueue<unsigned>* queue, unsigned first, unsigned n)
+            : _queue(queue), _first(first), _n(n) {}
+        void run() {
+            for( unsigned i = _first; i < _first + _n; ) {
+                if( _queue->push(i) ) ++i;
+                else yieldCurrentThread();
+            }
+        }
+    private:
+        LockFreeQueue<unsigned>* _queue;
+        unsigned _first;
+        unsigned _n;
+};
+
+class QueueConsumer : public QThread
+{
+    public:
+        QueueConsumer(LockFreeQueue<unsigned>* queue, std::vector<char>* seen,
+                      unsigned n)
+            : _queue(queue), _seen(seen), _n(n) {}
+        void run() {
+            for( unsigned i = 0; i < _n; ) {
+                unsigned value;
+                if( ! _queue->pop(value) ) { yieldCurrentThread(); continue; }
+                (*_seen)[value] = 1;
+                ++i;
+            }
+        }
+    private:
+        LockFreeQueue<unsigned>* _queue;
+        std::vector<char>* _seen;
+        unsigned _n;
+};
+}
+
+void LockFreeQueueTest::test_threaded()
+{
+    // 4 producers and 4 consumers: every item is taken exactly once
+    const unsigned n = 50000, threads = 4;
+    LockFreeQueue<unsigned> queue(64);
+    std::vector<char> seen(n * threads, 0);
+    std::vector<QueueProducer*> producers;
+    std::vector<QueueConsumer*> consumers;
+    for( unsigned t = 0; t < threads; ++t ) {
+        producers.push_back(new QueueProducer(&queue, t * n, n));
+        consumers.push_back(new QueueConsumer(&queue, &seen, n));
+    }
+    for( unsigned t = 0; t < threads; ++t ) {
+        consumers[t]->start();
+        producers[t]->start();
+    }
+    for( unsigned t = 0; t < threads; ++t ) {
+        producers[t]->wait();
+        consumers[t]->wait();
+        delete producers[t];
+        delete consumers[t];
+    }
+    CPPUNIT_ASSERT( queue.empty() );
+    for( unsigned i = 0; i < n * threads; ++i )
+        CPPUNIT_ASSERT( seen[i] );
+}
+
+} // namespace ampp
+} // namespace pelican
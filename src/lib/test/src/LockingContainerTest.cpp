@@ -1,5 +1,7 @@
 #include "LockingContainerTest.h"
 #include "LockingContainer.hpp"
+#include "LockingPtrContainer.hpp"
+#include <QtCore/QThread>
 
 
 namespace pelican {
@@ -52,5 +54,140 @@ void LockingContainerTest::test_method()
     CPPUNIT_ASSERT_EQUAL(3, *b3 );
 }
 
+void LockingContainerTest::test_timeout()
+{
+    // next() gives up after the timeout when nothing is unlocked
+    QList<int> buf; buf << 1;
+    LockingContainer<int> buffer(&buf);
+    int* b1 = buffer.next(0);
+    CPPUNIT_ASSERT_EQUAL(1, *b1 );
+    CPPUNIT_ASSERT( buffer.next(20) == 0 );
+    CPPUNIT_ASSERT_EQUAL( 1UL, buffer.blocked() );
+    CPPUNIT_ASSERT( ! buffer.waitAllAvailable(20) );
+    buffer.unlock( b1 );
+    CPPUNIT_ASSERT( buffer.waitAllAvailable(0) );
+
+    int a = 1, b = 2;
+    QList<int*> ptrs; ptrs << &a << &b;
+    LockingPtrContainer<int> ptrBuffer(&ptrs);
+    CPPUNIT_ASSERT_EQUAL( &a, ptrBuffer.next() );
+    CPPUNIT_ASSERT_EQUAL( &b, ptrBuffer.next() );
+    CPPUNIT_ASSERT( ptrBuffer.next(20) == 0 );
+    CPPUNIT_ASSERT_EQUAL( 1UL, ptrBuffer.blocked() );
+    CPPUNIT_ASSERT_EQUAL( 0, ptrBuffer.numberAvailable() );
+}
+
+namespace {
+template<class Container, typename T>
+class Unlocker : public QThread
+{
+    public:
+        Unlocker(Container* container, QList<T*> items)
+            : _container(container), _items(items) {}
+        void run() {
+            foreach( T* item, _items ) {
+                msleep(10);
+                _container->unlock(item);
+            }
+        }
+    private:
+        Container* _container;
+        QList<T*> _items;
+};
+}
+
+void LockingContainerTest::test_waitAllAvailable()
+{
+    // waitAllAvailable() returns once everything has been unlocked from
+    // another thread
+    QList<int> buf; buf << 1 << 2 << 3;
+    LockingContainer<int> buffer(&buf);
+    QList<int*> taken;
+    taken << buffer.next() << buffer.next() << buffer.next();
+    Unlocker<LockingContainer<int>, int> unlocker(&buffer, taken);
+    unlocker.start();
+    CPPUNIT_ASSERT( buffer.waitAllAvailable() );
+    CPPUNIT_ASSERT( buffer.allAvailable() );
+    unlocker.wait();
+
+    int a = 1, b = 2;
+    QList<int*> ptrs; ptrs << &a << &b;
+    LockingPtrContainer<int> ptrBuffer(&ptrs);
+    QList<int*> ptrsTaken;
+    ptrsTaken << ptrBuffer.next() << ptrBuffer.next();
+    Unlocker<LockingPtrContainer<int>, int> ptrUnlocker(&ptrBuffer, ptrsTaken);
+    ptrUnlocker.start();
+    CPPUNIT_ASSERT( ptrBuffer.next() != 0 ); // waits for the first unlock
+    ptrUnlocker.wait();
+    CPPUNIT_ASSERT( ! ptrBuffer.allAvailable() );
+    CPPUNIT_ASSERT_EQUAL( 1, ptrBuffer.numberAvailable() );
+}
+
+void LockingContainerTest::test_occupancy()
+{
+    QList<int> buf; buf << 1 << 2 << 3;
+    LockingContainer<int> buffer(&buf);
+    MetricGauge inUse;
+    buffer.setGauge( &inUse );
+    CPPUNIT_ASSERT_EQUAL( 3, buffer.size() );
+    int* b1 = buffer.tryNext();
+    int* b2 = buffer.tryNext();
+    CPPUNIT_ASSERT_EQUAL( 1, buffer.numberAvailable() );
+    CPPUNIT_ASSERT_EQUAL( (qint64)2, inUse.value() );
+    buffer.unlock( b1 );
+    buffer.unlock( b2 );
+    CPPUNIT_ASSERT_EQUAL( 3, buffer.numberAvailable() );
+    CPPUNIT_ASSERT_EQUAL( 1, buffer.lowWater() );
+    CPPUNIT_ASSERT_EQUAL( (qint64)0, inUse.value() );
+    CPPUNIT_ASSERT_EQUAL( (qint64)2, inUse.max() );
+
+    // tryNext() on an empty pool returns 0 without counting as blocked
+    int a = 1;
+    QList<int*> ptrs; ptrs << &a;
+    LockingPtrContainer<int> ptrBuffer(&ptrs);
+    CPPUNIT_ASSERT_EQUAL( &a, ptrBuffer.tryNext() );
+    CPPUNIT_ASSERT( ptrBuffer.tryNext() == 0 );
+    CPPUNIT_ASSERT_EQUAL( 0UL, ptrBuffer.blocked() );
+    CPPUNIT_ASSERT_EQUAL( &ptrs, ptrBuffer.rawBuffer() );
+}
+
+namespace {
+class User : public QThread
+{
+    public:
+        User(LockingPtrContainer<int>* pool, int n) : _pool(pool), _n(n) {}
+        void run() {
+            for( int i = 0; i < _n; ++i ) {
+                int* item = _pool->next();
+                __sync_fetch_and_add( item, 1 );
+                _pool->unlock( item );
+            }
+        }
+    private:
+        LockingPtrContainer<int>* _pool;
+        int _n;
+};
+}
+
+void LockingContainerTest::test_threaded()
+{
+    // more users than objects: every use is counted once
+    int items[4] = { 0, 0, 0, 0 };
+    QList<int*> ptrs;
+    for( int i = 0; i < 4; ++i ) ptrs << &items[i];
+    LockingPtrContainer<int> pool(&ptrs);
+    QList<User*> users;
+    for( int i = 0; i < 8; ++i ) {
+        users << new User( &pool, 10000 );
+        users.last()->start();
+    }
+    foreach( User* user, users ) {
+        user->wait();
+        delete user;
+    }
+    CPPUNIT_ASSERT( pool.allAvailable() );
+    CPPUNIT_ASSERT_EQUAL( 80000, items[0] + items[1] + items[2] + items[3] );
+}
+
 } // namespace ampp
 } // namespace pelican
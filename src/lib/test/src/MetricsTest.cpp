@@ -0,0 +1,197 @@
+#include "MetricsTest.h"
+#include "Metrics.h"
+#include "timer.h"
+
+#include <QtCore/QThread>
+#include <sstream>
+#include <string>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( MetricsTest );
+/**
+ *@details MetricsTest
+ */
+MetricsTest::MetricsTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+MetricsTest::~MetricsTest()
+{
+}
+
+void MetricsTest::setUp()
+{
+}
+
+void MetricsTest::tearDown()
+{
+}
+
+namespace {
+class CountingThread : public QThread
+{
+    public:
+        CountingThread(MetricCounter& counter) : _counter(counter) {}
+        void run() {
+            for( int i = 0; i < 100000; ++i ) _counter.add();
+        }
+    private:
+        MetricCounter& _counter;
+};
+
+class ProfilingThread : public QThread
+{
+    public:
+        ProfilingThread(MetricProfile& profile) : _profile(profile) {}
+        void run() {
+            for( quint64 i = 1; i <= 1000; ++i ) _profile.record(i * 1000);
+        }
+    private:
+        MetricProfile& _profile;
+};
+} // namespace
+
+void MetricsTest::test_counter()
+{
+    MetricCounter counter;
+    CPPUNIT_ASSERT_EQUAL( (quint64)0, counter.value() );
+    counter.add(5);
+    counter.add();
+    CPPUNIT_ASSERT_EQUAL( (quint64)6, counter.value() );
+
+    // concurrent increments are not lost
+    CountingThread a(counter), b(counter);
+    a.start(); b.start();
+    a.wait(); b.wait();
+    CPPUNIT_ASSERT_EQUAL( (quint64)200006, counter.value() );
+
+    // gauges keep their maximum
+    MetricGauge gauge;
+    gauge.set(10);
+    gauge.set(3);
+    CPPUNIT_ASSERT_EQUAL( (qint64)3, gauge.value() );
+    CPPUNIT_ASSERT_EQUAL( (qint64)10, gauge.max() );
+}
+
+void MetricsTest::test_histogram()
+{
+    MetricHistogram histogram;
+    CPPUNIT_ASSERT_EQUAL( (quint64)0, histogram.percentile(0.5) );
+
+    histogram.record(0.0);        // bucket 0
+    histogram.record(3.0e-6);     // [2,4) us
+    histogram.record(1.0e-3);     // 1000 us in [512,1024)
+    histogram.record(1.5e-3);     // 1500 us in [1024,2048)
+    CPPUNIT_ASSERT_EQUAL( (quint64)4, histogram.count() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, histogram.bucket(0) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, histogram.bucket(1) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, histogram.bucket(9) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, histogram.bucket(10) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1500, histogram.max() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1024, histogram.percentile(0.5) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)2048, histogram.percentile(0.99) );
+}
+
+void MetricsTest::test_profile()
+{
+    // buckets are within 1/8 of the durations they hold
+    for( quint64 ns = 1; ns < ((quint64)1 << 39); ns = ns * 3 / 2 + 1 ) {
+        unsigned k = MetricProfile::bucketOf(ns);
+        CPPUNIT_ASSERT( ns < MetricProfile::upperBound(k) );
+        CPPUNIT_ASSERT( k == 0 || ns >= MetricProfile::upperBound(k - 1) );
+        CPPUNIT_ASSERT( MetricProfile::upperBound(k) - ns <= ns / 8 + 1 );
+    }
+    CPPUNIT_ASSERT_EQUAL( MetricProfile::nBuckets - 1,
+                          MetricProfile::bucketOf((quint64)1 << 62) );
+
+    // 1..1000 us from each of four threads, in their own shards
+    MetricProfile profile;
+    CPPUNIT_ASSERT_EQUAL( (quint64)0, profile.percentile(0.5) );
+    profile.setBudget(990e-6);
+    ProfilingThread a(profile), b(profile), c(profile), d(profile);
+    a.start(); b.start(); c.start(); d.start();
+    a.wait(); b.wait(); c.wait(); d.wait();
+    CPPUNIT_ASSERT_EQUAL( (quint64)4000, profile.count() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)4 * 500500 * 1000, profile.total() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1000000, profile.max() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)40, profile.overBudget() );
+    quint64 p50 = profile.percentile(0.5);
+    quint64 p99 = profile.percentile(0.99);
+    quint64 p999 = profile.percentile(0.999);
+    CPPUNIT_ASSERT( p50 > 500000 && p50 <= 500000 * 9 / 8 );
+    CPPUNIT_ASSERT( p99 > 990000 && p99 <= 1000000 );
+    CPPUNIT_ASSERT( p999 >= p99 && p999 <= 1000000 );
+
+    // written out with its percentiles and budget
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    registry.profile("MetricsTest.profile").setBudget(1e-3);
+    registry.profile("MetricsTest.profile").record(2000000);
+    std::ostringstream text;
+    registry.write(text);
+    std::string report = text.str();
+    CPPUNIT_ASSERT( report.find("profile MetricsTest.profile count 1 mean_us 2000.000 "
+                                "p50_us 2000.000 p99_us 2000.000 p999_us 2000.000 "
+                                "max_us 2000.000 budget_us 1000 over 1\n") != std::string::npos );
+}
+
+void MetricsTest::test_timer()
+{
+    // the timer.h timers only record while profiling is on
+    bool enabled = MetricProfile::enabled();
+    TimerData data("MetricsTest.timerData");
+    MetricProfile::setEnabled(false);
+    timerStart(&data);
+    timerUpdate(&data);
+    CPPUNIT_ASSERT_EQUAL( 0, data.counter );
+    MetricProfile::setEnabled(true);
+    timerStart(&data);
+    timerUpdate(&data);
+    timerUpdate(&data); // no timerStart: ignored
+    CPPUNIT_ASSERT_EQUAL( 1, data.counter );
+    CPPUNIT_ASSERT( data.profile() == &MetricsRegistry::instance().profile("MetricsTest.timerData") );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, data.profile()->count() );
+    { ProfileTimer timer(*data.profile()); }
+    CPPUNIT_ASSERT_EQUAL( (quint64)2, data.profile()->count() );
+    MetricProfile::setEnabled(false);
+    { ProfileTimer timer(*data.profile()); }
+    CPPUNIT_ASSERT_EQUAL( (quint64)2, data.profile()->count() );
+
+    // a stage timer always records, in the histogram of the same name, and
+    // only goes in the profile while profiling is on
+    CPPUNIT_ASSERT( data.histogram() == &MetricsRegistry::instance().histogram("MetricsTest.timerData") );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, data.histogram()->count() );
+    stageTimerStart(&data);
+    timerUpdate(&data);
+    CPPUNIT_ASSERT_EQUAL( 2, data.counter );
+    CPPUNIT_ASSERT_EQUAL( (quint64)2, data.histogram()->count() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)2, data.profile()->count() );
+    MetricProfile::setEnabled(enabled);
+}
+
+void MetricsTest::test_registry()
+{
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    MetricCounter& counter = registry.counter("MetricsTest.counter");
+    CPPUNIT_ASSERT( &counter == &registry.counter("MetricsTest.counter") );
+    counter.add(7);
+    registry.gauge("MetricsTest.gauge").set(2);
+    { MetricTimer timer(registry.histogram("MetricsTest.timer")); }
+
+    std::ostringstream text;
+    registry.write(text);
+    std::string report = text.str();
+    CPPUNIT_ASSERT( report.find("counter MetricsTest.counter 7\n") != std::string::npos );
+    CPPUNIT_ASSERT( report.find("gauge MetricsTest.gauge 2 max 2\n") != std::string::npos );
+    CPPUNIT_ASSERT( report.find("histogram MetricsTest.timer count 1 ") != std::string::npos );
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,196 @@
+#include "PPFInverterTest.h"
+
+#include "PPFInverter.h"
+#include "PPFChanneliser.h"
+#include "SpectrumDataSet.h"
+#include "TimeSeriesDataSet.h"
+
+#include "pelican/utility/ConfigNode.h"
+
+#include <complex>
+#include <cmath>
+
+namespace pelican {
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PPFInverterTest);
+
+typedef std::complex<float> Complex;
+
+namespace {
+// Fills a sub-band/polarisation stream with the sum of tones at the given
+// frequencies (cycles per sample), starting from sample number t0.
+void fillTones(TimeSeriesDataSetC32* data, unsigned s, unsigned p,
+        const double* freqs, unsigned nFreqs, unsigned long t0)
+{
+    unsigned nTimes = data->nTimesPerBlock();
+    for (unsigned b = 0; b < data->nTimeBlocks(); ++b) {
+        Complex* times = data->timeSeriesData(b, s, p);
+        for (unsigned t = 0; t < nTimes; ++t) {
+            double i = t0 + b * nTimes + t;
+            std::complex<double> sum(0.0, 0.0);
+            for (unsigned f = 0; f < nFreqs; ++f)
+                sum += std::polar(1.0, 2.0 * M_PI * freqs[f] * i);
+            times[t] = Complex(sum.real(), sum.imag());
+        }
+    }
+}
+
+unsigned peakChannel(const Complex* spectrum, unsigned nChannels)
+{
+    unsigned peak = 0;
+    for (unsigned c = 1; c < nChannels; ++c)
+        if (std::abs(spectrum[c]) > std::abs(spectrum[peak])) peak = c;
+    return peak;
+}
+}
+
+/**
+ * @details
+ * Tests the configuration checks.
+ */
+void PPFInverterTest::test_configuration()
+{
+    {
+        ConfigNode config(_configXml("PPFInverter", 16, 8));
+        PPFInverter inverter(config);
+        CPPUNIT_ASSERT_EQUAL(16u, inverter._nOutChannels);
+        CPPUNIT_ASSERT_EQUAL(8u, inverter._nTaps);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, inverter._passband, 1e-12);
+    }
+    {
+        // Odd numbers of output channels do not have a centre channel.
+        ConfigNode config(_configXml("PPFInverter", 15, 8));
+        CPPUNIT_ASSERT_THROW(PPFInverter inverter(config), QString);
+    }
+}
+
+/**
+ * @details
+ * Channelises tones within the passband of their channels, inverts the
+ * spectra and compares the result with the input, delayed by nTaps - 1
+ * blocks. Both filters start empty, so the first 2 (nTaps - 1) output
+ * blocks are a start-up transient and are not compared. Two blobs are
+ * processed in turn to check the filter history is carried over.
+ */
+void PPFInverterTest::test_reconstruct()
+{
+    unsigned nChannels = 16;
+    unsigned nTaps = 8;
+    unsigned nBlocks = 32;
+    unsigned nPols = 2;
+    unsigned delay = nTaps - 1;
+
+    ConfigNode channeliserConfig(_configXml("PPFChanneliser", nChannels, nTaps));
+    ConfigNode inverterConfig(_configXml("PPFInverter", nChannels, nTaps));
+    PPFChanneliser channeliser(channeliserConfig);
+    PPFInverter inverter(inverterConfig);
+
+    // Tones at the centre and part way to the edge of their channels.
+    double freqs[2][3] = {
+        { 2.0 / nChannels, 7.2 / nChannels, -4.15 / nChannels },
+        { -1.0 / nChannels, 5.1 / nChannels, 3.8 / nChannels }
+    };
+
+    TimeSeriesDataSetC32 input[2];
+    double spectrumRate = 1.0e-3;
+    double errorPower = 0.0, signalPower = 0.0;
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        input[i].resize(nBlocks, 1, nPols, nChannels);
+        input[i].setBlockRate(spectrumRate / nChannels);
+        input[i].setLofarTimestamp(i * nBlocks * spectrumRate);
+        for (unsigned p = 0; p < nPols; ++p)
+            fillTones(&input[i], 0, p, freqs[p], 3, i * nBlocks * nChannels);
+
+        SpectrumDataSetC32 spectra;
+        TimeSeriesDataSetC32 output;
+        channeliser.run(&input[i], &spectra);
+        inverter.run(&spectra, &output);
+
+        CPPUNIT_ASSERT_EQUAL(nBlocks, output.nTimeBlocks());
+        CPPUNIT_ASSERT_EQUAL(nChannels, output.nTimesPerBlock());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(spectrumRate / nChannels,
+                output.getBlockRate(), 1e-12);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(input[i].getLofarTimestamp()
+                - delay * spectrumRate, output.getLofarTimestamp(), 1e-12);
+
+        // Output block b of this blob is input block (b - delay) overall.
+        for (unsigned b = 0; b < nBlocks; ++b)
+        {
+            unsigned block = i * nBlocks + b;
+            if (block < 2 * delay) continue;
+            unsigned in = block - delay;
+            for (unsigned p = 0; p < nPols; ++p)
+            {
+                const Complex* x = input[in / nBlocks].timeSeriesData(in % nBlocks, 0, p);
+                const Complex* z = output.timeSeriesData(b, 0, p);
+                for (unsigned t = 0; t < nChannels; ++t) {
+                    errorPower += std::norm(z[t] - x[t]);
+                    signalPower += std::norm(x[t]);
+                    CPPUNIT_ASSERT(std::abs(z[t] - x[t]) < 0.05);
+                }
+            }
+        }
+    }
+    CPPUNIT_ASSERT(std::sqrt(errorPower / signalPower) < 5.0e-3);
+}
+
+/**
+ * @details
+ * Re-channelises 64 channel spectra of a tone to 16 channels and checks the
+ * tone is in the same channel as when channelising the time series to 16
+ * channels directly (DC in channel 8 in both).
+ */
+void PPFInverterTest::test_rechannelise()
+{
+    unsigned nTaps = 8;
+    unsigned nBlocks = 32;
+    double freq = 3.0 / 16;
+
+    ConfigNode coarseConfig(_configXml("PPFChanneliser", 64, nTaps));
+    ConfigNode fineConfig(_configXml("PPFChanneliser", 16, nTaps));
+    ConfigNode inverterConfig(_configXml("PPFInverter", 16, nTaps));
+    PPFChanneliser coarse(coarseConfig);
+    PPFChanneliser fine(fineConfig);
+    PPFInverter inverter(inverterConfig);
+
+    TimeSeriesDataSetC32 input64, input16;
+    input64.resize(nBlocks, 1, 1, 64);
+    input16.resize(nBlocks * 4, 1, 1, 16);
+    fillTones(&input64, 0, 0, &freq, 1, 0);
+    fillTones(&input16, 0, 0, &freq, 1, 0);
+
+    SpectrumDataSetC32 spectra64, direct, rechannelised;
+    coarse.run(&input64, &spectra64);
+    fine.run(&input16, &direct);
+    inverter.run(&spectra64, &rechannelised);
+
+    CPPUNIT_ASSERT_EQUAL(nBlocks * 4, rechannelised.nTimeBlocks());
+    CPPUNIT_ASSERT_EQUAL(16u, rechannelised.nChannels());
+    CPPUNIT_ASSERT_EQUAL(8u + 3u, peakChannel(direct.spectrumData(
+            nBlocks * 4 - 1, 0, 0), 16));
+    // Past the start-up transient of the inversion.
+    for (unsigned b = 2 * (nTaps - 1) * 4; b < nBlocks * 4; ++b)
+        CPPUNIT_ASSERT_EQUAL(8u + 3u, peakChannel(rechannelised.spectrumData(
+                b, 0, 0), 16));
+}
+
+/**
+ * @details
+ * Generates the configuration XML for the channeliser or the inverter.
+ */
+QString PPFInverterTest::_configXml(const QString& module,
+        unsigned nChannels, unsigned nTaps)
+{
+    QString xml =
+            "<" + module + ">"
+            "	<outputChannelsPerSubband value=\"" + QString::number(nChannels) + "\"/>"
+            "	<processingThreads value=\"1\"/>"
+            "	<filter nTaps=\"" + QString::number(nTaps) + "\" filterWindow=\"kaiser\"/>"
+            "</" + module + ">";
+    return xml;
+}
+
+} // namespace ampp
+} // namespace pelican
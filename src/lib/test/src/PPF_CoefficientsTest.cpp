@@ -97,5 +97,48 @@ void PolyphaseCoefficientsTest::test_loadCoeffFile()
     QFile::remove(fileName);
 }
 
+
+/**
+ * @details
+ * Tests writing and reading back the binary coefficient cache.
+ */
+void PolyphaseCoefficientsTest::test_cache()
+{
+    unsigned nTaps     = 8;
+    unsigned nChannels = 64;
+    QString fileName = PolyphaseCoefficients::cacheFileName(".", nTaps,
+            nChannels, PolyphaseCoefficients::KAISER);
+
+    // Use Case
+    // No cache file present.
+    QFile::remove(fileName);
+    PolyphaseCoefficients cached;
+    CPPUNIT_ASSERT(!cached.loadCache(fileName, nTaps, nChannels,
+            PolyphaseCoefficients::KAISER));
+
+    // Use Case
+    // Cache written from generated coefficients reads back identically.
+    PolyphaseCoefficients coeff;
+    coeff.genereateFilter(nTaps, nChannels, PolyphaseCoefficients::KAISER);
+    coeff.saveCache(fileName, PolyphaseCoefficients::KAISER);
+    CPPUNIT_ASSERT(cached.loadCache(fileName, nTaps, nChannels,
+            PolyphaseCoefficients::KAISER));
+    CPPUNIT_ASSERT_EQUAL(coeff.size(), cached.size());
+    CPPUNIT_ASSERT_EQUAL(nTaps, cached.nTaps());
+    CPPUNIT_ASSERT_EQUAL(nChannels, cached.nChannels());
+    for (unsigned i = 0; i < coeff.size(); ++i)
+        CPPUNIT_ASSERT_EQUAL(coeff.ptr()[i], cached.ptr()[i]);
+
+    // Use Case
+    // Cache for different parameters is rejected.
+    CPPUNIT_ASSERT(!cached.loadCache(fileName, nTaps, 2 * nChannels,
+            PolyphaseCoefficients::KAISER));
+    CPPUNIT_ASSERT(!cached.loadCache(fileName, nTaps, nChannels,
+            PolyphaseCoefficients::HAMMING));
+
+    // Clean up.
+    QFile::remove(fileName);
+}
+
 } // namespace ampp
 } // namespace pelican
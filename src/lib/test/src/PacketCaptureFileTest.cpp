@@ -0,0 +1,144 @@
+#include "PacketCaptureFileTest.h"
+#include "PacketCaptureFile.h"
+#include "UdpBatchReceiver.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <vector>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PacketCaptureFileTest );
+/**
+ *@details PacketCaptureFileTest
+ */
+PacketCaptureFileTest::PacketCaptureFileTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+PacketCaptureFileTest::~PacketCaptureFileTest()
+{
+}
+
+void PacketCaptureFileTest::setUp()
+{
+    _fileName = QDir::tempPath() + "/_PacketCaptureFileTest_.cap";
+}
+
+void PacketCaptureFileTest::tearDown()
+{
+    QFile::remove(_fileName);
+}
+
+void PacketCaptureFileTest::test_roundTrip()
+{
+    // Use Case:
+    // packets of varying length are read back in order with their times,
+    // those longer than the snap length being cut short
+    unsigned snapLength = 100;
+    std::vector<char> packet(150);
+    {
+        PacketCaptureWriter writer;
+        CPPUNIT_ASSERT( writer.open(_fileName, snapLength) );
+        for( unsigned p = 0; p < 10; ++p ) {
+            for( unsigned i = 0; i < packet.size(); ++i )
+                packet[i] = (char)(p + i);
+            quint64 time = PacketCaptureFile::now() + 1000 * p;
+            CPPUNIT_ASSERT( writer.write(&packet[0], 15 * (p + 1), time) );
+        }
+        CPPUNIT_ASSERT_EQUAL( (quint64)10, writer.packets() );
+    }
+
+    PacketCaptureReader reader;
+    CPPUNIT_ASSERT( reader.open(_fileName) );
+    CPPUNIT_ASSERT_EQUAL( snapLength, reader.header().snapLength );
+    for( unsigned pass = 0; pass < 2; ++pass ) {
+        PacketCaptureReader::Record record;
+        quint64 previous = 0;
+        for( unsigned p = 0; p < 10; ++p ) {
+            CPPUNIT_ASSERT( reader.read(record) );
+            CPPUNIT_ASSERT_EQUAL( 15 * (p + 1), record.length );
+            CPPUNIT_ASSERT_EQUAL( qMin(15 * (p + 1), snapLength), record.captured );
+            CPPUNIT_ASSERT( record.time >= previous );
+            previous = record.time;
+            for( unsigned i = 0; i < record.captured; ++i )
+                CPPUNIT_ASSERT_EQUAL( (char)(p + i), record.data[i] );
+        }
+        CPPUNIT_ASSERT( ! reader.read(record) );
+        reader.rewind();
+    }
+}
+
+void PacketCaptureFileTest::test_truncated()
+{
+    // Use Case:
+    // a recording interrupted part way through a packet ends at the last
+    // complete one; other files are refused
+    std::vector<char> packet(64, 1);
+    {
+        PacketCaptureWriter writer;
+        CPPUNIT_ASSERT( writer.open(_fileName, 9000) );
+        writer.write(&packet[0], packet.size(), 0);
+        writer.write(&packet[0], packet.size(), 0);
+    }
+    QFile file(_fileName);
+    file.resize(file.size() - 10);
+
+    PacketCaptureReader reader;
+    CPPUNIT_ASSERT( reader.open(_fileName) );
+    PacketCaptureReader::Record record;
+    CPPUNIT_ASSERT( reader.read(record) );
+    CPPUNIT_ASSERT( ! reader.read(record) );
+    reader.close();
+
+    QFile text(_fileName);
+    text.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    text.write("not a capture file at all");
+    text.close();
+    CPPUNIT_ASSERT( ! reader.open(_fileName) );
+    CPPUNIT_ASSERT( ! reader.error().isEmpty() );
+}
+
+void PacketCaptureFileTest::test_gather()
+{
+    // Use Case:
+    // a replayed packet keeps the same segments as one received from the
+    // socket
+    UdpBatchReceiver receiver(4);
+    receiver.addSegment(8, true);
+    receiver.addSegment(16, false);
+    receiver.addSegment(32, true);
+    receiver.addSegment(8, false);
+
+    std::vector<char> packet(64);
+    for( unsigned i = 0; i < packet.size(); ++i ) packet[i] = (char)i;
+    std::vector<char> slot(receiver.slotSize(), -1);
+    CPPUNIT_ASSERT_EQUAL( 64U, receiver.gather(&packet[0], 64, &slot[0]) );
+    for( unsigned i = 0; i < 8; ++i )
+        CPPUNIT_ASSERT_EQUAL( (char)i, slot[i] );
+    for( unsigned i = 0; i < 32; ++i )
+        CPPUNIT_ASSERT_EQUAL( (char)(24 + i), slot[8 + i] );
+
+    // A short packet fills what it can.
+    std::fill(slot.begin(), slot.end(), -1);
+    CPPUNIT_ASSERT_EQUAL( 30U, receiver.gather(&packet[0], 30, &slot[0]) );
+    CPPUNIT_ASSERT_EQUAL( (char)24, slot[8] );
+    CPPUNIT_ASSERT_EQUAL( (char)29, slot[13] );
+    CPPUNIT_ASSERT_EQUAL( (char)-1, slot[14] );
+
+    // A long packet fills the slot and is reported at its full length.
+    packet.resize(80, 0);
+    CPPUNIT_ASSERT_EQUAL( 80U, receiver.gather(&packet[0], 80, &slot[0]) );
+    CPPUNIT_ASSERT_EQUAL( (char)55, slot[39] );
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,190 @@
+#include "PacketReorderWindowTest.h"
+#include "PacketReorderWindow.h"
+
+#include <vector>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PacketReorderWindowTest );
+/**
+ *@details PacketReorderWindowTest
+ */
+PacketReorderWindowTest::PacketReorderWindowTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+PacketReorderWindowTest::~PacketReorderWindowTest()
+{
+}
+
+void PacketReorderWindowTest::setUp()
+{
+}
+
+void PacketReorderWindowTest::tearDown()
+{
+}
+
+void PacketReorderWindowTest::test_inOrder()
+{
+    // packets received straight into their slots are claimed without a copy
+    std::vector<char> chunk(8 * 4);
+    PacketReorderWindow window(8, 4, 2, 4);
+    window.start(&chunk[0]);
+    window.resync(100);
+    CPPUNIT_ASSERT_EQUAL( (quint64)100, window.first() );
+
+    unsigned count;
+    CPPUNIT_ASSERT_EQUAL( 0U, window.freeRun(count) );
+    CPPUNIT_ASSERT_EQUAL( 8U, count );
+    for( unsigned i = 0; i < 5; ++i )
+        CPPUNIT_ASSERT( window.claim(100 + i, i) );
+    CPPUNIT_ASSERT_EQUAL( 5U, window.freeRun(count) );
+    CPPUNIT_ASSERT_EQUAL( 3U, count );
+
+    // a packet in the wrong slot is not claimed
+    CPPUNIT_ASSERT( ! window.claim(107, 5) );
+    CPPUNIT_ASSERT( ! window.complete() );
+    for( unsigned i = 5; i < 8; ++i )
+        CPPUNIT_ASSERT( window.claim(100 + i, i) );
+    CPPUNIT_ASSERT( window.complete() );
+    CPPUNIT_ASSERT_EQUAL( 8U, window.placed() );
+
+    // the next chunk follows on
+    window.start(&chunk[0]);
+    CPPUNIT_ASSERT_EQUAL( (quint64)108, window.first() );
+    CPPUNIT_ASSERT_EQUAL( 0U, window.placed() );
+    CPPUNIT_ASSERT( ! window.complete() );
+}
+
+void PacketReorderWindowTest::test_reorder()
+{
+    std::vector<char> chunk(8 * 4);
+    PacketReorderWindow window(8, 4, 2, 4);
+    window.start(&chunk[0]);
+    window.resync(0);
+
+    // swapped, duplicated and missing packets
+    unsigned order[] = { 0, 2, 1, 1, 3, 5, 6, 7 };
+    for( unsigned i = 0; i < 8; ++i ) {
+        char packet[4] = { (char)order[i], 0, 0, 0 };
+        PacketReorderWindow::Status status = window.place(order[i], packet);
+        CPPUNIT_ASSERT_EQUAL( (int)( i == 3 ? PacketReorderWindow::Duplicate
+                                            : PacketReorderWindow::Placed ), (int)status );
+    }
+    CPPUNIT_ASSERT_EQUAL( 1UL, window.duplicates() );
+    for( unsigned i = 0; i < 8; ++i ) {
+        CPPUNIT_ASSERT_EQUAL( i != 4, window.filled(i) );
+        if( i != 4 ) CPPUNIT_ASSERT_EQUAL( (char)i, chunk[i * 4] );
+    }
+
+    // the last slot has arrived but the gap may still be filled within the window
+    CPPUNIT_ASSERT( ! window.complete() );
+    char packet[4] = { 4, 0, 0, 0 };
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Placed, (int)window.place(4, packet) );
+    CPPUNIT_ASSERT( window.complete() );
+    CPPUNIT_ASSERT_EQUAL( (char)4, chunk[16] );
+
+    // packets for a chunk already started are late
+    window.start(&chunk[0]);
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Late, (int)window.place(7, packet) );
+    CPPUNIT_ASSERT_EQUAL( 1UL, window.late() );
+}
+
+void PacketReorderWindowTest::test_carry()
+{
+    std::vector<char> chunk(8 * 4);
+    PacketReorderWindow window(8, 4, 2, 3);
+    window.start(&chunk[0]);
+    window.resync(0);
+    for( unsigned i = 0; i < 6; ++i )
+        CPPUNIT_ASSERT( window.claim(i, i) );
+
+    // packets for the next chunk are kept until the window closes the chunk
+    char packet[4] = { 9, 0, 0, 0 };
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Carried, (int)window.place(9, packet) );
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Duplicate, (int)window.place(9, packet) );
+    CPPUNIT_ASSERT( window.complete() );
+    CPPUNIT_ASSERT( ! window.filled(6) );
+    CPPUNIT_ASSERT( ! window.filled(7) );
+    packet[0] = 8;
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Carried, (int)window.place(8, packet) );
+    packet[0] = 12;
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Carried, (int)window.place(12, packet) );
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Overflow, (int)window.place(13, packet) );
+    CPPUNIT_ASSERT_EQUAL( 3U, window.carried() );
+
+    // and placed in their slots when it starts
+    window.start(&chunk[0]);
+    CPPUNIT_ASSERT_EQUAL( 3U, window.placed() );
+    CPPUNIT_ASSERT_EQUAL( 0U, window.carried() );
+    CPPUNIT_ASSERT_EQUAL( (char)8, chunk[0] );
+    CPPUNIT_ASSERT_EQUAL( (char)9, chunk[4] );
+    CPPUNIT_ASSERT_EQUAL( (char)12, chunk[16] );
+
+    // new packets are still expected from the start of the chunk
+    unsigned count;
+    CPPUNIT_ASSERT_EQUAL( 2U, window.freeRun(count) );
+    CPPUNIT_ASSERT_EQUAL( 2U, count );
+}
+
+void PacketReorderWindowTest::test_resync()
+{
+    std::vector<char> chunk(8 * 4);
+    PacketReorderWindow window(8, 4, 2, 4);
+    window.start(&chunk[0]);
+    window.resync(1000);
+    CPPUNIT_ASSERT( window.claim(1000, 0) );
+    CPPUNIT_ASSERT( window.claim(1001, 1) );
+
+    // a jump closes the current chunk and starts the next one at the new packet
+    window.resync(50);
+    CPPUNIT_ASSERT( window.complete() );
+    char packet[4] = { 1, 0, 0, 0 };
+    CPPUNIT_ASSERT_EQUAL( (int)PacketReorderWindow::Carried, (int)window.place(50, packet) );
+    window.start(&chunk[0]);
+    CPPUNIT_ASSERT_EQUAL( (quint64)50, window.first() );
+    CPPUNIT_ASSERT_EQUAL( 1U, window.placed() );
+    CPPUNIT_ASSERT( window.filled(0) );
+}
+
+void PacketReorderWindowTest::test_position()
+{
+    // a stream starting at sample 403 with a packet every 4 samples, so
+    // that the samples are not multiples of 4
+    std::vector<char> chunk(8 * 4);
+    PacketReorderWindow window(8, 4, 2, 4);
+    window.start(&chunk[0]);
+    window.resync(100, 403, 4);
+    CPPUNIT_ASSERT_EQUAL( (quint64)403, window.position(0) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)423, window.position(5) );
+    CPPUNIT_ASSERT( window.claim(100, 0) );
+
+    // the next chunk follows on
+    window.start(&chunk[0]);
+    CPPUNIT_ASSERT_EQUAL( (quint64)435, window.position(0) );
+    CPPUNIT_ASSERT( window.claim(108, 0) );
+
+    // a resync in the middle of a chunk (say for a new rate) leaves the
+    // rest of the chunk as it was and applies from the next chunk
+    window.resync(300, 1201, 2);
+    CPPUNIT_ASSERT_EQUAL( (quint64)439, window.position(1) );
+    window.start(&chunk[0]);
+    CPPUNIT_ASSERT_EQUAL( (quint64)300, window.first() );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1201, window.position(0) );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1215, window.position(7) );
+
+    // by default the position is the sequence number
+    window.resync(7);
+    CPPUNIT_ASSERT_EQUAL( (quint64)11, window.position(4) );
+}
+
+} // namespace ampp
+} // namespace pelican
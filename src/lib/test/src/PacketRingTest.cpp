@@ -0,0 +1,243 @@
+#include "PacketRingTest.h"
+#include "PacketRing.h"
+
+#include <QtCore/QThread>
+#include <QtCore/QTime>
+#include <cstring>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PacketRingTest );
+/**
+ *@details PacketRingTest
+ */
+PacketRingTest::PacketRingTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+PacketRingTest::~PacketRingTest()
+{
+}
+
+void PacketRingTest::setUp()
+{
+}
+
+void PacketRingTest::tearDown()
+{
+}
+
+void PacketRingTest::test_fill()
+{
+    // capacity is rounded up to a power of 2
+    PacketRing ring(6, 16);
+    CPPUNIT_ASSERT_EQUAL( 8U, ring.capacity() );
+    CPPUNIT_ASSERT_EQUAL( 0U, ring.size() );
+
+    // empty ring has nothing to read
+    unsigned count = 4;
+    const unsigned* lengths;
+    ring.readSlots(count, lengths);
+    CPPUNIT_ASSERT_EQUAL( 0U, count );
+
+    // fill it
+    count = 10;
+    char* slots = ring.writeSlots(count);
+    CPPUNIT_ASSERT_EQUAL( 8U, count );
+    std::vector<unsigned> l(8);
+    for( unsigned i = 0; i < 8; ++i ) {
+        slots[i * 16] = (char)i;
+        l[i] = 100 + i;
+    }
+    ring.commit(8, &l[0]);
+    CPPUNIT_ASSERT_EQUAL( 8U, ring.size() );
+
+    // full ring has no space
+    count = 1;
+    ring.writeSlots(count);
+    CPPUNIT_ASSERT_EQUAL( 0U, count );
+    ring.countDropped(3);
+    CPPUNIT_ASSERT_EQUAL( 3UL, ring.dropped() );
+
+    // read back in order
+    count = 3;
+    const char* data = ring.readSlots(count, lengths);
+    CPPUNIT_ASSERT_EQUAL( 3U, count );
+    for( unsigned i = 0; i < 3; ++i ) {
+        CPPUNIT_ASSERT_EQUAL( (char)i, data[i * 16] );
+        CPPUNIT_ASSERT_EQUAL( 100 + i, lengths[i] );
+    }
+    ring.release(3);
+    CPPUNIT_ASSERT_EQUAL( 5U, ring.size() );
+}
+
+void PacketRingTest::test_wrap()
+{
+    PacketRing ring(4, 4);
+    std::vector<unsigned> l(4, 4);
+    unsigned next = 0, expected = 0;
+    for( unsigned iter = 0; iter < 10; ++iter ) {
+        // write 3, read 3: the runs of slots must stop at the end of the buffer
+        unsigned written = 0;
+        while( written < 3 ) {
+            unsigned count = 3 - written;
+            char* slots = ring.writeSlots(count);
+            CPPUNIT_ASSERT( count > 0 );
+            for( unsigned i = 0; i < count; ++i )
+                std::memcpy(slots + i * 4, &(++next), sizeof(unsigned));
+            ring.commit(count, &l[0]);
+            written += count;
+        }
+        unsigned read = 0;
+        while( read < 3 ) {
+            unsigned count = 3;
+            const unsigned* lengths;
+            const char* slots = ring.readSlots(count, lengths);
+            CPPUNIT_ASSERT( count > 0 );
+            for( unsigned i = 0; i < count; ++i ) {
+                unsigned value;
+                std::memcpy(&value, slots + i * 4, sizeof(unsigned));
+                CPPUNIT_ASSERT_EQUAL( ++expected, value );
+            }
+            ring.release(count);
+            read += count;
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL( 0U, ring.size() );
+}
+
+namespace {
+class RingProducer : public QThread
+{
+    public:
+        RingProducer(PacketRing* ring, unsigned n) : _ring(ring), _n(n) {}
+        void run() {
+            unsigned length = sizeof(unsigned);
+            for( unsigned i = 0; i < _n; ) {
+                unsigned count = 1;
+                char* slot = _ring->writeSlots(count);
+                if( count == 0 ) { _ring->waitForSpace(); continue; }
+                std::memcpy(slot, &i, sizeof(unsigned));
+                _ring->commit(1, &length);
+                ++i;
+            }
+        }
+    private:
+        PacketRing* _ring;
+        unsigned _n;
+};
+}
+
+void PacketRingTest::test_threaded()
+{
+    const unsigned n = 100000;
+    PacketRing ring(64, sizeof(unsigned));
+    RingProducer producer(&ring, n);
+    producer.start();
+    for( unsigned expected = 0; expected < n; ) {
+        unsigned count = 16;
+        const unsigned* lengths;
+        const char* slots = ring.readSlots(count, lengths);
+        if( count == 0 ) {
+            CPPUNIT_ASSERT( ring.waitForData(10000) );
+            continue;
+        }
+        for( unsigned i = 0; i < count; ++i ) {
+            unsigned value;
+            std::memcpy(&value, slots + i * sizeof(unsigned), sizeof(unsigned));
+            CPPUNIT_ASSERT_EQUAL( expected++, value );
+        }
+        ring.release(count);
+    }
+    producer.wait();
+    CPPUNIT_ASSERT_EQUAL( 0U, ring.size() );
+}
+
+namespace {
+// Commits one packet to the ring after a delay.
+class DelayedProducer : public QThread
+{
+    public:
+        DelayedProducer(PacketRing* ring, unsigned long ms) : _ring(ring), _ms(ms) {}
+        void run() {
+            msleep(_ms);
+            unsigned count = 1, length = 4;
+            _ring->writeSlots(count);
+            if( count ) _ring->commit(1, &length);
+        }
+    private:
+        PacketRing* _ring;
+        unsigned long _ms;
+};
+
+// Releases one packet from the ring after a delay.
+class DelayedConsumer : public QThread
+{
+    public:
+        DelayedConsumer(PacketRing* ring, unsigned long ms) : _ring(ring), _ms(ms) {}
+        void run() {
+            msleep(_ms);
+            unsigned count = 1;
+            const unsigned* lengths;
+            _ring->readSlots(count, lengths);
+            if( count ) _ring->release(1);
+        }
+    private:
+        PacketRing* _ring;
+        unsigned long _ms;
+};
+}
+
+void PacketRingTest::test_wait()
+{
+    PacketRing ring(2, 4);
+    unsigned lengths[] = { 4, 4 };
+    {
+        // Use case:
+        // Nothing is committed: the wait times out
+        QTime timer;
+        timer.start();
+        CPPUNIT_ASSERT( ! ring.waitForData(50) );
+        CPPUNIT_ASSERT( timer.elapsed() >= 45 );
+    }
+    {
+        // Use case:
+        // A packet is committed while waiting: the wait returns early
+        DelayedProducer producer(&ring, 50);
+        QTime timer;
+        timer.start();
+        producer.start();
+        CPPUNIT_ASSERT( ring.waitForData(10000) );
+        CPPUNIT_ASSERT( timer.elapsed() < 5000 );
+        CPPUNIT_ASSERT_EQUAL( 1U, ring.size() );
+        producer.wait();
+    }
+    {
+        // Use case:
+        // The ring is full: waiting for space times out until the
+        // consumer releases a slot
+        unsigned count = 1;
+        ring.writeSlots(count);
+        CPPUNIT_ASSERT_EQUAL( 1U, count );
+        ring.commit(1, lengths);
+        CPPUNIT_ASSERT( ! ring.waitForSpace(50) );
+        DelayedConsumer consumer(&ring, 50);
+        QTime timer;
+        timer.start();
+        consumer.start();
+        CPPUNIT_ASSERT( ring.waitForSpace(10000) );
+        CPPUNIT_ASSERT( timer.elapsed() < 5000 );
+        CPPUNIT_ASSERT_EQUAL( 1U, ring.size() );
+        consumer.wait();
+    }
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,139 @@
+#include "RealTimeWatchdogTest.h"
+#include "RealTimeWatchdog.h"
+
+#include <boost/bind.hpp>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RealTimeWatchdogTest );
+/**
+ *@details RealTimeWatchdogTest
+ */
+RealTimeWatchdogTest::RealTimeWatchdogTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+RealTimeWatchdogTest::~RealTimeWatchdogTest()
+{
+}
+
+void RealTimeWatchdogTest::setUp()
+{
+}
+
+void RealTimeWatchdogTest::tearDown()
+{
+}
+
+namespace {
+// records the calls made to a policy, as "+name" to shed and "-name" to restore
+class Recorder
+{
+    public:
+        void shed( const QString& name, bool on ) {
+            calls.append( ( on ? "+" : "-" ) + name );
+        }
+        QList<QString> calls;
+};
+}
+
+void RealTimeWatchdogTest::test_deficit()
+{
+    // the deficit is the backlog, never below zero; no shedding while disabled
+    Recorder r;
+    RealTimeWatchdog watchdog("RealTimeWatchdogTest.deficit");
+    watchdog.addPolicy( "a", boost::bind( &Recorder::shed, &r, QString("a"), _1 ) );
+    CPPUNIT_ASSERT( ! watchdog.enabled() );
+    watchdog.record( 1.5, 1.0 );
+    watchdog.record( 1.5, 1.0 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, watchdog.deficit(), 1e-9 );
+    watchdog.record( 0.75, 1.0 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.75, watchdog.deficit(), 1e-9 );
+    watchdog.record( 0.0, 1.0 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, watchdog.deficit(), 1e-9 );
+    for( int i = 0; i < 100; ++i ) watchdog.record( 2.0, 1.0 );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 100.0, watchdog.deficit(), 1e-9 );
+    CPPUNIT_ASSERT_EQUAL( 0, watchdog.level() );
+    CPPUNIT_ASSERT_EQUAL( 0, r.calls.size() );
+    MetricGauge& deficit = MetricsRegistry::instance().gauge("RealTimeWatchdogTest.deficit.deficit_us");
+    CPPUNIT_ASSERT_EQUAL( (qint64)100000000, deficit.value() );
+}
+
+void RealTimeWatchdogTest::test_shedding()
+{
+    Recorder r;
+    {
+        RealTimeWatchdog watchdog("RealTimeWatchdogTest.shedding");
+        watchdog.addPolicy( "a", boost::bind( &Recorder::shed, &r, QString("a"), _1 ) );
+        watchdog.addPolicy( "b", boost::bind( &Recorder::shed, &r, QString("b"), _1 ) );
+        watchdog.setEnabled( true );
+        watchdog.setThresholds( 2.0, 3, 5 );
+
+        // over budget, but not yet overload budgets behind
+        watchdog.record( 2.0, 1.0 );
+        watchdog.record( 2.0, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 0, watchdog.level() );
+        // sustain iterations behind: shed the first policy, then the next
+        for( int i = 0; i < 3; ++i ) watchdog.record( 2.0, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 1, watchdog.level() );
+        for( int i = 0; i < 3; ++i ) watchdog.record( 2.0, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 2, watchdog.level() );
+        // nothing left to shed
+        for( int i = 0; i < 6; ++i ) watchdog.record( 2.0, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 2, watchdog.level() );
+        CPPUNIT_ASSERT_EQUAL( 2, r.calls.size() );
+
+        // under budget while the backlog drains: nothing changes
+        while( watchdog.deficit() > 0.0 ) watchdog.record( 0.5, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 2, watchdog.level() );
+        // recover iterations caught up (counting the one that cleared the
+        // backlog): restore the last policy shed
+        for( int i = 0; i < 3; ++i ) watchdog.record( 0.5, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 2, watchdog.level() );
+        watchdog.record( 0.5, 1.0 );
+        CPPUNIT_ASSERT_EQUAL( 1, watchdog.level() );
+        CPPUNIT_ASSERT_EQUAL( 3, r.calls.size() );
+        CPPUNIT_ASSERT( r.calls[0] == "+a" );
+        CPPUNIT_ASSERT( r.calls[1] == "+b" );
+        CPPUNIT_ASSERT( r.calls[2] == "-b" );
+        MetricCounter& shed = MetricsRegistry::instance().counter("RealTimeWatchdogTest.shedding.shed");
+        CPPUNIT_ASSERT_EQUAL( (quint64)2, shed.value() );
+    }
+    // the rest is restored when the watchdog goes
+    CPPUNIT_ASSERT_EQUAL( 4, r.calls.size() );
+    CPPUNIT_ASSERT( r.calls[3] == "-a" );
+}
+
+void RealTimeWatchdogTest::test_policies()
+{
+    // setPolicies() picks and orders the policies, restoring any applied
+    Recorder r;
+    RealTimeWatchdog watchdog("RealTimeWatchdogTest.policies");
+    watchdog.addPolicy( "a", boost::bind( &Recorder::shed, &r, QString("a"), _1 ) );
+    watchdog.addPolicy( "b", boost::bind( &Recorder::shed, &r, QString("b"), _1 ) );
+    CPPUNIT_ASSERT( watchdog.policies() == QStringList() << "a" << "b" );
+    watchdog.setEnabled( true );
+    watchdog.setThresholds( 1.0, 1, 1 );
+    watchdog.record( 3.0, 1.0 );
+    CPPUNIT_ASSERT_EQUAL( 1, watchdog.level() );
+
+    watchdog.setPolicies( QStringList() << "b" << "unknown" );
+    CPPUNIT_ASSERT_EQUAL( 0, watchdog.level() );
+    CPPUNIT_ASSERT( watchdog.policies() == QStringList() << "b" );
+    watchdog.record( 3.0, 1.0 );
+    CPPUNIT_ASSERT_EQUAL( 1, watchdog.level() );
+    CPPUNIT_ASSERT_EQUAL( 3, r.calls.size() );
+    CPPUNIT_ASSERT( r.calls[0] == "+a" );
+    CPPUNIT_ASSERT( r.calls[1] == "-a" );
+    CPPUNIT_ASSERT( r.calls[2] == "+b" );
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,206 @@
+#include "SharedChunkRingTest.h"
+#include "SharedChunkRing.h"
+
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QTime>
+#include <unistd.h>
+#include <cstring>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SharedChunkRingTest );
+/**
+ *@details SharedChunkRingTest
+ */
+SharedChunkRingTest::SharedChunkRingTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+SharedChunkRingTest::~SharedChunkRingTest()
+{
+}
+
+void SharedChunkRingTest::setUp()
+{
+}
+
+void SharedChunkRingTest::tearDown()
+{
+}
+
+static QString ringName()
+{
+    return QString("SharedChunkRingTest.") + QString::number(getpid());
+}
+
+void SharedChunkRingTest::test_transfer()
+{
+    // Use Case:
+    // chunks written by the producer are seen in place by a consumer
+    // attached to the same segment, in order and with their sequence numbers
+    SharedChunkRing producer(ringName(), 4, 1000);
+    SharedChunkRing consumer(ringName());
+    CPPUNIT_ASSERT_EQUAL( 4U, consumer.slots() );
+    CPPUNIT_ASSERT_EQUAL( (size_t)1000, consumer.slotSize() );
+
+    size_t bytes;
+    quint64 sequence;
+    CPPUNIT_ASSERT( consumer.next(bytes, sequence, 0) == 0 );
+    for( unsigned chunk = 0; chunk < 10; ++chunk ) {
+        char* slot = producer.acquire(0);
+        CPPUNIT_ASSERT( slot != 0 );
+        std::memset(slot, chunk, 100 + chunk);
+        CPPUNIT_ASSERT_EQUAL( (quint64)chunk, producer.publish(100 + chunk) );
+        CPPUNIT_ASSERT_EQUAL( 1U, consumer.size() );
+
+        const char* data = consumer.next(bytes, sequence, 0);
+        CPPUNIT_ASSERT( data != 0 );
+        CPPUNIT_ASSERT_EQUAL( (size_t)(100 + chunk), bytes );
+        CPPUNIT_ASSERT_EQUAL( (quint64)chunk, sequence );
+        CPPUNIT_ASSERT_EQUAL( (char)chunk, data[0] );
+        CPPUNIT_ASSERT_EQUAL( (char)chunk, data[bytes - 1] );
+        consumer.release();
+    }
+    CPPUNIT_ASSERT_EQUAL( 0U, consumer.size() );
+}
+
+void SharedChunkRingTest::test_backPressure()
+{
+    // Use Case:
+    // the producer cannot overwrite chunks the consumer has not released;
+    // chunks it gives up on leave a gap in the sequence numbers
+    SharedChunkRing producer(ringName(), 2, 64);
+    SharedChunkRing consumer(ringName());
+    for( unsigned chunk = 0; chunk < 2; ++chunk ) {
+        CPPUNIT_ASSERT( producer.acquire(0) != 0 );
+        producer.publish(64);
+    }
+    CPPUNIT_ASSERT( producer.acquire(0) == 0 );
+    CPPUNIT_ASSERT( producer.acquire(5) == 0 );
+    producer.skip();
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, consumer.skipped() );
+
+    size_t bytes;
+    quint64 sequence;
+    consumer.next(bytes, sequence, 0);
+    CPPUNIT_ASSERT_EQUAL( (quint64)0, sequence );
+    consumer.release();
+    CPPUNIT_ASSERT( producer.acquire(0) != 0 );
+    producer.publish(64);
+
+    consumer.next(bytes, sequence, 0);
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, sequence );
+    consumer.release();
+    consumer.next(bytes, sequence, 0);
+    CPPUNIT_ASSERT_EQUAL( (quint64)3, sequence );
+    consumer.release();
+}
+
+void SharedChunkRingTest::test_attach()
+{
+    // Use Case:
+    // attaching fails without a producer, and the segment goes away with it
+    CPPUNIT_ASSERT_THROW( SharedChunkRing consumer(ringName()), QString );
+    {
+        SharedChunkRing producer(ringName(), 1, 16);
+        SharedChunkRing consumer(ringName());
+    }
+    CPPUNIT_ASSERT_THROW( SharedChunkRing consumer(ringName()), QString );
+    CPPUNIT_ASSERT_THROW( SharedChunkRing producer(ringName(), 0, 16), QString );
+}
+
+namespace {
+// Publishes (or, on the consumer side, releases) one chunk after a delay.
+class DelayedChunk : public QThread
+{
+    public:
+        DelayedChunk(SharedChunkRing* ring, bool publish)
+            : _ring(ring), _publish(publish) {}
+        void run() {
+            msleep(50);
+            if( _publish ) {
+                if( _ring->acquire(0) ) _ring->publish(8);
+            }
+            else {
+                size_t bytes;
+                quint64 sequence;
+                if( _ring->next(bytes, sequence, 0) ) _ring->release();
+            }
+        }
+    private:
+        SharedChunkRing* _ring;
+        bool _publish;
+};
+}
+
+void SharedChunkRingTest::test_wait()
+{
+    // Use Case:
+    // either side blocks until the other publishes or releases a chunk, or
+    // until its timeout
+    SharedChunkRing producer(ringName(), 1, 64);
+    SharedChunkRing consumer(ringName());
+    size_t bytes;
+    quint64 sequence;
+    QTime timer;
+    timer.start();
+    CPPUNIT_ASSERT( consumer.next(bytes, sequence, 50) == 0 );
+    CPPUNIT_ASSERT( timer.elapsed() >= 45 );
+    {
+        DelayedChunk publisher(&producer, true);
+        timer.start();
+        publisher.start();
+        CPPUNIT_ASSERT( consumer.next(bytes, sequence, 10000) != 0 );
+        CPPUNIT_ASSERT( timer.elapsed() < 5000 );
+        CPPUNIT_ASSERT_EQUAL( (quint64)0, sequence );
+        publisher.wait();
+    }
+    CPPUNIT_ASSERT( producer.acquire(50) == 0 );
+    {
+        DelayedChunk releaser(&consumer, false);
+        timer.start();
+        releaser.start();
+        CPPUNIT_ASSERT( producer.acquire(10000) != 0 );
+        CPPUNIT_ASSERT( timer.elapsed() < 5000 );
+        releaser.wait();
+    }
+}
+
+void SharedChunkRingTest::test_stale()
+{
+    // Use Case:
+    // a consumer sees that the producer has been restarted with a new
+    // segment, or has gone, and can attach to the new one
+    SharedChunkRing* first = new SharedChunkRing(ringName(), 2, 64);
+    SharedChunkRing consumer(ringName());
+    CPPUNIT_ASSERT( ! consumer.stale() );
+    {
+        SharedChunkRing second(ringName(), 2, 64);
+        CPPUNIT_ASSERT( consumer.stale() );
+        // the old producer leaves the new segment in place
+        delete first;
+        SharedChunkRing again(ringName());
+        CPPUNIT_ASSERT( ! again.stale() );
+        CPPUNIT_ASSERT( second.acquire(0) != 0 );
+        second.publish(8);
+        size_t bytes;
+        quint64 sequence;
+        CPPUNIT_ASSERT( again.next(bytes, sequence, 0) != 0 );
+        again.release();
+
+        // a closed ring does not block
+        CPPUNIT_ASSERT( consumer.next(bytes, sequence, -1) == 0 );
+    }
+    CPPUNIT_ASSERT( consumer.stale() );
+}
+
+} // namespace ampp
+} // namespace pelican
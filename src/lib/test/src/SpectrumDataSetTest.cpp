@@ -187,6 +187,58 @@ void SpectrumDataSetTest::test_serialise_deserialise()
 }
 
 
+/**
+ * @details
+ * Tests the layout aware accessors and that the interleaved layout
+ * serialises in the default polarisation block order.
+ */
+void SpectrumDataSetTest::test_layout()
+{
+     unsigned nTimeBlocks = 3;
+     unsigned nSubbands = 4;
+     unsigned nPolarisations = 2;
+     unsigned nChannels = 8;
+     SpectrumDataSetC32 spectra;
+     spectra.resize(nTimeBlocks, nSubbands, nPolarisations, nChannels);
+     spectra.setLayout(SpectrumDataSetC32::PolarisationInterleaved);
+     CPPUNIT_ASSERT_EQUAL(nPolarisations, spectra.channelStride());
+
+     for (unsigned b = 0; b < nTimeBlocks; ++b)
+         for (unsigned s = 0; s < nSubbands; ++s)
+             for (unsigned p = 0; p < nPolarisations; ++p)
+                 for (unsigned c = 0; c < nChannels; ++c)
+                     spectra.sample(b, s, p, c) = Complex(b * 1000 + s * 100 + p * 10 + c, p);
+
+     // Use Case
+     // Polarisations of a channel are adjacent in memory.
+     const Complex* data = spectra.data();
+     CPPUNIT_ASSERT_EQUAL(Complex(1203, 0), data[spectra.sampleIndex(1, 2, 0, 3)]);
+     CPPUNIT_ASSERT_EQUAL(spectra.sampleIndex(1, 2, 0, 3) + 1,
+             spectra.sampleIndex(1, 2, 1, 3));
+     const Complex* spectrum = spectra.spectrumData(1, 2, 1);
+     CPPUNIT_ASSERT_EQUAL(Complex(1215, 1), spectrum[5 * spectra.channelStride()]);
+
+     // Use Case
+     // Serialised data is in the default layout.
+     QBuffer serialBlob;
+     serialBlob.open(QBuffer::WriteOnly);
+     spectra.serialise(serialBlob);
+     CPPUNIT_ASSERT_EQUAL((qint64)spectra.serialisedBytes(), serialBlob.size());
+     serialBlob.close();
+     serialBlob.open(QBuffer::ReadOnly);
+     SpectrumDataSetC32 spectraNew;
+     spectraNew.deserialise(serialBlob, QSysInfo::ByteOrder);
+     CPPUNIT_ASSERT(spectraNew.layout() == SpectrumDataSetC32::PolarisationBlocks);
+     for (unsigned b = 0; b < nTimeBlocks; ++b)
+         for (unsigned s = 0; s < nSubbands; ++s)
+             for (unsigned p = 0; p < nPolarisations; ++p) {
+                 const Complex* d = spectraNew.spectrumData(b, s, p);
+                 for (unsigned c = 0; c < nChannels; ++c)
+                     CPPUNIT_ASSERT_EQUAL(spectra.sample(b, s, p, c), d[c]);
+             }
+}
+
+
 void SpectrumDataSetTest::test_access_performance()
 {
     unsigned nTimeBlocks = 16384;
@@ -0,0 +1,172 @@
+#include "StageGraphTest.h"
+#include "StageGraph.h"
+#include "pelican/data/DataBlob.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <boost/bind.hpp>
+#include <sys/time.h>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( StageGraphTest );
+/**
+ *@details StageGraphTest
+ */
+StageGraphTest::StageGraphTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+StageGraphTest::~StageGraphTest()
+{
+}
+
+void StageGraphTest::setUp()
+{
+}
+
+void StageGraphTest::tearDown()
+{
+}
+
+namespace {
+class TestBlob : public DataBlob
+{
+    public:
+        TestBlob( int i ) : DataBlob("TestBlob"), id(i) {}
+        int id;
+};
+
+// records the blobs each functor sees, in order
+class Recorder
+{
+    public:
+        Recorder() : sleep(0), failOn(-1) {}
+        void record( DataBlob* blob ) {
+            if( sleep ) QThread::usleep( sleep );
+            int id = static_cast<TestBlob*>(blob)->id;
+            if( id == failOn ) throw QString("failed on %1").arg(id);
+            QMutexLocker lock(&_mutex);
+            seen.append( id );
+        }
+        void failed( DataBlob* blob, const QString& stage ) {
+            QMutexLocker lock(&_mutex);
+            seen.append( static_cast<TestBlob*>(blob)->id );
+            stages.append( stage );
+        }
+        QList<int> seen;
+        QList<QString> stages;
+        unsigned long sleep;
+        int failOn;
+    private:
+        QMutex _mutex;
+};
+
+double now() {
+    struct timeval t;
+    gettimeofday( &t, 0 );
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+}
+
+void StageGraphTest::test_order()
+{
+    // one thread per stage: every stage sees the blobs in the order pushed
+    QList<TestBlob*> blobs;
+    for( int i = 0; i < 20; ++i ) blobs.append( new TestBlob(i) );
+    Recorder a, b, done;
+    {
+        StageGraph graph("StageGraphTest.order");
+        graph.addStage( "a", boost::bind( &Recorder::record, &a, _1 ), 1, 2 );
+        graph.addStage( "b", boost::bind( &Recorder::record, &b, _1 ), 1, 2 );
+        graph.onCompletion( boost::bind( &Recorder::record, &done, _1 ) );
+        CPPUNIT_ASSERT_EQUAL( 6, graph.capacity() );
+        foreach( TestBlob* blob, blobs ) {
+            graph.push( blob );
+        }
+        CPPUNIT_ASSERT( graph.waitForCompletion() );
+        CPPUNIT_ASSERT_EQUAL( 0, graph.inFlight() );
+    }
+    CPPUNIT_ASSERT_EQUAL( 20, done.seen.size() );
+    for( int i = 0; i < 20; ++i ) {
+        CPPUNIT_ASSERT_EQUAL( i, a.seen[i] );
+        CPPUNIT_ASSERT_EQUAL( i, b.seen[i] );
+        CPPUNIT_ASSERT_EQUAL( i, done.seen[i] );
+    }
+    foreach( TestBlob* blob, blobs ) delete blob;
+}
+
+void StageGraphTest::test_overlap()
+{
+    // two 20ms stages: the time per blob is that of one stage, not two
+    QList<TestBlob*> blobs;
+    for( int i = 0; i < 10; ++i ) blobs.append( new TestBlob(i) );
+    Recorder a, b;
+    a.sleep = b.sleep = 20000;
+    StageGraph graph("StageGraphTest.overlap");
+    graph.addStage( "a", boost::bind( &Recorder::record, &a, _1 ) );
+    graph.addStage( "b", boost::bind( &Recorder::record, &b, _1 ) );
+    double start = now();
+    foreach( TestBlob* blob, blobs ) {
+        graph.push( blob );
+    }
+    CPPUNIT_ASSERT( graph.waitForCompletion() );
+    double elapsed = now() - start;
+    CPPUNIT_ASSERT( elapsed < 0.35 ); // 0.4 run one after the other
+    CPPUNIT_ASSERT_EQUAL( 10, b.seen.size() );
+    foreach( TestBlob* blob, blobs ) delete blob;
+}
+
+void StageGraphTest::test_failure()
+{
+    // a blob that fails in a stage skips the rest but still completes
+    QList<TestBlob*> blobs;
+    for( int i = 0; i < 5; ++i ) blobs.append( new TestBlob(i) );
+    Recorder a, b, failed, done;
+    a.failOn = 3;
+    StageGraph graph("StageGraphTest.failure");
+    graph.addStage( "a", boost::bind( &Recorder::record, &a, _1 ) );
+    graph.addStage( "b", boost::bind( &Recorder::record, &b, _1 ) );
+    graph.onFailure( boost::bind( &Recorder::failed, &failed, _1, _2 ) );
+    graph.onCompletion( boost::bind( &Recorder::record, &done, _1 ) );
+    MetricCounter& errors = MetricsRegistry::instance().counter("StageGraphTest.failure.a.errors");
+    foreach( TestBlob* blob, blobs ) {
+        graph.push( blob );
+    }
+    CPPUNIT_ASSERT( graph.waitForCompletion( 10000 ) );
+    CPPUNIT_ASSERT_EQUAL( 4, b.seen.size() );
+    CPPUNIT_ASSERT( ! b.seen.contains(3) );
+    CPPUNIT_ASSERT_EQUAL( 5, done.seen.size() );
+    CPPUNIT_ASSERT_EQUAL( 1, failed.seen.size() );
+    CPPUNIT_ASSERT_EQUAL( 3, failed.seen[0] );
+    CPPUNIT_ASSERT( failed.stages[0] == "a" );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1, errors.value() );
+    foreach( TestBlob* blob, blobs ) delete blob;
+}
+
+void StageGraphTest::test_synchronous()
+{
+    // not async: push() returns once the blob has been through
+    TestBlob blob(7);
+    Recorder a, done;
+    StageGraph graph("StageGraphTest.synchronous");
+    graph.addStage( "a", boost::bind( &Recorder::record, &a, _1 ) );
+    graph.onCompletion( boost::bind( &Recorder::record, &done, _1 ) );
+    graph.setAsync( false );
+    CPPUNIT_ASSERT_EQUAL( 1, graph.capacity() );
+    graph.push( &blob );
+    CPPUNIT_ASSERT_EQUAL( 1, a.seen.size() );
+    CPPUNIT_ASSERT_EQUAL( 1, done.seen.size() );
+    CPPUNIT_ASSERT_EQUAL( 0, graph.inFlight() );
+}
+
+} // namespace ampp
+} // namespace pelican
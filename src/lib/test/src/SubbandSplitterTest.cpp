@@ -0,0 +1,116 @@
+#include "SubbandSplitterTest.h"
+#include "SubbandSplitter.h"
+
+#include <QtCore/QString>
+#include <vector>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SubbandSplitterTest );
+/**
+ *@details SubbandSplitterTest
+ */
+SubbandSplitterTest::SubbandSplitterTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+SubbandSplitterTest::~SubbandSplitterTest()
+{
+}
+
+void SubbandSplitterTest::setUp()
+{
+}
+
+void SubbandSplitterTest::tearDown()
+{
+}
+
+void SubbandSplitterTest::test_scatter()
+{
+    // Use Case:
+    // three streams each get their own sub-bands, in the slot asked for
+    unsigned nSubbands = 61, subbandBytes = 64;
+    SubbandSplitter splitter(nSubbands, subbandBytes);
+    CPPUNIT_ASSERT_EQUAL( 0U, splitter.addStream(0, 19) );
+    CPPUNIT_ASSERT_EQUAL( 1U, splitter.addStream(20, 39) );
+    CPPUNIT_ASSERT_EQUAL( 2U, splitter.addStream(40, 60) );
+    CPPUNIT_ASSERT_EQUAL( 3U, splitter.streams() );
+    CPPUNIT_ASSERT_EQUAL( 21U, splitter.subbands(2) );
+
+    UDPPacket packet;
+    packet.header.timestamp = 1234;
+    packet.header.blockSequenceNumber = 16;
+    packet.header.nrBeamlets = nSubbands;
+    for( unsigned i = 0; i < nSubbands * subbandBytes; ++i )
+        packet.data[i] = (char)(i / subbandBytes);
+
+    unsigned nSlots = 4, slot = 2;
+    std::vector<std::vector<char> > chunks(3);
+    std::vector<char*> outputs(3);
+    for( unsigned s = 0; s < 3; ++s ) {
+        chunks[s].resize(nSlots * splitter.packetSize(s), -1);
+        outputs[s] = &chunks[s][0];
+    }
+    splitter.scatter(packet, &outputs[0], slot);
+
+    unsigned first[] = { 0, 20, 40 };
+    for( unsigned s = 0; s < 3; ++s ) {
+        const char* out = outputs[s] + slot * splitter.packetSize(s);
+        const UDPPacket::Header* header = reinterpret_cast<const UDPPacket::Header*>(out);
+        CPPUNIT_ASSERT_EQUAL( 1234U, (unsigned)header->timestamp );
+        CPPUNIT_ASSERT_EQUAL( 16U, (unsigned)header->blockSequenceNumber );
+        CPPUNIT_ASSERT_EQUAL( splitter.subbands(s), (unsigned)header->nrBeamlets );
+        const char* data = out + sizeof(UDPPacket::Header);
+        for( unsigned i = 0; i < splitter.subbands(s) * subbandBytes; ++i )
+            CPPUNIT_ASSERT_EQUAL( (char)(first[s] + i / subbandBytes), data[i] );
+        // the other slots are untouched
+        CPPUNIT_ASSERT_EQUAL( (char)-1, outputs[s][0] );
+        CPPUNIT_ASSERT_EQUAL( (char)-1, chunks[s].back() );
+    }
+}
+
+void SubbandSplitterTest::test_fill()
+{
+    // Use Case:
+    // a missing packet is written as an empty packet to every stream
+    SubbandSplitter splitter(8, 32);
+    splitter.addStream(0, 3);
+    splitter.addStream(4, 7);
+    std::vector<char> a(splitter.packetSize(0), -1), b(splitter.packetSize(1), -1);
+    char* outputs[] = { &a[0], &b[0] };
+
+    UDPPacket::Header header;
+    header.timestamp = 99;
+    header.blockSequenceNumber = 32;
+    splitter.fill(header, outputs, 0);
+    for( unsigned s = 0; s < 2; ++s ) {
+        const UDPPacket::Header* h = reinterpret_cast<const UDPPacket::Header*>(outputs[s]);
+        CPPUNIT_ASSERT_EQUAL( 99U, (unsigned)h->timestamp );
+        CPPUNIT_ASSERT_EQUAL( 4U, (unsigned)h->nrBeamlets );
+        for( unsigned i = sizeof(UDPPacket::Header); i < splitter.packetSize(s); ++i )
+            CPPUNIT_ASSERT_EQUAL( (char)0, outputs[s][i] );
+    }
+}
+
+void SubbandSplitterTest::test_ranges()
+{
+    // Use Case:
+    // ranges outside the packet are refused
+    SubbandSplitter splitter(8, 32);
+    CPPUNIT_ASSERT_THROW( splitter.addStream(4, 8), QString );
+    CPPUNIT_ASSERT_THROW( splitter.addStream(5, 4), QString );
+    CPPUNIT_ASSERT_EQUAL( 0U, splitter.streams() );
+    // as are packets larger than a UDP packet
+    CPPUNIT_ASSERT_THROW( SubbandSplitter(1000, 1000), QString );
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -0,0 +1,141 @@
+#include "WorkerPoolTest.h"
+#include "WorkerPool.h"
+#include "ProcessingChain1.h"
+
+#include <QtCore/QThread>
+#include <boost/bind.hpp>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace pelican {
+
+namespace ampp {
+
+CPPUNIT_TEST_SUITE_REGISTRATION( WorkerPoolTest );
+/**
+ *@details WorkerPoolTest
+ */
+WorkerPoolTest::WorkerPoolTest()
+    : CppUnit::TestFixture()
+{
+}
+
+/**
+ *@details
+ */
+WorkerPoolTest::~WorkerPoolTest()
+{
+}
+
+void WorkerPoolTest::setUp()
+{
+}
+
+void WorkerPoolTest::tearDown()
+{
+}
+
+namespace {
+void count( int* n, unsigned long sleep ) {
+    if( sleep ) QThread::usleep( sleep );
+    __sync_fetch_and_add( n, 1 );
+}
+void fail() {
+    throw QString("task failed");
+}
+}
+
+void WorkerPoolTest::test_run()
+{
+    // every task runs, including those queued when the pool goes,
+    // and one failing does not stop the others
+    int n = 0;
+    {
+        WorkerPool pool( "WorkerPoolTest.run", 2, 100 );
+        CPPUNIT_ASSERT_EQUAL( 2U, pool.threads() );
+        pool.submit( &fail );
+        for( int i = 0; i < 50; ++i ) {
+            pool.submit( boost::bind( &count, &n, 1000 ) );
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL( 50, n );
+    CPPUNIT_ASSERT_EQUAL( (quint64)1,
+            MetricsRegistry::instance().counter("WorkerPoolTest.run.errors").value() );
+}
+
+void WorkerPoolTest::test_queueFull()
+{
+    // submit() waits for room rather than queueing without bound
+    int n = 0;
+    MetricCounter& blocked = MetricsRegistry::instance().counter("WorkerPoolTest.queueFull.blocked");
+    MetricGauge& queued = MetricsRegistry::instance().gauge("WorkerPoolTest.queueFull.queued");
+    {
+        WorkerPool pool( "WorkerPoolTest.queueFull", 1, 2, QThread::IdlePriority );
+        for( int i = 0; i < 6; ++i ) {
+            pool.submit( boost::bind( &count, &n, 10000 ) );
+            CPPUNIT_ASSERT( pool.queued() <= 2 );
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL( 6, n );
+    CPPUNIT_ASSERT( blocked.value() > 0 );
+    CPPUNIT_ASSERT( queued.max() <= 2 );
+    CPPUNIT_ASSERT( WorkerPool::priority("idle") == QThread::IdlePriority );
+    CPPUNIT_ASSERT( WorkerPool::priority("unknown") == QThread::LowPriority );
+}
+
+namespace {
+void slowTask( int* n, int ms ) {
+    count( n, ms * 1000 );
+}
+}
+
+void WorkerPoolTest::test_chain()
+{
+    // a ProcessingChain1 runs its tasks, then its post tasks, on the pool
+    int tasks = 0, posts = 0;
+    WorkerPool pool( "WorkerPoolTest.chain", 1, 4 );
+    {
+        ProcessingChain1<int> chain( "WorkerPoolTest.chain" );
+        chain.setPool( &pool );
+        QList<boost::function1<void, int> > parallel;
+        parallel << boost::bind( &slowTask, &tasks, _1 ) << boost::bind( &slowTask, &tasks, _1 );
+        QList<boost::function0<void> > post;
+        post << boost::bind( &count, &posts, 0 );
+        for( int i = 0; i < 5; ++i ) {
+            chain.exec( parallel, post, 5 );
+        }
+        CPPUNIT_ASSERT( chain.waitTaskCompletion() );
+    }
+    CPPUNIT_ASSERT_EQUAL( 10, tasks );
+    CPPUNIT_ASSERT_EQUAL( 5, posts );
+}
+
+namespace {
+void niceValue( int* nice ) {
+    *nice = getpriority( PRIO_PROCESS, syscall(SYS_gettid) );
+}
+}
+
+void WorkerPoolTest::test_nice()
+{
+    // the workers of a low priority pool run at a higher nice value than
+    // the thread creating it, and those of a normal one at the same
+    int own = 0;
+    niceValue( &own );
+    int nice[3] = { -100, -100, -100 };
+    QThread::Priority priorities[3] = { QThread::NormalPriority,
+            QThread::LowPriority, QThread::IdlePriority };
+    for( int i = 0; i < 3; ++i ) {
+        WorkerPool pool( "WorkerPoolTest.nice", 1, 1, priorities[i] );
+        pool.submit( boost::bind( &niceValue, &nice[i] ) );
+    }
+    CPPUNIT_ASSERT_EQUAL( own, nice[0] );
+    CPPUNIT_ASSERT_EQUAL( qMin( own + 10, 19 ), nice[1] );
+    CPPUNIT_ASSERT_EQUAL( 19, nice[2] );
+}
+
+} // namespace ampp
+} // namespace pelican
@@ -7,41 +7,42 @@
 #include <sys/time.h>
 #include "TimerData.h"
 
+/**
+ * @file timer.h
+ *
+ * Hot path timers, always compiled in and switched on at run time with
+ * MetricProfile::setEnabled() or the environment variable AMPP_PROFILE.
+ * While profiling is off timerStart() and timerUpdate() only test a flag
+ * and timerReport() prints nothing.
+ *
+ * The stages of a pipeline start their timers with stageTimerStart()
+ * instead, so that the histograms of those timers are always kept.
+ */
+
 namespace pelican {
 namespace ampp {
 
-#ifdef TIMING_ENABLED
 static inline void timerReport(TimerData* data, const char* message)
 {
-    data->report(message);
+    if( data->counter ) data->report(message);
 }
-#else
-#define timerReport(TimerData, char)
-#endif
 
-#ifdef TIMING_ENABLED
 #define DEFINE_TIMER(t) TimerData t;
-#else
-#define DEFINE_TIMER(t) 
-#endif
 
-#ifdef TIMING_ENABLED
 static inline void timerStart(TimerData* data)
+{
+    if( MetricProfile::enabled() ) data->tick();
+}
+
+static inline void stageTimerStart(TimerData* data)
 {
     data->tick();
 }
-#else
-#define timerStart(TimerData)
-#endif
 
-#ifdef TIMING_ENABLED
 static inline void timerUpdate(TimerData* data)
 {
     data->tock();
 }
-#else
-#define timerUpdate(TimerData)
-#endif
 
 } // end pelican-lofar namespace
 } // end pelican
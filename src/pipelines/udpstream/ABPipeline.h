@@ -7,9 +7,9 @@
 #include "DedispersionAnalyser.h"
 #include "WeightedSpectrumDataSet.h"
 #include "StokesIntegrator.h"
-#ifdef TIMING_ENABLED
+#include "StageGraph.h"
+#include "RealTimeWatchdog.h"
 #include "timer.h"
-#endif
 
 namespace pelican {
 namespace ampp {
@@ -35,6 +35,12 @@ class ABPipeline : public AbstractPipeline
     protected:
         void dedispersionAnalysis( DataBlob* data );
 
+        /// stages run on the weighted stokes, each in its own thread
+        void rfiClip( DataBlob* weighted );
+        void dedisperse( DataBlob* weighted );
+        void release( DataBlob* weighted );
+        void stageFailed( DataBlob* weighted, const QString& stage );
+
     private:
         QString _streamIdentifier;
 
@@ -44,10 +50,18 @@ class ABPipeline : public AbstractPipeline
         DedispersionAnalyser* _dedispersionAnalyser;
         StokesIntegrator* _stokesIntegrator;
 
+        // RFI clipping and dedispersion of chunk N overlap the
+        // integration of chunk N+1
+        StageGraph* _stages;
+
+        // sheds load when run() keeps falling behind real time
+        RealTimeWatchdog* _watchdog;
+
         // Local data blob pointers.
         QList<SpectrumDataSetStokes*> _stokesData;
         LockingPtrContainer<SpectrumDataSetStokes>* _stokesBuffer;
-        WeightedSpectrumDataSet* _weightedIntStokes;
+        QList<WeightedSpectrumDataSet*> _weightedData; // one per chunk in the stages
+        LockingPtrContainer<WeightedSpectrumDataSet>* _weightedBuffer;
 
         SpectrumDataSetStokes *_stokes;
         SpectrumDataSetStokes *_intStokes;
@@ -57,11 +71,12 @@ class ABPipeline : public AbstractPipeline
         unsigned int _minEventsFound;
         unsigned int _maxEventsFound;
 
-#ifdef TIMING_ENABLED
-        TimerData _rfiClipperTime;
-        TimerData _dedispersionTime;
+        // Per stage timings: histograms always, profiles while profiling
+        // is on, with run() against the real time budget of a chunk.
+        // (RFI_Clipper and dedispersion: ABPipeline.rfiClipper and
+        // ABPipeline.dedispersion, kept by the StageGraph)
+        TimerData _integratorTime;
         TimerData _totalTime;
-#endif
 };
 
 } // namespace ampp
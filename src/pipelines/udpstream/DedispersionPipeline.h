@@ -19,6 +19,8 @@
 #include "DedispersionAnalyser.h"
 #include "DedispersionDataAnalysisOutput.h"
 #include "timer.h"
+#include "RealTimeWatchdog.h"
+#include "Metrics.h"
 
 
 /**
@@ -67,6 +69,9 @@ class DedispersionPipeline : public AbstractPipeline
         DedispersionModule* _dedispersionModule;
         DedispersionAnalyser* _dedispersionAnalyser;
 
+        /// Sheds load when run() keeps falling behind real time
+        RealTimeWatchdog* _watchdog;
+
         /// Local data blobs
 	SpectrumDataSetC32* _spectra;
         QList<SpectrumDataSetC32*> _spectraBuffer;
@@ -79,19 +84,25 @@ class DedispersionPipeline : public AbstractPipeline
         LockingPtrContainer<SpectrumDataSetC32>* _rawBuffer;
         WeightedSpectrumDataSet* _weightedIntStokes;
 
-#ifdef TIMING_ENABLED
-        // Timers.
+        // Per stage timings: histograms always, profiles while profiling
+        // is on, with run() against the real time budget of a chunk.
         TimerData _ppfTime;
         TimerData _stokesTime;
         TimerData _integratorTime;
         TimerData _dedispersionTime;
         TimerData _totalTime;
         TimerData _rfiClipperTime;
-#endif
+        // The analysis runs on several threads at once, so it is timed
+        // through these by a timer local to each call.
+        MetricHistogram& _analysisTime;
+        MetricProfile& _analysisProfile;
 
         unsigned _iteration;
 	unsigned int _minEventsFound;
 	unsigned int _maxEventsFound;
+
+        // Free stokes buffers.
+        MetricGauge& _stokesBuffersFree;
 };
 
 } // namespace ampp
@@ -7,6 +7,10 @@
 #include "DedispersionAnalyser.h"
 #include "WeightedSpectrumDataSet.h"
 #include "StokesIntegrator.h"
+#include "StageGraph.h"
+#include "RealTimeWatchdog.h"
+#include "Metrics.h"
+#include "timer.h"
 
 namespace pelican {
 namespace ampp {
@@ -32,6 +36,12 @@ class K7Pipeline : public AbstractPipeline
     protected:
         void dedispersionAnalysis( DataBlob* data );
 
+        // Stages run on the weighted stokes, each in its own thread.
+        void rfiClip( DataBlob* weighted );
+        void dedisperse( DataBlob* weighted );
+        void release( DataBlob* weighted );
+        void stageFailed( DataBlob* weighted, const QString& stage );
+
     private:
         QString _streamIdentifier;
 
@@ -41,10 +51,18 @@ class K7Pipeline : public AbstractPipeline
         DedispersionAnalyser* _dedispersionAnalyser;
         StokesIntegrator* _stokesIntegrator;
 
+        // RFI clipping and dedispersion of chunk N overlap the
+        // integration of chunk N+1.
+        StageGraph* _stages;
+
+        // Sheds load when run() keeps falling behind real time.
+        RealTimeWatchdog* _watchdog;
+
         // Local data blob pointers.
         QList<SpectrumDataSetStokes*> _stokesData;
         LockingPtrContainer<SpectrumDataSetStokes>* _stokesBuffer;
-        WeightedSpectrumDataSet* _weightedIntStokes;
+        QList<WeightedSpectrumDataSet*> _weightedData; // one per chunk in the stages
+        LockingPtrContainer<WeightedSpectrumDataSet>* _weightedBuffer;
 
         SpectrumDataSetStokes *_stokes;
         SpectrumDataSetStokes *_intStokes;
@@ -52,6 +70,21 @@ class K7Pipeline : public AbstractPipeline
         unsigned long int _iteration;
         unsigned int _minEventsFound;
         unsigned int _maxEventsFound;
+
+        // Per stage timings: histograms always, profiles while profiling
+        // is on, with run() against the real time budget of a chunk.
+        // (RFI_Clipper and dedispersion: K7Pipeline.rfiClipper and
+        // K7Pipeline.dedispersion, kept by the StageGraph)
+        TimerData _runTime;
+        TimerData _integratorTime;
+        TimerData _outputTime;
+        // The analysis runs on several threads at once, so it is timed
+        // through these by a timer local to each call.
+        MetricHistogram& _analysisTime;
+        MetricProfile& _analysisProfile;
+
+        // Free stokes buffers.
+        MetricGauge& _stokesBuffersFree;
 };
 
 } // namespace ampp
@@ -64,10 +64,8 @@ class UdpBFPipeline : public AbstractPipeline
         WeightedSpectrumDataSet* weightedIntStokes;
 
         unsigned _iteration;
-#ifdef TIMING_ENABLED
         TimerData _totalTime;
         TimerData _rfiClipperTime;
-#endif
 
 
 };
@@ -18,11 +18,17 @@ using namespace ampp;
 // The constructor. It is good practice to initialise any pointer
 // members to zero.
 ABPipeline::ABPipeline(const QString& streamIdentifier)
-    : AbstractPipeline(), _streamIdentifier(streamIdentifier)
+    : AbstractPipeline(), _streamIdentifier(streamIdentifier),
+      _integratorTime("ABPipeline.stokesIntegrator"),
+      _totalTime("ABPipeline.run")
 {
     _rfiClipper = 0;
     _dedispersionModule = 0;
     _dedispersionAnalyser = 0;
+    _stages = 0;
+    _watchdog = 0;
+    _stokesBuffer = 0;
+    _weightedBuffer = 0;
     _counter = 0;
 }
 
@@ -30,9 +36,17 @@ ABPipeline::ABPipeline(const QString& streamIdentifier)
 // any local DataBlob's created.
 ABPipeline::~ABPipeline()
 {
+    // finish the chunks in the stages before the modules go
+    delete _stages;
+    delete _watchdog;
     delete _dedispersionAnalyser;
     delete _dedispersionModule;
     delete _rfiClipper;
+    foreach( WeightedSpectrumDataSet* d, _weightedData ) {
+        delete d;
+    }
+    delete _weightedBuffer;
+    delete _stokesBuffer;
 }
 
 // Initialises the pipeline, creating required modules and data blobs,
@@ -56,7 +70,31 @@ void ABPipeline::init()
     _stokesData = createBlobs<SpectrumDataSetStokes>("SpectrumDataSetStokes", history);
     _stokesBuffer = new LockingPtrContainer<SpectrumDataSetStokes>(&_stokesData);
     _intStokes = (SpectrumDataSetStokes *) createBlob("SpectrumDataSetStokes");
-    _weightedIntStokes = (WeightedSpectrumDataSet*) createBlob("WeightedSpectrumDataSet");
+
+    // RFI clipping and dedispersion each on their own thread, e.g.
+    //    <stages async="true"/>
+    //    <stage name="rfiClipper" queueDepth="4"/>
+    //    <stage name="dedispersion" queueDepth="4"/>
+    // Both modules are stateful, so keep them to one thread each.
+    _stages = new StageGraph("ABPipeline");
+    _stages->addStage( "rfiClipper", boost::bind( &ABPipeline::rfiClip, this, _1 ) );
+    _stages->addStage( "dedispersion", boost::bind( &ABPipeline::dedisperse, this, _1 ) );
+    _stages->configure( c );
+    _stages->onCompletion( boost::bind( &ABPipeline::release, this, _1 ) );
+    _stages->onFailure( boost::bind( &ABPipeline::stageFailed, this, _1, _2 ) );
+
+    // Shed load when falling behind real time, in this order by default, e.g.
+    //    <watchdog enable="true" overload="2" sustain="10" recover="100"/>
+    //    <shed policy="boxcars"/>
+    //    <shed policy="dmTrials"/>
+    _watchdog = new RealTimeWatchdog("ABPipeline.watchdog");
+    _watchdog->addPolicy( "boxcars", boost::bind( &DedispersionAnalyser::shedWideBoxcars, _dedispersionAnalyser, _1 ) );
+    _watchdog->addPolicy( "dmTrials", boost::bind( &DedispersionModule::shedDMTrials, _dedispersionModule, _1 ) );
+    _watchdog->configure( c );
+
+    // one for each chunk the stages can hold, and one being filled
+    _weightedData = createBlobs<WeightedSpectrumDataSet>("WeightedSpectrumDataSet", _stages->capacity() + 1);
+    _weightedBuffer = new LockingPtrContainer<WeightedSpectrumDataSet>(&_weightedData);
 
     // Request remote data.
     requestRemoteData("SpectrumDataSetStokes");
@@ -65,9 +103,8 @@ void ABPipeline::init()
 // Defines a single iteration of the pipeline.
 void ABPipeline::run(QHash<QString, DataBlob*>& remoteData)
 {
-#ifdef TIMING_ENABLED
-    timerStart(&_totalTime);
-#endif
+    stageTimerStart(&_totalTime);
+    _watchdog->start();
     // Get pointers to the remote data blob(s) from the supplied hash.
     SpectrumDataSetStokes* stokes = (SpectrumDataSetStokes*) remoteData["SpectrumDataSetStokes"];
     if( !stokes ) throw(QString("No stokes!"));
@@ -75,48 +112,67 @@ void ABPipeline::run(QHash<QString, DataBlob*>& remoteData)
        buffer, copy data to one */
     SpectrumDataSetStokes* stokesBuf = _stokesBuffer->next();
 
+    stageTimerStart(&_integratorTime);
     _stokesIntegrator->run(stokes, _intStokes);
+    timerUpdate(&_integratorTime);
     *stokesBuf = *_intStokes;
-    _weightedIntStokes->reset(stokesBuf);
-#ifdef TIMING_ENABLED
-    timerStart(&_rfiClipperTime);
-#endif
-    _rfiClipper->run(_weightedIntStokes);
-#ifdef TIMING_ENABLED
-    timerUpdate(&_rfiClipperTime);
-#endif
-#ifdef TIMING_ENABLED
-    timerStart(&_dedispersionTime);
-#endif
-    _dedispersionModule->dedisperse(_weightedIntStokes);
-#ifdef TIMING_ENABLED
-    timerUpdate(&_dedispersionTime);
-#endif
+    WeightedSpectrumDataSet* weightedStokes = _weightedBuffer->next();
+    weightedStokes->reset(stokesBuf);
+    // RFI clipping and dedispersion carry on after we return
+    _stages->push(weightedStokes);
     if (0 == _counter % 100)
     {
         std::cout << _counter << " chunks processed." << std::endl;
     }
-#ifdef TIMING_ENABLED
     timerUpdate(&_totalTime);
-    if (0 == _counter % 1000)
+    // run(), and each stage, has the time the chunk covers to keep up
+    double budget = _intStokes->getBlockRate() * _intStokes->nTimeBlocks();
+    _watchdog->stop(budget);
+    if (MetricProfile::enabled())
     {
-        timerReport(&ABDataAdapter::_adapterTime, "Adapter Time");
-        timerReport(&_rfiClipperTime, "RFI_Clipper");
-        timerReport(&_dedispersionTime, "DedispersionModule");
-
-        timerReport(&_totalTime, "Pipeline Time (excluding adapter)");
-        std::cout << endl;
-        std::cout << "Total (average) allowed time per iteration = " << stokesBuf->getBlockRate() * stokesBuf->nTimeBlocks() << " sec" << "\n";
-        std::cout << "Total (average) actual time per iteration = "
-                  << ABDataAdapter::_adapterTime.timeAverage +
-                  _totalTime.timeAverage << " sec" << "\n";
-        std::cout << std::endl;
+        _totalTime.profile()->setBudget(budget);
+        _stages->setBudget(budget);
+        if (0 == _counter % 1000)
+        {
+            timerReport(&ABDataAdapter::_adapterTime, "Adapter Time");
+            timerReport(&_integratorTime, "Stokes Integrator");
+
+            timerReport(&_totalTime, "Pipeline Time (excluding adapter)");
+            std::cout << std::endl;
+            std::cout << "Total (average) allowed time per iteration = " << budget << " sec" << "\n";
+            std::cout << "Total (average) actual time per iteration = "
+                      << ABDataAdapter::_adapterTime.timeAverage +
+                      _totalTime.timeAverage << " sec" << "\n";
+            std::cout << std::endl;
+        }
     }
-#endif
 
     _counter++;
 }
 
+void ABPipeline::rfiClip( DataBlob* weighted ) {
+    _rfiClipper->run( static_cast<WeightedSpectrumDataSet*>(weighted) );
+}
+
+void ABPipeline::dedisperse( DataBlob* weighted ) {
+    _dedispersionModule->dedisperse( static_cast<WeightedSpectrumDataSet*>(weighted) );
+}
+
+void ABPipeline::release( DataBlob* weighted ) {
+    // the dedispersion module has copied the data (and keeps the stokes
+    // buffer locked for as long as it needs it)
+    _weightedBuffer->unlock( static_cast<WeightedSpectrumDataSet*>(weighted) );
+}
+
+void ABPipeline::stageFailed( DataBlob* weighted, const QString& stage ) {
+    // a chunk that never reached the dedispersion module is not locked by
+    // it, so give its stokes buffer back here
+    if( stage == "rfiClipper" ) {
+        WeightedSpectrumDataSet* w = static_cast<WeightedSpectrumDataSet*>(weighted);
+        _stokesBuffer->unlock( static_cast<SpectrumDataSetStokes*>(w->dataSet()) );
+    }
+}
+
 void ABPipeline::dedispersionAnalysis( DataBlob* blob ) {
     DedispersionDataAnalysis result;
     DedispersionSpectra* data = static_cast<DedispersionSpectra*>(blob);
@@ -16,22 +16,29 @@ namespace ampp {
  *@details DedispersionPipeline 
  */
 DedispersionPipeline::DedispersionPipeline( const QString& streamIdentifier )
-    : AbstractPipeline(), _streamIdentifier(streamIdentifier)
+    : AbstractPipeline(), _streamIdentifier(streamIdentifier),
+      _ppfTime("DedispersionPipeline.ppf"),
+      _stokesTime("DedispersionPipeline.stokesGenerator"),
+      _integratorTime("DedispersionPipeline.stokesIntegrator"),
+      _dedispersionTime("DedispersionPipeline.dedispersion"),
+      _totalTime("DedispersionPipeline.run"),
+      _rfiClipperTime("DedispersionPipeline.rfiClipper"),
+      _analysisTime(MetricsRegistry::instance().histogram("DedispersionPipeline.dedispersionAnalysis")),
+      _analysisProfile(MetricsRegistry::instance().profile("DedispersionPipeline.dedispersionAnalysis")),
+      _stokesBuffersFree(MetricsRegistry::instance().gauge("DedispersionPipeline.stokesBuffersFree"))
 {
   //     _spectra = 0;
      _stokesBuffer = 0;
      _rawBuffer = 0;
      _dedispersionModule = 0;
      _dedispersionAnalyser = 0;
+     _watchdog = 0;
      _ppfChanneliser = 0;
      _rfiClipper = 0;
      _stokesIntegrator = 0;
      _stokesGenerator = 0;
 
-    // Initialise timer data.
-#ifdef TIMING_ENABLED
     _iteration = 0;
-#endif // TIMING_ENABLED
 }
 
 /**
@@ -39,6 +46,7 @@ DedispersionPipeline::DedispersionPipeline( const QString& streamIdentifier )
  */
 DedispersionPipeline::~DedispersionPipeline()
 {
+    delete _watchdog;
     delete _dedispersionModule;
     delete _dedispersionAnalyser;
     delete _stokesBuffer;
@@ -79,6 +87,17 @@ void DedispersionPipeline::init()
     _dedispersionModule->connect( boost::bind( &DedispersionPipeline::dedispersionAnalysis, this, _1 ) );
     _dedispersionModule->unlockCallback( boost::bind( &DedispersionPipeline::updateBufferLock, this, _1 ) );
 
+    // Shed load when falling behind real time, in this order by default, e.g.
+    //    <watchdog enable="true" overload="2" sustain="10" recover="100"/>
+    //    <shed policy="stokesI"/>
+    //    <shed policy="boxcars"/>
+    //    <shed policy="dmTrials"/>
+    _watchdog = new RealTimeWatchdog("DedispersionPipeline.watchdog");
+    _watchdog->addPolicy( "stokesI", boost::bind( &StokesGenerator::setStokesIOnly, _stokesGenerator, _1 ) );
+    _watchdog->addPolicy( "boxcars", boost::bind( &DedispersionAnalyser::shedWideBoxcars, _dedispersionAnalyser, _1 ) );
+    _watchdog->addPolicy( "dmTrials", boost::bind( &DedispersionModule::shedDMTrials, _dedispersionModule, _1 ) );
+    _watchdog->configure( c );
+
     // Create local datablobs
     _spectra = (SpectrumDataSetC32*) createBlob("SpectrumDataSetC32");
     // Uncomment the next line for buffered raw data
@@ -95,7 +114,8 @@ void DedispersionPipeline::init()
 
 void DedispersionPipeline::run(QHash<QString, DataBlob*>& remoteData)
 {
-    timerStart(&_totalTime);
+    stageTimerStart(&_totalTime);
+    _watchdog->start();
 
     // Get pointer to the remote time series data blob.
     // This is a block of data containing a number of time series of length
@@ -107,7 +127,7 @@ void DedispersionPipeline::run(QHash<QString, DataBlob*>& remoteData)
     // Run the polyphase channeliser.
     // Generates spectra from a blocks of time series indexed by sub-band
     // and polarisation.
-    timerStart(&_ppfTime);
+    stageTimerStart(&_ppfTime);
 
     // In case you are using a raw buffer, uncomment the following 2 lines
     //    SpectrumDataSetC32* spectra=_rawBuffer->next();
@@ -119,8 +139,9 @@ void DedispersionPipeline::run(QHash<QString, DataBlob*>& remoteData)
     timerUpdate(&_ppfTime);
 
     // Convert spectra in X, Y polarisation into spectra with stokes parameters.
-    timerStart(&_stokesTime);
+    stageTimerStart(&_stokesTime);
     SpectrumDataSetStokes* stokes=_stokesBuffer->next();
+    _stokesBuffersFree.set(_stokesBuffer->numberAvailable());
     _stokesGenerator->run(_spectra, stokes);
     //    std::cout << "PIPELINE: Stokes" << std::endl;
 
@@ -135,42 +156,48 @@ void DedispersionPipeline::run(QHash<QString, DataBlob*>& remoteData)
     //    std::cout << "PIPELINE: Weighted Stokes" << std::endl;
 
     // Clips RFI and modifies blob in place
-    timerStart(&_rfiClipperTime);
+    stageTimerStart(&_rfiClipperTime);
     _rfiClipper->run(_weightedIntStokes);
     //    std::cout << "PIPELINE: RFI done" << std::endl;
 
     //    dataOutput(&(_weightedIntStokes->stats()), "RFI_Stats");
     timerUpdate(&_rfiClipperTime);
 
-    timerStart(&_integratorTime);
+    stageTimerStart(&_integratorTime);
     //    _stokesIntegrator->run(stokes, _intStokes);
     //    dataOutput(_intStokes, "SpectrumDataSetStokes");
     timerUpdate(&_integratorTime);
 
     // start the asyncronous chain of events
-    timerStart(&_dedispersionTime);
+    stageTimerStart(&_dedispersionTime);
     _dedispersionModule->dedisperse( _weightedIntStokes );
     //    std::cout << "PIPELINE: Come out of dd" << std::endl;
     timerUpdate(&_dedispersionTime);
 
-#ifdef TIMING_ENABLED
     timerUpdate(&_totalTime);
-    if( ++_iteration%(_dedispersionModule->numberOfSamples()/(stokes->nTimeBlocks())) == 0 ) {
-        timerReport(&AdapterTimeSeriesDataSet::adapterTime, "Adapter Time");
-        timerReport(&_ppfTime, "Polyphase Filter");
-        timerReport(&_stokesTime, "Stokes Generator");
-        timerReport(&_rfiClipperTime, "RFI_Clipper");
-        timerReport(&_integratorTime, "Stokes Integrator");
-        timerReport(&_dedispersionTime, "DedispersionModule");
-        timerReport(&_totalTime, "Pipeline Time (excluding adapter)");
-        std::cout << endl;
-        std::cout << "Total (average) allowed time per iteration = "
-            << timeSeries->getBlockRate() << " sec" << "\n";
-        std::cout << "Total (average) actual time per iteration = "
-            << AdapterTimeSeriesDataSet::adapterTime.timeAverage + _totalTime.timeAverage << " sec" << "\n";
-        std::cout << std::endl;
+    ++_iteration;
+    // the block rate of the time series is that of its samples
+    double budget = timeSeries->getBlockRate() * timeSeries->nTimeBlocks()
+                    * timeSeries->nTimesPerBlock();
+    _watchdog->stop(budget);
+    if( MetricProfile::enabled() ) {
+        _totalTime.profile()->setBudget(budget);
+        if( _iteration%(_dedispersionModule->numberOfSamples()/(stokes->nTimeBlocks())) == 0 ) {
+            timerReport(&AdapterTimeSeriesDataSet::adapterTime, "Adapter Time");
+            timerReport(&_ppfTime, "Polyphase Filter");
+            timerReport(&_stokesTime, "Stokes Generator");
+            timerReport(&_rfiClipperTime, "RFI_Clipper");
+            timerReport(&_integratorTime, "Stokes Integrator");
+            timerReport(&_dedispersionTime, "DedispersionModule");
+            timerReport(&_totalTime, "Pipeline Time (excluding adapter)");
+            std::cout << std::endl;
+            std::cout << "Total (average) allowed time per iteration = "
+                << budget << " sec" << "\n";
+            std::cout << "Total (average) actual time per iteration = "
+                << AdapterTimeSeriesDataSet::adapterTime.timeAverage + _totalTime.timeAverage << " sec" << "\n";
+            std::cout << std::endl;
+        }
     }
-#endif
 }
 
 void DedispersionPipeline::dedispersionAnalysis( DataBlob* blob ) {
@@ -178,7 +205,13 @@ void DedispersionPipeline::dedispersionAnalysis( DataBlob* blob ) {
 //  std::cout << "PIPELINE: in dd analysis" << std::endl;
     DedispersionDataAnalysis result;
     DedispersionSpectra* data = static_cast<DedispersionSpectra*>(blob);
-    if ( _dedispersionAnalyser->analyse(data, &result) )
+    bool found;
+    {
+        MetricTimer timer(_analysisTime);
+        ProfileTimer profile(_analysisProfile);
+        found = _dedispersionAnalyser->analyse(data, &result);
+    }
+    if ( found )
       {
         std::cout << "Found " << result.eventsFound() << " events" << std::endl;
         std::cout << "Limits: " << _minEventsFound << " " << _maxEventsFound << " events" << std::endl;
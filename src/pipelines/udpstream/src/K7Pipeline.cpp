@@ -16,18 +16,31 @@ namespace pelican {
 namespace ampp {
 
 // The constructor. It is good practice to initialise any pointer members to zero.
-K7Pipeline::K7Pipeline(const QString& streamIdentifier) : AbstractPipeline(), _streamIdentifier(streamIdentifier)
+K7Pipeline::K7Pipeline(const QString& streamIdentifier) : AbstractPipeline(), _streamIdentifier(streamIdentifier),
+    _runTime("K7Pipeline.run"),
+    _integratorTime("K7Pipeline.stokesIntegrator"),
+    _outputTime("K7Pipeline.output"),
+    _analysisTime(MetricsRegistry::instance().histogram("K7Pipeline.dedispersionAnalysis")),
+    _analysisProfile(MetricsRegistry::instance().profile("K7Pipeline.dedispersionAnalysis")),
+    _stokesBuffersFree(MetricsRegistry::instance().gauge("K7Pipeline.stokesBuffersFree"))
 {
     _rfiClipper = 0;
     _stokesIntegrator = 0;
     _dedispersionModule = 0;
     _dedispersionAnalyser = 0;
+    _stages = 0;
+    _watchdog = 0;
+    _stokesBuffer = 0;
+    _weightedBuffer = 0;
     _iteration = 0;
 }
 
 // The destructor must clean up and created modules and any local dataBlob's created.
 K7Pipeline::~K7Pipeline()
 {
+    // finish the chunks in the stages before the modules go
+    delete _stages;
+    delete _watchdog;
     delete _rfiClipper;
     delete _stokesIntegrator;
     delete _dedispersionModule;
@@ -36,6 +49,12 @@ K7Pipeline::~K7Pipeline()
     {
         delete d;
     }
+    foreach ( WeightedSpectrumDataSet* d, _weightedData )
+    {
+        delete d;
+    }
+    delete _weightedBuffer;
+    delete _stokesBuffer;
 }
 
 // Initialises the pipeline, creating required modules and data blobs, and requesting remote data.
@@ -56,17 +75,44 @@ void K7Pipeline::init()
     _stokesBuffer = new LockingPtrContainer<SpectrumDataSetStokes>(&_stokesData);
     _intStokes = (SpectrumDataSetStokes *) createBlob("SpectrumDataSetStokes");
     _stokesIntegrator = (StokesIntegrator *) createModule("StokesIntegrator");
-    _weightedIntStokes = (WeightedSpectrumDataSet*) createBlob("WeightedSpectrumDataSet");
     _rfiClipper = (RFI_Clipper *) createModule("RFI_Clipper");
     _dedispersionModule = (DedispersionModule*) createModule("DedispersionModule");
     _dedispersionAnalyser = (DedispersionAnalyser*) createModule("DedispersionAnalyser");
     _dedispersionModule->connect( boost::bind( &K7Pipeline::dedispersionAnalysis, this, _1 ) );
     _dedispersionModule->unlockCallback( boost::bind( &K7Pipeline::updateBufferLock, this, _1 ) );
+
+    // RFI clipping and dedispersion each on their own thread, e.g.
+    //    <stages async="true"/>
+    //    <stage name="rfiClipper" queueDepth="4"/>
+    //    <stage name="dedispersion" queueDepth="4"/>
+    // Both modules are stateful, so keep them to one thread each.
+    _stages = new StageGraph("K7Pipeline");
+    _stages->addStage( "rfiClipper", boost::bind( &K7Pipeline::rfiClip, this, _1 ) );
+    _stages->addStage( "dedispersion", boost::bind( &K7Pipeline::dedisperse, this, _1 ) );
+    _stages->configure( c );
+    _stages->onCompletion( boost::bind( &K7Pipeline::release, this, _1 ) );
+    _stages->onFailure( boost::bind( &K7Pipeline::stageFailed, this, _1, _2 ) );
+
+    // Shed load when falling behind real time, in this order by default, e.g.
+    //    <watchdog enable="true" overload="2" sustain="10" recover="100"/>
+    //    <shed policy="boxcars"/>
+    //    <shed policy="dmTrials"/>
+    _watchdog = new RealTimeWatchdog("K7Pipeline.watchdog");
+    _watchdog->addPolicy( "boxcars", boost::bind( &DedispersionAnalyser::shedWideBoxcars, _dedispersionAnalyser, _1 ) );
+    _watchdog->addPolicy( "dmTrials", boost::bind( &DedispersionModule::shedDMTrials, _dedispersionModule, _1 ) );
+    _watchdog->configure( c );
+
+    // one for each chunk the stages can hold, and one being filled
+    _weightedData = createBlobs<WeightedSpectrumDataSet>("WeightedSpectrumDataSet", _stages->capacity() + 1);
+    _weightedBuffer = new LockingPtrContainer<WeightedSpectrumDataSet>(&_weightedData);
 }
 
 // Defines a single iteration of the pipeline.
 void K7Pipeline::run(QHash<QString, DataBlob*>& remoteData)
 {
+    stageTimerStart(&_runTime);
+    _watchdog->start();
+
     // Get pointers to the remote data blob(s) from the supplied hash.
     SpectrumDataSetStokes* stokes = (SpectrumDataSetStokes*) remoteData["SpectrumDataSetStokes"];
     if ( !stokes )
@@ -75,26 +121,75 @@ void K7Pipeline::run(QHash<QString, DataBlob*>& remoteData)
     }
     // To make sure the dedispersion module reads data from a lockable ring buffer, copy data to one.
     SpectrumDataSetStokes* stokesBuf = _stokesBuffer->next();
+    _stokesBuffersFree.set(_stokesBuffer->numberAvailable());
 
+    stageTimerStart(&_integratorTime);
     _stokesIntegrator->run(stokes, _intStokes);
+    timerUpdate(&_integratorTime);
+    // run(), and each stage, has the time the chunk covers to keep up
+    double budget = _intStokes->getBlockRate() * _intStokes->nTimeBlocks();
+    if (MetricProfile::enabled())
+    {
+        _runTime.profile()->setBudget(budget);
+        _stages->setBudget(budget);
+    }
     *stokesBuf = *_intStokes;
-    _weightedIntStokes->reset(stokesBuf);
+    WeightedSpectrumDataSet* weightedStokes = _weightedBuffer->next();
+    weightedStokes->reset(stokesBuf);
 
+    stageTimerStart(&_outputTime);
     dataOutput(_intStokes, "SpectrumDataSetStokes");
-    _rfiClipper->run(_weightedIntStokes);
-    _dedispersionModule->dedisperse(_weightedIntStokes);
+    timerUpdate(&_outputTime);
+    // RFI clipping and dedispersion carry on after we return
+    _stages->push(weightedStokes);
     if (0 == _iteration % 100)
     {
         std::cout << "K7Pipeline::run(): Finished the dedispersion pipeline, iteration " << _iteration << std::endl;
     }
     _iteration++;
+    timerUpdate(&_runTime);
+    _watchdog->stop(budget);
+}
+
+void K7Pipeline::rfiClip(DataBlob* weighted)
+{
+    _rfiClipper->run(static_cast<WeightedSpectrumDataSet*>(weighted));
+}
+
+void K7Pipeline::dedisperse(DataBlob* weighted)
+{
+    _dedispersionModule->dedisperse(static_cast<WeightedSpectrumDataSet*>(weighted));
+}
+
+void K7Pipeline::release(DataBlob* weighted)
+{
+    // The dedispersion module has copied the data (and keeps the stokes
+    // buffer locked for as long as it needs it).
+    _weightedBuffer->unlock(static_cast<WeightedSpectrumDataSet*>(weighted));
+}
+
+void K7Pipeline::stageFailed(DataBlob* weighted, const QString& stage)
+{
+    // A chunk that never reached the dedispersion module is not locked by
+    // it, so give its stokes buffer back here.
+    if ( stage == "rfiClipper" )
+    {
+        WeightedSpectrumDataSet* w = static_cast<WeightedSpectrumDataSet*>(weighted);
+        _stokesBuffer->unlock(static_cast<SpectrumDataSetStokes*>(w->dataSet()));
+    }
 }
 
 void K7Pipeline::dedispersionAnalysis(DataBlob* blob)
 {
     DedispersionDataAnalysis result;
     DedispersionSpectra* data = static_cast<DedispersionSpectra*>(blob);
-    if ( _dedispersionAnalyser->analyse(data, &result) )
+    bool found;
+    {
+        MetricTimer timer(_analysisTime);
+        ProfileTimer profile(_analysisProfile);
+        found = _dedispersionAnalyser->analyse(data, &result);
+    }
+    if ( found )
     {
         std::cout << "K7Pipeline::dedispersionAnalysis(): Found " << result.eventsFound() << " events" << std::endl;
         std::cout << "K7Pipeline::dedispersionAnalysis(): Limits: " << _minEventsFound << " " << _maxEventsFound << " events" << std::endl;
@@ -13,9 +13,14 @@ namespace ampp {
 /**
  * @details
  */
-TimingPipeline::TimingPipeline() : AbstractPipeline()
+TimingPipeline::TimingPipeline() : AbstractPipeline(),
+    _ppfTime("TimingPipeline.ppf"), _stokesTime("TimingPipeline.stokesGenerator"),
+    _integratorTime("TimingPipeline.stokesIntegrator"), _outputTime("TimingPipeline.output"),
+    _totalTime("TimingPipeline.run"), _rfiClipper("TimingPipeline.rfiClipper")
 {
     _iteration = 0;
+    // timing is what this pipeline is for
+    MetricProfile::setEnabled(true);
 
 }
 
@@ -13,7 +13,8 @@ namespace ampp {
  * @details
  */
 UdpBFPipeline::UdpBFPipeline( const QString& streamIdentifier ) 
-    : AbstractPipeline(), _streamIdentifier(streamIdentifier)
+    : AbstractPipeline(), _streamIdentifier(streamIdentifier),
+      _totalTime("UdpBFPipeline.run"), _rfiClipperTime("UdpBFPipeline.rfiClipper")
 {
     _iteration = 0;
 }
@@ -102,15 +103,18 @@ void UdpBFPipeline::run(QHash<QString, DataBlob*>& remoteData)
      _iteration++;
 
      if (_iteration == _totalIterations) stop();
-     #ifdef TIMING_ENABLED
      timerUpdate(&_totalTime);
-     if( _iteration % 100 == 0 )
+     if( MetricProfile::enabled() )
        {
-         timerReport(&_rfiClipperTime, "RFI_Clipper");
-         timerReport(&_totalTime, "Pipeline Time (excluding adapter)");
-         std::cout << std::endl;
+         _totalTime.profile()->setBudget( timeSeries->getBlockRate()
+                 * timeSeries->nTimeBlocks() * timeSeries->nTimesPerBlock() );
+         if( _iteration % 100 == 0 )
+           {
+             timerReport(&_rfiClipperTime, "RFI_Clipper");
+             timerReport(&_totalTime, "Pipeline Time (excluding adapter)");
+             std::cout << std::endl;
+           }
        }
-#endif
 
 
 }
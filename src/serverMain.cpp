@@ -3,6 +3,7 @@
 #include "pelican/utility/Config.h"
 
 #include "LofarDataSplittingChunker.h"
+#include "SubbandSplittingChunker.h"
 //#include "LofarChunker.h"
 
 #include <QtGui/QApplication>
@@ -16,16 +17,17 @@ using std::cerr;
 using std::endl;
 
 // Prototype for function to create a pelican configuration XML object.
-pelican::Config createConfig(int argc, char** argv);
+pelican::Config createConfig(int argc, char** argv, QString& chunker);
 
 int main(int argc, char** argv)
 {
     QCoreApplication app(argc, argv);
 
     try {
-        pelican::Config config = createConfig(argc, argv);
+        QString chunker;
+        pelican::Config config = createConfig(argc, argv, chunker);
         pelican::PelicanServer server(&config);
-        server.addStreamChunker("LofarDataSplittingChunker");
+        server.addStreamChunker(chunker);
 
         // Add the protocol.
         pelican::AbstractProtocol* protocol = new pelican::PelicanProtocol;
@@ -50,7 +52,7 @@ int main(int argc, char** argv)
  * @details
  * Create a Pelican Configuration XML document for the lofar data viewer.
  */
-pelican::Config createConfig(int argc, char** argv)
+pelican::Config createConfig(int argc, char** argv, QString& chunker)
 {
     // Check that argc and argv are nonzero
     if (argc == 0 || argv == NULL) throw QString("No command line.");
@@ -59,7 +61,10 @@ pelican::Config createConfig(int argc, char** argv)
     opts::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "Produce help message.")
-        ("config,c", opts::value<std::string>(), "Set configuration file.");
+        ("config,c", opts::value<std::string>(), "Set configuration file.")
+        ("chunker", opts::value<std::string>()->default_value("LofarDataSplittingChunker"),
+         "Chunker to split the stream (LofarDataSplittingChunker or "
+         "SubbandSplittingChunker for any number of streams).");
 
 
     // Configuration option without a selection flag in the first argument
@@ -79,6 +84,8 @@ pelican::Config createConfig(int argc, char** argv)
         exit(0);
     }
 
+    chunker = QString(varMap["chunker"].as<std::string>().c_str());
+
     // Get the configuration file name.
     std::string configFilename = "";
     if (varMap.count("config"))